@@ -1,7 +1,6 @@
 # app.py
 from __future__ import annotations
 import os, time, json, threading
-import serial
 from typing import Dict, Any, Optional, List, Set
 from pathlib import Path
 
@@ -11,6 +10,8 @@ from flask_sock import Sock
 from dotenv import load_dotenv
 
 from external import get_context  
+import gorilla
+import lzss
 
 def log(msg: str) -> None:
     print(time.strftime("[%H:%M:%S] "), msg, flush=True)
@@ -24,36 +25,39 @@ def _f(v):
 
 load_dotenv(dotenv_path=Path(__file__).with_name(".env"), override=False)
 
-SERIAL_PORT = os.getenv("SERIAL_PORT")
-SERIAL_BAUD = int(os.getenv("SERIAL_BAUD", "115200"))
-
-_ser = None
-def serial_open():
-    global _ser
-    if _ser and _ser.is_open:
-        return _ser
-    if not SERIAL_PORT:
-        return None
-    try:
-        _ser = serial.Serial(SERIAL_PORT, SERIAL_BAUD, timeout=0.5)
-        time.sleep(0.2)
-        return _ser
-    except Exception as e:
-        log(f"serial open error: {e}")
-        _ser = None
-        return None
-
-def send_serial_json(obj):
-    ser = serial_open()
-    if not ser:
-        return False
-    try:
-        raw = (json.dumps(obj, ensure_ascii=False) + "\n").encode("utf-8")
-        ser.write(raw); ser.flush()
-        return True
-    except Exception as e:
-        log(f"serial write error: {e}")
-        return False
+# Control commands reach the device through ingest_serial.py, the only
+# process that opens the tty: it long-polls GET /device/ctrl/next, writes
+# each command and posts the device's {"ack":...} to POST /device/ctrl/ack.
+CTRL_ACK_TIMEOUT_S = float(os.getenv("CTRL_ACK_TIMEOUT_S", "0.3"))
+CTRL_RELAY_STALE_S = 30.0          # no poll for this long: no relay attached
+CTRL_POLL_MAX_S = 20.0
+_ctrl_id = 0
+_ctrl_lock = threading.Lock()       # one command in flight
+_ctrl_cv = threading.Condition()
+_ctrl_out: List[Dict[str, Any]] = []
+_ctrl_acks: Dict[int, Dict[str, Any]] = {}
+_ctrl_relay_seen = 0.0
+
+def ctrl_relay_send(cmd: Dict[str, Any]) -> bool:
+    """Queues cmd for the relay; False when no relay is polling."""
+    with _ctrl_cv:
+        if time.monotonic() - _ctrl_relay_seen > CTRL_RELAY_STALE_S:
+            return False
+        _ctrl_acks.pop(cmd["id"], None)
+        _ctrl_out.append(cmd)
+        _ctrl_cv.notify_all()
+    return True
+
+def ctrl_relay_ack(cid: int, timeout: float) -> Optional[Dict[str, Any]]:
+    """Waits for the device's ack of command cid, relayed by ingest_serial.py."""
+    deadline = time.monotonic() + timeout
+    with _ctrl_cv:
+        while cid not in _ctrl_acks:
+            left = deadline - time.monotonic()
+            if left <= 0:
+                return None
+            _ctrl_cv.wait(left)
+        return _ctrl_acks.pop(cid)
 
 PORT = int(os.getenv("PORT", "5050"))
 DEFAULT_CITY = os.getenv("DEFAULT_CITY", "Madrid")
@@ -69,6 +73,11 @@ last_profile: Optional[Dict[str, Any]] = None
 last_recommendation: Optional[Dict[str, Any]] = None
 last_eco_tips: Optional[str] = None               
 last_reco_ts: float = 0.0
+ALERTS_KEEP = 50
+recent_alerts: List[Dict[str, Any]] = []          # newest last, deduped by id
+
+HISTORY_KEEP = 24 * 3600
+history_rows: List[Dict[str, Any]] = []           # 1 s rows from bulk uploads, oldest first
 
 ws_clients: Set = set()
 lock = threading.Lock()
@@ -159,6 +168,8 @@ def snapshot() -> Dict[str, Any]:
             "recommendation": last_recommendation or {},
             "reco": last_recommendation or {},
             "eco_tips": last_eco_tips or "",
+            "sun": (last_telemetry or {}).get("sun") or {},
+            "alerts": list(recent_alerts),
         }
 
 def ws_broadcast_state() -> None:
@@ -237,6 +248,7 @@ def last():
         "recommendation": rec,
         "reco": rec,
         "eco_tips": tips,
+        "sun": tel.get("sun") or {},
     })
 
 @app.post("/profile")
@@ -252,18 +264,55 @@ def save_profile():
     ws_broadcast_state()
     return jsonify({"ok": True})
 
+@app.after_request
+def advertise_encoding(resp):
+    # The device compresses its batches once it has seen this on a reply.
+    resp.headers["Accept-Encoding"] = lzss.ENCODING
+    return resp
+
+class _Unsupported(Exception):
+    pass
+
+def _request_json() -> Any:
+    """Request body as JSON, undoing Content-Encoding: x-soliris-lzss."""
+    enc = (request.headers.get("Content-Encoding") or "identity").strip().lower()
+    if enc == "identity":
+        return request.get_json(force=True, silent=True)
+    if enc != lzss.ENCODING:
+        raise _Unsupported(enc)
+    try:
+        return json.loads(lzss.decompress(request.get_data()))
+    except ValueError:
+        return None
+
 @app.post("/telemetry")
 @app.post("/api/telemetry")
 def ingest_telemetry():
-    """Receives telemetry (free JSON) and recalculates the reco if periodicity ok."""
+    """Receives telemetry (free JSON, or a batch of frames as an array) and
+    recalculates the reco if periodicity ok."""
     global last_telemetry, last_recommendation, last_reco_ts, last_eco_tips
-    data = request.get_json(force=True, silent=True) or {}
-    if not isinstance(data, dict):
-        data = {"raw": data}
-    data.setdefault("ts", int(time.time() * 1000))
-
+    try:
+        data = _request_json() or {}
+    except _Unsupported as e:
+        return jsonify({"ok": False, "error": f"unsupported Content-Encoding {e}"}), 415
+    frames = data if isinstance(data, list) else [data]
+    frames = [f if isinstance(f, dict) else {"raw": f} for f in frames] or [{}]
+    now_ms = int(time.time() * 1000)
+    # Batched frames carry their capture uptime; date them against the
+    # device uptime at send time when the device clock was not set yet.
+    dev_up = request.headers.get("X-Device-Uptime-Ms", type=int)
+    for f in frames:
+        if "ts" not in f and dev_up is not None and isinstance(f.get("up_ms"), int):
+            f["ts"] = now_ms - max(0, dev_up - f["up_ms"])
+        f.setdefault("ts", now_ms)
+    # Send-on-delta frames only carry the fields that moved: merge them
+    # into the last state, oldest first.
+    frames.sort(key=lambda f: f["ts"])
     with lock:
-        last_telemetry = data
+        merged = dict(last_telemetry or {})
+        for f in frames:
+            merged.update(f)
+        last_telemetry = merged
 
     now = time.time()
     if now - last_reco_ts >= MIN_RECO_PERIOD_SECONDS:
@@ -286,14 +335,113 @@ def ingest_telemetry():
 
     last_eco_tips = _mk_eco_tips(last_context or {}, last_recommendation or {})
     ws_broadcast_state()
-    return jsonify({"ok": True})
+    return jsonify({"ok": True, "frames": len(frames)})
+
+@app.post("/telemetry/batch")
+def ingest_history_batch():
+    """Compressed 1 s history uploaded after an outage (gorilla.py). Rows are
+    epoch seconds, or device uptime seconds (recorded before SNTP) rebased
+    via X-Device-Uptime-Ms. "ts_src" says which: "device", "uptime", or
+    "recv" when nothing dates them (ts is then the arrival time)."""
+    try:
+        b = gorilla.decode(request.get_data())
+    except ValueError as e:
+        return jsonify({"ok": False, "error": str(e)}), 400
+    now_ms = int(time.time() * 1000)
+    dev_up = request.headers.get("X-Device-Uptime-Ms", type=int)
+    for row in b["rows"]:
+        if b["epoch"]:
+            row["ts"], row["ts_src"] = row["t"] * 1000, "device"
+        elif dev_up is not None:
+            row["ts"], row["ts_src"] = now_ms - max(0, dev_up - row["t"] * 1000), "uptime"
+        else:
+            row["ts"], row["ts_src"] = now_ms, "recv"
+    with lock:
+        history_rows.extend(b["rows"])
+        history_rows.sort(key=lambda r: r["ts"])
+        del history_rows[:-HISTORY_KEEP]
+    log(f"history batch: {len(b['rows'])} rows in {request.content_length} bytes")
+    return jsonify({"ok": True, "rows": len(b["rows"])})
+
+@app.get("/history")
+def get_history():
+    since = request.args.get("since", default=0, type=int)
+    dated = request.args.get("dated", default=0, type=int)     # 1: drop rows dated on arrival
+    with lock:
+        rows = [r for r in history_rows if r["ts"] >= since and not (dated and r.get("ts_src") == "recv")]
+    return jsonify({"rows": rows})
+
+@app.post("/alert")
+def ingest_alert():
+    """Safety event from the device priority lane (Wi-Fi, or relayed from
+    serial/BLE). A 2xx is the ack: the device stops resending it."""
+    body = request.get_json(force=True, silent=True) or {}
+    a = body.get("alert") if isinstance(body, dict) else None
+    if not isinstance(a, dict) or not isinstance(a.get("id"), int):
+        return jsonify({"ok": False, "error": "expected {alert:{id,...}}"}), 400
+    now_ms = int(time.time() * 1000)
+    with lock:
+        if any(x.get("id") == a["id"] for x in recent_alerts):
+            return jsonify({"ok": True, "id": a["id"], "dup": True})
+        # Detection time: device clock when set, else its uptime offset.
+        up, sent = a.get("up_ms"), a.get("sent_up_ms")
+        if "ts" not in a and isinstance(up, int) and isinstance(sent, int):
+            a["ts"] = now_ms - max(0, sent - up)
+        a.setdefault("ts", now_ms)
+        a["recv_ts"] = now_ms
+        a["latency_ms"] = max(0, now_ms - a["ts"])
+        recent_alerts.append(a)
+        del recent_alerts[:-ALERTS_KEEP]
+    log(f"ALERT {a.get('kind')} #{a['id']} latency={a['latency_ms']} ms sends={a.get('sends')}")
+    ws_broadcast({"type": "alert", "alert": a})
+    ws_broadcast_state()
+    return jsonify({"ok": True, "id": a["id"]})
 
 @app.post("/device/ctrl")
 def device_ctrl():
+    global _ctrl_id
     data = request.get_json(force=True, silent=True) or {}
-    ok = send_serial_json(data)
-    log(f"/device/ctrl {data} -> serial={'ok' if ok else 'fail'}")
-    return jsonify({"ok": ok})
+    with _ctrl_lock:
+        if not isinstance(data.get("id"), int):
+            _ctrl_id = _ctrl_id % 0xFFFFFFFF + 1
+            data["id"] = _ctrl_id
+        t0 = time.perf_counter()
+        ok = ctrl_relay_send(data)
+        ack = ctrl_relay_ack(data["id"], CTRL_ACK_TIMEOUT_S) if ok else None
+        rtt_ms = round((time.perf_counter() - t0) * 1000, 1)
+    log(f"/device/ctrl {data} -> relay={'ok' if ok else 'none'} ack={ack} rtt={rtt_ms}ms")
+    return jsonify({"ok": ok, "ack": ack, "rtt_ms": rtt_ms if ack else None})
+
+@app.get("/device/ctrl/next")
+def device_ctrl_next():
+    """Relay side (ingest_serial.py): pending commands, waiting up to ?wait= s."""
+    global _ctrl_relay_seen
+    wait = min(max(request.args.get("wait", default=0.0, type=float), 0.0), CTRL_POLL_MAX_S)
+    deadline = time.monotonic() + wait
+    with _ctrl_cv:
+        _ctrl_relay_seen = time.monotonic()
+        while not _ctrl_out:
+            left = deadline - time.monotonic()
+            if left <= 0:
+                break
+            _ctrl_cv.wait(left)
+        cmds, _ctrl_out[:] = list(_ctrl_out), []
+        _ctrl_relay_seen = time.monotonic()
+    return jsonify({"cmds": cmds})
+
+@app.post("/device/ctrl/ack")
+def device_ctrl_ack():
+    """Relay side: the device's {"ack":{"id":...,"ok":...,"lat_us":...}}."""
+    body = request.get_json(force=True, silent=True) or {}
+    ack = body.get("ack") if isinstance(body, dict) else None
+    if not isinstance(ack, dict) or not isinstance(ack.get("id"), int):
+        return jsonify({"ok": False, "error": "expected {ack:{id,...}}"}), 400
+    with _ctrl_cv:
+        _ctrl_acks[ack["id"]] = ack
+        while len(_ctrl_acks) > 32:                # nobody waited for these
+            _ctrl_acks.pop(next(iter(_ctrl_acks)))
+        _ctrl_cv.notify_all()
+    return jsonify({"ok": True})
 
 
 def refresher():
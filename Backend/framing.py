@@ -0,0 +1,86 @@
+"""Reader for the device's framed serial stream (soliris-firmware/include/frame.h).
+
+    wire  : 0x00 COBS(frame) 0x00
+    frame : u8 chan | u8 type | u16 seq | u32 t_us | payload | crc32   (little endian)
+
+Plain text lines printed between frames (boot messages, firmware in text
+mode) are passed through as text.
+"""
+from __future__ import annotations
+
+import struct
+import zlib
+from dataclasses import dataclass
+
+CH_CAPTURE, CH_TELEM, CH_LOG = 1, 2, 3
+TEL_PART, TEL_LINE = 1, 2
+TLOG_RECORDS = 1
+MAX_WIRE = 8 + 512 + 4 + (8 + 512 + 4) // 254 + 3
+
+
+@dataclass
+class Frame:
+    chan: int
+    type: int
+    seq: int
+    t_us: int
+    payload: bytes
+
+
+def cobs_decode(data: bytes) -> bytes | None:
+    out, i = bytearray(), 0
+    while i < len(data):
+        code = data[i]
+        if not code or i + code > len(data):
+            return None
+        out += data[i + 1:i + code]
+        i += code
+        if code != 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def parse(body: bytes) -> Frame | None:
+    raw = cobs_decode(body)
+    if raw is None or len(raw) < 12:
+        return None
+    if zlib.crc32(raw[:-4]) != struct.unpack_from("<I", raw, len(raw) - 4)[0]:
+        return None
+    chan, typ, seq, t_us = struct.unpack_from("<BBHI", raw)
+    return Frame(chan, typ, seq, t_us, raw[8:-4])
+
+
+class Reader:
+    """feed() any split of the stream; yields Frame objects and text lines (str)."""
+
+    def __init__(self) -> None:
+        self.buf = bytearray()
+        self.text = bytearray()
+        self.crc_errors = 0
+
+    def _text(self, b: bytes):
+        self.text += b
+        while b"\n" in self.text:
+            line, _, rest = bytes(self.text).partition(b"\n")
+            self.text = bytearray(rest)
+            line = line.rstrip(b"\r").decode(errors="ignore")
+            if line:
+                yield line
+
+    def feed(self, data: bytes):
+        for b in data:
+            if b:
+                self.buf.append(b)
+                if len(self.buf) > MAX_WIRE:          # too long for a frame: text
+                    yield from self._text(bytes(self.buf))
+                    self.buf.clear()
+                continue
+            if self.buf:
+                f = parse(bytes(self.buf))
+                if f is not None:
+                    yield f
+                elif any(c < 9 or c == 0x7F for c in self.buf):
+                    self.crc_errors += 1
+                else:
+                    yield from self._text(bytes(self.buf))
+                self.buf.clear()
@@ -0,0 +1,111 @@
+"""Decoder for the device's compressed history batches
+(soliris-firmware/include/gorilla.h; host C++ twin: tools/gorilla/gor_check.cpp)."""
+from __future__ import annotations
+import struct
+from typing import Any, Dict, List
+
+F_EPOCH = 0x01
+
+
+class _Bits:
+    def __init__(self, b: bytes):
+        self.b, self.i = b, 0
+
+    def bit(self) -> int:
+        k = self.i >> 3
+        if k >= len(self.b):
+            raise ValueError("truncated batch")
+        v = (self.b[k] >> (7 - (self.i & 7))) & 1
+        self.i += 1
+        return v
+
+    def get(self, n: int) -> int:
+        v = 0
+        for _ in range(n):
+            v = (v << 1) | self.bit()
+        return v
+
+
+def _dod(r: _Bits) -> int:
+    if not r.bit():
+        return 0
+    if not r.bit():
+        return r.get(7) - 63
+    if not r.bit():
+        return r.get(9) - 255
+    if not r.bit():
+        return r.get(12) - 2047
+    v = r.get(32)
+    return v - (1 << 32) if v & 0x80000000 else v
+
+
+def _run(r: _Bits) -> int:
+    n = 0
+    while not r.bit():
+        n += 1
+        if n > 16:
+            raise ValueError("bad run length")
+    return (1 << n) | r.get(n)
+
+
+def decode(buf: bytes) -> Dict[str, Any]:
+    """{"epoch": bool, "cols": [...], "flags": [...], "t": [...], "rows": [{name: value}]};
+    missing values are None. Raises ValueError on a malformed batch."""
+    if len(buf) < 8 or buf[:2] != b"GR" or buf[2] != 1:
+        raise ValueError("not a v1 batch")
+    flags, ncols, nflags, nrows = buf[3], buf[4], buf[5], struct.unpack_from("<H", buf, 6)[0]
+    z = buf.find(b"\0", 8)
+    if z < 0:
+        raise ValueError("no column names")
+    names = buf[8:z].decode("ascii").split(",")
+    if len(names) != ncols + nflags:
+        raise ValueError("column count mismatch")
+    r = _Bits(buf[z + 1:])
+    ts: List[int] = []
+    if nrows:
+        t, d = r.get(32), 1
+        ts.append(t)
+        for _ in range(1, nrows):
+            d += _dod(r)
+            t = (t + d) & 0xFFFFFFFF
+            ts.append(t)
+    cols: List[List[Any]] = []
+    for _ in range(ncols if nrows else 0):
+        v = r.get(32)
+        lead, trail = -1, 0
+        vals = [v]
+        for _ in range(1, nrows):
+            if r.bit():
+                if r.bit():
+                    lead = r.get(5)
+                    n = r.get(5) + 1
+                    if lead + n > 32:
+                        raise ValueError("bad xor window")
+                    trail = 32 - lead - n
+                    v ^= r.get(n) << trail
+                else:
+                    if lead < 0:
+                        raise ValueError("xor window before first")
+                    v ^= r.get(32 - lead - trail) << trail
+            vals.append(v)
+        fl = [struct.unpack("<f", struct.pack("<I", x))[0] for x in vals]
+        cols.append([None if x != x else round(x, 4) for x in fl])
+    fcols: List[List[int]] = []
+    for _ in range(nflags if nrows else 0):
+        b, out = r.bit(), []
+        while len(out) < nrows:
+            n = _run(r)
+            if len(out) + n > nrows:
+                raise ValueError("flag runs overflow")
+            out += [b] * n
+            b ^= 1
+        fcols.append(out)
+    rows = []
+    for i in range(nrows):
+        row: Dict[str, Any] = {"t": ts[i]}
+        for c in range(ncols):
+            row[names[c]] = cols[c][i]
+        for f in range(nflags):
+            row[names[ncols + f]] = fcols[f][i]
+        rows.append(row)
+    return {"epoch": bool(flags & F_EPOCH), "cols": names[:ncols], "flags": names[ncols:], "t": ts, "rows": rows}
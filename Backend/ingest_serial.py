@@ -1,47 +1,131 @@
 # Backend/ingest_serial.py
-import argparse, json, time, requests, sys
+# Telemetry arrives as JSON lines on its own framed channel, device logs as
+# tokenized records on another (framing.py, tlog.py). Plain text lines are
+# still scanned for JSON, for firmware in {"log":"text"} mode or older builds.
+#
+# This is the only process that opens the tty: control commands from the API
+# (POST /device/ctrl) are long-polled from --ctrl_endpoint and written here,
+# and the device's {"ack":...} lines are posted back instead of being treated
+# as samples.
+import argparse, json, time, requests, sys, threading
 from serial import Serial
+import framing, tlog
 
 def main():
   p = argparse.ArgumentParser()
   p.add_argument("--port", required=True, help="ex: /dev/cu.usbmodem1101, COM5, /dev/ttyACM0")
   p.add_argument("--baud", type=int, default=115200)
-  p.add_argument("--endpoint", default="http://192.168.1.26:5050/recommend")  
+  p.add_argument("--endpoint", default="http://192.168.1.26:5050/recommend")
   p.add_argument("--min_interval", type=float, default=5.0, help="seconds between model calls")
+  p.add_argument("--alert_endpoint", default="http://192.168.1.26:5050/alert")
+  p.add_argument("--ctrl_endpoint", default="http://192.168.1.26:5050/device/ctrl",
+                 help="API control relay (empty: don't relay commands)")
+  p.add_argument("--tlog_defs", default=str(tlog.DEFS_PATH), help="firmware log dictionary (tlog_defs.h)")
+  p.add_argument("--no_logs", action="store_true", help="don't print device logs")
   args = p.parse_args()
 
   print(f"📟 Reading {args.port} @ {args.baud} → {args.endpoint}")
   last_call = 0.0
+  logs = tlog.Decoder(args.tlog_defs)
+  reader = framing.Reader()
+  tel_line, tel_seq, log_seq, log_dropped = b"", None, None, 0
 
   with Serial(args.port, args.baud, timeout=1) as ser:
-    while True:
-      try:
-        line = ser.readline()
-        if not line:
-          time.sleep(0.02); continue
-        s = line.decode(errors="ignore").strip()
-        if "{" not in s or "}" not in s:
-          continue
-        s = s[s.find("{"): s.rfind("}")+1]
+    wlock = threading.Lock()                            # ev_ack and ctrl writers
+
+    def ser_send(obj):
+      with wlock:
+        ser.write((json.dumps(obj, ensure_ascii=False) + "\n").encode())
+
+    def ctrl_relay():
+      while True:
         try:
-          sample = json.loads(s)
+          r = requests.get(args.ctrl_endpoint + "/next", params={"wait": 15}, timeout=20)
+          if not r.ok:
+            time.sleep(1); continue
+          for cmd in r.json().get("cmds") or []:
+            ser_send(cmd)
         except Exception:
-          continue
+          time.sleep(1)
 
-        now = time.time()
-        if now - last_call < args.min_interval:
-          
-          continue
+    if args.ctrl_endpoint:
+      threading.Thread(target=ctrl_relay, daemon=True).start()
 
-        last_call = now
-        r = requests.post(args.endpoint, json={"sample": sample}, timeout=10)
+    def handle_sample(sample):
+      nonlocal last_call
+      if isinstance(sample.get("ack"), dict):
+        if args.ctrl_endpoint:
+          try:
+            requests.post(args.ctrl_endpoint + "/ack", json=sample, timeout=2)
+          except Exception as e:
+            print("⚠️ ack relay", e)
+        return
+
+      # Safety events are relayed at once, whatever the rate limit, and
+      # acked back so the device stops resending them.
+      if isinstance(sample.get("alert"), dict):
+        r = requests.post(args.alert_endpoint, json=sample, timeout=5)
         if r.ok:
-          data = r.json()
-          rec = (data.get("recommendation") or {})
-          lvl = rec.get("risk_level")
-          print(f"✅ risk={lvl}  reasons={rec.get('reasons')}  actions={rec.get('actions')}")
+          ser_send({"ev_ack": sample["alert"].get("id")})
+          print(f"🚨 {sample['alert'].get('kind')} #{sample['alert'].get('id')} relayed")
         else:
-          print("⚠️ http", r.status_code, r.text[:200])
+          print("⚠️ alert http", r.status_code, r.text[:200])
+        return
+
+      now = time.time()
+      if now - last_call < args.min_interval:
+        return
+
+      last_call = now
+      r = requests.post(args.endpoint, json={"sample": sample}, timeout=10)
+      if r.ok:
+        data = r.json()
+        rec = (data.get("recommendation") or {})
+        lvl = rec.get("risk_level")
+        print(f"✅ risk={lvl}  reasons={rec.get('reasons')}  actions={rec.get('actions')}")
+      else:
+        print("⚠️ http", r.status_code, r.text[:200])
+
+    def handle_json(s):
+      try:
+        sample = json.loads(s)
+      except Exception:
+        return
+      if isinstance(sample, dict):
+        handle_sample(sample)
+
+    while True:
+      try:
+        data = ser.read(ser.in_waiting or 1)
+        if not data:
+          time.sleep(0.02); continue
+
+        for ev in reader.feed(data):
+          if isinstance(ev, str):                           # text: legacy JSON lines
+            if "{" in ev and "}" in ev:
+              handle_json(ev[ev.find("{"): ev.rfind("}")+1])
+            continue
+
+          if ev.chan == framing.CH_TELEM:
+            if tel_seq is not None and ev.seq != (tel_seq + 1) & 0xFFFF:
+              tel_line = b""                                # lost a piece of a long line
+            tel_seq = ev.seq
+            tel_line += ev.payload
+            if ev.type == framing.TEL_LINE:
+              line, tel_line = tel_line, b""
+              handle_json(line.decode(errors="ignore"))
+
+          elif ev.chan == framing.CH_LOG and ev.type == framing.TLOG_RECORDS:
+            if log_seq is not None and ev.seq != (log_seq + 1) & 0xFFFF:
+              print(f"📜 {(ev.seq - log_seq - 1) & 0xFFFF} log frame(s) lost")
+            log_seq = ev.seq
+            dropped, recs = logs.records(ev.payload)
+            if dropped != log_dropped:
+              print(f"📜 {dropped - log_dropped} log record(s) dropped on the device")
+              log_dropped = dropped
+            if not args.no_logs:
+              for t_us, lvl, text in recs:
+                print(f"📜 {t_us / 1e6:10.3f} {lvl} {text}")
 
       except KeyboardInterrupt:
         print("\nbye."); sys.exit(0)
@@ -49,4 +133,4 @@ def main():
         print("❌", e); time.sleep(0.3)
 
 if __name__ == "__main__":
-  main()
\ No newline at end of file
+  main()
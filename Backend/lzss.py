@@ -0,0 +1,51 @@
+"""Decoder for the device's LZSS stream (soliris-firmware/include/lzss.h),
+used for Content-Encoding: x-soliris-lzss bodies and compressed BLE bridges."""
+from __future__ import annotations
+
+ENCODING = "x-soliris-lzss"
+WIN, MIN_LEN = 1024, 3
+
+
+class Decoder:
+    """Streaming: feed() any split of the stream, get the bytes decoded so far."""
+
+    def __init__(self) -> None:
+        self.win = bytearray(WIN)
+        self.wpos = 0
+        self.ctrl = 0
+        self.left = 0
+        self.hi = -1
+
+    def _put(self, out: bytearray, c: int) -> None:
+        self.win[self.wpos] = c
+        self.wpos = (self.wpos + 1) & (WIN - 1)
+        out.append(c)
+
+    def feed(self, data: bytes) -> bytes:
+        out = bytearray()
+        for b in data:
+            if not self.left and self.hi < 0:
+                self.ctrl, self.left = b, 8
+            elif self.hi < 0 and self.ctrl & 1:
+                self._put(out, b)
+                self.ctrl >>= 1
+                self.left -= 1
+            elif self.hi < 0:
+                self.hi = b
+            else:
+                off, n = (self.hi << 2) | (b >> 6), (b & 0x3F) + MIN_LEN
+                self.hi = -1
+                self.ctrl >>= 1
+                self.left -= 1
+                if not off:
+                    if b:
+                        raise ValueError("bad sync item")
+                    self.left = 0
+                    continue
+                for _ in range(n):
+                    self._put(out, self.win[(self.wpos - off) & (WIN - 1)])
+        return bytes(out)
+
+
+def decompress(data: bytes) -> bytes:
+    return Decoder().feed(data)
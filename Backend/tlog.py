@@ -0,0 +1,81 @@
+"""Decoder for the device's tokenized logs (soliris-firmware/include/tlog.h).
+
+The dictionary is read from tlog_defs.h, so new tokens need no change here.
+
+    record : u8 len | u16 id | u32 t_us | args
+    args   : integers and floats 4 bytes each, strings u8 n + n bytes
+"""
+from __future__ import annotations
+
+import re
+import struct
+from pathlib import Path
+
+DEFS_PATH = Path(__file__).resolve().parent.parent / "soliris-firmware" / "include" / "tlog_defs.h"
+LEVELS = {"TLOG_ERROR": "E", "TLOG_WARN": "W", "TLOG_INFO": "I", "TLOG_DEBUG": "D"}
+_DEF = re.compile(r'X\(\s*(\w+)\s*,\s*(\w+)\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)')
+_CONV = re.compile(r"%([-+ #0]*\d*(?:\.\d+)?)[hlLzjtq]*([diuxXocfFeEgGaAs%])")
+HDR = 7
+
+
+def load_defs(path: str | Path = DEFS_PATH) -> list[tuple[str, str, str]]:
+    """[(name, level letter, format)] in id order."""
+    text = Path(path).read_text(encoding="utf-8")
+    return [(n, LEVELS.get(l, "?"), f.encode().decode("unicode_escape").encode("latin-1").decode("utf-8"))
+            for n, l, f in _DEF.findall(text)]
+
+
+class Decoder:
+    def __init__(self, path: str | Path = DEFS_PATH) -> None:
+        self.defs = load_defs(path)
+
+    def format(self, rec: bytes) -> tuple[int, str, str] | None:
+        """One record -> (t_us, level, text), None if malformed."""
+        if len(rec) < HDR or rec[0] != len(rec):
+            return None
+        tid, t_us = struct.unpack_from("<HI", rec, 1)
+        if tid >= len(self.defs):
+            return None
+        name, level, fmt = self.defs[tid]
+        pos, out, last = HDR, [], 0
+        for m in _CONV.finditer(fmt):
+            out.append(fmt[last:m.start()])
+            last = m.end()
+            spec, conv = m.group(1), m.group(2)
+            if conv == "%":
+                out.append("%")
+                continue
+            if conv == "s":
+                if pos >= len(rec) or pos + 1 + rec[pos] > len(rec):
+                    return None
+                n = rec[pos]
+                val = rec[pos + 1:pos + 1 + n].decode(errors="replace")
+                pos += 1 + n
+            else:
+                if pos + 4 > len(rec):
+                    return None
+                if conv in "fFeEgGaA":
+                    val = struct.unpack_from("<f", rec, pos)[0]
+                    conv = "e" if conv in "aA" else conv
+                elif conv in "di":
+                    val, conv = struct.unpack_from("<i", rec, pos)[0], "d"
+                else:
+                    val = struct.unpack_from("<I", rec, pos)[0]
+                    conv = "d" if conv == "u" else conv
+                pos += 4
+            out.append(("%" + spec + conv) % val)
+        out.append(fmt[last:])
+        return t_us, level, "".join(out)
+
+    def records(self, payload: bytes):
+        """A TLOG_RECORDS payload -> (device drop counter, [(t_us, level, text)])."""
+        dropped = struct.unpack_from("<I", payload)[0] if len(payload) >= 4 else 0
+        out, o = [], 4
+        while o < len(payload):
+            n = payload[o]
+            r = self.format(payload[o:o + n]) if n >= HDR else None
+            if r is None:
+                break
+            out.append(r)
+            o += n
+        return dropped, out
@@ -0,0 +1,61 @@
+import 'dart:typed_data';
+
+/// Streaming decoder for the firmware's LZSS (soliris-firmware/include/lzss.h),
+/// used on the BLE bridge once {"enc":"lzss"} is negotiated.
+///
+///   group : ctrl byte, then up to 8 items, bit i (LSB first) 1 = literal
+///   match : 2 bytes, off(10) len-3(6) big endian; off 0 is a sync (the
+///           rest of the group is empty)
+///
+/// The window spans the whole connection, so every notification has to be
+/// fed, in order, to one decoder. Feed any split of the stream.
+class LzDecoder {
+  static const _win = 1024, _minLen = 3;
+
+  final _w = Uint8List(_win);
+  int _wpos = 0, _ctrl = 0, _left = 0, _hi = -1;
+
+  /// Set once the stream is malformed; [feed] then decodes nothing more.
+  bool bad = false;
+
+  List<int> feed(List<int> p) {
+    final out = <int>[];
+    for (final b in p) {
+      if (bad) break;
+      if (_left == 0 && _hi < 0) {
+        _ctrl = b;
+        _left = 8;
+        continue;
+      }
+      if (_hi < 0 && (_ctrl & 1) != 0) {
+        _put(b, out);
+        _ctrl >>= 1;
+        _left--;
+        continue;
+      }
+      if (_hi < 0) {
+        _hi = b;
+        continue;
+      }
+      final off = (_hi << 2) | (b >> 6), len = (b & 0x3F) + _minLen;
+      _hi = -1;
+      _ctrl >>= 1;
+      _left--;
+      if (off == 0) {
+        if (b != 0) bad = true;
+        _left = 0; // sync
+        continue;
+      }
+      for (var k = 0; k < len; k++) {
+        _put(_w[(_wpos - off) & (_win - 1)], out);
+      }
+    }
+    return out;
+  }
+
+  void _put(int c, List<int> out) {
+    _w[_wpos] = c;
+    _wpos = (_wpos + 1) & (_win - 1);
+    out.add(c);
+  }
+}
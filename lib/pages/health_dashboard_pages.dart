@@ -12,6 +12,7 @@ import '../widgets/multi_metric_chart.dart';
 import '../widgets/notification_bell.dart';
 import '../alert_center.dart';
 import 'alert_page.dart';
+import '../soliris_ble.dart';
 import '../theme/scale_utils.dart';
 
 class HealthDashboardPage extends StatefulWidget {
@@ -86,6 +87,45 @@ class _HealthDashboardPageState extends State<HealthDashboardPage> {
       _series['Resp rate'] = rr;
       _series['Steps/min'] = steps;
     });
+    _loadDeviceHistory(day);
+  }
+
+  // Replace the sample curves with the wearable's own 15-min rollups when
+  // it is connected over BLE (no backend round-trip).
+  Future<void> _loadDeviceHistory(DateTime day) async {
+    if (!solirisBle.isConnected) return;
+    final start = DateTime(day.year, day.month, day.day);
+    final from = start.millisecondsSinceEpoch ~/ 1000;
+    final to = from + 86400;
+    const metrics = {
+      'HR': 'hr',
+      'SpO₂': 'spo2',
+      'Skin temp': 'skin',
+      'Steps/min': 'steps',
+    };
+    final loaded = <String, List<FlSpot>>{};
+    for (final e in metrics.entries) {
+      try {
+        final rows = await solirisBle.queryHistory(
+          metric: e.value,
+          res: 900,
+          from: from,
+          to: to,
+          max: 96,
+        );
+        if (rows.isEmpty) continue;
+        loaded[e.key] = [
+          for (final r in rows)
+            FlSpot(
+              (r[0] - from) / 60.0,
+              // steps are stored per second; mean * 60 = steps per minute
+              e.value == 'steps' ? r[3] * 60.0 : r[3].toDouble(),
+            ),
+        ];
+      } catch (_) {}
+    }
+    if (!mounted || loaded.isEmpty || day != selectedDate) return;
+    setState(() => _series.addAll(loaded));
   }
 
   Future<void> generateHealthSummaryPDF(BuildContext context) async {
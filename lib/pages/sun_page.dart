@@ -141,6 +141,10 @@ class _SunPageState extends State<SunPage> {
                     (tel['m'] is Map ? (tel['m'] as Map)['lx'] : null),
               )?.toInt();
 
+              final Map<String, dynamic> sun = _asMap(tel['sun'] ?? msg['sun']);
+              final int? sunMinutes = _num(sun['min'])?.toInt();
+              final int? sunDose = _num(sun['day'])?.toInt();
+
               final tileHeight = _tileHeight(context);
               final tipsText = _buildEcoTips(msg);
 
@@ -220,6 +224,14 @@ class _SunPageState extends State<SunPage> {
                         title: 'UV index',
                         value: uv == null ? '--' : uv.toStringAsFixed(1),
                       ),
+                      _MetricTile(
+                        title: 'Sun today',
+                        value: sunMinutes == null ? '--' : '$sunMinutes min',
+                      ),
+                      _MetricTile(
+                        title: 'Sun dose',
+                        value: sunDose == null ? '--' : '${(sunDose / 100).toStringAsFixed(0)}',
+                      ),
                     ],
                   ),
 
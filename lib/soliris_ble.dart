@@ -2,6 +2,8 @@ import 'dart:async';
 import 'dart:convert';
 import 'package:flutter_reactive_ble/flutter_reactive_ble.dart';
 
+import 'lzss.dart';
+
 class SolirisBle {
   static final Uuid svcCtrl = Uuid.parse(
     "c0de0001-2bad-4b0b-a3f8-9b3b5f2a0001",
@@ -9,6 +11,15 @@ class SolirisBle {
   static final Uuid chrCtrl = Uuid.parse(
     "c0de0002-2bad-4b0b-a3f8-9b3b5f2a0001",
   );
+  // Bridge notify characteristic: newline-terminated JSON replies, LZSS
+  // compressed once {"enc":"lzss"} is acknowledged by the device's marker.
+  static const _lzMarker = '{"enc":"x-soliris-lzss"}';
+  static final Uuid svcBridge = Uuid.parse(
+    "6E400001-B5A3-F393-E0A9-E50E24DCCA9E",
+  );
+  static final Uuid chrBridge = Uuid.parse(
+    "6E400003-B5A3-F393-E0A9-E50E24DCCA9E",
+  );
 
   final _ble = FlutterReactiveBle();
 
@@ -16,6 +27,10 @@ class SolirisBle {
   StreamSubscription<DiscoveredDevice>? _scanSub;
   StreamSubscription<ConnectionStateUpdate>? _connSub;
   QualifiedCharacteristic? _ctrlChar;
+  StreamSubscription<List<int>>? _bridgeSub;
+  final _msgs = StreamController<Map<String, dynamic>>.broadcast();
+  final _line = <int>[];
+  LzDecoder? _lz;
 
   bool get isConnected => _ctrlChar != null;
 
@@ -40,7 +55,9 @@ class SolirisBle {
                           serviceId: svcCtrl,
                           characteristicId: chrCtrl,
                         );
-                        c.complete();
+                        _startBridge(d.id);
+                        _writeJson({"enc": "lzss"}).catchError((_) {});
+                        if (!c.isCompleted) c.complete();
                       }
                     },
                     onError: (e) {
@@ -60,12 +77,66 @@ class SolirisBle {
   Future<void> disconnect() async {
     await _scanSub?.cancel();
     await _connSub?.cancel();
+    await _bridgeSub?.cancel();
     _scanSub = null;
     _connSub = null;
+    _bridgeSub = null;
+    _line.clear();
+    _lz = null;
     _ctrlChar = null;
     _device = null;
   }
 
+  // One subscription per connection: the compressed stream can only be
+  // decoded from its start, so every reader listens to [_msgs].
+  void _startBridge(String deviceId) {
+    _bridgeSub?.cancel();
+    _line.clear();
+    _lz = null;
+    _bridgeSub = _ble
+        .subscribeToCharacteristic(
+          QualifiedCharacteristic(
+            deviceId: deviceId,
+            serviceId: svcBridge,
+            characteristicId: chrBridge,
+          ),
+        )
+        .listen(_onBridge, onError: (e) => _msgs.addError(e));
+  }
+
+  void _onBridge(List<int> chunk) {
+    final lz = _lz;
+    final bytes = lz == null ? chunk : lz.feed(chunk);
+    if (lz != null && lz.bad) {
+      // Lost sync: drop back to plain text and ask for a fresh stream.
+      _lz = null;
+      _line.clear();
+      _writeJson({"enc": "none"})
+          .then((_) => _writeJson({"enc": "lzss"}))
+          .catchError((_) {});
+      return;
+    }
+    for (var i = 0; i < bytes.length; i++) {
+      if (bytes[i] != 0x0A) {
+        _line.add(bytes[i]);
+        continue;
+      }
+      final line = utf8.decode(_line, allowMalformed: true);
+      _line.clear();
+      if (_lz == null && line.endsWith(_lzMarker)) {
+        _lz = LzDecoder(); // what follows the marker is compressed
+        _onBridge(bytes.sublist(i + 1));
+        return;
+      }
+      try {
+        final m = jsonDecode(line);
+        if (m is! Map) continue;
+        if (_lz != null && m['enc'] == 'none') _lz = null;
+        _msgs.add(Map<String, dynamic>.from(m));
+      } catch (_) {}
+    }
+  }
+
   Future<void> _writeJson(Map<String, dynamic> m) async {
     if (_ctrlChar == null) throw StateError("BLE not connected");
     final payload = utf8.encode(jsonEncode(m));
@@ -76,6 +147,111 @@ class SolirisBle {
   Future<void> setLed(bool on) => _writeJson({"led": on});
   Future<void> setBuzz(bool on) => _writeJson({"buzz": on});
   Future<void> play(String k) => _writeJson({"play": k});
+
+  /// On-device history for [metric] ("hr", "spo2", "skin", "steps", ...).
+  /// [res] is 1 (raw), 60 or 900 seconds; [from]/[to] and the returned times
+  /// are epoch seconds. Rows are [t, min, max, mean, n] (or [t, v] for raw).
+  /// Before its clock is set the device keys rows by uptime ("clock": 0,
+  /// "up_s" = its uptime now): the range is then asked again in uptime and
+  /// the rows are rebased on this phone's clock.
+  Future<List<List<num>>> queryHistory({
+    required String metric,
+    required int res,
+    required int from,
+    required int to,
+    int max = 240,
+  }) async {
+    var h = await _queryHist(metric, res, from, to, max);
+    var offset = 0;
+    final upS = h['up_s'];
+    if (h['clock'] == 0 && upS is num) {
+      offset = DateTime.now().millisecondsSinceEpoch ~/ 1000 - upS.toInt();
+      final upFrom = from - offset, upTo = to - offset;
+      if (upTo < 0) return const [];
+      h = await _queryHist(metric, res, upFrom < 0 ? 0 : upFrom, upTo, max);
+    }
+    return [
+      for (final r in (h['rows'] as List? ?? const []))
+        if (r is List && r.isNotEmpty)
+          [(r[0] as num) + offset, ...r.skip(1).cast<num>()],
+    ];
+  }
+
+  // The device runs one history query at a time and answers {"busy":1} to
+  // another: this app's queries are chained, and a busy reply (another
+  // client's query in flight) is retried.
+  Future<void> _histTail = Future.value();
+
+  Future<Map<String, dynamic>> _queryHist(
+    String metric,
+    int res,
+    int from,
+    int to,
+    int max,
+  ) {
+    final run = _histTail.then((_) async {
+      for (var attempt = 0; attempt < 20; attempt++) {
+        final h = await _histRequest(metric, res, from, to, max);
+        if (h['busy'] != 1) return h;
+        await Future.delayed(const Duration(milliseconds: 250));
+      }
+      throw StateError("device history busy");
+    });
+    _histTail = run.then((_) {}, onError: (_) {});
+    return run;
+  }
+
+  Future<Map<String, dynamic>> _histRequest(
+    String metric,
+    int res,
+    int from,
+    int to,
+    int max,
+  ) async {
+    if (_ctrlChar == null) throw StateError("BLE not connected");
+    final done = Completer<Map<String, dynamic>>();
+    final sub = _msgs.stream.listen(
+      (m) {
+        final h = m['hist'];
+        if (h is Map && h['m'] == metric && !done.isCompleted) {
+          done.complete(Map<String, dynamic>.from(h));
+        }
+      },
+      onError: (e) {
+        if (!done.isCompleted) done.completeError(e);
+      },
+    );
+    try {
+      await _writeJson({
+        "get": "hist",
+        "m": metric,
+        "res": res,
+        "from": from,
+        "to": to,
+        "max": max,
+      });
+      return await done.future.timeout(const Duration(seconds: 10));
+    } finally {
+      await sub.cancel();
+    }
+  }
+
+  /// Safety events ({"alert":{id, kind, ...}}) pushed over the bridge; each
+  /// one is acked with {"ev_ack": id} so the device stops resending it.
+  Stream<Map<String, dynamic>> alerts() {
+    if (_ctrlChar == null) throw StateError("BLE not connected");
+    return _msgs.stream
+        .map((m) {
+          final a = m['alert'];
+          if (a is Map) {
+            _writeJson({"ev_ack": a['id']}).catchError((_) {});
+            return Map<String, dynamic>.from(a);
+          }
+          return null;
+        })
+        .where((a) => a != null)
+        .cast<Map<String, dynamic>>();
+  }
 }
 
 final solirisBle = SolirisBle();
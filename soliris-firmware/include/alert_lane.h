@@ -0,0 +1,145 @@
+#pragma once
+// Priority lane for safety events (fall, unconscious, cardiac). A detection
+// becomes an event with an id and its detection time and goes out at once
+// on every link that is up: USB serial host, BLE central, cellular tunnel,
+// and Wi-Fi, which is woken out of the upload schedule and POSTs the event
+// to /alert before any telemetry batch. Unacked events are resent with
+// backoff until the backend acks them: HTTP 2xx from /alert, or
+// {"ev_ack":id} back over serial/BLE (ingest_serial.py, the app).
+//
+//   {"alert":{"id":..,"kind":"fall","up_ms":..,"ts":..,"value":..,"sent_up_ms":..,"sends":1,"userId":".."}}
+//
+// up_ms/sent_up_ms let the backend date the detection without a device
+// clock; ts (epoch ms) is there once SNTP has run.
+#include <Arduino.h>
+#include "uplink.h"
+#include "telemetry.h"
+#include "serial_chan.h"
+
+#define ALERT_MAX            8
+#define ALERT_RETRY_MS    2000     // first resend, doubles
+#define ALERT_RETRY_MAX  30000
+#define ALERT_PATH     "/alert"
+#define CARDIAC_LOW_BPM     40
+#define CARDIAC_HIGH_BPM   150
+#define CARDIAC_HOLD_MS  15000     // out of range this long, on the wrist
+
+enum AlertEv : uint8_t { EV_FALL, EV_UNCONSCIOUS, EV_CARDIAC, EV_NKINDS };
+static const char* const EV_NAMES[EV_NKINDS] = { "fall", "unconscious", "cardiac" };
+
+struct AlertEvent {
+  uint32_t id;                     // 0: free slot
+  uint8_t  kind;
+  bool     acked;
+  uint32_t up_ms, epoch;           // detection: uptime, epoch s (0: clock unset)
+  float    value;                  // unconscious score, bpm
+  uint32_t next_ms, retry_ms;
+  uint32_t wifi_sess;              // upload session that last POSTed it
+  uint16_t sends;
+};
+
+static AlertEvent  alert_q[ALERT_MAX];
+static const char* alert_user = "";
+static uint32_t    alert_next_id = 1;
+static bool        alert_prev[EV_NKINDS];
+static uint32_t    alert_raised = 0, alert_acks = 0, alert_overwrites = 0;
+static uint32_t    alert_lat_last_ms = 0, alert_lat_max_ms = 0;   // detection -> ack
+
+static size_t alert_format(char* buf, size_t cap, const AlertEvent& e) {
+  JsonOut o(buf, cap);
+  o.put("{\"alert\":{\"id\":%lu,\"kind\":\"%s\",\"up_ms\":%lu", (unsigned long)e.id, EV_NAMES[e.kind],
+        (unsigned long)e.up_ms);
+  if (e.epoch) o.put(",\"ts\":%lu000", (unsigned long)e.epoch);
+  o.raw(",\"value\":"); o.num(e.value, 2);
+  o.put(",\"sent_up_ms\":%lu,\"sends\":%u,\"userId\":\"%s\"}}", (unsigned long)millis(), (unsigned)e.sends + 1, alert_user);
+  return o.ok ? (size_t)(o.p - buf) : 0;
+}
+
+static void alert_ack(uint32_t id, const char* via) {
+  for (AlertEvent& e : alert_q) {
+    if (e.id != id || e.acked) continue;
+    e.acked = true; alert_acks++;
+    alert_lat_last_ms = millis() - e.up_ms;
+    if (alert_lat_last_ms > alert_lat_max_ms) alert_lat_max_ms = alert_lat_last_ms;
+    tlog<TL_ALERT_ACK>(EV_NAMES[e.kind], id, via, alert_lat_last_ms);
+  }
+}
+
+static void alert_raise(uint8_t kind, float value) {
+  AlertEvent* slot = nullptr;
+  for (AlertEvent& e : alert_q) if (!e.id || e.acked) { slot = &e; break; }
+  if (!slot) {                                   // all pending: replace the oldest
+    slot = &alert_q[0];
+    for (AlertEvent& e : alert_q) if ((int32_t)(e.up_ms - slot->up_ms) < 0) slot = &e;
+    alert_overwrites++;
+  }
+  uint32_t now = millis();
+  *slot = {};
+  slot->id = alert_next_id++; slot->kind = kind; slot->value = value;
+  slot->up_ms = now; slot->epoch = clock_epoch();
+  slot->next_ms = now; slot->retry_ms = ALERT_RETRY_MS;
+  alert_raised++;
+  uplink_kick();
+  pm_wake();
+}
+
+// Rising edge of a detector output raises one event.
+static void alert_note(uint8_t kind, bool active, float value) {
+  if (active && !alert_prev[kind]) alert_raise(kind, value);
+  alert_prev[kind] = active;
+}
+
+// Sustained brady/tachycardia while the sensor is on the wrist.
+static bool cardiac_update(bool contact, float bpm, uint32_t now) {
+  static uint32_t since = 0;
+  bool out = contact && bpm > 0 && (bpm < CARDIAC_LOW_BPM || bpm > CARDIAC_HIGH_BPM);
+  if (!out) { since = 0; return false; }
+  if (!since) since = now;
+  return now - since >= CARDIAC_HOLD_MS;
+}
+
+// Upload hook (upl_prio): each pending event once per Wi-Fi session, one per pass.
+static bool alert_wifi_pass() {
+  static char buf[256];
+  for (AlertEvent& e : alert_q) {
+    if (!e.id || e.acked || e.wifi_sess == upl_sessions) continue;
+    e.wifi_sess = upl_sessions;
+    if (!alert_format(buf, sizeof(buf), e)) continue;
+    PmHold radio(PM_LOCK_RADIO);
+    if (http_post_wifi(String(buf), ALERT_PATH)) alert_ack(e.id, "wifi");
+    return true;
+  }
+  return false;
+}
+
+static void alert_begin(const char* user) {
+  alert_user = user;
+  alert_next_id = ((esp_random() & 0x7FFF) << 16) | 1;   // ids stay unique across reboots
+  upl_prio = alert_wifi_pass;
+}
+
+// Every loop pass: (re)sends due events on the local links and keeps Wi-Fi
+// coming up until they are acked.
+static void alert_service(uint32_t now) {
+  static char buf[256];
+  for (AlertEvent& e : alert_q) {
+    if (!e.id || e.acked || (int32_t)(now - e.next_ms) < 0) continue;
+    if (alert_format(buf, sizeof(buf), e)) {
+      if (Serial) tel.println(buf);
+      ble_notify_text(String(buf));
+#if USE_CELLULAR_TUNNEL
+      if (cellReady) http_post_cell_tunnel(String(buf));
+#endif
+    }
+    e.sends++;
+    e.next_ms = now + e.retry_ms;
+    e.retry_ms = min(e.retry_ms * 2, (uint32_t)ALERT_RETRY_MAX);
+    if (upl_state == UPL_OFF) uplink_kick();
+  }
+}
+
+static int alert_pending() {
+  int n = 0;
+  for (const AlertEvent& e : alert_q) n += e.id && !e.acked;
+  return n;
+}
@@ -0,0 +1,36 @@
+#pragma once
+// Battery level. The current PCB has no battery (USB only), so with the
+// default BATT_ADC_PIN=-1 the level is unknown and policies treat the
+// device as mains-powered.
+#include <Arduino.h>
+
+#ifndef BATT_ADC_PIN
+  #define BATT_ADC_PIN   -1
+#endif
+#ifndef BATT_DIVIDER
+  #define BATT_DIVIDER   2.0f     // resistor divider ratio on the sense pin
+#endif
+#define BATT_LOW_PCT     20
+
+// Percent 0..100, or -1 when unknown.
+static int battery_pct() {
+#if BATT_ADC_PIN >= 0
+  static uint32_t next_ms = 0;
+  static int pct = -1;
+  uint32_t now = millis();
+  if (pct >= 0 && (int32_t)(now - next_ms) < 0) return pct;
+  next_ms = now + 10000;
+  float v = analogReadMilliVolts(BATT_ADC_PIN) * BATT_DIVIDER / 1000.0f;
+  // single-cell Li-ion, linear between 3.3 V and 4.15 V is good enough here
+  float p = (v - 3.30f) / (4.15f - 3.30f) * 100.0f;
+  pct = (int)constrain(p, 0.0f, 100.0f);
+  return pct;
+#else
+  return -1;
+#endif
+}
+
+static inline bool battery_low() {
+  int p = battery_pct();
+  return p >= 0 && p < BATT_LOW_PCT;
+}
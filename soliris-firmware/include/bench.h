@@ -0,0 +1,89 @@
+#pragma once
+// Micro-benchmark runner, same cases on the host ([env:bench]) and on the
+// device (serial line "bench [filter]").
+//
+// Each case runs `iters` operations per repetition; the best of BENCH_REPS
+// repetitions is reported, one JSON line per case:
+//   {"bench":"es_hPa","iters":2000,"ns_op":41.2,"cyc_op":98.9,"target":"esp32s3","build":"..."}
+// cyc_op is the CPU cycle counter on the ESP32-S3 and 0 on the host, where
+// only the monotonic clock is portable.
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef ARDUINO
+  #include <Arduino.h>
+  #define BENCH_TARGET "esp32s3"
+#else
+  #include <chrono>
+  #define BENCH_TARGET "host"
+#endif
+
+#ifndef BENCH_BUILD
+  #define BENCH_BUILD __DATE__ " " __TIME__
+#endif
+#define BENCH_REPS 5
+
+struct BenchCase {
+  const char* name;
+  uint32_t    iters;
+  void      (*fn)(uint32_t iters);
+};
+
+static volatile float    bench_sink_f = 0;   // keeps results alive
+static volatile uint32_t bench_sink_u = 0;
+
+struct BenchTime { uint64_t ns, cyc; };
+
+static inline BenchTime bench_now() {
+#ifdef ARDUINO
+  uint32_t c = ESP.getCycleCount();
+  return { (uint64_t)micros() * 1000u, c };
+#else
+  auto t = std::chrono::steady_clock::now().time_since_epoch();
+  return { (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(t).count(), 0 };
+#endif
+}
+
+// Returns best ns and cycles per op.
+static void bench_measure(const BenchCase& c, double& ns_op, double& cyc_op) {
+  c.fn(c.iters / 10 + 1);                                // warm caches / lazy init
+  uint64_t best_ns = UINT64_MAX, best_cyc = UINT64_MAX;
+  for (int r = 0; r < BENCH_REPS; ++r) {
+    BenchTime a = bench_now();
+    c.fn(c.iters);
+    BenchTime b = bench_now();
+#ifdef ARDUINO
+    uint64_t cyc = (uint32_t)(b.cyc - a.cyc);            // 32-bit counter, < 17 s at 240 MHz
+    uint64_t ns  = cyc * 1000u / getCpuFrequencyMhz();   // finer than micros()
+#else
+    uint64_t cyc = 0, ns = b.ns - a.ns;
+#endif
+    if (ns < best_ns)   best_ns = ns;
+    if (cyc < best_cyc) best_cyc = cyc;
+  }
+  ns_op  = (double)best_ns  / c.iters;
+  cyc_op = (double)best_cyc / c.iters;
+}
+
+// Runs every case whose name contains `filter` (all when empty); out(line)
+// receives each JSON line without the newline. Returns cases run.
+template <typename Out>
+static int bench_run(const BenchCase* cases, int n, const char* filter, Out out) {
+  int ran = 0;
+  char line[192];
+  for (int i = 0; i < n; ++i) {
+    if (filter && *filter && !strstr(cases[i].name, filter)) continue;
+    double ns, cyc;
+    bench_measure(cases[i], ns, cyc);
+    snprintf(line, sizeof(line),
+             "{\"bench\":\"%s\",\"iters\":%lu,\"ns_op\":%.1f,\"cyc_op\":%.1f,\"target\":\"%s\",\"build\":\"%s\"}",
+             cases[i].name, (unsigned long)cases[i].iters, ns, cyc, BENCH_TARGET, BENCH_BUILD);
+    out(line);
+    ran++;
+#ifdef ARDUINO
+    delay(1);                                            // let the idle task run
+#endif
+  }
+  return ran;
+}
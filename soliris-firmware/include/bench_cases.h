@@ -0,0 +1,798 @@
+#pragma once
+// Benchmark cases for the firmware's hot kernels (see bench.h).
+// The PPG case runs the live detector on synthetic samples and restores its
+// state afterwards; the tlog cases use a ring of their own.
+#include <math.h>
+#include "bench.h"
+#include "pipeline.h"
+#include "telemetry.h"
+#include "push_window.h"
+#include "hist_batch.h"
+#include "lzss.h"
+#include "snapshot.h"
+#include "ctrl.h"
+#include "ring.h"
+#include "tlog.h"
+#include "report_policy.h"
+
+#ifdef ARDUINO
+  typedef String BenchStr;
+#else
+  #include <string>
+  #include <thread>
+  typedef std::string BenchStr;
+#endif
+
+// ---- synthetic inputs --------------------------------------------------------
+#define BENCH_PPG_N   100        // one second at 100 Hz, ~72 bpm
+#define BENCH_IMU_N   250        // five seconds at 50 Hz
+
+static uint32_t bench_ppg_ir[BENCH_PPG_N], bench_ppg_red[BENCH_PPG_N];
+static float    bench_imu[BENCH_IMU_N][6];
+static float    bench_imu_tilt[BENCH_IMU_N];     // ground truth, degrees
+static bool     bench_inputs_ready = false;
+
+// Forearm rocking about x (tilt 45 +/- 40 deg at 0.2 Hz) while walking:
+// 3 m/s2 vertical bounce at 1.8 Hz, expressed in the body frame.
+static void bench_inputs() {
+  if (bench_inputs_ready) return;
+  for (int i = 0; i < BENCH_PPG_N; ++i) {
+    float ph = fmodf(i * 0.012f, 1.0f);
+    bench_ppg_ir[i]  = 60000 + (uint32_t)(1500.0f * expf(-ph * 8.0f));
+    bench_ppg_red[i] = 50000 + (uint32_t)(700.0f  * expf(-ph * 8.0f));
+  }
+  const float PI_F = 3.14159265f;
+  for (int i = 0; i < BENCH_IMU_N; ++i) {
+    float t  = i * 0.02f;
+    float th = (45.0f + 40.0f * sinf(2 * PI_F * 0.2f * t)) * PI_F / 180.0f;
+    float dth = 40.0f * PI_F / 180.0f * 2 * PI_F * 0.2f * cosf(2 * PI_F * 0.2f * t);
+    float up = G + 3.0f * sinf(2 * PI_F * 1.8f * t);
+    bench_imu[i][0] = 0;                 bench_imu[i][1] = up * sinf(th); bench_imu[i][2] = up * cosf(th);
+    bench_imu[i][3] = dth;               bench_imu[i][4] = 0;             bench_imu[i][5] = 0;
+    bench_imu_tilt[i] = th * 180.0f / PI_F;
+  }
+  bench_inputs_ready = true;
+}
+
+// Pre-Madgwick gravity estimate: accel low-pass, normalize, acosf.
+struct LegacyGravity {
+  float x = 0, y = 0, z = 0; bool init = false;
+  float tilt_deg(float ax, float ay, float az) {
+    const float A = 0.05f;
+    if (!init) { x = ax; y = ay; z = az; init = true; }
+    x = (1 - A) * x + A * ax; y = (1 - A) * y + A * ay; z = (1 - A) * z + A * az;
+    float n = sqrtf(x*x + y*y + z*z); if (n < 1e-3f) n = 1e-3f;
+    float c = fabsf(z) / n; if (c > 1) c = 1;
+    return acosf(c) * 57.2958f;
+  }
+};
+
+// libm versions of the fastmath.h paths (pre-table code), for the *_libm
+// cases and the "fastmath" error check.
+static float spo2_libm(float msIR, float msRED, float dcIR, float dcRED) {
+  float R = (sqrtf(msRED) / dcRED) / (sqrtf(msIR) / dcIR);
+  float sp = 104.0f - 17.0f * R;
+  return sp < 70.0f ? 70.0f : sp > 100.0f ? 100.0f : sp;
+}
+
+static Posture posture_libm(float up_z) {
+  float c = fabsf(up_z); if (c > 1.0f) c = 1.0f;
+  float tilt = acosf(c) * 57.2958f;
+  return tilt < TILT_LYING_DEG ? POST_LYING : tilt < TILT_SITTING_DEG ? POST_SITTING : POST_STANDING;
+}
+
+#define BENCH_SPO2_N 64
+static float bench_spo2[BENCH_SPO2_N][4];       // msIR, msRED, dcIR, dcRED
+
+static void bench_spo2_inputs() {
+  for (int i = 0; i < BENCH_SPO2_N; ++i) {
+    float r = 0.3f + 1.5f * i / BENCH_SPO2_N, dcI = 60000.0f + 40 * i, dcR = 50000.0f - 30 * i;
+    float acI = 400.0f + 10 * i;
+    bench_spo2[i][0] = acI * acI; bench_spo2[i][2] = dcI; bench_spo2[i][3] = dcR;
+    bench_spo2[i][1] = (r * acI * dcR / dcI) * (r * acI * dcR / dcI);
+  }
+}
+
+// ---- kernels -----------------------------------------------------------------
+static void bk_es_hPa(uint32_t n) {
+  float s = 0;
+  for (uint32_t i = 0; i < n; ++i) s += es_hPa(-10.0f + (i & 63) * 0.7f);
+  bench_sink_f = s;
+}
+
+static void bk_rh_retarget(uint32_t n) {
+  float s = 0;
+  for (uint32_t i = 0; i < n; ++i) s += rh_retarget(40.0f + (i & 31), 30.0f + (i & 7) * 0.5f, 24.5f);
+  bench_sink_f = s;
+}
+
+static void bk_spo2_lut(uint32_t n) {
+  bench_spo2_inputs();
+  float s = 0;
+  for (uint32_t i = 0; i < n; ++i) {
+    const float* v = bench_spo2[i % BENCH_SPO2_N];
+    s += SPO2_LUT((v[1] / v[0]) * fm_sq(v[2] / v[3]));
+  }
+  bench_sink_f = s;
+}
+
+static void bk_spo2_libm(uint32_t n) {
+  bench_spo2_inputs();
+  float s = 0;
+  for (uint32_t i = 0; i < n; ++i) {
+    const float* v = bench_spo2[i % BENCH_SPO2_N];
+    s += spo2_libm(v[0], v[1], v[2], v[3]);
+  }
+  bench_sink_f = s;
+}
+
+// Motion/still/impact tests of one IMU sample, on |a|^2 vs on |a|.
+static void bk_imu_mag2(uint32_t n) {
+  bench_inputs();
+  uint32_t s = 0;
+  for (uint32_t i = 0; i < n; ++i) {
+    const float* v = bench_imu[i % BENCH_IMU_N];
+    float a2 = v[0]*v[0] + v[1]*v[1] + v[2]*v[2];
+    s += MOTION_BAND.outside(a2) + STILL_BAND.outside(a2) + (a2 > IMPACT_A2);
+  }
+  bench_sink_u = s;
+}
+
+static void bk_imu_mag_sqrtf(uint32_t n) {
+  bench_inputs();
+  uint32_t s = 0;
+  for (uint32_t i = 0; i < n; ++i) {
+    const float* v = bench_imu[i % BENCH_IMU_N];
+    float m = sqrtf(v[0]*v[0] + v[1]*v[1] + v[2]*v[2]), d = fabsf(m - G);
+    s += (d > MOTION_DYN) + (d > NO_MOTION_DYN) + (m > IMPACT_G * G);
+  }
+  bench_sink_u = s;
+}
+
+static void bk_ppg_process(uint32_t n) {
+  bench_inputs();
+  static PpgSaved live;
+  ppg_save(live);
+  uint32_t now = 0;
+  for (uint32_t i = 0; i < n; ++i) {
+    uint32_t k = i % BENCH_PPG_N;
+    ppg_process(bench_ppg_ir[k], bench_ppg_red[k], now += 10);
+  }
+  bench_sink_u = ppg_bpm_avg;
+  ppg_restore(live);
+}
+
+static void bk_posture_cos(uint32_t n) {
+  uint32_t s = 0;
+  for (uint32_t i = 0; i < n; ++i) s += posture_from_up(((int)(i & 255) - 128) / 128.0f);
+  bench_sink_u = s;
+}
+
+static void bk_posture_acosf(uint32_t n) {
+  uint32_t s = 0;
+  for (uint32_t i = 0; i < n; ++i) s += posture_libm(((int)(i & 255) - 128) / 128.0f);
+  bench_sink_u = s;
+}
+
+static void bk_orient_madgwick(uint32_t n) {
+  bench_inputs();
+  OrientFilter f;
+  float gx, gy, gz, s = 0;
+  for (uint32_t i = 0; i < n; ++i) {
+    const float* v = bench_imu[i % BENCH_IMU_N];
+    f.update(v[3], v[4], v[5], v[0], v[1], v[2], 0.02f);
+    f.gravity(gx, gy, gz);
+    s += gz;
+  }
+  bench_sink_f = s;
+}
+
+static void bk_orient_legacy_lp(uint32_t n) {
+  bench_inputs();
+  LegacyGravity g;
+  float s = 0;
+  for (uint32_t i = 0; i < n; ++i) {
+    const float* v = bench_imu[i % BENCH_IMU_N];
+    s += g.tilt_deg(v[0], v[1], v[2]);
+  }
+  bench_sink_f = s;
+}
+
+static void bk_qf_qi(uint32_t n) {
+  float s = 0; int k = 0;
+  for (uint32_t i = 0; i < n; ++i) {
+    float x = 20.0f + (i & 127) * 0.173f;
+    s += qf(x, 0.5f) + qf(x, 0.01f);
+    k += qi(x * 20.0f, 5.0f);
+  }
+  bench_sink_f = s; bench_sink_u = k;
+}
+
+static const char BENCH_SUN_JSON[] =
+  "{\"day\":1234,\"roll\":210,\"min\":42,\"sed\":null,\"date\":20261018,\"hours\":[0,0,0,0,0,0,0,0,12,40,"
+  "88,120,160,200,180,140,90,50,10,0,0,0,0,0]}";
+
+static void bk_telemetry_format(uint32_t n) {
+  static char buf[768];
+  TelemetryFrame t = { "veronique", 75, 97, 33.5f, 24.5f, 650, 120, true, 0.62f,
+                       BENCH_SUN_JSON, true, 40.4168, -3.7038, 0, 0, nullptr, 0 };
+  size_t len = 0;
+  for (uint32_t i = 0; i < n; ++i) { t.hr = 60 + (i & 31); len += telemetry_format(buf, sizeof(buf), t); }
+  bench_sink_u = (uint32_t)len;
+}
+
+// One second of samples into the push window, and the 30 s render.
+static void bk_pushwin_add(uint32_t n) {
+  static PushWindow w;
+  float row[TS_NMETRIC] = { 72, 97, 33.4f, 24.1f, 45, 1013, 650, 120, 0.4f, 2, 1 };
+  pushwin_reset(w, 0, 0);
+  for (uint32_t i = 0; i < n; ++i) { row[TS_HR] = 60 + (i & 31); pushwin_add(w, row); }
+  bench_sink_u = w.a[TS_HR].n;
+}
+
+static void bk_pushwin_format(uint32_t n) {
+  static PushWindow w;
+  static char buf[512];
+  float row[TS_NMETRIC] = { 72, 97, 33.4f, 24.1f, 45, 1013, 650, 120, 0.4f, 2, 1 };
+  pushwin_reset(w, 0, 0);
+  for (int i = 0; i < 30; ++i) pushwin_add(w, row);
+  size_t len = 0;
+  for (uint32_t i = 0; i < n; ++i) len += pushwin_format(buf, sizeof(buf), w, 30000, 40);
+  bench_sink_u = (uint32_t)len;
+}
+
+// 15 minutes worn at a desk with a short walk: slow drifts, a few sensor
+// gaps, step bursts. Values sit on the TS_QUANT grid like the device's.
+#define BENCH_HIST_N  HB_ROWS
+static float    bench_hist[BENCH_HIST_N][TS_NMETRIC];
+static const float* bench_hist_rows[BENCH_HIST_N];
+static uint32_t bench_hist_t[BENCH_HIST_N];
+static uint8_t  bench_hist_fl[BENCH_HIST_N];
+
+static void bench_hist_inputs() {
+  if (bench_hist_rows[0]) return;
+  uint32_t seed = 1;
+  auto rnd = [&]() { seed = seed * 1664525u + 1013904223u; return (seed >> 8) / 16777216.0f; };
+  float hr = 72, skin = 33.4f, env = 24.1f, co2 = 650;
+  for (int i = 0; i < BENCH_HIST_N; ++i) {
+    bool walk = i >= 400 && i < 520;
+    hr += (walk ? 0.3f : 0) + (rnd() - 0.5f) * 0.8f - (hr - 72) * 0.02f;
+    skin += (rnd() - 0.5f) * 0.02f; env += (rnd() - 0.5f) * 0.01f; co2 += (rnd() - 0.45f) * 2;
+    float* r = bench_hist[i];
+    r[TS_HR] = hr; r[TS_SPO2] = rnd() < 0.9f ? 97 : 98; r[TS_SKIN] = skin; r[TS_ENV_C] = env;
+    r[TS_RH] = 45; r[TS_HPA] = 1013.2f; r[TS_CO2] = co2; r[TS_VOC] = 100 + (i / 60);
+    r[TS_SUN] = walk ? 0.3f : 0.02f; r[TS_STEPS] = walk ? (rnd() < 0.5f ? 2 : 1) : 0; r[TS_MOTION] = walk;
+    if (i % 97 == 13) r[TS_HR] = r[TS_SPO2] = NAN;                   // PPG dropout
+    for (int m = 0; m < TS_NMETRIC; ++m) if (!isnan(r[m])) r[m] = roundf(r[m] / TS_QUANT[m]) * TS_QUANT[m];
+    bench_hist_rows[i] = r;
+    bench_hist_t[i] = 1790000000u + i + (i >= 600 ? 30 : 0);         // 30 s asleep
+    bench_hist_fl[i] = TS_F_ONWRIST | (walk ? TS_F_MOTION | TS_F_TOUCH : 0);
+  }
+}
+
+// One 15 min history batch.
+static void bk_hist_encode(uint32_t n) {
+  static uint8_t buf[HB_BUF_BYTES];
+  bench_hist_inputs();
+  HistSrc src = { bench_hist_t, bench_hist_rows, bench_hist_fl };
+  size_t len = 0;
+  for (uint32_t i = 0; i < n; ++i) len += hist_encode(buf, sizeof(buf), src, BENCH_HIST_N, true);
+  bench_sink_u = (uint32_t)len;
+}
+
+// One upload batch (6 kB JSON array) of send-on-delta frames with their
+// push windows, as the Wi-Fi lane queues them.
+#define BENCH_LZ_BYTES 6144
+static char   bench_lz_body[BENCH_LZ_BYTES + 1024];
+static size_t bench_lz_len = 0;
+
+static void bench_lz_inputs() {
+  if (bench_lz_len) return;
+  static char frame[1024], win[512];
+  PushWindow w;
+  float row[TS_NMETRIC] = { 72, 97, 33.4f, 24.1f, 45, 1013, 650, 120, 0.4f, 2, 1 };
+  size_t k = 0;
+  bench_lz_body[k++] = '[';
+  for (int i = 0; k < BENCH_LZ_BYTES; ++i) {
+    pushwin_reset(w, 0, 0);
+    for (int j = 0; j < 10; ++j) { row[TS_HR] = 64 + (i * 7 + j) % 19; row[TS_CO2] = 600 + i * 10 % 90; pushwin_add(w, row); }
+    pushwin_format(win, sizeof(win), w, 10000, 4 + i);
+    TelemetryFrame t = { "veronique", 60 + i % 23, 96 + i % 3, 33.0f + (i % 9) * 0.05f, 24.5f, 600 + i * 10 % 90,
+                         110 + i % 7, (i & 4) != 0, 0.05f * (i % 8), nullptr, (i & 1) != 0, 40.4168, -3.7038,
+                         (uint32_t)(60000 + i * 10000), (uint32_t)(1790000000 + i * 10), win, 0 };
+    if (i % 3) t.fields = (1u << TF_HR) | (1u << TF_SKIN) | (1u << TF_CO2);   // partial frames
+    size_t n = telemetry_format(frame, sizeof(frame), t);
+    if (i) bench_lz_body[k++] = ',';
+    memcpy(bench_lz_body + k, frame, n); k += n;
+  }
+  bench_lz_body[k++] = ']';
+  bench_lz_len = k;
+}
+
+template <uint8_t DEPTH>
+static void bk_lz_batch(uint32_t n) {
+  static LzEnc e;
+  bench_lz_inputs();
+  uint32_t out = 0;
+  for (uint32_t i = 0; i < n; ++i) {
+    lz_init(e, DEPTH);
+    lz_write(e, (const uint8_t*)bench_lz_body, bench_lz_len, [&](const uint8_t*, size_t m) { out += m; });
+    lz_flush(e, [&](const uint8_t*, size_t m) { out += m; });
+  }
+  bench_sink_u = out;
+}
+
+static void bk_lz_decode(uint32_t n) {
+  static LzEnc e;
+  static LzDec d;
+  static uint8_t comp[BENCH_LZ_BYTES + 2048];
+  static size_t clen = 0;
+  bench_lz_inputs();
+  if (!clen) {
+    lz_init(e);
+    auto sink = [&](const uint8_t* p, size_t m) { memcpy(comp + clen, p, m); clen += m; };
+    lz_write(e, (const uint8_t*)bench_lz_body, bench_lz_len, sink);
+    lz_flush(e, sink);
+  }
+  uint32_t s = 0;
+  for (uint32_t i = 0; i < n; ++i) { lz_dec_init(d); lz_dec_feed(d, comp, clen, [&](uint8_t b) { s += b; }); }
+  bench_sink_u = s;
+}
+
+// A snapshot the size of the IMU state; every word carries the version.
+struct BenchSnap { uint32_t w[16]; };
+static Snapshot<BenchSnap> bench_snap;
+
+static void bk_snap_publish(uint32_t n) {
+  BenchSnap v;
+  for (uint32_t i = 0; i < n; ++i) { for (uint32_t& x : v.w) x = i; bench_snap.publish(v); }
+  bench_sink_u = bench_snap.version();
+}
+
+static void bk_snap_read(uint32_t n) {
+  BenchSnap v;
+  uint32_t s = 0;
+  for (uint32_t i = 0; i < n; ++i) { bench_snap.read(v); s += v.w[15]; }
+  bench_sink_u = s;
+}
+
+// side-effect free when applied: unknown play/get names are ignored
+static const char BENCH_CTRL_JSON[] = "{\"play\":\"none\",\"get\":\"none\",\"m\":\"hr\",\"res\":60,\"from\":0,\"n\":60}";
+
+// Same command in the binary form.
+static const uint8_t BENCH_CTRL_BIN[] = {
+  CTRL_BIN_MAGIC, 25,
+  0x03, 4, 'n','o','n','e',  0x05, 4, 'n','o','n','e',  0x06, 2, 'h','r',
+  0x08, 1, 60,  0x09, 1, 0,  0x07, 1, 60,
+};
+
+static void bk_ctrl_parse(uint32_t n) {
+  uint32_t s = 0;
+  for (uint32_t i = 0; i < n; ++i) {
+    CtrlCmd c;
+    s += ctrl_parse(BENCH_CTRL_JSON, sizeof(BENCH_CTRL_JSON) - 1, c) ? (uint32_t)c.n : 0;
+  }
+  bench_sink_u = s;
+}
+
+static void bk_ctrl_parse_bin(uint32_t n) {
+  uint32_t s = 0;
+  for (uint32_t i = 0; i < n; ++i) {
+    CtrlCmd c;
+    s += ctrl_parse((const char*)BENCH_CTRL_BIN, sizeof(BENCH_CTRL_BIN), c) ? (uint32_t)c.n : 0;
+  }
+  bench_sink_u = s;
+}
+
+static void bk_offline_ring(uint32_t n) {
+  static DropRing<BenchStr, 64> q;
+  static BenchStr item, out;
+  if (!item.length()) {
+    for (int i = 0; i < 240; ++i) item += (char)('a' + i % 26);   // typical push size
+    for (int i = 0; i < 32; ++i) q.push(item);                       // half-full backlog
+  }
+  uint32_t s = 0;
+  for (uint32_t i = 0; i < n; ++i) {
+    q.push(item);
+    if (q.pop(out)) s += out.length();
+  }
+  bench_sink_u = s;
+}
+
+// The once-a-second [FALL] line: a tokenized record against the printf it replaced.
+static TlogRing bench_tlog_ring;
+
+static void bk_tlog_record(uint32_t n) {
+  TlogRing& g = bench_tlog_ring;
+  for (uint32_t i = 0; i < n; ++i) {
+    tlog_to<TL_FALL_STATE>(g, 1, 0, 1, i, 0, 0.42f, i >> 1, 2);
+    if (tlog_pending(g) > TLOG_RING_BYTES / 2) g.r = g.w;     // nothing drains it
+  }
+  bench_sink_u = g.w;
+}
+
+// One second of the report policy on a lane, fields jittering around.
+static void bk_rp_eval(uint32_t n) {
+  static RpLane l;
+  float v[TF_N] = { 70, 97, 33.5f, 24.5f, 650, 120, 1, 0.4f, 0, 40.4168f, -3.7038f };
+  rp_init(l, 2000);
+  uint32_t k = 0;
+  for (uint32_t i = 0; i < n; ++i) {
+    v[TF_HR] = (i & 1) ? 75 : 70;
+    uint16_t m = rp_eval(l, v, 1000 + i * 1000);
+    if (m) rp_commit(l, v, m, 1000 + i * 1000, 100);
+    k += m;
+  }
+  bench_sink_u = k;
+}
+
+static void bk_tlog_snprintf(uint32_t n) {
+  char line[TLOG_LINE_MAX];
+  uint32_t s = 0;
+  for (uint32_t i = 0; i < n; ++i)
+    s += snprintf(line, sizeof(line), "[FALL] hadImp=%d lying=%d inactive=%d | still_ms=%u fall=%d | a_hp=%.2f steps=%lu act=%d",
+                  1, 0, 1, (unsigned)i, 0, 0.42f, (unsigned long)(i >> 1), 2);
+  bench_sink_u = s;
+}
+
+#ifdef ARDUINO
+extern bool ctrl_handle(const char* s, size_t n, CtrlCmd& c);
+static void bk_ctrl_apply(uint32_t n) {
+  for (uint32_t i = 0; i < n; ++i) { CtrlCmd c; ctrl_handle(BENCH_CTRL_JSON, sizeof(BENCH_CTRL_JSON) - 1, c); }
+}
+#endif
+
+static const BenchCase BENCH_CASES[] = {
+  { "es_hPa",            2000, bk_es_hPa },
+  { "rh_retarget",       2000, bk_rh_retarget },
+  { "spo2_lut",          2000, bk_spo2_lut },
+  { "spo2_libm",         2000, bk_spo2_libm },
+  { "imu_mag2",          2000, bk_imu_mag2 },
+  { "imu_mag_sqrtf",     2000, bk_imu_mag_sqrtf },
+  { "ppg_process",       2000, bk_ppg_process },
+  { "posture_cos",       2000, bk_posture_cos },
+  { "posture_acosf",     2000, bk_posture_acosf },
+  { "orient_madgwick",   2000, bk_orient_madgwick },
+  { "orient_legacy_lp",  2000, bk_orient_legacy_lp },
+  { "qf_qi",             2000, bk_qf_qi },
+  { "telemetry_format",   200, bk_telemetry_format },
+  { "pushwin_add",       2000, bk_pushwin_add },
+  { "pushwin_format",     200, bk_pushwin_format },
+  { "hist_encode",         20, bk_hist_encode },
+  { "lz_batch_d1",         20, bk_lz_batch<1> },
+  { "lz_batch_d8",         20, bk_lz_batch<8> },
+  { "lz_batch_d32",        20, bk_lz_batch<32> },
+  { "lz_decode",           20, bk_lz_decode },
+  { "snap_publish",      2000, bk_snap_publish },
+  { "snap_read",         2000, bk_snap_read },
+  { "ctrl_parse",         200, bk_ctrl_parse },
+  { "ctrl_parse_bin",     200, bk_ctrl_parse_bin },
+#ifdef ARDUINO
+  { "ctrl_apply",         200, bk_ctrl_apply },
+#endif
+  { "offline_ring",      1000, bk_offline_ring },
+  { "tlog_record",       2000, bk_tlog_record },
+  { "tlog_snprintf",     2000, bk_tlog_snprintf },
+  { "rp_eval",           2000, bk_rp_eval },
+};
+static const int BENCH_NCASES = sizeof(BENCH_CASES) / sizeof(BENCH_CASES[0]);
+
+// Heap allocations so far, when the build can count them (host: operator new
+// and malloc wraps in bench_main.cpp; device: memstat.h wraps).
+static uint32_t (*bench_alloc_count)() = nullptr;
+
+// Accuracy companion to the orient cases: RMS tilt error against the synthetic
+// ground truth, after a 2 s settling period.
+static void bench_check_orient(char* line, size_t cap) {
+  bench_inputs();
+  OrientFilter f; LegacyGravity lg;
+  double e_m = 0, e_l = 0; int n = 0;
+  for (int rep = 0; rep < 4; ++rep)
+    for (int i = 0; i < BENCH_IMU_N; ++i) {
+      const float* v = bench_imu[i];
+      f.update(v[3], v[4], v[5], v[0], v[1], v[2], 0.02f);
+      float gx, gy, gz; f.gravity(gx, gy, gz);
+      float cz = fabsf(gz); if (cz > 1) cz = 1;
+      float tm = acosf(cz) * 57.2958f, tl = lg.tilt_deg(v[0], v[1], v[2]);
+      if (rep == 0 && i < 100) continue;
+      e_m += (tm - bench_imu_tilt[i]) * (tm - bench_imu_tilt[i]);
+      e_l += (tl - bench_imu_tilt[i]) * (tl - bench_imu_tilt[i]);
+      n++;
+    }
+  double rms_m = sqrt(e_m / n), rms_l = sqrt(e_l / n);
+  snprintf(line, cap, "{\"check\":\"orient_tilt_rms_deg\",\"madgwick\":%.2f,\"legacy_lp\":%.2f,\"pass\":%d,\"target\":\"%s\"}",
+           rms_m, rms_l, (rms_m < 2.0 && rms_m < rms_l) ? 1 : 0, BENCH_TARGET);
+}
+
+// The Q16.16 filter (ORIENT_FIXED=1) against the float one on the same
+// samples: the fixed-point path is compiled and kept in step here even
+// though the default build never selects it.
+static void bench_check_orient_q16(char* line, size_t cap) {
+  bench_inputs();
+  Madgwick<float> ff; Madgwick<q16> fq;
+  double e2 = 0, emax = 0; int n = 0;
+  for (int rep = 0; rep < 4; ++rep)
+    for (int i = 0; i < BENCH_IMU_N; ++i) {
+      const float* v = bench_imu[i];
+      ff.update(v[3], v[4], v[5], v[0], v[1], v[2], 0.02f);
+      fq.update(v[3], v[4], v[5], v[0], v[1], v[2], 0.02f);
+      float ax, ay, az, bx, by, bz;
+      ff.gravity(ax, ay, az); fq.gravity(bx, by, bz);
+      float c = ax*bx + ay*by + az*bz;
+      if (c > 1) c = 1;
+      double e = acosf(c) * 57.2958f;                 // angle between the two up vectors
+      e2 += e * e; if (e > emax) emax = e;
+      n++;
+    }
+  double rms = sqrt(e2 / n);
+  snprintf(line, cap, "{\"check\":\"orient_q16_vs_float_deg\",\"rms\":%.3f,\"max\":%.3f,\"pass\":%d,\"target\":\"%s\"}",
+           rms, emax, (rms < 0.5 && emax < 2.0) ? 1 : 0, BENCH_TARGET);
+}
+
+// The control parser must not allocate, and both encodings must agree.
+// allocs is -1 where the build cannot count them.
+static void bench_check_ctrl(char* line, size_t cap) {
+  uint32_t a0 = bench_alloc_count ? bench_alloc_count() : 0;
+  CtrlCmd j, b;
+  bool ok = true;
+  for (int i = 0; i < 100; ++i) {
+    ok &= ctrl_parse(BENCH_CTRL_JSON, sizeof(BENCH_CTRL_JSON) - 1, j);
+    ok &= ctrl_parse((const char*)BENCH_CTRL_BIN, sizeof(BENCH_CTRL_BIN), b);
+  }
+  long allocs = bench_alloc_count ? (long)(bench_alloc_count() - a0) : -1;
+  ok &= !strcmp(j.play, b.play) && !strcmp(j.get, b.get) && !strcmp(j.metric, b.metric)
+        && j.n == b.n && j.res == b.res && j.from == b.from && j.n == 60;
+  snprintf(line, cap, "{\"check\":\"ctrl_parse\",\"allocs\":%ld,\"agree\":%d,\"pass\":%d,\"target\":\"%s\"}",
+           allocs, ok ? 1 : 0, (ok && allocs <= 0) ? 1 : 0, BENCH_TARGET);
+}
+
+// The history batch must decode to the exact rows, at a tenth of the same
+// seconds sent as JSON rows.
+struct BenchHistSink {
+  uint16_t bad = 0;
+  void t(uint16_t i, uint32_t t)         { bad += t != bench_hist_t[i]; }
+  void v(uint16_t i, uint8_t c, float x) {
+    float y = bench_hist[i][HB_COLS[c]];
+    bad += !(isnan(x) ? isnan(y) : x == y);
+  }
+  void flag(uint16_t i, uint8_t f, bool b) { bad += b != !!(bench_hist_fl[i] & (1u << f)); }
+};
+
+static void bench_check_gorilla(char* line, size_t cap) {
+  static uint8_t buf[HB_BUF_BYTES];
+  bench_hist_inputs();
+  HistSrc src = { bench_hist_t, bench_hist_rows, bench_hist_fl };
+  size_t len = hist_encode(buf, sizeof(buf), src, BENCH_HIST_N, true);
+  size_t json = 0;
+  for (int i = 0; i < BENCH_HIST_N; ++i) {
+    char row[256];
+    JsonOut o(row, sizeof(row));
+    o.put("{\"t\":%lu", (unsigned long)bench_hist_t[i]);
+    for (size_t c = 0; c < HB_NCOLS; ++c) {
+      uint8_t m = HB_COLS[c];
+      o.put(",\"%s\":", TS_NAMES[m]);
+      o.num(bench_hist[i][m], PW_DEC[m]);
+    }
+    o.put(",\"on_wrist\":%d,\"motion\":%d,\"touch\":%d},", bench_hist_fl[i] & 1, (bench_hist_fl[i] >> 1) & 1,
+          (bench_hist_fl[i] >> 2) & 1);
+    json += o.p - row;
+  }
+  GorHeader h; BenchHistSink sink;
+  bool ok = len && gor_decode(buf, len, h, sink) && !sink.bad && h.nrows == BENCH_HIST_N;
+  double ratio = len ? (double)json / len : 0;
+  snprintf(line, cap, "{\"check\":\"gorilla\",\"rows\":%d,\"bytes\":%u,\"json_bytes\":%u,\"ratio\":%.1f,\"pass\":%d,\"target\":\"%s\"}",
+           BENCH_HIST_N, (unsigned)len, (unsigned)json, ratio, (ok && ratio >= 10) ? 1 : 0, BENCH_TARGET);
+}
+
+// Compression ratio per search depth on the same batch (the lz_batch cases
+// give the CPU side), after an exact round trip; BLE-style per-frame
+// flushes on one stream must still pay off.
+static void bench_check_lzss(char* line, size_t cap) {
+  static LzEnc e;
+  static LzDec d;
+  static uint8_t comp[BENCH_LZ_BYTES + 2048], dec[BENCH_LZ_BYTES + 1024];
+  bench_lz_inputs();
+  const uint8_t depths[] = { 1, 8, 32 };
+  double ratio[3];
+  bool ok = true;
+  for (int k = 0; k < 3; ++k) {
+    size_t c = 0, o = 0;
+    auto sink = [&](const uint8_t* p, size_t m) { if (c + m <= sizeof(comp)) memcpy(comp + c, p, m); c += m; };
+    lz_init(e, depths[k]);
+    lz_write(e, (const uint8_t*)bench_lz_body, bench_lz_len, sink);
+    lz_flush(e, sink);
+    lz_dec_init(d);
+    ok &= c <= sizeof(comp) && lz_dec_feed(d, comp, c, [&](uint8_t b) { if (o < sizeof(dec)) dec[o] = b; o++; });
+    ok &= o == bench_lz_len && !memcmp(dec, bench_lz_body, o);
+    ratio[k] = (double)bench_lz_len / c;
+  }
+  size_t c = 0;                                  // one flush per frame
+  lz_init(e);
+  for (size_t i = 0, j; i < bench_lz_len; i = j) {
+    for (j = i + 1; j < bench_lz_len && bench_lz_body[j - 1] != '}'; ++j) {}
+    lz_write(e, (const uint8_t*)bench_lz_body + i, j - i, [&](const uint8_t*, size_t m) { c += m; });
+    if (bench_lz_body[j - 1] == '}') lz_flush(e, [&](const uint8_t*, size_t m) { c += m; });
+  }
+  lz_flush(e, [&](const uint8_t*, size_t m) { c += m; });
+  double stream = (double)bench_lz_len / c;
+  snprintf(line, cap, "{\"check\":\"lzss\",\"bytes\":%u,\"ratio_d1\":%.2f,\"ratio_d8\":%.2f,\"ratio_d32\":%.2f,"
+           "\"ratio_flushed\":%.2f,\"pass\":%d,\"target\":\"%s\"}",
+           (unsigned)bench_lz_len, ratio[0], ratio[1], ratio[2], stream, (ok && ratio[1] >= 3) ? 1 : 0, BENCH_TARGET);
+}
+
+// A writer on another task (other core on the device) publishes as fast as
+// it can while this one reads: no read may mix two versions, and versions
+// must never go backwards.
+struct BenchSnapRun { Snapshot<BenchSnap>* s; std::atomic<bool> stop{false}, done{false}; uint32_t pubs = 0; };
+
+static void bench_snap_writer(void* arg) {
+  BenchSnapRun* r = (BenchSnapRun*)arg;
+  BenchSnap v;
+  while (!r->stop.load(std::memory_order_relaxed)) {
+    r->pubs++;
+    for (uint32_t& x : v.w) x = r->pubs;
+    r->s->publish(v);
+  }
+  r->done.store(true);
+#ifdef ARDUINO
+  vTaskDelete(nullptr);
+#endif
+}
+
+static void bench_check_snapshot(char* line, size_t cap) {
+  static Snapshot<BenchSnap> s;
+  BenchSnapRun run; run.s = &s;
+#ifdef ARDUINO
+  xTaskCreatePinnedToCore(bench_snap_writer, "snapw", 2048, &run, 1, nullptr, 0);
+#else
+  std::thread w(bench_snap_writer, &run);
+#endif
+  uint32_t reads = 0, torn = 0, back = 0, prev = 0;
+  while (reads < 200000) {
+    BenchSnap v;
+    uint32_t n = s.read(v);
+    for (uint32_t x : v.w) torn += x != v.w[0];
+    torn += n != v.w[0];
+    back += n < prev;
+    prev = n; reads++;
+  }
+  run.stop.store(true);
+#ifdef ARDUINO
+  while (!run.done.load()) delay(1);
+#else
+  w.join();
+#endif
+  bool ok = !torn && !back && run.pubs > 0;
+  snprintf(line, cap, "{\"check\":\"snapshot\",\"reads\":%lu,\"pubs\":%lu,\"retries\":%lu,\"torn\":%lu,\"pass\":%d,\"target\":\"%s\"}",
+           (unsigned long)reads, (unsigned long)run.pubs, (unsigned long)s.retries.load(), (unsigned long)(torn + back),
+           ok ? 1 : 0, BENCH_TARGET);
+}
+
+// Tables and squared/cosine thresholds against libm, over dense sweeps.
+// Threshold tests may only disagree within float rounding of the boundary.
+static void bench_check_fastmath(char* line, size_t cap) {
+  double sp = 0;
+  for (float r = 0.05f; r <= 2.5f; r += 0.0005f)              // msIR = dcIR = dcRED = 1
+    sp = fmax(sp, fabs(SPO2_LUT(r * r) - spo2_libm(1, r * r, 1, 1)));
+  uint32_t far = 0;
+  for (int i = -200000; i <= 200000; ++i) {
+    float z = i / 200000.0f, c = fabsf(z);
+    bool edge = fabsf(c - COS_LYING) < 1e-5f || fabsf(c - COS_SITTING) < 1e-5f;
+    far += posture_from_up(z) != posture_libm(z) && !edge;
+  }
+  for (int i = 0; i <= 400000; ++i) {
+    float m = i * 1e-4f, a2 = m * m, d = fabsf(m - G);        // |a| 0..40 m/s2
+    bool edge = fabsf(d - MOTION_DYN) < 1e-4f || fabsf(d - NO_MOTION_DYN) < 1e-4f
+             || fabsf(d - 2 * NO_MOTION_DYN) < 1e-4f || fabsf(m - IMPACT_G * G) < 1e-4f;
+    bool diff = MOTION_BAND.outside(a2) != (d > MOTION_DYN) || STILL_BAND.outside(a2) != (d > NO_MOTION_DYN)
+             || STILL_BAND_LYING.outside(a2) != (d > 2 * NO_MOTION_DYN) || (a2 > IMPACT_A2) != (m > IMPACT_G * G);
+    far += diff && !edge;
+  }
+  bool ok = sp < 0.2 && !far;
+  snprintf(line, cap, "{\"check\":\"fastmath\",\"spo2_abs\":%.3f,\"thr_mismatch\":%lu,\"pass\":%d,\"target\":\"%s\"}",
+           sp, (unsigned long)far, ok ? 1 : 0, BENCH_TARGET);
+}
+
+// Decoded records must read exactly like printf of the same format, and a
+// full ring must drop whole records and count them.
+#define BENCH_TLOG_SAME(id, ...) do {                                         \
+    uint8_t rec[TLOG_REC_MAX]; char a[TLOG_LINE_MAX], b[TLOG_LINE_MAX];        \
+    size_t n = tlog_encode<id>(rec, 0, __VA_ARGS__);                           \
+    bad += tlog_format(a, sizeof(a), rec, n) < 0;                             \
+    snprintf(b, sizeof(b), TLOG_DEFS[id].fmt, __VA_ARGS__);                   \
+    bad += strcmp(a, b) != 0; fmts++;                                         \
+  } while (0)
+
+static void bench_check_tlog(char* line, size_t cap) {
+  uint32_t bad = 0, fmts = 0;
+  BENCH_TLOG_SAME(TL_FALL_IMPACT, 31.27f, 31.27f / 9.81f);
+  BENCH_TLOG_SAME(TL_FALL_STATE, 1, 0, 1, 4321u, 0, -0.5f, 12345ul, 2);
+  BENCH_TLOG_SAME(TL_NET_POST_ERR, "http://10.0.0.2/data", -11);
+  BENCH_TLOG_SAME(TL_NET_WIFI_OK, 2840ul, 7);
+  BENCH_TLOG_SAME(TL_HEALTH_ISOLATE, "scd", 4u, 137u, 8000ul);
+  BENCH_TLOG_SAME(TL_ALERT_ACK, "fall", 2147483649ul, "link", 312ul);
+  BENCH_TLOG_SAME(TL_MPU_SAMPLE, 0.01f, -9.79f, 0.33f, 0.002f, -0.014f, 1.5f);
+
+  uint8_t rec[TLOG_REC_MAX];
+  char    txt[TLOG_LINE_MAX];
+  TlogRing& g = bench_tlog_ring;
+  g.r = g.w;
+  uint32_t d0 = g.dropped, r0 = g.records, taken = 0;
+  for (uint32_t i = 0; i < 1000; ++i) tlog_to<TL_HEALTH_BACK>(g, "bme", i);
+  while (size_t n = tlog_take(rec, sizeof(rec), 1, g)) {
+    bad += tlog_format(txt, sizeof(txt), rec, n) < 0 || n != rec[0];
+    taken++;
+  }
+  uint32_t dropped = g.dropped - d0;
+  bool ok = !bad && taken + dropped == 1000 && taken == g.records - r0 && dropped > 0;
+  snprintf(line, cap, "{\"check\":\"tlog\",\"formats\":%lu,\"ring_taken\":%lu,\"ring_dropped\":%lu,\"bad\":%lu,\"pass\":%d,\"target\":\"%s\"}",
+           (unsigned long)fmts, (unsigned long)taken, (unsigned long)dropped, (unsigned long)bad, ok ? 1 : 0, BENCH_TARGET);
+}
+
+// Report policy on a BLE-like lane (2 s min gap) over ten minutes each:
+// values flapping across a publish-quantum boundary every second must cost
+// no more frames than stable ones, and a steady ramp must still report
+// within RP_ROC_RUN seconds.
+static uint32_t bench_rp_run(int mode, uint32_t* first_hr_s) {
+  RpLane l;
+  rp_init(l, 2000);
+  float v[TF_N] = { 70, 97, 33.5f, 24.5f, 400, 120, 1, 0.4f, 0, 40.4168f, -3.7038f };
+  uint32_t frames = 0;
+  for (uint32_t t = 1; t <= 600; ++t) {
+    if (mode == 1) { v[TF_HR] = (t & 1) ? 75 : 70; v[TF_CO2] = (t & 1) ? 450 : 400; v[TF_SKIN] = (t & 1) ? 34 : 33.5f; }
+    if (mode == 2 && t > 100 && t <= 104) v[TF_HR] += 5;
+    uint16_t m = rp_eval(l, v, t * 1000);
+    if (!m) continue;
+    if (mode == 2 && t > 100 && (m & (1u << TF_HR)) && !*first_hr_s) *first_hr_s = t - 100;
+    rp_commit(l, v, m, t * 1000, 100);
+    frames++;
+  }
+  return frames;
+}
+
+static void bench_check_rp(char* line, size_t cap) {
+  uint32_t ramp_s = 0;
+  uint32_t stable = bench_rp_run(0, nullptr), flap = bench_rp_run(1, nullptr);
+  bench_rp_run(2, &ramp_s);
+  bool ok = flap <= stable && ramp_s && ramp_s <= RP_ROC_RUN;
+  snprintf(line, cap, "{\"check\":\"report_policy\",\"frames_stable\":%lu,\"frames_flap\":%lu,\"ramp_s\":%lu,\"pass\":%d,\"target\":\"%s\"}",
+           (unsigned long)stable, (unsigned long)flap, (unsigned long)ramp_s, ok ? 1 : 0, BENCH_TARGET);
+}
+
+// True when `filter` is empty or part of one of the space-separated case
+// names: a check runs with the cases it backs, by the test bench_run uses.
+static bool bench_check_match(const char* names, const char* filter) {
+  if (!*filter) return true;
+  char name[24];
+  while (*names) {
+    size_t n = strcspn(names, " ");
+    if (n < sizeof(name)) {
+      memcpy(name, names, n); name[n] = 0;
+      if (strstr(name, filter)) return true;
+    }
+    names += n;
+    while (*names == ' ') ++names;
+  }
+  return false;
+}
+
+// Checks matching `filter` (all when empty); out(line) as in bench_run.
+template <typename Out>
+static void bench_checks(const char* filter, Out out) {
+  char line[192];
+  if (bench_check_match("orient_madgwick orient_legacy_lp", filter)) {
+    bench_check_orient(line, sizeof(line)); out(line);
+    bench_check_orient_q16(line, sizeof(line)); out(line);
+  }
+  if (bench_check_match("spo2_lut spo2_libm imu_mag2 imu_mag_sqrtf posture_cos posture_acosf", filter)) {
+    bench_check_fastmath(line, sizeof(line)); out(line);
+  }
+  if (bench_check_match("ctrl_parse ctrl_parse_bin", filter)) { bench_check_ctrl(line, sizeof(line)); out(line); }
+  if (bench_check_match("hist_encode", filter)) { bench_check_gorilla(line, sizeof(line)); out(line); }
+  if (bench_check_match("lz_batch_d1 lz_batch_d8 lz_batch_d32 lz_decode", filter)) {
+    bench_check_lzss(line, sizeof(line)); out(line);
+  }
+  if (bench_check_match("snap_publish snap_read", filter)) { bench_check_snapshot(line, sizeof(line)); out(line); }
+  if (bench_check_match("tlog_record tlog_snprintf", filter)) { bench_check_tlog(line, sizeof(line)); out(line); }
+  if (bench_check_match("rp_eval", filter)) { bench_check_rp(line, sizeof(line)); out(line); }
+}
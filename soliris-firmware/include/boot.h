@@ -0,0 +1,122 @@
+#pragma once
+// Fast boot: the bus topology found by a full probe (I2C ACK maps of Wire
+// and Wire1, the OneWire pin and ROM, where the MPU answered) is cached in
+// NVS. Next boot only checks that every cached device still answers and
+// skips the scans; any mismatch falls back to the full probe and rewrites
+// the cache. boot_stage() keeps a per-stage time breakdown.
+#include <Arduino.h>
+#include <Wire.h>
+#include <OneWire.h>
+#include <Preferences.h>
+#include "tlog.h"
+
+#define TOPO_VERSION      1
+#define BOOT_MAX_STAGES  16
+
+enum { BUS_WIRE = 0, BUS_WIRE1 = 1, BUS_ONEWIRE = 2 };   // i2c[] covers the first two
+
+struct BusTopo {
+  uint16_t version;
+  uint8_t  i2c[2][16];         // ACK bitmap per 7-bit address, [BUS_WIRE] / [BUS_WIRE1]
+  int8_t   ow_pin;             // -1: no OneWire device found
+  uint8_t  ow_rom[8];
+  int8_t   mpu_bus;            // -1: no MPU
+  uint8_t  mpu_addr;
+};
+
+static BusTopo topo = {};
+static bool    topo_stored = false;      // NVS had a record of this version
+static bool    topo_cached = false;      // this boot trusts it (verified)
+static bool    topo_dirty  = false;
+
+static inline bool topo_has(int bus, uint8_t a) { return topo.i2c[bus][a >> 3] & (1u << (a & 7)); }
+static inline void topo_set(int bus, uint8_t a) { topo.i2c[bus][a >> 3] |= (uint8_t)(1u << (a & 7)); }
+
+// Worth trying a device at this address? Always when the topology is unknown.
+static inline bool topo_expect(int bus, uint8_t a) { return !topo_cached || topo_has(bus, a); }
+
+static inline bool i2c_ack(TwoWire& bus, uint8_t a) {
+  bus.beginTransmission(a);
+  return bus.endTransmission() == 0;
+}
+
+// Cheap, before the buses are up: only reads NVS.
+static void topo_load() {
+  Preferences p; BusTopo t;
+  if (!p.begin("topo", true)) return;
+  size_t n = p.getBytes("t", &t, sizeof(t));
+  p.end();
+  if (n != sizeof(t) || t.version != TOPO_VERSION) return;
+  topo = t; topo_stored = true;
+}
+
+// One ACK per cached device plus a OneWire presence pulse; a few ms.
+static bool topo_verify(TwoWire& wire, TwoWire& wire1) {
+  if (!topo_stored) return false;
+  TwoWire* buses[2] = { &wire, &wire1 };
+  for (int b = 0; b < 2; ++b)
+    for (uint8_t a = 1; a < 127; ++a)
+      if (topo_has(b, a) && !i2c_ack(*buses[b], a)) {
+        Serial.printf("[TOPO] 0x%02X gone from bus %d, full probe\n", a, b);
+        return false;
+      }
+  if (topo.ow_pin >= 0) {
+    pinMode(topo.ow_pin, INPUT_PULLUP);
+    OneWire ow(topo.ow_pin);
+    if (!ow.reset()) { Serial.printf("[TOPO] no OneWire presence on GPIO %d, full probe\n", topo.ow_pin); return false; }
+  }
+  return topo_cached = true;
+}
+
+// Full probe of one bus, printed like the old i2c_scan().
+static void topo_scan(TwoWire& bus, int b, const char* name) {
+  memset(topo.i2c[b], 0, sizeof(topo.i2c[b]));
+  Serial.print("[SCAN] "); Serial.print(name); Serial.print(": ");
+  for (uint8_t a = 1; a < 127; a++)
+    if (i2c_ack(bus, a)) { topo_set(b, a); Serial.print("0x"); Serial.print(a, HEX); Serial.print(" "); }
+  Serial.println();
+  topo_dirty = true;
+}
+
+static void topo_save() {
+  if (!topo_dirty) return;
+  topo.version = TOPO_VERSION;
+  Preferences p;
+  if (!p.begin("topo", false)) return;
+  p.putBytes("t", &topo, sizeof(topo));
+  p.end();
+  topo_dirty = false;
+}
+
+// A cached device failed to start: probe everything next boot.
+static void topo_invalidate() {
+  Preferences p;
+  if (!p.begin("topo", false)) return;
+  p.remove("t");
+  p.end();
+}
+
+// ---- boot timing -------------------------------------------------------------
+struct BootStage { const char* name; uint16_t ms; };
+
+static BootStage boot_stages[BOOT_MAX_STAGES];
+static uint8_t   boot_nstages = 0;
+static uint32_t  boot_prev_ms = 0, boot_total_ms = 0, boot_first_sample_ms = 0;
+
+// Closes the stage that ends now (time since the previous call, or reset).
+static void boot_stage(const char* name) {
+  uint32_t t = millis();
+  if (boot_nstages < BOOT_MAX_STAGES) boot_stages[boot_nstages++] = { name, (uint16_t)(t - boot_prev_ms) };
+  boot_prev_ms = t;
+}
+
+// Once every device is up or failed.
+static void boot_report() {
+  boot_total_ms = millis();
+  tlog<TL_BOOT_DONE>((unsigned long)boot_total_ms, topo_cached ? "cached" : "probed");
+  for (int i = 0; i < boot_nstages; ++i) tlog<TL_BOOT_STAGE>(boot_stages[i].name, (unsigned)boot_stages[i].ms);
+}
+
+static inline void boot_first_sample() {
+  if (!boot_first_sample_ms) boot_first_sample_ms = millis();
+}
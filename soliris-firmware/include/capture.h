@@ -0,0 +1,148 @@
+#pragma once
+// Raw waveform capture over USB CDC ({"capture":1} / {"capture":0}).
+//
+// Samplers call cap_ppg()/cap_imu() right after reading the sensor; samples
+// are packed into blocks and each full block is framed (frame.h) into a byte
+// ring. capture_service() drains whole frames to the CDC endpoint only as far
+// as availableForWrite() allows, so a slow or absent host never blocks the
+// samplers: when the ring is full the frame is dropped and counted. Every
+// frame carries a per-channel sequence number and a CAP_STATUS frame with the
+// cumulative drop count goes out once per second.
+#include <Arduino.h>
+#include "frame.h"
+
+#ifndef CAP_RING_BYTES
+  #define CAP_RING_BYTES    16384
+#endif
+#define CAP_PPG_BLOCK       25          // 250 ms of 100 Hz PPG  -> 212 B payload
+#define CAP_IMU_BLOCK       10          // 200 ms of 50 Hz IMU   -> 244 B payload
+#define CAP_STATUS_MS       1000
+
+static bool     cap_on = false;
+static uint16_t cap_seq = 0;
+static uint32_t cap_frames = 0, cap_dropped = 0, cap_bytes = 0;
+static uint32_t cap_next_status_ms = 0;
+
+// byte ring of [u16 len][wire bytes] records
+static uint8_t  cap_ring[CAP_RING_BYTES];
+static uint32_t cap_r = 0, cap_w = 0;     // free-running indices
+
+struct CapBlock {
+  uint8_t  buf[4 + 24 * CAP_IMU_BLOCK > 4 + 8 * CAP_PPG_BLOCK ? 4 + 24 * CAP_IMU_BLOCK : 4 + 8 * CAP_PPG_BLOCK];
+  uint16_t n, len;
+  uint32_t t0_us, last_us;
+};
+static CapBlock cap_ppg_blk = {}, cap_imu_blk = {};
+
+static void cap_ring_put(const uint8_t* p, uint32_t n) {
+  for (uint32_t i = 0; i < n; ++i) cap_ring[(cap_w + i) % CAP_RING_BYTES] = p[i];
+  cap_w += n;
+}
+
+static void cap_emit(uint8_t type, uint32_t t_us, const uint8_t* payload, size_t n) {
+  uint8_t wire[FRAME_MAX_WIRE];
+  FrameHdr h = { FRAME_CH_CAPTURE, type, cap_seq++, t_us };
+  size_t len = frame_build(wire, sizeof(wire), h, payload, n);
+  if (!len) return;
+  if (CAP_RING_BYTES - (cap_w - cap_r) < len + 2) { cap_dropped++; return; }
+  uint8_t l[2]; frame_put16(l, (uint16_t)len);
+  cap_ring_put(l, 2);
+  cap_ring_put(wire, len);
+  cap_frames++;
+}
+
+// period is derived from the block's own timestamps, not the nominal rate
+static void cap_block_flush(CapBlock& b, uint8_t type) {
+  if (!b.n) return;
+  uint32_t per10 = b.n > 1 ? (b.last_us - b.t0_us) / (b.n - 1) / 10 : 0;
+  frame_put16(b.buf, (uint16_t)min<uint32_t>(per10, 0xFFFF));
+  frame_put16(b.buf + 2, b.n);
+  cap_emit(type, b.t0_us, b.buf, b.len);
+  b.n = 0; b.len = 4;
+}
+
+static inline void cap_block_stamp(CapBlock& b, uint32_t t_us) {
+  if (!b.n) { b.t0_us = t_us; b.len = 4; }
+  b.last_us = t_us;
+}
+
+static void cap_ppg(uint32_t t_us, uint32_t ir, uint32_t red) {
+  if (!cap_on) return;
+  CapBlock& b = cap_ppg_blk;
+  cap_block_stamp(b, t_us);
+  frame_put32(b.buf + b.len, ir);  frame_put32(b.buf + b.len + 4, red);
+  b.len += 8;
+  if (++b.n == CAP_PPG_BLOCK) cap_block_flush(b, CAP_PPG);
+}
+
+static void cap_imu(uint32_t t_us, float ax, float ay, float az, float gx, float gy, float gz) {
+  if (!cap_on) return;
+  CapBlock& b = cap_imu_blk;
+  cap_block_stamp(b, t_us);
+  float v[6] = { ax, ay, az, gx, gy, gz };
+  memcpy(b.buf + b.len, v, sizeof(v));        // ESP32 and x86 are both little endian
+  b.len += sizeof(v);
+  if (++b.n == CAP_IMU_BLOCK) cap_block_flush(b, CAP_IMU);
+}
+
+// 1 Hz inputs of the ambient / on-wrist pipelines, one frame per reading.
+static void cap_env(uint32_t t_us, float t_c, float rh, float hpa, float skin_c) {
+  if (!cap_on) return;
+  float v[4] = { t_c, rh, hpa, skin_c };
+  cap_emit(CAP_ENV, t_us, (const uint8_t*)v, sizeof(v));
+}
+
+static void cap_status(uint32_t t_us) {
+  uint8_t p[13];
+  frame_put32(p, cap_frames); frame_put32(p + 4, cap_dropped); frame_put32(p + 8, cap_bytes);
+  p[12] = cap_on;
+  cap_emit(CAP_STATUS, t_us, p, sizeof(p));
+}
+
+static void capture_set(bool on) {
+  if (on == cap_on) return;
+  if (!on) {                                  // flush partial blocks, then a final status
+    cap_block_flush(cap_ppg_blk, CAP_PPG);
+    cap_block_flush(cap_imu_blk, CAP_IMU);
+    cap_on = false;
+    cap_status(micros());
+    return;
+  }
+  cap_ppg_blk.n = cap_imu_blk.n = 0;
+  cap_frames = cap_dropped = cap_bytes = 0;
+  cap_on = true;
+  cap_next_status_ms = millis();
+}
+
+// Call from loop(): writes complete frames only, never waits for the host.
+static void capture_service(uint32_t now) {
+  if (cap_on && (int32_t)(now - cap_next_status_ms) >= 0) {
+    cap_next_status_ms = now + CAP_STATUS_MS;
+    cap_status(micros());
+  }
+  while (cap_w != cap_r) {
+    uint8_t l[2] = { cap_ring[cap_r % CAP_RING_BYTES], cap_ring[(cap_r + 1) % CAP_RING_BYTES] };
+    uint16_t len = frame_get16(l);
+    if (Serial.availableForWrite() < (int)len) break;
+    uint32_t at = (cap_r + 2) % CAP_RING_BYTES;
+    uint32_t first = min<uint32_t>(len, CAP_RING_BYTES - at);
+    Serial.write(cap_ring + at, first);
+    if (first < len) Serial.write(cap_ring, len - first);
+    cap_r += 2 + len;
+    cap_bytes += len;
+  }
+}
+
+// Before Serial.begin(): a larger TX buffer and a short write timeout. With
+// 0, HWCDC drops whatever doesn't fit at once and cuts text lines in the
+// middle; a few ms lets a reading host take the rest of the line, while a
+// port nobody reads still stalls a write for at most that long. Frames are
+// checked against availableForWrite() and never hit the timeout.
+#define CAP_TX_TIMEOUT_MS   10
+
+static void capture_serial_setup() {
+#if ARDUINO_USB_MODE && ARDUINO_USB_CDC_ON_BOOT
+  Serial.setTxBufferSize(4096);
+  Serial.setTxTimeoutMs(CAP_TX_TIMEOUT_MS);
+#endif
+}
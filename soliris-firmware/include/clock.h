@@ -0,0 +1,42 @@
+#pragma once
+// Wall-clock helpers. The device has no RTC battery: time is only known once
+// SNTP has synced over Wi-Fi. Everything that needs calendar time must cope
+// with clock_epoch() == 0 and fall back to uptime.
+#include <Arduino.h>
+#include <time.h>
+
+#ifndef SOLIRIS_TZ
+  #define SOLIRIS_TZ   "CET-1CEST,M3.5.0,M10.5.0/3"   // Madrid (DEMO_LOCATION)
+#endif
+#ifndef NTP_SERVER
+  #define NTP_SERVER   "pool.ntp.org"
+#endif
+
+static bool clock_started = false;
+
+static void clock_begin() {
+  if (clock_started) return;
+  configTzTime(SOLIRIS_TZ, NTP_SERVER);
+  clock_started = true;
+}
+
+// Seconds since epoch, or 0 while the clock is not set.
+static inline uint32_t clock_epoch() {
+  time_t t = time(nullptr);
+  return (t > 1700000000) ? (uint32_t)t : 0;
+}
+
+// Local calendar day as yyyymmdd, or 0 while the clock is not set.
+static inline uint32_t clock_day_id() {
+  time_t t = (time_t)clock_epoch();
+  if (!t) return 0;
+  struct tm lt; localtime_r(&t, &lt);
+  return (uint32_t)((lt.tm_year + 1900) * 10000 + (lt.tm_mon + 1) * 100 + lt.tm_mday);
+}
+
+static inline int clock_local_hour() {
+  time_t t = (time_t)clock_epoch();
+  if (!t) return (int)((millis() / 3600000UL) % 24);
+  struct tm lt; localtime_r(&t, &lt);
+  return lt.tm_hour;
+}
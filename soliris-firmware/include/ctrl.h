@@ -0,0 +1,333 @@
+#pragma once
+// Control commands, one per serial line or BLE write, in either encoding:
+//   JSON    {"led":true,"buzz":false,"play":"sun","capture":1,"log":"text","get":"hist",...,"id":7}
+//   binary  0xC5 <len> then <len> bytes of { <op> <n> <n value bytes> }
+//           (strings raw, integers little-endian on 1-4 bytes)
+// Keys and opcodes share one table (CTRL_KEYS). Parsing never touches the
+// heap: JSON strings are unescaped into a fixed arena on the parser's stack
+// (reentrant, BLE writes parse on the NimBLE task) and copied into the
+// command. Parsing is kept apart from applying (main.cpp) so it runs on the
+// host too.
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define CTRL_MAX_LINE  256
+#define CTRL_BIN_MAGIC 0xC5
+
+struct CtrlCmd {
+  int8_t   led = -1, buzz = -1, capture = -1;   // -1: not in the command
+  char     play[8] = "", get[8] = "", metric[12] = "hr";
+  int32_t  n = -1;                               // -1: query default
+  uint32_t res = 60, from = 0, to = 0;
+  int      max = 240;
+  uint32_t id = 0;                               // echoed in the ack, 0: none
+  uint32_t ev_ack = 0;                           // safety event id acked by the host
+  char     rp[12] = "", via[6] = "";             // report rule: field or "*", lane ("": all)
+  int32_t  db = -1, rel = -1, roc = -1, sil = -1; // rule values, -1: keep
+  char     enc[16] = "";                         // bridge encoding: "lzss" or "none"
+  char     log[6] = "";                          // serial logs: "bin", "text" or "off"
+};
+
+// ---- dispatch table ----------------------------------------------------------
+enum CtrlKind : uint8_t { CK_BOOL, CK_FLAG, CK_STR, CK_INT, CK_UINT };
+enum CtrlValType : uint8_t { CV_NULL, CV_BOOL, CV_NUM, CV_STR, CV_OTHER };
+
+struct CtrlVal {
+  uint8_t     type;
+  bool        b;
+  int64_t     i;
+  bool        integral;
+  const char* s;
+  size_t      len;
+};
+
+struct CtrlKey {
+  const char* key;
+  uint8_t     op;                                // binary opcode
+  uint8_t     kind;
+  void      (*set)(CtrlCmd&, const CtrlVal&);   // called with a value of the right kind
+};
+
+static inline void ctrl_copy(char* dst, size_t cap, const char* s, size_t n) {
+  if (n > cap - 1) n = cap - 1;
+  memcpy(dst, s, n);
+  dst[n] = 0;
+}
+
+static void ck_led(CtrlCmd& c, const CtrlVal& v)     { c.led  = v.b; }
+static void ck_buzz(CtrlCmd& c, const CtrlVal& v)    { c.buzz = v.b; }
+static void ck_capture(CtrlCmd& c, const CtrlVal& v) { c.capture = v.b; }
+static void ck_play(CtrlCmd& c, const CtrlVal& v)    { ctrl_copy(c.play, sizeof(c.play), v.s, v.len); }
+static void ck_get(CtrlCmd& c, const CtrlVal& v)     { ctrl_copy(c.get, sizeof(c.get), v.s, v.len); }
+static void ck_metric(CtrlCmd& c, const CtrlVal& v)  { ctrl_copy(c.metric, sizeof(c.metric), v.s, v.len); }
+static void ck_n(CtrlCmd& c, const CtrlVal& v)       { c.n = (int32_t)v.i; }
+static void ck_res(CtrlCmd& c, const CtrlVal& v)     { c.res = (uint32_t)v.i; }
+static void ck_from(CtrlCmd& c, const CtrlVal& v)    { c.from = (uint32_t)v.i; }
+static void ck_to(CtrlCmd& c, const CtrlVal& v)      { c.to = (uint32_t)v.i; }
+static void ck_max(CtrlCmd& c, const CtrlVal& v)     { c.max = (int)v.i; }
+static void ck_id(CtrlCmd& c, const CtrlVal& v)      { c.id = (uint32_t)v.i; }
+static void ck_ev_ack(CtrlCmd& c, const CtrlVal& v)  { c.ev_ack = (uint32_t)v.i; }
+static void ck_rp(CtrlCmd& c, const CtrlVal& v)      { ctrl_copy(c.rp, sizeof(c.rp), v.s, v.len); }
+static void ck_via(CtrlCmd& c, const CtrlVal& v)     { ctrl_copy(c.via, sizeof(c.via), v.s, v.len); }
+static void ck_db(CtrlCmd& c, const CtrlVal& v)      { c.db = (int32_t)v.i; }
+static void ck_rel(CtrlCmd& c, const CtrlVal& v)     { c.rel = (int32_t)v.i; }
+static void ck_roc(CtrlCmd& c, const CtrlVal& v)     { c.roc = (int32_t)v.i; }
+static void ck_sil(CtrlCmd& c, const CtrlVal& v)     { c.sil = (int32_t)v.i; }
+static void ck_enc(CtrlCmd& c, const CtrlVal& v)     { ctrl_copy(c.enc, sizeof(c.enc), v.s, v.len); }
+static void ck_log(CtrlCmd& c, const CtrlVal& v)     { ctrl_copy(c.log, sizeof(c.log), v.s, v.len); }
+
+// New commands: add a CtrlCmd field, a setter and a row; opcodes are never reused.
+static constexpr CtrlKey CTRL_KEYS[] = {
+  { "led",     0x01, CK_BOOL, ck_led },
+  { "buzz",    0x02, CK_BOOL, ck_buzz },
+  { "play",    0x03, CK_STR,  ck_play },
+  { "capture", 0x04, CK_FLAG, ck_capture },
+  { "get",     0x05, CK_STR,  ck_get },
+  { "m",       0x06, CK_STR,  ck_metric },
+  { "n",       0x07, CK_INT,  ck_n },
+  { "res",     0x08, CK_UINT, ck_res },
+  { "from",    0x09, CK_UINT, ck_from },
+  { "to",      0x0A, CK_UINT, ck_to },
+  { "max",     0x0B, CK_INT,  ck_max },
+  { "id",      0x0C, CK_UINT, ck_id },
+  { "ev_ack",  0x0D, CK_UINT, ck_ev_ack },
+  { "rp",      0x0E, CK_STR,  ck_rp },
+  { "via",     0x0F, CK_STR,  ck_via },
+  { "db",      0x10, CK_INT,  ck_db },
+  { "rel",     0x11, CK_INT,  ck_rel },
+  { "roc",     0x12, CK_INT,  ck_roc },
+  { "sil",     0x13, CK_INT,  ck_sil },
+  { "enc",     0x14, CK_STR,  ck_enc },
+  { "log",     0x15, CK_STR,  ck_log },
+};
+static constexpr int CTRL_NKEYS = sizeof(CTRL_KEYS) / sizeof(CTRL_KEYS[0]);
+
+static constexpr bool ctrl_ops_unique(int i = 0, int j = 1) {
+  return i >= CTRL_NKEYS ? true
+       : j >= CTRL_NKEYS ? ctrl_ops_unique(i + 1, i + 2)
+       : CTRL_KEYS[i].op != CTRL_KEYS[j].op && ctrl_ops_unique(i, j + 1);
+}
+static_assert(ctrl_ops_unique(), "duplicate control opcode");
+
+static const CtrlKey* ctrl_key_by_name(const char* s, size_t n) {
+  for (const CtrlKey& k : CTRL_KEYS)
+    if (!strncmp(k.key, s, n) && k.key[n] == 0) return &k;
+  return nullptr;
+}
+
+static const CtrlKey* ctrl_key_by_op(uint8_t op) {
+  for (const CtrlKey& k : CTRL_KEYS) if (k.op == op) return &k;
+  return nullptr;
+}
+
+// Coerces v to the key's kind (same rules as the ArduinoJson version:
+// led/buzz need a real bool, capture takes any non-null, numbers must be
+// integers and unsigned fields non-negative); false: ignore the key.
+static bool ctrl_coerce(const CtrlKey& k, CtrlVal& v) {
+  switch (k.kind) {
+    case CK_BOOL: return v.type == CV_BOOL;
+    case CK_FLAG:
+      if (v.type == CV_NULL) return false;
+      v.b = v.type == CV_BOOL ? v.b : v.type == CV_NUM ? v.i != 0 : false;
+      return true;
+    case CK_STR:  return v.type == CV_STR;
+    case CK_INT:  return v.type == CV_NUM && v.integral && v.i >= INT32_MIN && v.i <= INT32_MAX;
+    case CK_UINT: return v.type == CV_NUM && v.integral && v.i >= 0 && v.i <= UINT32_MAX;
+  }
+  return false;
+}
+
+// ---- JSON --------------------------------------------------------------------
+// Flat objects only: nested values are skipped and never match a key.
+struct CtrlJson {
+  const char* p; const char* e;
+  size_t arena_used = 0;
+  char   arena[CTRL_MAX_LINE];
+
+  CtrlJson(const char* s, size_t len) : p(s), e(s + len) {}
+
+  void ws() { while (p < e && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) ++p; }
+  bool lit(const char* w) {
+    size_t n = strlen(w);
+    if ((size_t)(e - p) < n || memcmp(p, w, n)) return false;
+    p += n; return true;
+  }
+
+  // Unescapes into the arena; \uXXXX outside ASCII becomes '?'.
+  bool str(CtrlVal& v) {
+    if (p >= e || *p != '"') return false;
+    ++p;
+    char* out = arena + arena_used; char* cap = arena + sizeof(arena);
+    v.type = CV_STR; v.s = out;
+    while (p < e && *p != '"') {
+      char ch = *p++;
+      if (ch == '\\') {
+        if (p >= e) return false;
+        ch = *p++;
+        switch (ch) {
+          case 'n': ch = '\n'; break; case 't': ch = '\t'; break; case 'r': ch = '\r'; break;
+          case 'b': ch = '\b'; break; case 'f': ch = '\f'; break;
+          case 'u': {
+            if (e - p < 4) return false;
+            unsigned u = 0;
+            for (int i = 0; i < 4; ++i) {
+              char h = *p++; u <<= 4;
+              if (h >= '0' && h <= '9') u |= h - '0';
+              else if ((h | 0x20) >= 'a' && (h | 0x20) <= 'f') u |= (h | 0x20) - 'a' + 10;
+              else return false;
+            }
+            ch = u < 0x80 ? (char)u : '?';
+          } break;
+          default: break;                        // \" \\ \/
+        }
+      }
+      if (out >= cap) return false;
+      *out++ = ch;
+    }
+    if (p >= e) return false;
+    ++p;
+    v.len = out - v.s;
+    arena_used += v.len;
+    return true;
+  }
+
+  bool num(CtrlVal& v) {
+    bool neg = p < e && *p == '-'; if (neg) ++p;
+    if (p >= e || *p < '0' || *p > '9') return false;
+    int64_t x = 0;
+    while (p < e && *p >= '0' && *p <= '9') { if (x < (INT64_MAX / 10)) x = x * 10 + (*p - '0'); ++p; }
+    v.type = CV_NUM; v.integral = true; v.i = neg ? -x : x;
+    if (p < e && *p == '.') { v.integral = false; ++p; while (p < e && *p >= '0' && *p <= '9') ++p; }
+    if (p < e && (*p == 'e' || *p == 'E')) {
+      v.integral = false; ++p;
+      if (p < e && (*p == '+' || *p == '-')) ++p;
+      while (p < e && *p >= '0' && *p <= '9') ++p;
+    }
+    return true;
+  }
+
+  // Skips a nested object/array, strings included.
+  bool skip() {
+    int depth = 0;
+    while (p < e) {
+      char ch = *p++;
+      if (ch == '"') { while (p < e && *p != '"') { if (*p == '\\') ++p; ++p; } if (p >= e) return false; ++p; }
+      else if (ch == '{' || ch == '[') depth++;
+      else if (ch == '}' || ch == ']') { if (--depth == 0) return true; }
+    }
+    return false;
+  }
+
+  bool value(CtrlVal& v) {
+    ws();
+    if (p >= e) return false;
+    v.type = CV_NULL;
+    switch (*p) {
+      case '"': return str(v);
+      case 't': v.type = CV_BOOL; v.b = true;  return lit("true");
+      case 'f': v.type = CV_BOOL; v.b = false; return lit("false");
+      case 'n': return lit("null");
+      case '{': case '[': v.type = CV_OTHER; return skip();
+      default:  return num(v);
+    }
+  }
+};
+
+static bool ctrl_parse_json(const char* s, size_t len, CtrlCmd& c) {
+  CtrlJson j(s, len);
+  j.ws();
+  if (j.p >= j.e || *j.p != '{') return false;
+  ++j.p; j.ws();
+  if (j.p < j.e && *j.p == '}') { ++j.p; }
+  else for (;;) {
+    CtrlVal k, v;
+    j.ws();
+    size_t mark = j.arena_used;
+    if (!j.str(k)) return false;
+    j.arena_used = mark;                         // key text only needed for the lookup
+    const CtrlKey* key = ctrl_key_by_name(k.s, k.len);
+    j.ws();
+    if (j.p >= j.e || *j.p != ':') return false;
+    ++j.p;
+    if (!j.value(v)) return false;
+    if (key && ctrl_coerce(*key, v)) key->set(c, v);
+    j.ws();
+    if (j.p < j.e && *j.p == ',') { ++j.p; continue; }
+    if (j.p < j.e && *j.p == '}') { ++j.p; break; }
+    return false;
+  }
+  j.ws();
+  return j.p == j.e;
+}
+
+// ---- binary ------------------------------------------------------------------
+static bool ctrl_parse_bin(const uint8_t* b, size_t len, CtrlCmd& c) {
+  if (len < 2 || b[0] != CTRL_BIN_MAGIC || b[1] != len - 2) return false;
+  for (size_t i = 2; i < len; ) {
+    if (len - i < 2) return false;
+    uint8_t op = b[i], n = b[i + 1];
+    i += 2;
+    if (len - i < n) return false;
+    const CtrlKey* k = ctrl_key_by_op(op);
+    if (k) {
+      CtrlVal v = {};
+      if (k->kind == CK_STR) { v.type = CV_STR; v.s = (const char*)b + i; v.len = n; }
+      else if (n <= 4) {
+        uint32_t x = 0;
+        for (int q = n - 1; q >= 0; --q) x = (x << 8) | b[i + q];
+        v.type = k->kind == CK_BOOL ? CV_BOOL : CV_NUM;
+        v.b = x != 0; v.integral = true;
+        v.i = (k->kind == CK_INT && n == 4) ? (int64_t)(int32_t)x : (int64_t)x;
+      }
+      if (ctrl_coerce(*k, v)) k->set(c, v);
+    }
+    i += n;
+  }
+  return true;
+}
+
+static bool ctrl_parse(const char* s, size_t len, CtrlCmd& c) {
+  if (len && (uint8_t)s[0] == CTRL_BIN_MAGIC) return ctrl_parse_bin((const uint8_t*)s, len, c);
+  return ctrl_parse_json(s, len, c);
+}
+
+// ---- byte stream -------------------------------------------------------------
+// Splits a serial stream into commands: text lines (trimmed, NUL-terminated)
+// and length-prefixed binary commands. Over-long input is dropped whole.
+struct CtrlRx {
+  char     buf[CTRL_MAX_LINE + 2];
+  uint16_t n = 0, need = 0;
+  uint8_t  st = 0;                               // 0 line, 1 binary length, 2 binary body
+  bool     drop = false;
+  uint32_t overflows = 0;
+
+  void reset() { n = 0; st = 0; drop = false; }
+
+  // on_cmd(const char* s, size_t n)
+  template <typename F>
+  void push(uint8_t b, F on_cmd) {
+    if (st == 1) {
+      need = b; buf[n++] = (char)b; st = 2;
+      if (need > CTRL_MAX_LINE - 2) { drop = true; overflows++; }
+      if (!need) { on_cmd(buf, n); reset(); }
+      return;
+    }
+    if (st == 2) {
+      if (!drop) buf[n++] = (char)b;
+      if (--need == 0) { if (!drop) on_cmd(buf, n); reset(); }
+      return;
+    }
+    if (b == '\n') {
+      while (n && (buf[n - 1] == '\r' || buf[n - 1] == ' ' || buf[n - 1] == '\t')) n--;
+      buf[n] = 0;
+      if (n && !drop) on_cmd(buf, n);
+      reset();
+      return;
+    }
+    if (!n && (b == ' ' || b == '\t' || b == '\r')) return;
+    if (!n && !drop && b == CTRL_BIN_MAGIC) { buf[n++] = (char)b; st = 1; return; }
+    if (n >= CTRL_MAX_LINE - 1) { if (!drop) overflows++; drop = true; return; }
+    buf[n++] = (char)b;
+  }
+};
@@ -0,0 +1,75 @@
+#pragma once
+// Control command queue: serial RX is read from the HW CDC RX event, BLE
+// writes from the NimBLE task; both post whole commands (CtrlRx framing,
+// include/ctrl.h) with their receive time. loop() drains the queue every
+// iteration, so a command waits for at most one loop pass instead of the
+// 30 s push period.
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include "ctrl.h"
+#include "power.h"
+
+#define CTRL_Q_LEN        8
+#define CTRL_RX_BUF_BYTES 1024     // CDC RX buffer, absorbs bursts between events
+
+enum : uint8_t { CTRL_SRC_SERIAL = 0, CTRL_SRC_BLE = 1 };
+
+struct CtrlMsg {
+  uint32_t t_us;                   // receive time (micros)
+  uint8_t  src;
+  uint16_t n;
+  char     buf[CTRL_MAX_LINE + 2];
+};
+
+static QueueHandle_t ctrl_q = nullptr;
+static CtrlRx        ctrl_rx_serial;         // RX event task only
+static uint32_t      ctrl_q_rx = 0, ctrl_q_drops = 0;
+static uint32_t      ctrl_lat_max_us = 0, ctrl_lat_avg_us = 0;
+
+// Drops (and counts) the command when the queue is full. `m` is a scratch
+// message owned by the calling task: CtrlMsg is too big for the small
+// event/NimBLE stacks, and the queue copies it.
+static bool ctrl_enqueue(CtrlMsg& m, const char* s, size_t n, uint8_t src) {
+  if (!ctrl_q || n > sizeof(m.buf) - 1) { ctrl_q_drops++; return false; }
+  m.t_us = micros(); m.src = src; m.n = (uint16_t)n;
+  memcpy(m.buf, s, n); m.buf[n] = 0;
+  bool ok = xQueueSend(ctrl_q, &m, 0) == pdTRUE;
+  if (ok) { ctrl_q_rx++; pm_wake(); } else ctrl_q_drops++;
+  return ok;
+}
+
+static void ctrl_serial_rx_event(void*, esp_event_base_t, int32_t, void*) {
+  static CtrlMsg m;
+  while (Serial.available() > 0)
+    ctrl_rx_serial.push((uint8_t)Serial.read(), [](const char* s, size_t n) {
+      ctrl_enqueue(m, s, n, CTRL_SRC_SERIAL);
+    });
+}
+
+static void ctrl_ble_write(const char* s, size_t n) {
+  static CtrlMsg m;
+  ctrl_enqueue(m, s, n, CTRL_SRC_BLE);
+}
+
+// Before Serial.begin().
+static void ctrl_queue_begin() {
+  ctrl_q = xQueueCreate(CTRL_Q_LEN, sizeof(CtrlMsg));
+  Serial.setRxBufferSize(CTRL_RX_BUF_BYTES);
+  Serial.onEvent(ARDUINO_HW_CDC_RX_EVENT, ctrl_serial_rx_event);
+}
+
+// handle(const CtrlMsg&) for every queued command, oldest first.
+template <typename F>
+static void ctrl_queue_service(F handle) {
+  static CtrlMsg m;
+  while (ctrl_q && xQueueReceive(ctrl_q, &m, 0) == pdTRUE) handle(m);
+}
+
+// Receive-to-apply latency bookkeeping; returns the latency.
+static uint32_t ctrl_latency_note(const CtrlMsg& m) {
+  uint32_t lat = micros() - m.t_us;
+  if (lat > ctrl_lat_max_us) ctrl_lat_max_us = lat;
+  ctrl_lat_avg_us = ctrl_lat_avg_us ? (ctrl_lat_avg_us * 7 + lat) / 8 : lat;
+  return lat;
+}
@@ -0,0 +1,64 @@
+#pragma once
+// Compile-time tables and thresholds for the per-sample paths (PPG, IMU),
+// so they need no acosf/sqrtf:
+//
+//   - Lut<N>: f tabulated at N+1 points over [lo, hi], built by the compiler
+//     (lut_make with a constexpr f), read with linear interpolation.
+//   - Angle thresholds become cosine comparisons (tilt < 35 deg <=>
+//     cos(tilt) > cos_deg(35)), magnitude thresholds squared ones
+//     (|a| > k <=> a.a > k*k; MagBand for | |a| - c | > t).
+//
+// ce_sqrt/ce_cos are double-precision series meant for constant expressions
+// only. The error bound of each table is checked against libm by the
+// "fastmath" bench check. Portable.
+#include <stdint.h>
+
+static constexpr double CE_PI  = 3.14159265358979323846;
+
+constexpr double ce_sqrt(double x) {
+  if (x <= 0) return 0;
+  double g = x > 1 ? x : 1;
+  for (int i = 0; i < 64; ++i) g = 0.5 * (g + x / g);
+  return g;
+}
+
+constexpr double ce_cos(double rad) {
+  while (rad >  CE_PI) rad -= 2 * CE_PI;
+  while (rad < -CE_PI) rad += 2 * CE_PI;
+  double r2 = rad * rad, term = 1, sum = 1;
+  for (int i = 1; i < 20; ++i) { term *= -r2 / ((2 * i - 1) * (2 * i)); sum += term; }
+  return sum;
+}
+
+constexpr float cos_deg(double deg) { return (float)ce_cos(deg * CE_PI / 180.0); }
+constexpr float fm_sq(float x) { return x * x; }
+
+// | |v| - c | > t, tested on |v|^2.
+struct MagBand {
+  float lo2, hi2;
+  constexpr MagBand(float c, float t) : lo2(c > t ? fm_sq(c - t) : -1.0f), hi2(fm_sq(c + t)) {}
+  bool outside(float v2) const { return v2 > hi2 || v2 < lo2; }
+};
+
+template <int N>
+struct Lut {
+  float lo, hi, k;                               // k = N / (hi - lo)
+  float y[N + 1];
+  // Clamped to [lo, hi]; callers that can leave the range check in_range().
+  float operator()(float x) const {
+    float u = (x - lo) * k;
+    if (!(u > 0)) return y[0];
+    if (u >= N)   return y[N];
+    int i = (int)u;
+    return y[i] + (u - i) * (y[i + 1] - y[i]);
+  }
+  bool in_range(float x) const { return x >= lo && x <= hi; }
+};
+
+template <int N, typename F>
+constexpr Lut<N> lut_make(double lo, double hi, F f) {
+  Lut<N> t{};
+  t.lo = (float)lo; t.hi = (float)hi; t.k = (float)(N / (hi - lo));
+  for (int i = 0; i <= N; ++i) t.y[i] = (float)f(lo + (hi - lo) * i / N);
+  return t;
+}
@@ -0,0 +1,174 @@
+#pragma once
+// Binary framing shared by the firmware and the host tools.
+//
+//   wire  : 0x00 COBS(frame) 0x00
+//   frame : hdr(8) payload(n) crc32(4)
+//   hdr   : u8 chan | u8 type | u16 seq | u32 t_us      (little endian)
+//
+// COBS keeps 0x00 out of the frame body, so frames can share a byte stream
+// with plain text lines (which never contain 0x00) and a reader can resync on
+// any delimiter; the leading 0x00 cuts off text printed between two frames.
+// No Arduino dependency.
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define FRAME_HDR_LEN   8
+#define FRAME_CRC_LEN   4
+#define FRAME_MAX_BODY  512                       // payload bytes
+#define FRAME_MAX_RAW   (FRAME_HDR_LEN + FRAME_MAX_BODY + FRAME_CRC_LEN)
+#define FRAME_MAX_WIRE  (FRAME_MAX_RAW + FRAME_MAX_RAW / 254 + 3)
+
+enum FrameChan : uint8_t {
+  FRAME_CH_CAPTURE = 1,       // raw sensor blocks
+  FRAME_CH_TELEM   = 2,       // telemetry / control replies (JSON text)
+  FRAME_CH_LOG     = 3,       // tokenized logs
+};
+
+// capture channel payload types
+enum CapType : uint8_t {
+  CAP_PPG    = 1,   // u16 period_us/10, u16 n, n x (u32 ir, u32 red)
+  CAP_IMU    = 2,   // u16 period_us/10, u16 n, n x 6 x f32 (ax ay az m/s2, gx gy gz rad/s)
+  CAP_STATUS = 3,   // u32 frames, u32 dropped, u32 bytes, u8 active
+  CAP_ENV    = 4,   // 4 x f32: BME280 T degC, RH %, hPa, skin degC (NaN if absent)
+};
+
+// telemetry channel payload types: a JSON line, cut into frames if it is long
+enum TelType : uint8_t {
+  TEL_PART   = 1,   // more of the line follows
+  TEL_LINE   = 2,   // last (or only) piece of the line
+};
+
+// log channel payload types
+enum LogType : uint8_t {
+  TLOG_RECORDS = 1, // u32 records dropped so far, then tlog.h records
+};
+
+struct FrameHdr {
+  uint8_t  chan, type;
+  uint16_t seq;
+  uint32_t t_us;
+};
+
+static inline void frame_put16(uint8_t* p, uint16_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); }
+static inline void frame_put32(uint8_t* p, uint32_t v) {
+  p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24);
+}
+static inline uint16_t frame_get16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static inline uint32_t frame_get32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// CRC-32 (IEEE 802.3, reflected), nibble table: 64 bytes of ROM.
+static inline uint32_t frame_crc32(const uint8_t* d, size_t n, uint32_t crc = 0) {
+  static const uint32_t T[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C };
+  crc = ~crc;
+  for (size_t i = 0; i < n; ++i) {
+    crc = T[(crc ^ d[i]) & 0x0F] ^ (crc >> 4);
+    crc = T[(crc ^ (d[i] >> 4)) & 0x0F] ^ (crc >> 4);
+  }
+  return ~crc;
+}
+
+// COBS encode n bytes, append the 0x00 delimiter. Returns bytes written or 0.
+static inline size_t cobs_encode(const uint8_t* in, size_t n, uint8_t* out, size_t cap) {
+  if (cap < n + n / 254 + 2) return 0;
+  size_t code_at = 0, o = 1;
+  uint8_t code = 1;
+  for (size_t i = 0; i < n; ++i) {
+    if (in[i]) { out[o++] = in[i]; code++; }
+    if (!in[i] || code == 0xFF) {
+      out[code_at] = code; code = 1; code_at = o++;
+    }
+  }
+  out[code_at] = code;
+  out[o++] = 0;
+  return o;
+}
+
+// COBS decode one frame body (without the delimiter). Returns length or 0.
+static inline size_t cobs_decode(const uint8_t* in, size_t n, uint8_t* out, size_t cap) {
+  size_t i = 0, o = 0;
+  while (i < n) {
+    uint8_t code = in[i++];
+    if (!code) return 0;
+    for (uint8_t k = 1; k < code; ++k) {
+      if (i >= n || o >= cap) return 0;
+      out[o++] = in[i++];
+    }
+    if (code != 0xFF && i < n) { if (o >= cap) return 0; out[o++] = 0; }
+  }
+  return o;
+}
+
+// Build hdr+payload+crc into raw[], then 0x00 + COBS into wire[]. Returns wire length.
+static inline size_t frame_build(uint8_t* wire, size_t cap, const FrameHdr& h,
+                                 const uint8_t* payload, size_t n) {
+  if (n > FRAME_MAX_BODY) return 0;
+  uint8_t raw[FRAME_MAX_RAW];
+  raw[0] = h.chan; raw[1] = h.type;
+  frame_put16(raw + 2, h.seq);
+  frame_put32(raw + 4, h.t_us);
+  if (n) memcpy(raw + FRAME_HDR_LEN, payload, n);
+  frame_put32(raw + FRAME_HDR_LEN + n, frame_crc32(raw, FRAME_HDR_LEN + n));
+  if (cap < 1) return 0;
+  wire[0] = 0;
+  size_t w = cobs_encode(raw, FRAME_HDR_LEN + n + FRAME_CRC_LEN, wire + 1, cap - 1);
+  return w ? w + 1 : 0;
+}
+
+// Streaming reader: push bytes, get a callback per valid frame.
+// Bytes that are not part of a valid frame (text lines, corrupt frames) are
+// counted; text between frames goes to on_text when one is given (a
+// delimiter or a full buffer ends a piece, not a newline).
+struct FrameReader {
+  uint8_t  buf[FRAME_MAX_WIRE];
+  size_t   len = 0;
+  bool     overflow = false;
+  uint32_t frames = 0, crc_errors = 0, junk = 0;
+
+  template <typename F>
+  void push(const uint8_t* d, size_t n, F on_frame) {
+    push(d, n, on_frame, [](const uint8_t*, size_t) {});
+  }
+
+  template <typename F, typename T>
+  void push(const uint8_t* d, size_t n, F on_frame, T on_text) {
+    for (size_t i = 0; i < n; ++i) {
+      if (d[i]) {
+        if (len == sizeof(buf) && !overflow && !looks_binary(buf, len)) {
+          junk += len; on_text((const uint8_t*)buf, len); len = 0;
+        }
+        if (len < sizeof(buf)) buf[len++] = d[i]; else overflow = true;
+        continue;
+      }
+      if (len && !overflow) {
+        uint8_t raw[FRAME_MAX_RAW];
+        size_t r = cobs_decode(buf, len, raw, sizeof(raw));
+        if (r >= FRAME_HDR_LEN + FRAME_CRC_LEN &&
+            frame_crc32(raw, r - FRAME_CRC_LEN) == frame_get32(raw + r - FRAME_CRC_LEN)) {
+          FrameHdr h = { raw[0], raw[1], frame_get16(raw + 2), frame_get32(raw + 4) };
+          frames++;
+          on_frame(h, (const uint8_t*)(raw + FRAME_HDR_LEN), r - FRAME_HDR_LEN - FRAME_CRC_LEN);
+        } else if (r && looks_binary(buf, len)) {
+          crc_errors++;
+        } else {
+          junk += len;
+          if (!looks_binary(buf, len)) on_text((const uint8_t*)buf, len);
+        }
+      } else if (len) {
+        crc_errors++;
+      }
+      len = 0; overflow = false;
+    }
+  }
+
+  // Text that happens to sit before a delimiter is not a CRC error.
+  // (UTF-8 in the device's French messages counts as text.)
+  static bool looks_binary(const uint8_t* p, size_t n) {
+    for (size_t i = 0; i < n; ++i) if (p[i] < 0x09 || p[i] == 0x7F) return true;
+    return false;
+  }
+};
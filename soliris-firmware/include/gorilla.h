@@ -0,0 +1,206 @@
+#pragma once
+// Columnar compressed batch for 1 s telemetry rows (Gorilla-style).
+//
+//   header : 'G' 'R' u8 version, u8 flags, u8 ncols, u8 nflags, u16 nrows (LE),
+//            column names "hr,spo2,...,on_wrist,..." NUL-terminated
+//   bits   : MSB first, columns one after the other
+//     time   u32 t0, then delta-of-delta against the previous delta
+//            (starts at 1 s): '0' same, '10'+7, '110'+9, '1110'+12, '1111'+32 bits
+//     float  per column: u32 first value, then XOR with the previous one:
+//            '0' equal, '10' + bits inside the previous leading/trailing-zero
+//            window, '11' + u5 leading zeros + u5 (length-1) + meaningful bits
+//     flag   per column: first value, then run lengths (Exp-Golomb) of
+//            alternating values up to nrows
+//
+// Float bit patterns round-trip exactly (NAN marks a missing value).
+// Neither side touches the heap; the decoder bounds-checks every read and
+// rejects a batch that does not add up. Portable (device, host tools).
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define GOR_VERSION     1
+#define GOR_HDR_LEN     8
+#define GOR_MAX_COLS   32
+#define GOR_MAX_FLAGS   8
+#define GOR_MAX_NAMES 256
+#define GOR_F_EPOCH  0x01            // t is epoch seconds, else device uptime seconds
+
+struct GorWriter {
+  uint8_t* p; size_t cap, bits = 0; bool ok = true;
+  GorWriter(uint8_t* buf, size_t n) : p(buf), cap(n) {}
+  void bit(unsigned b) {
+    size_t i = bits >> 3;
+    if (i >= cap) { ok = false; return; }
+    if (!(bits & 7)) p[i] = 0;
+    if (b) p[i] |= (uint8_t)(0x80 >> (bits & 7));
+    bits++;
+  }
+  void put(uint32_t v, int n) { while (n--) bit((v >> n) & 1); }
+  size_t bytes() const { return (bits + 7) >> 3; }
+};
+
+struct GorReader {
+  const uint8_t* p; size_t n, bits = 0; bool ok = true;
+  GorReader(const uint8_t* buf, size_t len) : p(buf), n(len) {}
+  unsigned bit() {
+    if ((bits >> 3) >= n) { ok = false; return 0; }
+    unsigned b = (p[bits >> 3] >> (7 - (bits & 7))) & 1;
+    bits++;
+    return b;
+  }
+  uint32_t get(int k) { uint32_t v = 0; while (k--) v = (v << 1) | bit(); return v; }
+};
+
+struct GorSpec {
+  uint8_t     flags, ncols, nflags;
+  uint16_t    nrows;
+  const char* names;               // ncols + nflags comma-separated names
+};
+
+static inline uint32_t gor_fbits(float f) { uint32_t u; memcpy(&u, &f, 4); return u; }
+static inline float    gor_ffrom(uint32_t u) { float f; memcpy(&f, &u, 4); return f; }
+
+static void gor_put_dod(GorWriter& w, int64_t dod) {
+  if (dod == 0)                        w.bit(0);
+  else if (dod >= -63 && dod <= 64)     { w.put(0x2, 2); w.put((uint32_t)(dod + 63), 7); }
+  else if (dod >= -255 && dod <= 256)   { w.put(0x6, 3); w.put((uint32_t)(dod + 255), 9); }
+  else if (dod >= -2047 && dod <= 2048) { w.put(0xE, 4); w.put((uint32_t)(dod + 2047), 12); }
+  else                                  { w.put(0xF, 4); w.put((uint32_t)dod, 32); }
+}
+
+static int64_t gor_get_dod(GorReader& r) {
+  if (!r.bit()) return 0;
+  if (!r.bit()) return (int64_t)r.get(7) - 63;
+  if (!r.bit()) return (int64_t)r.get(9) - 255;
+  if (!r.bit()) return (int64_t)r.get(12) - 2047;
+  return (int32_t)r.get(32);
+}
+
+// Exp-Golomb, v >= 1.
+static void gor_put_run(GorWriter& w, uint32_t v) {
+  int n = 31 - __builtin_clz(v);
+  w.put(0, n);
+  w.put(v, n + 1);
+}
+
+static uint32_t gor_get_run(GorReader& r) {
+  int n = 0;
+  while (r.ok && !r.bit()) if (++n > 16) { r.ok = false; return 0; }
+  return r.ok ? (1u << n) | r.get(n) : 0;
+}
+
+// src.t(i) -> uint32_t, src.v(i, c) -> float, src.flag(i, f) -> bool.
+// Returns the batch size, 0 if it did not fit in cap.
+template <typename Src>
+static size_t gor_encode(uint8_t* buf, size_t cap, const GorSpec& s, Src& src) {
+  size_t nl = strlen(s.names) + 1;
+  if (cap < GOR_HDR_LEN + nl || s.ncols > GOR_MAX_COLS || s.nflags > GOR_MAX_FLAGS || nl > GOR_MAX_NAMES) return 0;
+  buf[0] = 'G'; buf[1] = 'R'; buf[2] = GOR_VERSION; buf[3] = s.flags;
+  buf[4] = s.ncols; buf[5] = s.nflags; buf[6] = (uint8_t)s.nrows; buf[7] = (uint8_t)(s.nrows >> 8);
+  memcpy(buf + GOR_HDR_LEN, s.names, nl);
+  GorWriter w(buf + GOR_HDR_LEN + nl, cap - GOR_HDR_LEN - nl);
+  if (!s.nrows) return GOR_HDR_LEN + nl;
+
+  uint32_t pt = src.t(0); int64_t pd = 1;
+  w.put(pt, 32);
+  for (uint16_t i = 1; i < s.nrows && w.ok; ++i) {
+    uint32_t t = src.t(i);
+    int64_t d = (int64_t)t - pt;
+    gor_put_dod(w, d - pd);
+    pd = d; pt = t;
+  }
+
+  for (uint8_t c = 0; c < s.ncols && w.ok; ++c) {
+    uint32_t prev = gor_fbits(src.v(0, c));
+    int lead = -1, trail = 0;
+    w.put(prev, 32);
+    for (uint16_t i = 1; i < s.nrows && w.ok; ++i) {
+      uint32_t cur = gor_fbits(src.v(i, c)), x = cur ^ prev;
+      prev = cur;
+      if (!x) { w.bit(0); continue; }
+      w.bit(1);
+      int l = __builtin_clz(x), tz = __builtin_ctz(x);
+      if (lead >= 0 && l >= lead && tz >= trail) { w.bit(0); w.put(x >> trail, 32 - lead - trail); continue; }
+      int len = 32 - l - tz;
+      w.bit(1); w.put(l, 5); w.put(len - 1, 5); w.put(x >> tz, len);
+      lead = l; trail = tz;
+    }
+  }
+
+  for (uint8_t f = 0; f < s.nflags && w.ok; ++f) {
+    bool v = src.flag(0, f);
+    w.bit(v);
+    uint32_t run = 1;
+    for (uint16_t i = 1; i < s.nrows; ++i) {
+      bool b = src.flag(i, f);
+      if (b == v) { run++; continue; }
+      gor_put_run(w, run); v = b; run = 1;
+    }
+    gor_put_run(w, run);
+  }
+  return w.ok ? GOR_HDR_LEN + nl + w.bytes() : 0;
+}
+
+struct GorHeader {
+  uint8_t  version, flags, ncols, nflags;
+  uint16_t nrows;
+  char     names[GOR_MAX_NAMES];
+};
+
+// Columns come out in order: sink.t(i, t) for every row, then
+// sink.v(i, c, x) column by column, then sink.flag(i, f, b). False on a
+// malformed batch (the sink may have seen part of it).
+template <typename Sink>
+static bool gor_decode(const uint8_t* buf, size_t n, GorHeader& h, Sink& sink) {
+  if (n < GOR_HDR_LEN || buf[0] != 'G' || buf[1] != 'R' || buf[2] != GOR_VERSION) return false;
+  h.version = buf[2]; h.flags = buf[3]; h.ncols = buf[4]; h.nflags = buf[5];
+  h.nrows = (uint16_t)(buf[6] | (buf[7] << 8));
+  if (h.ncols > GOR_MAX_COLS || h.nflags > GOR_MAX_FLAGS) return false;
+  const uint8_t* z = (const uint8_t*)memchr(buf + GOR_HDR_LEN, 0, n - GOR_HDR_LEN);
+  if (!z || (size_t)(z - buf - GOR_HDR_LEN) >= GOR_MAX_NAMES) return false;
+  memcpy(h.names, buf + GOR_HDR_LEN, z - buf - GOR_HDR_LEN + 1);
+  GorReader r(z + 1, n - (z + 1 - buf));
+  if (!h.nrows) return true;
+
+  uint32_t t = r.get(32); int64_t d = 1;
+  sink.t(0, t);
+  for (uint16_t i = 1; i < h.nrows && r.ok; ++i) {
+    d += gor_get_dod(r);
+    t = (uint32_t)(t + d);
+    sink.t(i, t);
+  }
+
+  for (uint8_t c = 0; c < h.ncols && r.ok; ++c) {
+    uint32_t v = r.get(32);
+    int lead = -1, trail = 0;
+    sink.v(0, c, gor_ffrom(v));
+    for (uint16_t i = 1; i < h.nrows && r.ok; ++i) {
+      if (r.bit()) {
+        if (r.bit()) {
+          lead = (int)r.get(5);
+          int len = (int)r.get(5) + 1;
+          if (lead + len > 32) return false;
+          trail = 32 - lead - len;
+          v ^= r.get(len) << trail;
+        } else {
+          if (lead < 0) return false;            // no window yet
+          v ^= r.get(32 - lead - trail) << trail;
+        }
+      }
+      sink.v(i, c, gor_ffrom(v));
+    }
+  }
+
+  for (uint8_t f = 0; f < h.nflags && r.ok; ++f) {
+    bool b = r.bit();
+    uint32_t i = 0;
+    while (i < h.nrows && r.ok) {
+      uint32_t run = gor_get_run(r);
+      if (!run || i + run > h.nrows) return false;
+      for (uint32_t k = 0; k < run; ++k) sink.flag((uint16_t)(i + k), f, b);
+      i += run; b = !b;
+    }
+  }
+  return r.ok;
+}
@@ -0,0 +1,105 @@
+#pragma once
+// History bulk upload. After the link has been down for a while the raw
+// 1 s rows of the time-series store go up as compressed columnar batches
+// (gorilla.h) instead of the JSON frames queued meanwhile:
+//   POST /telemetry/batch   Content-Type: application/x-soliris-gorilla
+// Values are cut to TS_QUANT first, so slow signals XOR to a few bits and
+// the flags (worn, moving, sun contact) collapse to runs. Once the outage
+// is covered without a hole, the queued frames are dropped except the
+// newest (it still carries the sun/GPS state).
+// The encoding half is portable (host benches); the upload needs the device.
+#include "gorilla.h"
+#include "ts_metric.h"
+
+#define HB_PATH       "/telemetry/batch"
+#define HB_TYPE       "application/x-soliris-gorilla"
+#define HB_ROWS        900            // seconds per batch (halved when it does not fit)
+#define HB_BUF_BYTES 16384
+#define HB_OUTAGE_S    600            // shorter gaps are left to the queued frames
+
+// Columns: every metric but motion, which goes as a flag.
+static const uint8_t HB_COLS[] = {
+  TS_HR, TS_SPO2, TS_SKIN, TS_ENV_C, TS_RH, TS_HPA, TS_CO2, TS_VOC, TS_SUN, TS_STEPS
+};
+#define HB_NCOLS   (sizeof(HB_COLS) / sizeof(HB_COLS[0]))
+#define HB_NFLAGS  3                  // TS_F_ONWRIST, TS_F_MOTION, TS_F_TOUCH
+static const char HB_NAMES[] = "hr,spo2,skin,env_c,rh,hpa,co2,voc,sun,steps,on_wrist,motion,touch";
+
+// Gorilla source over row pointers (one TS_NMETRIC row and flags per second).
+struct HistSrc {
+  const uint32_t*     ts;
+  const float* const* rows;
+  const uint8_t*      fl;
+  uint32_t t(uint16_t i)               { return ts[i]; }
+  float    v(uint16_t i, uint8_t c)    { uint8_t m = HB_COLS[c]; float x = rows[i][m]; return isnan(x) ? NAN : roundf(x / TS_QUANT[m]) * TS_QUANT[m]; }
+  bool     flag(uint16_t i, uint8_t f) { return fl[i] & (1u << f); }
+};
+
+static size_t hist_encode(uint8_t* buf, size_t cap, HistSrc& src, uint16_t n, bool epoch) {
+  GorSpec s = { (uint8_t)(epoch ? GOR_F_EPOCH : 0), (uint8_t)HB_NCOLS, HB_NFLAGS, n, HB_NAMES };
+  return gor_encode(buf, cap, s, src);
+}
+
+#ifdef ARDUINO
+#include "tsdb.h"
+#include "uplink.h"
+
+static uint8_t*      hb_buf = nullptr;
+static uint32_t*     hb_t = nullptr;
+static const float** hb_rows = nullptr;
+static uint8_t*      hb_fl = nullptr;
+static uint32_t      hb_sent_s = 0;       // last second the backend has
+static bool          hb_active = false, hb_whole = false;
+static uint32_t      hb_batches = 0, hb_rows_up = 0, hb_fails = 0, hb_dropped = 0;
+static uint64_t      hb_bytes = 0;
+
+// One pass of the upload session (upl_bulk hook).
+static int hist_pass() {
+  if (!ts_ready || !ts_raw_last) return 0;
+  uint32_t last = ts_raw_last, first = ts_raw_first();
+  if (!hb_active) {
+    if (last < hb_sent_s + HB_OUTAGE_S || offlineQ.empty()) { hb_sent_s = last; return 0; }
+    hb_active = true;
+    hb_whole = hb_sent_s + 1 >= first;    // nothing fell out of the raw ring
+  }
+  uint32_t from = max(hb_sent_s + 1, first);
+  if (from > last) {                      // caught up
+    hb_active = false;
+    if (hb_whole) while (offlineQ.size() > 1) { offlineQ.drop(1); hb_dropped++; }
+    return 0;
+  }
+
+  uint16_t n = 0;
+  uint32_t t = from;
+  for (; t <= last && n < HB_ROWS; ++t) {
+    uint8_t fl;
+    const float* r = ts_raw_at(t, &fl);
+    bool any = false;
+    for (int m = 0; m < TS_NMETRIC && !any; ++m) any = !isnan(r[m]);
+    if (!any) continue;                   // asleep or off: the gap is in the timestamps
+    hb_t[n] = t; hb_rows[n] = r; hb_fl[n] = fl; n++;
+  }
+  if (!n) { hb_sent_s = t - 1; return 1; }
+
+  HistSrc src = { hb_t, hb_rows, hb_fl };
+  bool epoch = clock_epoch() && last >= 1000000000UL;   // else uptime seconds
+  uint16_t n0 = n;
+  size_t len = 0;
+  while (n && !(len = hist_encode(hb_buf, HB_BUF_BYTES, src, n, epoch))) n /= 2;
+  if (!len) return -1;
+  PmHold radio(PM_LOCK_RADIO);
+  if (!http_post_wifi_body(hb_buf, len, HB_PATH, HB_TYPE)) { hb_fails++; return -1; }
+  hb_sent_s = (n == n0) ? t - 1 : hb_t[n - 1];
+  hb_batches++; hb_rows_up += n; hb_bytes += len; upl_bytes += len;
+  return 1;
+}
+
+static void hist_begin() {
+  hb_buf  = (uint8_t*)ts_alloc(HB_BUF_BYTES);
+  hb_t    = (uint32_t*)ts_alloc(sizeof(uint32_t) * HB_ROWS);
+  hb_rows = (const float**)ts_alloc(sizeof(float*) * HB_ROWS);
+  hb_fl   = (uint8_t*)ts_alloc(HB_ROWS);
+  if (hb_buf && hb_t && hb_rows && hb_fl) upl_bulk = hist_pass;
+  else tlog<TL_HIST_NOBUF>();
+}
+#endif
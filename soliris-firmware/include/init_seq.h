@@ -0,0 +1,105 @@
+#pragma once
+// Init orchestrator: one runner task per bus (Wire, Wire1, OneWire) brings
+// its devices up concurrently with the other buses and with the rest of
+// setup(). A device is a step function called with an increasing phase; a
+// step returns how long to wait before the next phase (ms), INIT_OK or
+// INIT_FAIL. While one device waits (SCD4x stop, PPG priming...) the
+// runner steps the others on its bus, so the waits overlap.
+//
+// deps is a bitmask of devices that must be ready first; a failed
+// dependency fails the dependent without running it. Each device flips its
+// own *_ok flag in its last step, so loop() samples it from then on.
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/event_groups.h>
+#include "tlog.h"
+
+#define INIT_OK        (-1)
+#define INIT_FAIL      (-2)
+#define INIT_NBUSES      3
+#define INIT_STACK    4096
+#define INIT_POLL_MS     2     // waiting on another bus's dependency
+
+enum InitState : uint8_t { INIT_PENDING, INIT_RUNNING, INIT_READY, INIT_FAILED };
+
+struct InitDev {
+  const char* name;
+  uint8_t     bus;                       // runner index
+  uint32_t    deps;                      // bit i: device i of the table
+  int32_t   (*step)(uint8_t phase);
+  // runtime
+  volatile uint8_t state;
+  uint8_t     phase;
+  uint32_t    wake_ms, ready_ms;
+};
+
+static InitDev*           init_devs = nullptr;
+static int                init_ndevs = 0;
+static EventGroupHandle_t init_done_ev = nullptr;
+static uint32_t           init_done_ms = 0;
+static const char* const  INIT_BUS_NAMES[INIT_NBUSES] = { "wire", "wire1", "onewire" };
+
+// Ready / failed / still waiting for this device's dependencies.
+static uint8_t init_deps_state(const InitDev& d) {
+  for (int i = 0; i < init_ndevs; ++i) {
+    if (!(d.deps & (1u << i))) continue;
+    if (init_devs[i].state == INIT_FAILED) return INIT_FAILED;
+    if (init_devs[i].state != INIT_READY)  return INIT_PENDING;
+  }
+  return INIT_READY;
+}
+
+static void init_runner(void* arg) {
+  uint8_t bus = (uint8_t)(uintptr_t)arg;
+  for (;;) {
+    bool left = false;
+    uint32_t now = millis(), next = now + 1000;
+    for (int i = 0; i < init_ndevs; ++i) {
+      InitDev& d = init_devs[i];
+      if (d.bus != bus || d.state >= INIT_READY) continue;
+      left = true;
+      if (d.state == INIT_PENDING) {
+        uint8_t ds = init_deps_state(d);
+        if (ds == INIT_PENDING) { next = min(next, now + INIT_POLL_MS); continue; }
+        if (ds == INIT_FAILED)  { d.state = INIT_FAILED; d.ready_ms = millis(); continue; }
+        d.state = INIT_RUNNING; d.wake_ms = now;
+      }
+      if ((int32_t)(now - d.wake_ms) < 0) { next = min(next, d.wake_ms); continue; }
+      int32_t r = d.step(d.phase++);
+      now = millis();
+      if (r >= 0) { d.wake_ms = now + r; next = min(next, d.wake_ms); continue; }
+      d.ready_ms = now;
+      d.state = r == INIT_OK ? INIT_READY : INIT_FAILED;
+      tlog<TL_INIT_DONE>(d.name, r == INIT_OK ? "ready" : "failed", now, INIT_BUS_NAMES[bus]);
+      next = now;                        // dependents may unblock
+    }
+    if (!left) break;
+    int32_t w = (int32_t)(next - millis());
+    vTaskDelay(w > 0 ? pdMS_TO_TICKS(w) : 1);
+  }
+  xEventGroupSetBits(init_done_ev, 1u << bus);
+  vTaskDelete(nullptr);
+}
+
+// Starts one runner per bus that has devices; returns immediately.
+static void init_start(InitDev* devs, int n) {
+  init_devs = devs; init_ndevs = n;
+  init_done_ev = xEventGroupCreate();
+  for (int b = 0; b < INIT_NBUSES; ++b) {
+    bool used = false;
+    for (int i = 0; i < n; ++i) used |= devs[i].bus == b;
+    if (!used) { xEventGroupSetBits(init_done_ev, 1u << b); continue; }
+    char name[16]; snprintf(name, sizeof(name), "init_%s", INIT_BUS_NAMES[b]);
+    xTaskCreate(init_runner, name, INIT_STACK, (void*)(uintptr_t)b, 2, nullptr);
+  }
+}
+
+// True once, from loop(), when every runner has finished.
+static bool init_finished() {
+  const EventBits_t all = (1u << INIT_NBUSES) - 1;
+  if (init_done_ms || !init_done_ev) return false;
+  if ((xEventGroupGetBits(init_done_ev) & all) != all) return false;
+  init_done_ms = millis();
+  return true;
+}
@@ -0,0 +1,171 @@
+#pragma once
+// Streaming LZSS with a fixed footprint (encoder ~8 KB, decoder ~1 KB), for
+// uplink bodies and the BLE bridge. Byte-aligned so the decoders stay small:
+//
+//   group : ctrl byte, then up to 8 items, bit i (LSB first) 1 = literal
+//   item  : literal  1 byte
+//           match    2 bytes  off(10) len-3(6), big endian; off 1..1023
+//                    back from the current end, len 3..66
+//           sync     2 bytes  0x00 0x00 (match with off 0): rest of the
+//                    group is empty, a new ctrl byte follows
+//
+// lz_flush() ends the pending group with a sync item so everything written
+// so far can be decoded now; the window is kept, so a stream of small
+// frames (BLE) keeps matching against the earlier ones. An HTTP body is one
+// stream: lz_init, lz_write, lz_flush.
+// Match search follows a 3-byte hash chain for `depth` candidates: the
+// ratio/CPU knob (see the lz_* bench cases). Portable.
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define LZ_WIN        1024
+#define LZ_MIN_LEN       3
+#define LZ_MAX_LEN      66
+#define LZ_HASH_BITS    10
+#define LZ_DEPTH         8
+#define LZ_ENCODING   "x-soliris-lzss"       // Content-Encoding / Accept-Encoding token
+
+struct LzEnc {
+  uint8_t  buf[2 * LZ_WIN];                  // window + pending input
+  uint16_t head[1 << LZ_HASH_BITS];          // newest position + 1 per hash, 0: none
+  uint16_t prev[2 * LZ_WIN];                 // older position + 1 with the same hash
+  uint16_t pos, end;                         // next byte to encode, bytes in buf
+  uint8_t  grp[17], gn, gitems;              // pending group: bytes used, items
+  uint8_t  depth;
+  uint32_t in, out;
+};
+
+static void lz_init(LzEnc& e, uint8_t depth = LZ_DEPTH) {
+  memset(e.head, 0, sizeof(e.head));
+  e.pos = e.end = 0;
+  e.grp[0] = 0; e.gn = 1; e.gitems = 0;
+  e.depth = depth ? depth : 1;
+  e.in = e.out = 0;
+}
+
+static inline uint16_t lz_hash(const uint8_t* p) {
+  return (uint16_t)(((p[0] << 8) ^ (p[1] << 4) ^ p[2]) * 2654435761u >> (32 - LZ_HASH_BITS)) & ((1 << LZ_HASH_BITS) - 1);
+}
+
+template <typename Out>
+static inline void lz_item_done(LzEnc& e, Out& out) {
+  if (++e.gitems < 8) return;
+  out(e.grp, e.gn); e.out += e.gn;
+  e.grp[0] = 0; e.gn = 1; e.gitems = 0;
+}
+
+// Drop the older half of the window once the buffer is full.
+static void lz_slide(LzEnc& e) {
+  memmove(e.buf, e.buf + LZ_WIN, LZ_WIN);
+  for (uint16_t& h : e.head) h = h > LZ_WIN ? h - LZ_WIN : 0;
+  for (int i = 0; i < LZ_WIN; ++i) {
+    uint16_t p = e.prev[i + LZ_WIN];
+    e.prev[i] = p > LZ_WIN ? p - LZ_WIN : 0;
+  }
+  e.pos -= LZ_WIN; e.end -= LZ_WIN;
+}
+
+static inline void lz_insert(LzEnc& e, uint16_t p) {
+  if (p + LZ_MIN_LEN > e.end) return;
+  uint16_t h = lz_hash(e.buf + p);
+  e.prev[p] = e.head[h];
+  e.head[h] = p + 1;
+}
+
+// Encodes while at least `keep` bytes are pending (0: all of them).
+template <typename Out>
+static void lz_encode(LzEnc& e, uint16_t keep, Out& out) {
+  while (e.end - e.pos > keep) {
+    uint16_t avail = e.end - e.pos, best = 0, boff = 0;
+    if (avail >= LZ_MIN_LEN) {
+      uint16_t lim = avail < LZ_MAX_LEN ? avail : LZ_MAX_LEN;
+      uint16_t c = e.head[lz_hash(e.buf + e.pos)];
+      for (uint8_t d = 0; c && d < e.depth; ++d, c = e.prev[c - 1]) {
+        uint16_t cand = c - 1;
+        if (e.pos - cand >= LZ_WIN) break;               // chains run oldest last
+        if (e.buf[cand + best] != e.buf[e.pos + best]) continue;
+        uint16_t n = 0;
+        while (n < lim && e.buf[cand + n] == e.buf[e.pos + n]) n++;
+        if (n > best) { best = n; boff = e.pos - cand; if (n == lim) break; }
+      }
+    }
+    if (best >= LZ_MIN_LEN) {
+      e.grp[e.gn++] = (uint8_t)(boff >> 2);
+      e.grp[e.gn++] = (uint8_t)((boff << 6) | (best - LZ_MIN_LEN));
+      for (uint16_t k = 0; k < best; ++k) lz_insert(e, e.pos + k);
+      e.pos += best;
+    } else {
+      e.grp[0] |= (uint8_t)(1u << e.gitems);
+      e.grp[e.gn++] = e.buf[e.pos];
+      lz_insert(e, e.pos);
+      e.pos++;
+    }
+    lz_item_done(e, out);
+  }
+}
+
+// out(const uint8_t* p, size_t n) receives the compressed bytes.
+template <typename Out>
+static void lz_write(LzEnc& e, const uint8_t* p, size_t n, Out out) {
+  e.in += n;
+  while (n) {
+    if (e.end == sizeof(e.buf)) {
+      lz_encode(e, LZ_MAX_LEN, out);                   // matches need the lookahead
+      if (e.pos >= LZ_WIN) lz_slide(e);
+      else break;
+    }
+    size_t k = sizeof(e.buf) - e.end;
+    if (k > n) k = n;
+    memcpy(e.buf + e.end, p, k);
+    e.end += k; p += k; n -= k;
+  }
+}
+
+template <typename Out>
+static void lz_flush(LzEnc& e, Out out) {
+  lz_encode(e, 0, out);
+  if (!e.gitems) return;
+  e.grp[e.gn++] = 0; e.grp[e.gn++] = 0;                // sync
+  out(e.grp, e.gn); e.out += e.gn;
+  e.grp[0] = 0; e.gn = 1; e.gitems = 0;
+}
+
+// Streaming decoder; feed any split of the stream.
+struct LzDec {
+  uint8_t  win[LZ_WIN];
+  uint16_t wpos;
+  uint8_t  ctrl, left;                         // flags of the current group, items left
+  int16_t  hi;                                 // first byte of a split match, -1: none
+  bool     bad;
+};
+
+static void lz_dec_init(LzDec& d) { d.wpos = 0; d.left = 0; d.hi = -1; d.bad = false; memset(d.win, 0, sizeof(d.win)); }
+
+// out(uint8_t b) per decoded byte. False once the stream is malformed
+// (a match reaching before the start is not detected: the window is zeroed).
+template <typename Out>
+static bool lz_dec_feed(LzDec& d, const uint8_t* p, size_t n, Out out) {
+  for (size_t i = 0; i < n && !d.bad; ++i) {
+    uint8_t b = p[i];
+    if (!d.left && d.hi < 0) { d.ctrl = b; d.left = 8; continue; }
+    if (d.hi < 0 && (d.ctrl & 1)) {
+      d.win[d.wpos] = b; d.wpos = (d.wpos + 1) & (LZ_WIN - 1); out(b);
+      d.ctrl >>= 1; d.left--;
+      continue;
+    }
+    if (d.hi < 0) { d.hi = b; continue; }
+    uint16_t off = (uint16_t)((d.hi << 2) | (b >> 6)), len = (b & 0x3F) + LZ_MIN_LEN;
+    d.hi = -1; d.ctrl >>= 1; d.left--;
+    if (!off) {
+      if (b) d.bad = true;
+      d.left = 0;                              // sync
+      continue;
+    }
+    for (uint16_t k = 0; k < len; ++k) {
+      uint8_t c = d.win[(d.wpos - off) & (LZ_WIN - 1)];
+      d.win[d.wpos] = c; d.wpos = (d.wpos + 1) & (LZ_WIN - 1); out(c);
+    }
+  }
+  return !d.bad;
+}
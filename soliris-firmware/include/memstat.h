@@ -0,0 +1,111 @@
+#pragma once
+// Memory instrumentation: heap / PSRAM / fragmentation, task stack
+// high-water marks, and allocation counts per subsystem.
+//
+// Per-subsystem counts need the linker to route malloc & co. through the
+// __wrap_ functions below (MEMSTAT_WRAP=1 plus -Wl,--wrap=... in
+// platformio.ini). Allocations made by the loop task are charged to the
+// subsystem of the innermost MemScope; allocations from any other task
+// (NimBLE host, Wi-Fi, lwIP...) go to MEM_TASKS.
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#ifndef MEMSTAT_WRAP
+  #define MEMSTAT_WRAP 0
+#endif
+#define MEM_SAMPLE_MS 10000
+
+enum MemTag : uint8_t { MEM_CORE = 0, MEM_SENSORS, MEM_NET, MEM_BLE, MEM_CTRL, MEM_TELEM, MEM_TSDB, MEM_TASKS, MEM_NTAGS };
+static const char* const MEM_TAG_NAMES[MEM_NTAGS] = {
+  "core", "sensors", "net", "ble", "ctrl", "telem", "tsdb", "tasks"
+};
+
+struct MemTagCount { uint32_t allocs, reallocs, bytes; };
+
+static MemTagCount   mem_tags[MEM_NTAGS];
+static uint32_t      mem_frees = 0;
+static volatile uint8_t mem_tag = MEM_CORE;
+static TaskHandle_t  mem_loop_task = nullptr;
+
+struct MemScope {
+  uint8_t prev;
+  explicit MemScope(MemTag t) : prev(mem_tag) { mem_tag = t; }
+  ~MemScope() { mem_tag = prev; }
+};
+
+#if MEMSTAT_WRAP
+extern "C" {
+void* __real_malloc(size_t n);
+void* __real_calloc(size_t n, size_t sz);
+void* __real_realloc(void* p, size_t n);
+void  __real_free(void* p);
+
+static inline MemTagCount& mem_slot() {
+  return mem_tags[(mem_loop_task && xTaskGetCurrentTaskHandle() == mem_loop_task) ? mem_tag : MEM_TASKS];
+}
+static inline void mem_count(size_t n, bool re) {
+  MemTagCount& c = mem_slot();
+  __atomic_fetch_add(re ? &c.reallocs : &c.allocs, 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&c.bytes, (uint32_t)n, __ATOMIC_RELAXED);
+}
+
+void* __wrap_malloc(size_t n) { void* p = __real_malloc(n); if (p) mem_count(n, false); return p; }
+void* __wrap_calloc(size_t n, size_t sz) { void* p = __real_calloc(n, sz); if (p) mem_count(n * sz, false); return p; }
+void* __wrap_realloc(void* p, size_t n) {
+  void* q = __real_realloc(p, n);
+  if (q) mem_count(n, p != nullptr);         // String growth shows up as reallocs
+  return q;
+}
+void __wrap_free(void* p) { if (p) __atomic_fetch_add(&mem_frees, 1, __ATOMIC_RELAXED); __real_free(p); }
+}
+#endif
+
+// Periodic sample, also the source for the stats frame.
+struct MemSample {
+  uint32_t heap, heap_min, largest, largest_min;
+  uint32_t psram_size, psram_free, psram_largest;
+};
+static MemSample mem_s = {};
+static uint32_t  mem_next_ms = 0;
+
+static const char* const MEM_TASK_NAMES[] = {
+  "loopTask", "nimble_host", "wifi", "tiT", "esp_timer", "sys_evt"
+};
+
+static void mem_sample() {
+  mem_s.heap    = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+  mem_s.largest = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
+  mem_s.heap_min = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
+  if (!mem_s.largest_min || mem_s.largest < mem_s.largest_min) mem_s.largest_min = mem_s.largest;
+  mem_s.psram_size    = heap_caps_get_total_size(MALLOC_CAP_SPIRAM);
+  mem_s.psram_free    = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+  mem_s.psram_largest = heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM);
+}
+
+// First thing in setup(): from here on the loop task's allocations are tagged.
+static void mem_begin() {
+  mem_loop_task = xTaskGetCurrentTaskHandle();
+  mem_sample();
+}
+
+static void mem_service(uint32_t now) {
+  if ((int32_t)(now - mem_next_ms) < 0) return;
+  mem_next_ms = now + MEM_SAMPLE_MS;
+  mem_sample();
+}
+
+// 100 - largest/free: 0 when the free internal heap is one block.
+static inline uint8_t mem_frag_pct() {
+  return mem_s.heap ? (uint8_t)(100 - (uint64_t)mem_s.largest * 100 / mem_s.heap) : 0;
+}
+
+// Calls fn(name, hwm_bytes) for every known task that exists.
+template <typename F>
+static void mem_for_each_stack(F fn) {
+  for (const char* n : MEM_TASK_NAMES) {
+    TaskHandle_t h = (!strcmp(n, "loopTask") && mem_loop_task) ? mem_loop_task : xTaskGetHandle(n);
+    if (h) fn(n, (uint32_t)uxTaskGetStackHighWaterMark(h));
+  }
+}
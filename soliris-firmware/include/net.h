@@ -2,6 +2,13 @@
 #include <Arduino.h>
 #include <WiFi.h>
 #include <HTTPClient.h>
+#include "clock.h"
+#include "ring.h"
+#include "memstat.h"
+#include "power.h"
+#include "lzss.h"
+#include "tlog.h"
+#include <esp_heap_caps.h>
 
 #if defined(__has_include)
   #if __has_include("secret.h")
@@ -55,66 +62,79 @@ static NimBLEServer*        bleServer = nullptr;
 static NimBLECharacteristic* bleChar  = nullptr;
 #define BLE_SVC_UUID  "6E400001-B5A3-F393-E0A9-E50E24DCCA9E"
 #define BLE_CHR_UUID  "6E400003-B5A3-F393-E0A9-E50E24DCCA9E"
+#define BLE_ADV_MIN   1600     // 0.625 ms units: 1 s .. 1.28 s, was 20..40 ms
+#define BLE_ADV_MAX   2048
+#define BLE_LZ_OUT     640     // compressed bytes gathered per notify burst
 
 static bool wifiReady = false;
 static bool cellReady = false;
 static bool bleReady  = false;
+static bool net_lz_ok = false;   // backend advertised LZ_ENCODING (Accept-Encoding on a reply)
+static LzEnc* ble_lz = nullptr;  // bridge compression, per connection ({"enc":"lzss"})
+static volatile bool ble_lz_on = false;
 
-static uint32_t lastWiFiAttempt = 0;
 static uint32_t lastCellAttempt = 0;
 
 #define OFFLINE_MAX  64
-static String offlineQ[OFFLINE_MAX];
-static int qHead = 0, qTail = 0;
+static DropRing<String, OFFLINE_MAX> offlineQ;
 
-static void offline_enqueue(const String& s) {
-  int nxt = (qTail + 1) % OFFLINE_MAX;
-  if (nxt == qHead) { qHead = (qHead + 1) % OFFLINE_MAX; } 
-  offlineQ[qTail] = s; qTail = nxt;
-}
-static bool offline_dequeue(String& out) {
-  if (qHead == qTail) return false;
-  out = offlineQ[qHead]; qHead = (qHead + 1) % OFFLINE_MAX; return true;
-}
+static void offline_enqueue(const String& s) { offlineQ.push(s); }
+static bool offline_dequeue(String& out) { return offlineQ.pop(out); }
 
-static void wifi_connect() {
+// Non-blocking: the upload scheduler (uplink.h) polls WiFi.status().
+static void wifi_radio_on() {
   WiFi.mode(WIFI_STA);
+  WiFi.setSleep(WIFI_PS_MAX_MODEM);     // sleeps between DTIMs while associated
   WiFi.begin(WIFI_SSID, WIFI_PASS);
-  uint32_t t0 = millis();
-  while (WiFi.status() != WL_CONNECTED && (millis() - t0) < 12000) delay(200);
-  wifiReady = (WiFi.status() == WL_CONNECTED);
-  Serial.println(wifiReady ? "[NET] Wi-Fi OK" : "[NET] Wi-Fi FAIL");
 }
 
-static bool http_post_wifi(const String& json) {
+static void wifi_radio_off() {
+  WiFi.disconnect(true);
+  WiFi.mode(WIFI_OFF);
+  wifiReady = false;
+}
+
+// `enc`: Content-Encoding of the body (nullptr: identity). Every reply
+// tells whether the backend takes LZ_ENCODING; a 415 turns it off again.
+static bool http_post_wifi_body(const uint8_t* body, size_t len, const char* path, const char* type,
+                                const char* enc = nullptr) {
   if (!wifiReady) return false;
   HTTPClient http;
-  String url = String(BACKEND_WIFI) + String(ENDPOINT_PATH);  
+  String url = String(BACKEND_WIFI) + String(path);
   if (!http.begin(url)) return false;
-  http.addHeader("Content-Type", "application/json");
+  static const char* keys[] = { "Accept-Encoding" };
+  http.collectHeaders(keys, 1);
+  http.addHeader("Content-Type", type);
+  if (enc) http.addHeader("Content-Encoding", enc);
+  http.addHeader("X-Device-Uptime-Ms", String(millis()));   // dates frames without "ts"
 
-  int code = http.POST((uint8_t*)json.c_str(), json.length());
+  int code = http.POST((uint8_t*)body, len);
+  if (code > 0) net_lz_ok = code != 415 && http.header("Accept-Encoding").indexOf(LZ_ENCODING) >= 0;
 
   if (code <= 0) {
-    Serial.printf("[NET] POST %s -> ERR %d\n", url.c_str(), code);
+    tlog<TL_NET_POST_ERR>(url.c_str(), code);
   } else {
-    Serial.printf("[NET] POST %s -> %d\n", url.c_str(), code);
+    tlog<TL_NET_POST>(url.c_str(), code);
   }
 
   http.end();
   return (code > 0 && code < 400);
 }
 
+static bool http_post_wifi(const String& json, const char* path = ENDPOINT_PATH) {
+  return http_post_wifi_body((const uint8_t*)json.c_str(), json.length(), path, "application/json");
+}
+
 static void cell_connect() {
 #if defined(TINY_GSM_MODEM_SIM7600) || defined(TINY_GSM_MODEM_SIM7000) || defined(TINY_GSM_MODEM_A7670) || defined(TINY_GSM_MODEM_BG95)
 
   Modem.begin(115200, SERIAL_8N1, 16, 17);
   delay(300);
-  if (!modem.init())                             { Serial.println("[NET] Modem init FAIL"); cellReady = false; return; }
-  if (!modem.waitForNetwork(60000))              { Serial.println("[NET] No network");      cellReady = false; return; }
-  if (!modem.gprsConnect(APN, APN_USER, APN_PASS)) { Serial.println("[NET] GPRS FAIL");      cellReady = false; return; }
+  if (!modem.init())                             { tlog<TL_NET_CELL_FAIL>("Modem init FAIL"); cellReady = false; return; }
+  if (!modem.waitForNetwork(60000))              { tlog<TL_NET_CELL_FAIL>("No network");      cellReady = false; return; }
+  if (!modem.gprsConnect(APN, APN_USER, APN_PASS)) { tlog<TL_NET_CELL_FAIL>("GPRS FAIL");      cellReady = false; return; }
   cellReady = true;
-  Serial.println("[NET] Cellular OK");
+  tlog<TL_NET_CELL_OK>();
 #else
   cellReady = false;
 #endif
@@ -135,19 +155,21 @@ class BridgeCallbacks : public NimBLEServerCallbacks {
  public:
   void onConnect(NimBLEServer* s) {
     (void)s;
-    Serial.println("[NET] BLE central connecté");
+    tlog<TL_NET_BLE_UP>();
   }
   void onConnect(NimBLEServer* s, ble_gap_conn_desc* desc) {
     (void)s; (void)desc;
-    Serial.println("[NET] BLE central connecté");
+    tlog<TL_NET_BLE_UP>();
   }
   void onDisconnect(NimBLEServer* s) {
     (void)s;
-    Serial.println("[NET] BLE central déconnecté");
+    tlog<TL_NET_BLE_DOWN>();
+    ble_lz_on = false;
   }
   void onDisconnect(NimBLEServer* s, int reason) {
     (void)s; (void)reason;
-    Serial.println("[NET] BLE central déconnecté");
+    tlog<TL_NET_BLE_DOWN>();
+    ble_lz_on = false;                 // the next central negotiates again
   }
 };
 
@@ -161,68 +183,76 @@ static void ble_start() {
       NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY
   );
   svc->start();
-  bleServer->getAdvertising()->addServiceUUID(BLE_SVC_UUID);
-  bleServer->getAdvertising()->start();
+  NimBLEAdvertising* adv = bleServer->getAdvertising();
+  adv->addServiceUUID(BLE_SVC_UUID);
+  adv->setMinInterval(BLE_ADV_MIN);
+  adv->setMaxInterval(BLE_ADV_MAX);
+  adv->start();                         // once, with both services listed
   bleReady = true;
-  Serial.println("[NET] BLE prêt (advertising).");
+  tlog<TL_NET_BLE_READY>();
 }
 
+// Wi-Fi is left off; the upload scheduler brings it up per flush.
 static void net_setup() {
-  wifi_connect();
+  MemScope ms(MEM_NET);
 #if defined(TINY_GSM_MODEM_SIM7600) || defined(TINY_GSM_MODEM_SIM7000) || defined(TINY_GSM_MODEM_A7670) || defined(TINY_GSM_MODEM_BG95)
-  if (!wifiReady) cell_connect();
+  cell_connect();
 #endif
   ble_start(); 
+}
 
-static void net_loop() {
-  if (!wifiReady && (millis() - lastWiFiAttempt) > 15000) {
-    lastWiFiAttempt = millis();
-    wifi_connect();
-  }
-#if defined(TINY_GSM_MODEM_SIM7600) || defined(TINY_GSM_MODEM_SIM7000) || defined(TINY_GSM_MODEM_A7670) || defined(TINY_GSM_MODEM_BG95)
-  if (!wifiReady && !cellReady && (millis() - lastCellAttempt) > 30000) {
-    lastCellAttempt = millis();
-    cell_connect();
-  }
-#endif
+static inline bool ble_connected() { return bleReady && bleServer && bleServer->getConnectedCount(); }
+
+static uint32_t ble_lz_in = 0, ble_lz_out = 0;
 
-  if (wifiReady) {
-    String item; int flushed = 0;
-    while (offline_dequeue(item) && flushed < 8) {
-      if (!http_post_wifi(item)) { offline_enqueue(item); break; }
-      flushed++;
-    }
+static void ble_notify_bytes(const uint8_t* p, size_t n) {
+  const size_t CHUNK = 160;
+  for (size_t i = 0; i < n; i += CHUNK) {
+    bleChar->setValue(p + i, min(CHUNK, n - i));
+    bleChar->notify();
+    delay(15);
   }
 }
 
-static bool net_send(const String& json) {
-  if (wifiReady) {
-    if (http_post_wifi(json)) return true;
+// Newline-terminated text over the bridge characteristic, in MTU-sized
+// chunks. Compressed, the line plus its newline is one flushed piece of the
+// connection's LZ stream (lzss.h) and there is no separate "\n" chunk.
+static void ble_notify_text(const String& json) {
+  if (!bleChar || !ble_connected()) return;
+  MemScope ms(MEM_BLE);
+  PmHold radio(PM_LOCK_RADIO);
+  if (ble_lz_on && ble_lz) {
+    static uint8_t out[BLE_LZ_OUT];
+    size_t k = 0;
+    auto sink = [&](const uint8_t* p, size_t n) {
+      if (k + n > sizeof(out)) { ble_notify_bytes(out, k); k = 0; }
+      memcpy(out + k, p, n); k += n;
+    };
+    lz_write(*ble_lz, (const uint8_t*)json.c_str(), json.length(), sink);
+    lz_write(*ble_lz, (const uint8_t*)"\n", 1, sink);
+    lz_flush(*ble_lz, sink);
+    ble_notify_bytes(out, k);
+    ble_lz_in += json.length() + 1; ble_lz_out += k;
+    return;
   }
+  ble_notify_bytes((const uint8_t*)json.c_str(), json.length());
+  const char* end = "\n";
+  bleChar->setValue((uint8_t*)end, 1);
+  bleChar->notify();
+}
 
-#if USE_CELLULAR_TUNNEL
-  #if defined(TINY_GSM_MODEM_SIM7600) || defined(TINY_GSM_MODEM_SIM7000) || defined(TINY_GSM_MODEM_A7670) || defined(TINY_GSM_MODEM_BG95)
-    if (cellReady) {
-      if (http_post_cell_tunnel(json)) return true;
-    }
-  #endif
-#else
-  if (!wifiReady) offline_enqueue(json); 
-#endif
-
-  if (bleReady && bleChar) {
-    size_t n = json.length();
-    const size_t CHUNK = 160;
-    for (size_t i = 0; i < n; i += CHUNK) {
-      String part = json.substring(i, min(i + CHUNK, n));
-      bleChar->setValue((uint8_t*)part.c_str(), part.length());
-      bleChar->notify();
-      delay(15);
-    }
-    const char* end = "\n";
-    bleChar->setValue((uint8_t*)end, 1);
-    bleChar->notify();
+// Switches the bridge encoding. The switch point is marked in the old
+// encoding: {"enc":"x-soliris-lzss"} (plain) before the first compressed
+// line, {"enc":"none"} (compressed) before plain text again.
+static bool ble_lz_set(bool on) {
+  if (on == ble_lz_on) return true;
+  if (on && !ble_lz) {
+    ble_lz = (LzEnc*)heap_caps_malloc(sizeof(LzEnc), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!ble_lz) ble_lz = (LzEnc*)heap_caps_malloc(sizeof(LzEnc), MALLOC_CAP_8BIT);
+    if (!ble_lz) return false;
   }
-
-  return false;
-}
\ No newline at end of file
+  ble_notify_text(on ? "{\"enc\":\"" LZ_ENCODING "\"}" : "{\"enc\":\"none\"}");
+  if (on) lz_init(*ble_lz);
+  ble_lz_on = on;
+  return true;
+}
@@ -0,0 +1,132 @@
+#pragma once
+// Gyro + accel orientation filter (Madgwick, IMU variant).
+// No Arduino dependency and no allocation: the same code runs on the ESP32-S3
+// and on the host. The scalar type is a template parameter so the filter can
+// run in float (default, the S3 has an FPU) or in Q16.16 fixed point.
+#include <stdint.h>
+#include <math.h>
+
+#ifndef ORIENT_FIXED
+  #define ORIENT_FIXED 0
+#endif
+
+#ifndef ORIENT_BETA
+  #define ORIENT_BETA 0.10f      // gradient step, rad/s of gyro error assumed
+#endif
+
+// ---- Q16.16 scalar ---------------------------------------------------------
+struct q16 {
+  int32_t v;
+  q16() : v(0) {}
+  q16(float f) : v((int32_t)lrintf(f * 65536.0f)) {}
+  static q16 raw(int32_t r){ q16 x; x.v = r; return x; }
+  float f() const { return (float)v / 65536.0f; }
+
+  q16 operator+(q16 o) const { return raw(v + o.v); }
+  q16 operator-(q16 o) const { return raw(v - o.v); }
+  q16 operator-()      const { return raw(-v); }
+  q16 operator*(q16 o) const { return raw((int32_t)(((int64_t)v * o.v) >> 16)); }
+  q16& operator+=(q16 o){ v += o.v; return *this; }
+  q16& operator-=(q16 o){ v -= o.v; return *this; }
+  q16& operator*=(q16 o){ *this = *this * o; return *this; }
+  bool operator==(q16 o) const { return v == o.v; }
+};
+
+static inline float orient_to_float(float x){ return x; }
+static inline float orient_to_float(q16 x)  { return x.f(); }
+
+static inline float orient_inv_sqrt(float x){ return 1.0f / sqrtf(x); }
+
+// Integer-only 1/sqrt for Q16.16, Newton iterations from a power-of-two seed.
+static inline q16 orient_inv_sqrt(q16 x){
+  if (x.v <= 0) return q16::raw(0);
+  // seed: 2^(-floor(log2(x))/2), in Q16.16
+  int lz = __builtin_clz((uint32_t)x.v);
+  int e  = (31 - lz) - 16;                 // x ~ 2^e
+  int32_t y = (e >= 0) ? (65536 >> ((e + 1) / 2)) : (65536 << ((-e) / 2));
+  for (int i = 0; i < 4; ++i) {
+    // y = y * (3 - x*y*y) / 2
+    int64_t yy  = ((int64_t)y * y) >> 16;
+    int64_t xyy = ((int64_t)x.v * yy) >> 16;
+    y = (int32_t)(((int64_t)y * ((3 << 16) - xyy)) >> 17);
+  }
+  return q16::raw(y);
+}
+
+// ---- Madgwick IMU update -----------------------------------------------------
+template <typename T>
+struct Madgwick {
+  T q0, q1, q2, q3;
+  T beta;
+  bool init;
+
+  Madgwick() : q0(1.0f), q1(0.0f), q2(0.0f), q3(0.0f), beta(ORIENT_BETA), init(false) {}
+
+  // Seed the attitude from a single accel sample so there is no convergence
+  // transient at boot (yaw is arbitrary, it is never used).
+  void seed(float ax, float ay, float az) {
+    float n = sqrtf(ax*ax + ay*ay + az*az);
+    if (n < 1e-3f) return;
+    ax /= n; ay /= n; az /= n;
+    // rotation taking body gravity (ax,ay,az) onto +Z
+    float w = 1.0f + az;
+    float x = ay, y = -ax;
+    if (w < 1e-4f) { w = 0.0f; x = 1.0f; y = 0.0f; }
+    float m = sqrtf(w*w + x*x + y*y);
+    q0 = T(w / m); q1 = T(x / m); q2 = T(y / m); q3 = T(0.0f);
+    init = true;
+  }
+
+  // gx/gy/gz in rad/s, ax/ay/az in any unit, dt in s.
+  void update(float gxf, float gyf, float gzf, float axf, float ayf, float azf, float dtf) {
+    if (!init) { seed(axf, ayf, azf); return; }
+    const T half(0.5f), two(2.0f), four(4.0f), eight(8.0f);
+    T gx(gxf), gy(gyf), gz(gzf), dt(dtf);
+
+    T qd0 = half * (-q1*gx - q2*gy - q3*gz);
+    T qd1 = half * ( q0*gx + q2*gz - q3*gy);
+    T qd2 = half * ( q0*gy - q1*gz + q3*gx);
+    T qd3 = half * ( q0*gz + q1*gy - q2*gx);
+
+    float an = axf*axf + ayf*ayf + azf*azf;
+    if (an > 1e-6f) {
+      float r = 1.0f / sqrtf(an);
+      T ax(axf*r), ay(ayf*r), az(azf*r);
+
+      T _2q0 = two*q0, _2q1 = two*q1, _2q2 = two*q2, _2q3 = two*q3;
+      T _4q0 = four*q0, _4q1 = four*q1, _4q2 = four*q2;
+      T _8q1 = eight*q1, _8q2 = eight*q2;
+      T q0q0 = q0*q0, q1q1 = q1*q1, q2q2 = q2*q2, q3q3 = q3*q3;
+
+      T s0 = _4q0*q2q2 + _2q2*ax + _4q0*q1q1 - _2q1*ay;
+      T s1 = _4q1*q3q3 - _2q3*ax + four*q0q0*q1 - _2q0*ay - _4q1 + _8q1*q1q1 + _8q1*q2q2 + _4q1*az;
+      T s2 = four*q0q0*q2 + _2q0*ax + _4q2*q3q3 - _2q3*ay - _4q2 + _8q2*q1q1 + _8q2*q2q2 + _4q2*az;
+      T s3 = four*q1q1*q3 - _2q1*ax + four*q2q2*q3 - _2q2*ay;
+
+      T sn = s0*s0 + s1*s1 + s2*s2 + s3*s3;
+      if (!(sn == T(0.0f))) {
+        T rs = orient_inv_sqrt(sn) * beta;
+        qd0 -= s0*rs; qd1 -= s1*rs; qd2 -= s2*rs; qd3 -= s3*rs;
+      }
+    }
+
+    q0 += qd0*dt; q1 += qd1*dt; q2 += qd2*dt; q3 += qd3*dt;
+    T rn = orient_inv_sqrt(q0*q0 + q1*q1 + q2*q2 + q3*q3);
+    q0 *= rn; q1 *= rn; q2 *= rn; q3 *= rn;
+  }
+
+  // Unit gravity ("up") direction expressed in the body frame.
+  void gravity(float& gx, float& gy, float& gz) const {
+    float w = orient_to_float(q0), x = orient_to_float(q1);
+    float y = orient_to_float(q2), z = orient_to_float(q3);
+    gx = 2.0f * (x*z - w*y);
+    gy = 2.0f * (w*x + y*z);
+    gz = w*w - x*x - y*y + z*z;
+  }
+};
+
+#if ORIENT_FIXED
+  typedef Madgwick<q16>   OrientFilter;
+#else
+  typedef Madgwick<float> OrientFilter;
+#endif
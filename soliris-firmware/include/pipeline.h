@@ -0,0 +1,552 @@
+#pragma once
+// Detection pipelines: PPG (HR/SpO2/contact), steps/activity/posture,
+// fall/unconscious, on-wrist and ambient correction.
+//
+// No driver or Arduino dependency: every entry point takes its samples and
+// the current time in ms, so the same code runs on the device (main.cpp feeds
+// it from the sensors and millis()) and in the host replay (src/host/).
+// Outputs are the globals below, as before.
+#include <stdint.h>
+#include <math.h>
+#include <string.h>
+#include "orient.h"
+#include "fastmath.h"
+#include "tlog.h"
+
+// PIPE_LOG(TL_token, args...): a tlog record on the device, a printed line in
+// the host replay.
+#ifdef ARDUINO
+  #include <Arduino.h>
+  #define PIPE_LOG(id, ...)  do { if (pipe_log) tlog<id>(__VA_ARGS__); } while (0)
+#else
+  #include <stdio.h>
+  #define PIPE_LOG(id, ...)  do { if (pipe_log) tlog_print<id>(__VA_ARGS__); } while (0)
+#endif
+
+static bool pipe_log = true;              // debug lines ([FALL] ...)
+
+enum Activity { ACT_STILL=0, ACT_WALK=1, ACT_RUN=2 };
+enum Posture  { POST_UNKNOWN=0, POST_STANDING=1, POST_SITTING=2, POST_LYING=3 };
+
+// ---- thresholds ---------------------------------------------------------------
+// Float thresholds are constexpr so fastmath.h can square or cosine them.
+constexpr float G = 9.81f;
+
+#ifndef EASY_TEST
+  #define EASY_TEST 1
+#endif
+#if EASY_TEST
+  constexpr float IMPACT_G          = 1.8f;
+  constexpr float NO_MOTION_DYN     = 1.0f;
+  const float    NO_MOTION_GYRO     = 2.0f;
+  const uint16_t IMPACT_LOCK_MS     = 800;
+  const uint16_t INACT_AFTER_MS     = 3000;
+  const uint16_t LYING_CONFIRM_MS   = 1000;
+  const float    STEP_PEAK          = 0.35f;
+#else
+  constexpr float IMPACT_G          = 2.8f;
+  constexpr float NO_MOTION_DYN     = 0.25f;
+  const float    NO_MOTION_GYRO     = 0.50f;
+  const uint16_t IMPACT_LOCK_MS     = 1200;
+  const uint16_t INACT_AFTER_MS     = 10000;
+  const uint16_t LYING_CONFIRM_MS   = 4000;
+  const float    STEP_PEAK          = 0.60f;
+#endif
+
+const int   HR_BRADY       = 40;
+const int   HR_TACHY       = 180;
+const int   SPO2_LOW       = 88;
+const uint16_t UNCON_MIN_MS = 20000;
+
+const uint8_t  IMU_PERIOD_MS = 20;
+const float    G_LP_ALPHA    = 0.05f;
+const float    HP_ALPHA      = 0.30f;
+const uint16_t STEP_MIN_MS   = 250;
+const uint16_t STEP_MAX_MS   = 1200;
+
+constexpr float TILT_LYING_DEG   = 35.0f;       // tilt of the body z axis from vertical
+constexpr float TILT_SITTING_DEG = 65.0f;
+constexpr float MOTION_DYN       = 0.6f;        // motion flag, m/s2 off 1 g
+
+// The IMU path works on |a|^2 (no sqrtf per sample): magnitude and angle
+// thresholds as squared / cosine comparisons.
+static constexpr float   IMPACT_A2   = fm_sq(IMPACT_G * G);
+static constexpr float   COS_LYING   = cos_deg(TILT_LYING_DEG);
+static constexpr float   COS_SITTING = cos_deg(TILT_SITTING_DEG);
+static constexpr MagBand MOTION_BAND(G, MOTION_DYN);
+static constexpr MagBand STILL_BAND(G, NO_MOTION_DYN);
+static constexpr MagBand STILL_BAND_LYING(G, 2.0f * NO_MOTION_DYN);
+
+// ---- steps / activity / posture / fall state ---------------------------------------
+volatile uint32_t step_count = 0;
+uint32_t last_step_ms = 0;
+uint16_t last_step_interval_ms = 0;
+uint32_t t_last_upright_ms = 0;
+static uint32_t still_ms = 0;
+
+bool  fall_event = false;
+bool  unconscious = false;
+float unconscious_score = 0.0f;
+
+uint32_t t_impact_ms      = 0;
+uint32_t t_last_motion_ms = 0;
+uint32_t t_lying_since_ms = 0;
+
+Activity activity_state = ACT_STILL;
+Posture  posture_state  = POST_UNKNOWN;
+
+OrientFilter orient;
+float up_x=0, up_y=0, up_z=1;           // gravity direction in body frame, from the quaternion
+static uint32_t orient_last_ms = 0;
+float a_par_hp = 0;
+static float    gnorm = 0;              // gravity as this accelerometer reads it (low-passed a_par)
+static float    step_prev_hp = 0.0f;
+static uint32_t fall_last_impact = 0, fall_score_high_ms = 0, fall_next_dbg = 0;
+static Posture  fall_prev_post = POST_UNKNOWN;
+
+static float gyro_sum_g = 0.0f;
+static int   motion_g   = 0;
+
+// ---- PPG state ---------------------------------------------------------------
+bool ppg_contact = false;
+
+uint8_t ppg_irDrive  = 0x30;
+uint8_t ppg_redDrive = 0x30;
+
+long        PPG_IR_LOW  = 40000;
+long        PPG_IR_HIGH = 120000;
+const uint8_t PPG_DRIVE_MIN = 0x20, PPG_DRIVE_MAX = 0xB0;
+
+const int   PPG_SR_HZ = 100;
+
+static float    ppg_env = 0.0f;
+static float    ppg_prev_ac = 0.0f;
+const  float    PPG_ENV_ALPHA = 0.10f;
+const  float    PPG_THR_RATIO = 0.55f;
+const  uint16_t PPG_REFRACT_MS = 280;
+
+unsigned long ppg_lastBeat = 0;
+
+float   ppg_bpm = 0;
+uint8_t ppg_rates[8] = {0};
+uint8_t ppg_rateSpot = 0;
+int     ppg_rateFilled = 0;
+int     ppg_bpm_avg  = 0;
+
+float dc_ir = 0, dc_red = 0;
+float rms_ir = 0, rms_red = 0;
+uint32_t spo2_n = 0;
+float   spo2_value = NAN;
+uint8_t spo2_quality = 0;
+
+const long  DC_CONTACT_MIN = 20000;
+const long  DC_LOSS_MIN    = 15000;
+const float AC_CONTACT_MIN = 120.0f;
+const float AC_LOSS_MIN    = 80.0f;
+const int   CONTACT_ON_SAMPLES  = 8;
+const int   CONTACT_OFF_SAMPLES = 20;
+
+static float ppg_ac_abs_avg = 0.0f;
+static int   ppg_yes_cnt = 0, ppg_no_cnt = 0;
+
+// Everything ppg_process() writes, so a caller feeding it other samples (the
+// bench) can put the live detector back as it was.
+#define PPG_STATE_LIST(X) \
+  X(ppg_contact) X(ppg_irDrive) X(ppg_env) X(ppg_prev_ac) X(ppg_lastBeat) \
+  X(ppg_bpm) X(ppg_rates) X(ppg_rateSpot) X(ppg_rateFilled) X(ppg_bpm_avg) \
+  X(dc_ir) X(dc_red) X(rms_ir) X(rms_red) X(spo2_n) X(spo2_value) X(spo2_quality) \
+  X(ppg_ac_abs_avg) X(ppg_yes_cnt) X(ppg_no_cnt)
+
+#define PPG_X_FIELD(v)    decltype(v) v##_;
+#define PPG_X_SAVE(v)     memcpy(&s.v##_, &v, sizeof(v));
+#define PPG_X_RESTORE(v)  memcpy(&v, &s.v##_, sizeof(v));
+struct PpgSaved { PPG_STATE_LIST(PPG_X_FIELD) };
+static inline void ppg_save(PpgSaved& s)          { PPG_STATE_LIST(PPG_X_SAVE) }
+static inline void ppg_restore(const PpgSaved& s) { PPG_STATE_LIST(PPG_X_RESTORE) }
+
+// ---- on-wrist state -----------------------------------------------------------
+bool  onWrist = false;
+float onwrist_score = 0.0f;
+float onwrist_dSA   = NAN;
+float onwrist_dTdt  = 0.0f;
+static float    ow_skin_lp = NAN, ow_skin_lp_prev = NAN, ow_s_lp = 0.0f;
+static uint32_t ow_t_prev = 0, ow_arm_t0 = 0;
+
+// ---- ambient state ------------------------------------------------------------
+float T_FIXED_OFFSET = -4.94f;
+float RH_GAIN        = 1.00f;
+float RH_OFFSET      = 10.0f;
+
+const float K_UP   = 0.002f;
+const float K_DOWN = 0.60f;
+const float ALPHA_SMOOTH = 0.30f;
+
+float T_floor = NAN;
+float T_air_est_prev = NAN;
+
+float env_c_out = NAN, rh_out_corr = NAN, hpa_out = NAN;
+
+static float es_hPa(float T_C) {
+  return 6.112f * expf((17.62f * T_C) / (243.12f + T_C));
+}
+static float rh_retarget(float RH_raw, float Traw_C, float Tcorr_C) {
+  float e = (RH_raw / 100.0f) * es_hPa(Traw_C);
+  float RHcorr = 100.0f * (e / es_hPa(Tcorr_C));
+  if (RHcorr < 0)   RHcorr = 0;
+  if (RHcorr > 100) RHcorr = 100;
+  return RHcorr;
+}
+
+// ---- PPG ------------------------------------------------------------------------
+// Calibration SpO2 = 104 - 17 R, tabulated over R^2 so the AC amplitudes
+// (sqrt of the running mean squares) are never taken. The ends are the
+// clamps: R <= 4/17 reads 100 %, R >= 2 reads 70 %.
+static constexpr double SPO2_R_LO = 4.0 / 17.0, SPO2_R_HI = 2.0;
+static constexpr Lut<128> SPO2_LUT = lut_make<128>(SPO2_R_LO * SPO2_R_LO, SPO2_R_HI * SPO2_R_HI,
+  [](double r2) { return 104.0 - 17.0 * ce_sqrt(r2); });
+
+// One 100 Hz sample. Returns true when ppg_irDrive changed and the LED
+// amplitude has to be written to the sensor.
+static bool ppg_process(long ir, long red, uint32_t now) {
+  bool drive_changed = false;
+
+  if (ir > PPG_IR_HIGH && ppg_irDrive > 0x08) {
+    ppg_irDrive -= 0x08; drive_changed = true;
+  } else if (ir < PPG_IR_LOW && ppg_irDrive < 0xF0) {
+    ppg_irDrive += 0x08; drive_changed = true;
+  }
+
+  const float ALPHA_DC = 0.02f;
+  dc_ir = (1.0f-ALPHA_DC)*dc_ir + ALPHA_DC*(float)ir;
+  float ac_ir = (float)ir - dc_ir;
+
+  const float ALPHA_ACABS = 0.10f;
+  ppg_ac_abs_avg = (1.0f-ALPHA_ACABS)*ppg_ac_abs_avg + ALPHA_ACABS*fabsf(ac_ir);
+
+  bool cond_on  = (dc_ir > DC_CONTACT_MIN) && (ppg_ac_abs_avg > AC_CONTACT_MIN);
+  bool cond_off = (dc_ir < DC_LOSS_MIN)    || (ppg_ac_abs_avg < AC_LOSS_MIN);
+
+  if (cond_on)  { ppg_yes_cnt++; ppg_no_cnt = 0; } else { ppg_yes_cnt = 0; }
+  if (cond_off) { ppg_no_cnt++;  ppg_yes_cnt = 0; }
+
+  if (!ppg_contact && ppg_yes_cnt >= CONTACT_ON_SAMPLES)  ppg_contact = true;
+  if ( ppg_contact && ppg_no_cnt  >= CONTACT_OFF_SAMPLES) {
+    ppg_contact = false;
+    ppg_rateSpot = 0; ppg_rateFilled = 0; ppg_bpm = 0; ppg_bpm_avg = 0;
+  }
+
+  if (!ppg_contact && ppg_irDrive != PPG_DRIVE_MIN) {
+    ppg_irDrive = PPG_DRIVE_MIN; drive_changed = true;
+  }
+
+  ppg_env = (1.0f-PPG_ENV_ALPHA)*ppg_env + PPG_ENV_ALPHA*fabsf(ac_ir);
+  float thr = PPG_THR_RATIO * ppg_env;
+
+  if (ppg_contact &&
+      ac_ir > thr && ppg_prev_ac <= thr &&
+      (now - ppg_lastBeat) > PPG_REFRACT_MS) {
+
+    unsigned long beatMs = now - ppg_lastBeat;
+    ppg_lastBeat = now;
+
+    if (beatMs > 250 && beatMs < 2000) {
+      float inst = 60000.0f / (float)beatMs;
+      ppg_bpm = inst;
+
+      ppg_rates[ppg_rateSpot++] = (uint8_t)inst;
+      if (ppg_rateSpot >= 8) ppg_rateSpot = 0;
+      if (ppg_rateFilled < 8) ppg_rateFilled++;
+
+      int s = 0; for (int i=0;i<ppg_rateFilled;i++) s += ppg_rates[i];
+      ppg_bpm_avg = (ppg_rateFilled > 0) ? (s / ppg_rateFilled) : 0;
+    }
+  }
+  ppg_prev_ac = ac_ir;
+
+  const float ALPHA_RMS = 0.05f;
+  dc_red = (1.0f-ALPHA_DC)*dc_red + ALPHA_DC*(float)red;
+  float ac_red = (float)red - dc_red;
+
+  rms_ir  = (1.0f-ALPHA_RMS)*rms_ir  + ALPHA_RMS*(ac_ir*ac_ir);
+  rms_red = (1.0f-ALPHA_RMS)*rms_red + ALPHA_RMS*(ac_red*ac_red);
+  spo2_n++;
+
+  if (spo2_n >= 100) {
+    float msIR  = fmaxf(rms_ir,  0.0f);          // acX^2
+    float msRED = fmaxf(rms_red, 0.0f);
+
+    if (ppg_contact && dc_ir>15000 && dc_red>15000 && msIR>fm_sq(300) && msRED>fm_sq(150)) {
+      float R2 = (msRED / msIR) * fm_sq(dc_ir / dc_red);
+      spo2_value = SPO2_LUT(R2);
+
+      float snr2 = msIR / dc_ir;                 // (acIR / sqrt(dc_ir))^2
+      spo2_quality = (snr2 > fm_sq(50)) ? 3 : (snr2 > fm_sq(20)) ? 2 : 1;
+    } else {
+      spo2_value = NAN; spo2_quality = 0;
+    }
+    spo2_n = 0;
+  }
+
+  if (!ppg_contact) {
+    ppg_rateSpot = 0; ppg_rateFilled = 0; ppg_bpm = 0; ppg_bpm_avg = 0;
+    ppg_env = 0; ppg_prev_ac = 0;
+  }
+  return drive_changed;
+}
+
+// Seed the DC trackers from the sensor's first samples.
+static inline void ppg_seed(float ir_mean, float red_mean) {
+  dc_ir = ir_mean; dc_red = red_mean;
+  rms_ir = 0; rms_red = 0; spo2_n = 0;
+}
+
+// ---- steps / activity / posture ----------------------------------------------------
+// Tilt of the body z axis from vertical -> posture.
+static inline Posture posture_from_up(float up_z) {
+  float cosZ = fabsf(up_z);                      // tilt < X deg <=> cos(tilt) > cos(X)
+  if      (cosZ > COS_LYING)   return POST_LYING;
+  else if (cosZ > COS_SITTING) return POST_SITTING;
+  return POST_STANDING;
+}
+
+// a2: |a|^2, (m/s2)^2.
+void update_steps_activity_posture(float ax, float ay, float az,
+                                   float gx, float gy, float gz,
+                                   float a2, uint32_t now_ms) {
+
+  if (!isfinite(ax) || !isfinite(ay) || !isfinite(az)) {
+    activity_state = ACT_STILL;
+    return;
+  }
+
+  if (!(a2 > 0.25f) || !isfinite(a2)) {
+    a2 = ax*ax + ay*ay + az*az;
+  }
+
+  float dt = orient_last_ms ? (now_ms - orient_last_ms) / 1000.0f : IMU_PERIOD_MS / 1000.0f;
+  if (dt <= 0.0f || dt > 0.2f) dt = IMU_PERIOD_MS / 1000.0f;
+  orient_last_ms = now_ms;
+  if (isfinite(gx) && isfinite(gy) && isfinite(gz)) orient.update(gx, gy, gz, ax, ay, az, dt);
+  else                                                orient.update(0, 0, 0, ax, ay, az, dt);
+  orient.gravity(up_x, up_y, up_z);
+
+  posture_state = posture_from_up(up_z);
+
+  if (posture_state != POST_LYING) t_last_upright_ms = now_ms;
+
+  float a_par     = ax*up_x + ay*up_y + az*up_z;
+  gnorm = gnorm ? (1.0f-G_LP_ALPHA)*gnorm + G_LP_ALPHA*a_par : a_par;   // absorbs scale/offset error
+  float a_par_dyn = a_par - gnorm;
+  a_par_hp = (1.0f-HP_ALPHA)*a_par_hp + HP_ALPHA*a_par_dyn;
+
+  uint16_t dt_ms = now_ms - last_step_ms;
+  bool rising = (a_par_hp > STEP_PEAK && step_prev_hp <= STEP_PEAK);
+  if (rising && dt_ms >= STEP_MIN_MS && dt_ms <= STEP_MAX_MS) {
+    step_count++;
+    last_step_interval_ms = dt_ms;
+    last_step_ms = now_ms;
+  }
+  step_prev_hp = a_par_hp;
+
+  const MagBand& still = posture_state == POST_LYING ? STILL_BAND_LYING : STILL_BAND;
+  float thr_gyro = NO_MOTION_GYRO;
+  if (posture_state == POST_LYING) {
+    thr_gyro *= 3.0f;
+  }
+  float gyro_sum = fabsf(gx) + fabsf(gy) + fabsf(gz);
+  bool moving = still.outside(a2) || (gyro_sum > thr_gyro);
+
+  if (t_impact_ms && (now_ms - t_impact_ms) < 700) {
+    moving = false;
+  }
+
+  if (!moving) {
+    still_ms = (still_ms + IMU_PERIOD_MS);
+    if (still_ms > 60000) still_ms = 60000;
+  } else {
+    still_ms = 0;
+  }
+
+  uint32_t since_step = now_ms - last_step_ms;
+  if (since_step < 2500) {
+    if (last_step_interval_ms > 0 && last_step_interval_ms < 450) activity_state = ACT_RUN;
+    else                                                           activity_state = ACT_WALK;
+  } else if (!moving) {
+    activity_state = ACT_STILL;
+  } else {
+    activity_state = ACT_WALK;
+  }
+
+  if (moving) t_last_motion_ms = now_ms;
+}
+
+// ---- fall / unconscious -----------------------------------------------------------
+void update_fall_and_unconscious(float a2, Posture posture,
+                                 int bpm_pub, int spo2_pub,
+                                 bool ppg_has_contact, uint32_t now) {
+  bool impact = (a2 > IMPACT_A2) && ((now - fall_last_impact) > IMPACT_LOCK_MS);
+  if (impact) {
+    t_impact_ms = now;
+    fall_last_impact = now;
+    float amag = sqrtf(a2);
+    PIPE_LOG(TL_FALL_IMPACT, amag, amag/9.81f);
+  }
+
+  if (posture == POST_LYING) {
+    if (fall_prev_post != POST_LYING) t_lying_since_ms = now;
+  } else {
+    t_lying_since_ms = 0;
+  }
+  fall_prev_post = posture;
+
+  bool had_recent_impact = (t_impact_ms && (now - t_impact_ms) < 8000);
+  bool lying_confirmed   = (t_lying_since_ms && (now - t_lying_since_ms) > LYING_CONFIRM_MS);
+  bool inactive_enough   = (still_ms >= INACT_AFTER_MS);
+  bool soft_drop         = ((now - t_last_upright_ms) < 2000) && lying_confirmed;
+
+  fall_event = ((had_recent_impact || soft_drop) && inactive_enough);
+
+  float s = 0.0f;
+  if (lying_confirmed) s += 0.35f;
+  if (inactive_enough) s += 0.35f;
+
+  bool hr_bad   = (bpm_pub <= 0 || bpm_pub < HR_BRADY);
+  bool spo2_bad = (spo2_pub >= 0 && spo2_pub < SPO2_LOW);
+  if (hr_bad)   s += 0.20f;
+  if (spo2_bad) s += 0.35f;
+
+  if (!ppg_has_contact) s -= 0.10f;
+
+  if (s < 0) s = 0;
+  if (s > 1) s = 1;
+  unconscious_score = 0.8f * unconscious_score + 0.2f * s;
+
+  if (unconscious_score >= 0.75f) {
+    if (!fall_score_high_ms) fall_score_high_ms = now;
+    unconscious = ((now - fall_score_high_ms) > UNCON_MIN_MS);
+  } else {
+    fall_score_high_ms = 0;
+    if (still_ms < 500 || posture != POST_LYING) unconscious = false;
+  }
+
+  if ((int32_t)(now - fall_next_dbg) >= 0) {
+    fall_next_dbg = now + 1000;
+    PIPE_LOG(TL_FALL_STATE,
+      (int)had_recent_impact, (int)lying_confirmed, (int)inactive_enough,
+      (unsigned)still_ms, (int)fall_event, a_par_hp,
+      (unsigned long)step_count, (int)activity_state);
+  }
+}
+
+// One 50 Hz IMU sample through motion, steps/posture and fall detection.
+// a2 is |a|^2 (m/s2)^2: nothing on this path needs the magnitude itself.
+static inline void imu_process(float ax, float ay, float az, float gx, float gy, float gz,
+                        float a2, uint32_t now) {
+  gyro_sum_g = (isnan(gx)||isnan(gy)||isnan(gz)) ? 0.0f : (fabsf(gx)+fabsf(gy)+fabsf(gz));
+  bool accel_dyn = !isnan(a2) && MOTION_BAND.outside(a2);
+  motion_g = (accel_dyn || gyro_sum_g > 0.6f) ? 1 : 0;
+
+  update_steps_activity_posture(ax, ay, az, gx, gy, gz, a2, now);
+
+  update_fall_and_unconscious(
+    a2, posture_state,
+    /* bpm_pub  */ ppg_contact ? ((int)roundf(ppg_bpm/5.0f)*5) : 0,
+    /* spo2_pub */ (isnan(spo2_value) ? -1 : (int)roundf(spo2_value)),
+    /* ppg contact */ ppg_contact,
+    now
+  );
+}
+
+// ---- on-wrist (1 Hz) ----------------------------------------------------------------
+void onwrist_update_robuste(float skinC, float airC, bool ppg_contact, float dc_ir, int motion,
+                            uint32_t now) {
+  if (!isnan(skinC)) ow_skin_lp = isnan(ow_skin_lp) ? skinC : (0.9f*ow_skin_lp + 0.1f*skinC);
+  float dTdt = 0.0f;
+  if (!isnan(ow_skin_lp)) {
+    if (!isnan(ow_skin_lp_prev) && ow_t_prev) {
+      float dt = (now - ow_t_prev) / 1000.0f; if (dt < 0.5f) dt = 0.5f;
+      dTdt = (ow_skin_lp - ow_skin_lp_prev) / dt;
+    }
+    ow_skin_lp_prev = ow_skin_lp;
+  }
+  ow_t_prev = now;
+
+  bool skinOK = !isnan(ow_skin_lp) && ow_skin_lp > 20.0f && ow_skin_lp < 45.0f;
+  bool airOK  = !isnan(airC);
+  float dSA   = (skinOK && airOK) ? (ow_skin_lp - airC) : NAN;
+  bool near_skin_ppg = ppg_contact || (dc_ir > 20000);
+
+  float s = 0.0f;
+  if (skinOK && ow_skin_lp >= 29.0f && ow_skin_lp <= 36.5f) s += 0.35f;
+  if (!isnan(dSA) && dSA > 3.0f)                    s += 0.35f;
+  else if (!isnan(dSA) && dSA > 1.0f)               s += 0.15f;
+  if (dTdt > 0.03f)                                 s += 0.15f;
+  if (near_skin_ppg)                                s += 0.35f;
+  if (motion)                                       s -= 0.10f;
+  if (s < 0) s = 0;
+  if (s > 1) s = 1;
+
+  ow_s_lp = 0.8f*ow_s_lp + 0.2f*s;
+
+  if (!onWrist) {
+    if (ow_s_lp >= 0.60f) { if (!ow_arm_t0) ow_arm_t0 = now; if (now - ow_arm_t0 > 15000) onWrist = true; }
+    else ow_arm_t0 = 0;
+  } else {
+    if (ow_s_lp <= 0.35f) { onWrist = false; ow_arm_t0 = 0; }
+  }
+
+  onwrist_score = ow_s_lp;
+  onwrist_dSA   = dSA;
+  onwrist_dTdt  = dTdt;
+}
+
+// ---- ambient (1 Hz) ---------------------------------------------------------------
+// Raw BME280 reading -> self-heating corrected air temperature and RH.
+static inline void ambient_process(float T_bme, float RH_raw, float hpa) {
+  hpa_out = hpa;
+
+  if (isnan(T_floor)) T_floor = T_bme;
+  if (T_bme < T_floor) T_floor += K_DOWN * (T_bme - T_floor);
+  else                 T_floor += K_UP   * (T_bme - T_floor);
+  if (T_floor > T_bme) T_floor = T_bme;
+
+  float T_air_est = T_floor;
+
+  if (isnan(T_air_est_prev)) T_air_est_prev = T_air_est;
+  T_air_est = (1.0f - ALPHA_SMOOTH) * T_air_est_prev + ALPHA_SMOOTH * T_air_est;
+  T_air_est_prev = T_air_est;
+
+  float T_air_final = T_air_est + T_FIXED_OFFSET;
+
+  float RH_corr  = rh_retarget(RH_raw, T_bme, T_air_final);
+  float RH_final = RH_GAIN * RH_corr + RH_OFFSET;
+  if (RH_final < 0)   RH_final = 0;
+  if (RH_final > 100) RH_final = 100;
+
+  env_c_out   = T_air_final;
+  rh_out_corr = RH_final;
+}
+
+// Back to power-on state (replay runs several sessions in one process).
+static inline void pipeline_reset() {
+  step_count = 0; last_step_ms = 0; last_step_interval_ms = 0; t_last_upright_ms = 0; still_ms = 0;
+  fall_event = false; unconscious = false; unconscious_score = 0.0f;
+  t_impact_ms = t_last_motion_ms = t_lying_since_ms = 0;
+  activity_state = ACT_STILL; posture_state = POST_UNKNOWN;
+  orient = OrientFilter(); up_x = 0; up_y = 0; up_z = 1; orient_last_ms = 0;
+  a_par_hp = 0; gnorm = 0; step_prev_hp = 0;
+  fall_last_impact = fall_score_high_ms = fall_next_dbg = 0; fall_prev_post = POST_UNKNOWN;
+  gyro_sum_g = 0; motion_g = 0;
+
+  ppg_contact = false; ppg_irDrive = 0x30; ppg_env = 0; ppg_prev_ac = 0; ppg_lastBeat = 0;
+  ppg_bpm = 0; ppg_rateSpot = 0; ppg_rateFilled = 0; ppg_bpm_avg = 0;
+  for (auto& r : ppg_rates) r = 0;
+  dc_ir = dc_red = rms_ir = rms_red = 0; spo2_n = 0; spo2_value = NAN; spo2_quality = 0;
+  ppg_ac_abs_avg = 0; ppg_yes_cnt = ppg_no_cnt = 0;
+
+  onWrist = false; onwrist_score = 0; onwrist_dSA = NAN; onwrist_dTdt = 0;
+  ow_skin_lp = ow_skin_lp_prev = NAN; ow_s_lp = 0; ow_t_prev = ow_arm_t0 = 0;
+
+  T_floor = T_air_est_prev = NAN;
+  env_c_out = rh_out_corr = hpa_out = NAN;
+}
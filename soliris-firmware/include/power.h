@@ -0,0 +1,143 @@
+#pragma once
+// Power manager. loop() no longer spins: after each pass it blocks until the
+// next sample is due (PPG 10 ms, IMU 20 ms, environment 1 s), a command
+// arrives (pm_wake) or PM_MAX_IDLE_MS passes. With a core built with
+// CONFIG_PM_ENABLE and tickless idle those waits become automatic light
+// sleep with frequency scaling; otherwise the idle task clock-gates the CPU.
+//
+// Locks are held only around the work that needs them:
+//   bus    APB at max     I2C/OneWire transactions and the waits between them
+//   radio  no light sleep HTTP / BLE transfers
+//   usb    no light sleep while a USB host is attached (USB-Serial/JTAG
+//                         drops the link in light sleep)
+// Residency is accounted per state: active (loop working), idle (waiting, no
+// light sleep in this build: clock gating only), idle_held (waiting with a
+// lock that blocks light sleep), idle_sleep (waiting, light sleep allowed).
+// A sensor interrupt ends the wait through pm_wake_isr().
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+#include "tlog.h"
+#if CONFIG_PM_ENABLE
+  #include <esp_pm.h>
+#endif
+
+#define PM_MAX_IDLE_MS   10      // keeps LED/buzzer patterns and polled services fed
+#define PM_MIN_FREQ_MHZ  40      // XTAL
+
+enum PmLockId : uint8_t { PM_LOCK_BUS, PM_LOCK_RADIO, PM_LOCK_USB, PM_NLOCKS };
+static const char* const PM_LOCK_NAMES[PM_NLOCKS] = { "bus", "radio", "usb" };
+
+enum PmState : uint8_t { PM_ACTIVE, PM_IDLE_GATED, PM_IDLE_HELD, PM_IDLE_SLEEP, PM_NSTATES };
+static const char* const PM_STATE_NAMES[PM_NSTATES] = { "active", "idle", "idle_held", "idle_sleep" };
+
+struct PmLock {
+  uint8_t  depth;
+  uint32_t t0_us, takes;
+  uint64_t held_us;
+#if CONFIG_PM_ENABLE
+  esp_pm_lock_handle_t h;
+#endif
+};
+
+static PmLock       pm_locks[PM_NLOCKS];
+static uint64_t     pm_res_us[PM_NSTATES];
+static uint32_t     pm_t_us = 0;
+static TaskHandle_t pm_loop_task = nullptr;
+static bool         pm_dfs = false;          // esp_pm configured (DFS)
+static bool         pm_sleep = false;        // ...with automatic light sleep (tickless idle)
+
+// Loop task only.
+static void pm_acquire(PmLockId id) {
+  PmLock& l = pm_locks[id];
+  if (l.depth++) return;
+  l.t0_us = micros(); l.takes++;
+#if CONFIG_PM_ENABLE
+  if (l.h) esp_pm_lock_acquire(l.h);
+#endif
+}
+
+static void pm_release(PmLockId id) {
+  PmLock& l = pm_locks[id];
+  if (!l.depth || --l.depth) return;
+  l.held_us += micros() - l.t0_us;
+#if CONFIG_PM_ENABLE
+  if (l.h) esp_pm_lock_release(l.h);
+#endif
+}
+
+struct PmHold {
+  PmLockId id;
+  explicit PmHold(PmLockId i) : id(i) { pm_acquire(id); }
+  ~PmHold() { pm_release(id); }
+};
+
+// Any task / ISR: end the current idle wait early.
+static void pm_wake() { if (pm_loop_task) xTaskNotifyGive(pm_loop_task); }
+static void IRAM_ATTR pm_wake_isr() {
+  BaseType_t hp = pdFALSE;
+  if (pm_loop_task) vTaskNotifyGiveFromISR(pm_loop_task, &hp);
+  if (hp) portYIELD_FROM_ISR();
+}
+
+// Level-triggered GPIO wake from light sleep for a sensor interrupt line.
+static void pm_wake_pin(int pin, bool active_low) {
+  if (pin < 0) return;
+  gpio_wakeup_enable((gpio_num_t)pin, active_low ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
+  esp_sleep_enable_gpio_wakeup();
+}
+
+static void pm_begin() {
+  pm_loop_task = xTaskGetCurrentTaskHandle();
+  pm_t_us = micros();
+#if CONFIG_PM_ENABLE
+  esp_pm_lock_create(ESP_PM_APB_FREQ_MAX,   0, "bus",   &pm_locks[PM_LOCK_BUS].h);
+  esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "radio", &pm_locks[PM_LOCK_RADIO].h);
+  esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "usb",   &pm_locks[PM_LOCK_USB].h);
+  #if ESP_IDF_VERSION_MAJOR >= 5
+  esp_pm_config_t cfg = {};
+  #else
+  esp_pm_config_esp32s3_t cfg = {};
+  #endif
+  cfg.max_freq_mhz = getCpuFrequencyMhz();
+  cfg.min_freq_mhz = PM_MIN_FREQ_MHZ;
+  #if CONFIG_FREERTOS_USE_TICKLESS_IDLE
+  cfg.light_sleep_enable = true;
+  #endif
+  pm_dfs = esp_pm_configure(&cfg) == ESP_OK;
+  #if CONFIG_FREERTOS_USE_TICKLESS_IDLE
+  pm_sleep = pm_dfs;
+  #endif
+#endif
+  if (pm_sleep)    tlog<TL_PM_DFS>();
+  else if (pm_dfs) tlog<TL_PM_DFS_ONLY>();
+  else             tlog<TL_PM_IDLE>();
+}
+
+// Holds the usb lock while a host is attached (HWCDC reports SOFs).
+static void pm_usb_update() {
+  bool host = (bool)Serial;
+  if (host && !pm_locks[PM_LOCK_USB].depth) pm_acquire(PM_LOCK_USB);
+  else if (!host && pm_locks[PM_LOCK_USB].depth) pm_release(PM_LOCK_USB);
+}
+
+// End of loop(): wait up to wait_ms, or until pm_wake().
+static void pm_idle(uint32_t wait_ms) {
+  uint32_t t = micros();
+  pm_res_us[PM_ACTIVE] += t - pm_t_us;
+  pm_usb_update();
+  if (wait_ms > PM_MAX_IDLE_MS) wait_ms = PM_MAX_IDLE_MS;
+  if (wait_ms) {
+    bool held = pm_locks[PM_LOCK_RADIO].depth || pm_locks[PM_LOCK_USB].depth || pm_locks[PM_LOCK_BUS].depth;
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait_ms));
+    uint32_t t2 = micros();
+    pm_res_us[!pm_sleep ? PM_IDLE_GATED : held ? PM_IDLE_HELD : PM_IDLE_SLEEP] += t2 - t;
+    t = t2;
+  }
+  pm_t_us = t;
+}
+
+// Earlier of two millis() deadlines.
+static inline uint32_t pm_earliest(uint32_t a, uint32_t b) { return (int32_t)(b - a) < 0 ? b : a; }
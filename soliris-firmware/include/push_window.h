@@ -0,0 +1,60 @@
+#pragma once
+// Push-window aggregates. The 1 s sample row that goes to the time-series
+// store also feeds a running min/max/sum/count plus the last value per
+// metric (O(1) per second); the push sends the whole window instead of the
+// instant it fires on:
+//   "win":{"s":30,"hr":[min,max,mean,last,n],...,"steps":12,"sun_dose":40}
+// Metrics without a sample in the window are null. Steps and sun dose go
+// out as deltas over the window. The window aggregates the unquantized row;
+// pushwin_format() rounds every figure to the publish step so the window
+// carries no more resolution than the instant values. Portable (host benches).
+#include "ts_metric.h"
+#include "telemetry.h"
+
+// Decimals per metric in the push.
+static const uint8_t PW_DEC[TS_NMETRIC] = { 0, 0, 2, 2, 1, 1, 0, 0, 2, 0, 2 };
+
+// DEMO_MODE publish steps (qf() in main.cpp); 0 = sent as is.
+static const float PW_DEMO_STEP[TS_NMETRIC] = { 5, 1, 0.5f, 0.5f, 1, 1, 50, 5, 0.01f, 0, 0 };
+
+struct PushWindow {
+  TsAgg    a[TS_NMETRIC];
+  float    last[TS_NMETRIC];
+  uint32_t t0_ms, dose0;
+};
+
+static void pushwin_reset(PushWindow& w, uint32_t now_ms, uint32_t dose) {
+  for (int m = 0; m < TS_NMETRIC; ++m) { w.a[m].clear(); w.last[m] = NAN; }
+  w.t0_ms = now_ms; w.dose0 = dose;
+}
+
+static inline void pushwin_add(PushWindow& w, const float v[TS_NMETRIC]) {
+  for (int m = 0; m < TS_NMETRIC; ++m) {
+    if (isnan(v[m])) continue;
+    w.a[m].add(v[m]);
+    w.last[m] = v[m];
+  }
+}
+
+// Renders the "win" object (without the key); 0 if cap was too small.
+// dose: current daily sun dose, which restarts at midnight. step: per-metric
+// rounding of min/max/mean/last (PW_DEMO_STEP), or nullptr.
+static size_t pushwin_format(char* buf, size_t cap, const PushWindow& w, uint32_t now_ms, uint32_t dose,
+                             const float* step = nullptr) {
+  JsonOut o(buf, cap);
+  o.put("{\"s\":%lu", (unsigned long)((now_ms - w.t0_ms + 500) / 1000));
+  for (int m = 0; m < TS_NMETRIC; ++m) {
+    if (m == TS_STEPS) continue;
+    const TsAgg& a = w.a[m];
+    o.put(",\"%s\":", TS_NAMES[m]);
+    if (!a.n) { o.raw("null"); continue; }
+    int d = PW_DEC[m];
+    float q = step ? step[m] : 0;
+    auto r = [q](float v) { return q > 0 ? qf(v, q) : v; };
+    o.put("[%.*f,%.*f,%.*f,%.*f,%u]", d, (double)r(a.mn), d, (double)r(a.mx), d, (double)r(a.sum / a.n),
+          d, (double)r(w.last[m]), (unsigned)a.n);
+  }
+  o.put(",\"steps\":%lu", (unsigned long)w.a[TS_STEPS].sum);
+  o.put(",\"sun_dose\":%lu}", (unsigned long)(dose >= w.dose0 ? dose - w.dose0 : dose));
+  return o.ok ? (size_t)(o.p - buf) : 0;
+}
@@ -0,0 +1,130 @@
+#pragma once
+// Send-on-delta reporting. Every second each transport lane looks at the
+// published (already quantized) frame values and reports a field only when
+// it moved past its deadband since that lane last sent it, when it changes
+// faster than its rate-of-change trigger for RP_ROC_RUN seconds in a row in
+// the same direction (a value flapping across a quantum boundary never
+// does), or when it has been silent for its max interval. A frame goes out when at least one field is due (never
+// closer than the lane's min gap) and then also carries the fields past
+// half their silence, so heartbeats bunch into one frame.
+//
+// A change is due when |v - sent| > 0, >= abs and >= rel * |sent|; NAN
+// (no value) counts as a change when it appears or clears.
+// Rules are set at runtime over the control channel (rp_set). Portable.
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "telemetry.h"
+
+#define RP_ROC_RUN  2
+
+enum RpLaneId : uint8_t { RP_WIFI, RP_BLE, RP_NLANES };
+static const char* const RP_LANE_NAMES[RP_NLANES] = { "wifi", "ble" };
+
+struct RpRule {
+  float    abs, rel;       // deadband: absolute (field units), relative (fraction)
+  float    roc;            // units/s between consecutive seconds, 0: off
+  uint16_t silence_s;      // max interval without the field, 0: never forced
+};
+
+struct RpLane {
+  RpRule   rule[TF_N];
+  uint32_t min_gap_ms;
+  // runtime
+  float    sent[TF_N], prev[TF_N];
+  int8_t   run[TF_N];      // consecutive seconds over roc, signed by direction
+  uint32_t sent_ms[TF_N], prev_ms, frame_ms;
+  uint16_t never;          // fields not sent yet
+  uint16_t held;           // due while inside the min gap
+  uint32_t frames, fields, bytes;
+};
+
+// Deadbands are two publish quanta (hr 5 bpm buckets, 0.5 C, CO2 50 ppm...);
+// the rate triggers catch a quantum a second sustained over RP_ROC_RUN s.
+static const RpRule RP_DEFAULTS[TF_N] = {
+  /* hr        */ { 10,     0,     5,    300 },
+  /* spo2      */ { 2,      0,     1,    300 },
+  /* temp_skin */ { 1,      0,     0.5f, 600 },
+  /* env_c     */ { 1,      0,     0.5f, 600 },
+  /* co2       */ { 100,    0.1f,  50,   600 },
+  /* voc       */ { 10,     0.1f,  0,    600 },
+  /* sun_touch */ { 1,      0,     0,    600 },
+  /* sun_proxy */ { 0.05f,  0.2f,  0,    600 },
+  /* motion    */ { 1,      0,     0,    600 },
+  /* gps.lat   */ { 0.0005f, 0,    0,   1800 },   // ~50 m
+  /* gps.lon   */ { 0.0005f, 0,    0,   1800 },
+};
+
+static void rp_init(RpLane& l, uint32_t min_gap_ms) {
+  memcpy(l.rule, RP_DEFAULTS, sizeof(l.rule));
+  l.min_gap_ms = min_gap_ms;
+  l.never = (1u << TF_N) - 1; l.held = 0;
+  l.prev_ms = 0; l.frame_ms = 0; l.frames = 0; l.fields = 0; l.bytes = 0;
+  for (int f = 0; f < TF_N; ++f) { l.sent[f] = NAN; l.prev[f] = NAN; l.sent_ms[f] = 0; l.run[f] = 0; }
+}
+
+static inline bool rp_moved(const RpRule& r, float sent, float v) {
+  if (isnan(sent) || isnan(v)) return isnan(sent) != isnan(v);
+  float d = fabsf(v - sent);
+  return d > 0 && d >= r.abs && d >= r.rel * fabsf(sent);
+}
+
+// Fields to send now (0: nothing). Call once per second per lane.
+static uint16_t rp_eval(RpLane& l, const float v[TF_N], uint32_t now_ms) {
+  uint16_t due = l.never | l.held;
+  float dt = l.prev_ms ? (now_ms - l.prev_ms) / 1000.0f : 0;
+  for (int f = 0; f < TF_N; ++f) {
+    const RpRule& r = l.rule[f];
+    uint32_t quiet = now_ms - l.sent_ms[f];
+    int8_t& run = l.run[f];
+    float d = v[f] - l.prev[f];                  // NAN when either side is missing
+    if (r.roc > 0 && dt > 0 && fabsf(d) / dt >= r.roc) {
+      if (d > 0) run = run > 0 ? (int8_t)(run < RP_ROC_RUN ? run + 1 : run) : 1;
+      else       run = run < 0 ? (int8_t)(run > -RP_ROC_RUN ? run - 1 : run) : -1;
+    } else {
+      run = 0;
+    }
+    if (rp_moved(r, l.sent[f], v[f])) due |= 1u << f;
+    else if (r.silence_s && quiet >= r.silence_s * 1000u) due |= 1u << f;
+    else if (run >= RP_ROC_RUN || run <= -RP_ROC_RUN) due |= 1u << f;
+    l.prev[f] = v[f];
+  }
+  l.prev_ms = now_ms;
+  if (!due) return 0;
+  if (l.frame_ms && now_ms - l.frame_ms < l.min_gap_ms) { l.held = due; return 0; }
+  for (int f = 0; f < TF_N; ++f)                // piggyback the nearly silent
+    if (l.rule[f].silence_s && now_ms - l.sent_ms[f] >= l.rule[f].silence_s * 500u) due |= 1u << f;
+  return due;
+}
+
+// The frame with `mask` (len bytes) went out.
+static void rp_commit(RpLane& l, const float v[TF_N], uint16_t mask, uint32_t now_ms, size_t len) {
+  for (int f = 0; f < TF_N; ++f) {
+    if (!(mask & (1u << f))) continue;
+    l.sent[f] = v[f]; l.sent_ms[f] = now_ms; l.fields++;
+  }
+  l.never &= ~mask; l.held &= ~mask;
+  l.frame_ms = now_ms; l.frames++; l.bytes += len;
+}
+
+static inline int rp_field_by_name(const char* s) {
+  for (int f = 0; f < TF_N; ++f) if (!strcmp(s, TF_NAMES[f])) return f;
+  return -1;
+}
+
+// Runtime rule change for one field or "*"; negative arguments keep the
+// current value. abs and roc in thousandths of the field unit, rel in
+// permille. False for an unknown field.
+static inline bool rp_set(RpLane& l, const char* field, int32_t abs_m, int32_t rel_pm, int32_t roc_m, int32_t sil_s) {
+  int only = strcmp(field, "*") ? rp_field_by_name(field) : -1;
+  if (strcmp(field, "*") && only < 0) return false;
+  for (int f = 0; f < TF_N; ++f) {
+    if (only >= 0 && f != only) continue;
+    RpRule& r = l.rule[f];
+    if (abs_m >= 0)  r.abs = abs_m / 1000.0f;
+    if (rel_pm >= 0) r.rel = rel_pm / 1000.0f;
+    if (roc_m >= 0)  r.roc = roc_m / 1000.0f;
+    if (sil_s >= 0)  r.silence_s = (uint16_t)(sil_s > 65535 ? 65535 : sil_s);
+  }
+  return true;
+}
@@ -0,0 +1,25 @@
+#pragma once
+// Fixed-capacity FIFO that drops the oldest entry when full. Holds N-1 items.
+// Portable (used with String on the device, std::string in host benches).
+template <typename T, int N>
+struct DropRing {
+  T   q[N];
+  int head = 0, tail = 0;
+  unsigned drops = 0;                    // oldest entries overwritten
+
+  void push(const T& v) {
+    int nxt = (tail + 1) % N;
+    if (nxt == head) { head = (head + 1) % N; drops++; }
+    q[tail] = v; tail = nxt;
+  }
+  bool pop(T& out) {
+    if (head == tail) return false;
+    out = q[head]; head = (head + 1) % N;
+    return true;
+  }
+  // i-th oldest entry, i < size(); drop(n) releases the n oldest once used.
+  const T& at(int i) const { return q[(head + i) % N]; }
+  void drop(int n) { if (n > size()) n = size(); head = (head + n) % N; }
+  int  size() const { return (tail - head + N) % N; }
+  bool empty() const { return head == tail; }
+};
@@ -0,0 +1,35 @@
+#pragma once
+// .scap capture file, written by tools/capture and read by the host tools.
+//   "SCAP1\n"  then per frame:  u16 len | hdr(8) | payload(len - 8)
+// Only frames that passed the CRC are stored. Host only (stdio).
+#include <stdio.h>
+#include "frame.h"
+
+#define SCAP_MAGIC "SCAP1\n"
+
+static inline bool scap_write_header(FILE* f) { return fwrite(SCAP_MAGIC, 1, 6, f) == 6; }
+
+static inline bool scap_write(FILE* f, const FrameHdr& h, const uint8_t* p, size_t n) {
+  uint8_t rec[2 + FRAME_HDR_LEN];
+  frame_put16(rec, (uint16_t)(FRAME_HDR_LEN + n));
+  rec[2] = h.chan; rec[3] = h.type;
+  frame_put16(rec + 4, h.seq);
+  frame_put32(rec + 6, h.t_us);
+  return fwrite(rec, 1, sizeof(rec), f) == sizeof(rec) && fwrite(p, 1, n, f) == n;
+}
+
+static inline bool scap_check_header(FILE* f) {
+  char m[6];
+  return fread(m, 1, 6, f) == 6 && !memcmp(m, SCAP_MAGIC, 6);
+}
+
+// Reads the next frame; p must hold FRAME_MAX_BODY bytes. false at EOF.
+static inline bool scap_read(FILE* f, FrameHdr& h, uint8_t* p, size_t& n) {
+  uint8_t rec[2 + FRAME_HDR_LEN];
+  if (fread(rec, 1, sizeof(rec), f) != sizeof(rec)) return false;
+  uint16_t len = frame_get16(rec);
+  if (len < FRAME_HDR_LEN || len - FRAME_HDR_LEN > FRAME_MAX_BODY) return false;
+  h = { rec[2], rec[3], frame_get16(rec + 4), frame_get32(rec + 6) };
+  n = len - FRAME_HDR_LEN;
+  return fread(p, 1, n, f) == n;
+}
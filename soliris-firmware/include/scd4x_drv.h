@@ -0,0 +1,234 @@
+#pragma once
+// SCD4x scheduling driven by the sensor's data-ready flag.
+//
+// read_measurement is only issued after get_data_ready_status reported new
+// data, and every command is split in "issue" / "fetch after execution time"
+// so loop() never blocks on the sensor. The measurement mode follows how
+// often CO2 is actually consumed (scd_set_demand) and the battery state:
+//   demand <= 10 s            -> periodic (5 s)
+//   demand <= 60 s            -> low-power periodic (30 s)
+//   slower, or battery low    -> single shot once per demand period
+// Single shot exists on the SCD41/SCD43 only: scd_begin() reads the sensor
+// variant and an SCD40 (or a firmware that can't tell) stays in low-power
+// periodic instead.
+#include <Arduino.h>
+#include <Wire.h>
+#include "battery.h"
+#include "tlog.h"
+
+#ifndef SCD4X_ADDR
+  #define SCD4X_ADDR   0x62
+#endif
+
+#define SCD_CMD_START_PERIODIC     0x21B1
+#define SCD_CMD_START_LP_PERIODIC  0x21AC
+#define SCD_CMD_STOP_PERIODIC      0x3F86
+#define SCD_CMD_READ_MEASUREMENT   0xEC05
+#define SCD_CMD_DATA_READY         0xE4B8
+#define SCD_CMD_SINGLE_SHOT        0x219D     // SCD41/SCD43 only
+#define SCD_CMD_GET_VARIANT        0x202F     // bits 15..12: 0 SCD40, 1 SCD41, 5 SCD43
+
+// Datasheet typical supply currents (SCD40 @3.3 V), used for the estimate.
+#define SCD_UA_PERIODIC   15000
+#define SCD_UA_LP         3200
+#define SCD_UA_IDLE       200
+#define SCD_UA_SHOT       18000      // during the 5 s single-shot measurement
+
+#define SCD_NEVER         0xFFFFFFFFu
+
+enum ScdMode : uint8_t { SCD_OFF = 0, SCD_PERIODIC, SCD_LOW_POWER, SCD_SINGLE_SHOT };
+enum ScdOp   : uint8_t { SCD_OP_NONE = 0, SCD_OP_READY, SCD_OP_READ, SCD_OP_STOP, SCD_OP_SHOT };
+
+static ScdMode  scd_mode = SCD_OFF;
+static ScdOp    scd_op = SCD_OP_NONE;
+static uint32_t scd_op_due = 0;          // when the pending op's answer can be fetched
+static uint32_t scd_next_poll = 0;       // next data-ready poll
+static uint32_t scd_demand_ms = 30000;   // how often a consumer needs a fresh value
+static uint32_t scd_next_shot = 0;
+static bool     scd_has_shot = false;     // variant supports single shot
+
+static uint16_t scd_co2 = 0;
+static float    scd_t = NAN, scd_rh = NAN;
+static bool     scd_fresh = false;
+static uint32_t scd_last_ms = 0;
+
+// stats
+static uint32_t scd_i2c_xfers = 0, scd_reads = 0, scd_not_ready = 0, scd_errors = 0;
+static uint64_t scd_charge_uas = 0;      // integrated uA*ms/1000
+static uint32_t scd_charge_t0 = 0, scd_begin_ms = 0;
+static uint32_t scd_cur_ua = SCD_UA_IDLE;
+
+static uint8_t scd_crc(const uint8_t* d) {
+  uint8_t c = 0xFF;
+  for (int i = 0; i < 2; ++i) {
+    c ^= d[i];
+    for (int b = 0; b < 8; ++b) c = (c & 0x80) ? (uint8_t)((c << 1) ^ 0x31) : (uint8_t)(c << 1);
+  }
+  return c;
+}
+
+static void scd_account(uint32_t now, uint32_t new_ua) {
+  scd_charge_uas += (uint64_t)scd_cur_ua * (uint32_t)(now - scd_charge_t0) / 1000;
+  scd_charge_t0 = now;
+  scd_cur_ua = new_ua;
+}
+
+static bool scd_send(uint16_t cmd) {
+  scd_i2c_xfers++;
+  Wire.beginTransmission(SCD4X_ADDR);
+  Wire.write((uint8_t)(cmd >> 8)); Wire.write((uint8_t)cmd);
+  return Wire.endTransmission() == 0;
+}
+
+static bool scd_fetch(uint16_t* w, uint8_t n) {
+  scd_i2c_xfers++;
+  uint8_t len = n * 3;
+  if (Wire.requestFrom((uint8_t)SCD4X_ADDR, len) != len) return false;
+  for (uint8_t i = 0; i < n; ++i) {
+    uint8_t b[3] = { (uint8_t)Wire.read(), (uint8_t)Wire.read(), (uint8_t)Wire.read() };
+    if (scd_crc(b) != b[2]) return false;
+    w[i] = ((uint16_t)b[0] << 8) | b[1];
+  }
+  return true;
+}
+
+static void scd_issue(uint16_t cmd, ScdOp op, uint32_t now, uint32_t exec_ms) {
+  if (!scd_send(cmd)) { scd_errors++; scd_op = SCD_OP_NONE; return; }
+  scd_op = op; scd_op_due = now + exec_ms;
+}
+
+static ScdMode scd_pick_mode() {
+  uint32_t demand = scd_demand_ms;
+  if (battery_low()) demand *= 4;
+  if (demand <= 10000) return SCD_PERIODIC;
+  if ((demand <= 60000 && !battery_low()) || !scd_has_shot) return SCD_LOW_POWER;
+  return SCD_SINGLE_SHOT;
+}
+
+// 0 SCD40, 1 SCD41, 5 SCD43; -1 if the sensor doesn't answer the command.
+static int scd_read_variant() {
+  uint16_t w;
+  if (!scd_send(SCD_CMD_GET_VARIANT)) return -1;
+  delay(1);
+  if (!scd_fetch(&w, 1)) return -1;
+  return w >> 12;
+}
+
+// Consumers declare how often they need CO2 (e.g. PUSH_PERIOD_MS).
+static void scd_set_demand(uint32_t period_ms) { scd_demand_ms = period_ms ? period_ms : 30000; }
+
+// Take over from the vendor driver once the sensor answered getSerialNumber
+// (it is idle at that point). Runs on the init runner: the variant read
+// waits 1 ms.
+static void scd_begin(uint32_t now) {
+  int v = scd_read_variant();
+  scd_has_shot = v == 1 || v == 5;
+  tlog<TL_SCD_VARIANT>(v == 0 ? "SCD40" : v == 1 ? "SCD41" : v == 5 ? "SCD43" : "unknown",
+                       scd_has_shot ? "single shot" : "low-power periodic");
+  scd_mode = SCD_OFF;
+  scd_charge_t0 = scd_begin_ms = now;
+  scd_charge_uas = 0;                    // ua_avg spans since the last (re)start
+}
+
+static void scd_enter(ScdMode m, uint32_t now) {
+  scd_mode = m;
+  switch (m) {
+    case SCD_PERIODIC:
+      scd_issue(SCD_CMD_START_PERIODIC, SCD_OP_NONE, now, 1);
+      scd_next_poll = now + 5000; scd_account(now, SCD_UA_PERIODIC); break;
+    case SCD_LOW_POWER:
+      scd_issue(SCD_CMD_START_LP_PERIODIC, SCD_OP_NONE, now, 1);
+      scd_next_poll = now + 30000; scd_account(now, SCD_UA_LP); break;
+    case SCD_SINGLE_SHOT:
+      scd_next_shot = now; scd_next_poll = SCD_NEVER; scd_account(now, SCD_UA_IDLE); break;
+    default: break;
+  }
+}
+
+static uint32_t scd_period_ms() {
+  return scd_mode == SCD_PERIODIC ? 5000 : scd_mode == SCD_LOW_POWER ? 30000 : scd_demand_ms;
+}
+
+static void scd_service(uint32_t now) {
+  if (scd_op != SCD_OP_NONE) {
+    if ((int32_t)(now - scd_op_due) < 0) return;
+    ScdOp op = scd_op; scd_op = SCD_OP_NONE;
+    uint16_t w[3];
+    switch (op) {
+      case SCD_OP_READY:
+        if (!scd_fetch(w, 1)) { scd_errors++; scd_next_poll = now + 1000; break; }
+        if ((w[0] & 0x07FF) == 0) {                 // not yet: back off a little
+          scd_not_ready++;
+          scd_next_poll = now + (scd_mode == SCD_PERIODIC ? 250 : 1000);
+          break;
+        }
+        scd_issue(SCD_CMD_READ_MEASUREMENT, SCD_OP_READ, now, 1);
+        break;
+      case SCD_OP_READ:
+        if (!scd_fetch(w, 3) || w[0] == 0) { scd_errors++; scd_next_poll = now + 1000; break; }
+        scd_co2 = w[0];
+        scd_t   = -45.0f + 175.0f * w[1] / 65535.0f;
+        scd_rh  = 100.0f * w[2] / 65535.0f;
+        scd_fresh = true; scd_last_ms = now; scd_reads++;
+        // next data is one period away; poll just after it should be there
+        scd_next_poll = now + scd_period_ms() - 200;
+        if (scd_mode == SCD_SINGLE_SHOT) {
+          scd_account(now, SCD_UA_IDLE);
+          scd_next_poll = SCD_NEVER;
+        }
+        break;
+      case SCD_OP_STOP:                            // 500 ms elapsed, sensor idle
+        scd_mode = SCD_OFF; scd_account(now, SCD_UA_IDLE);
+        break;
+      case SCD_OP_SHOT:
+        scd_next_poll = now; break;
+      default: break;
+    }
+    return;
+  }
+
+  ScdMode want = scd_pick_mode();
+  if (want != scd_mode) {
+    if (scd_mode == SCD_PERIODIC || scd_mode == SCD_LOW_POWER) {
+      scd_issue(SCD_CMD_STOP_PERIODIC, SCD_OP_STOP, now, 500);
+      return;
+    }
+    scd_enter(want, now);
+    return;
+  }
+
+  if (scd_mode == SCD_SINGLE_SHOT && scd_next_poll == SCD_NEVER) {
+    if ((int32_t)(now - scd_next_shot) >= 0) {
+      scd_next_shot = now + scd_demand_ms * (battery_low() ? 4 : 1);
+      scd_account(now, SCD_UA_SHOT);
+      scd_issue(SCD_CMD_SINGLE_SHOT, SCD_OP_SHOT, now, 5000);
+    }
+    return;
+  }
+
+  if ((int32_t)(now - scd_next_poll) >= 0)
+    scd_issue(SCD_CMD_DATA_READY, SCD_OP_READY, now, 1);
+}
+
+// Hand out a value once; NAN when nothing new arrived since the last call.
+static float scd_take(float* out_rh) {
+  if (!scd_fresh) return NAN;
+  scd_fresh = false;
+  if (out_rh) *out_rh = scd_rh;
+  return (float)scd_co2;
+}
+
+static uint32_t scd_avg_ua(uint32_t now) {
+  scd_account(now, scd_cur_ua);
+  uint32_t span = now - scd_begin_ms;
+  return span ? (uint32_t)(scd_charge_uas * 1000 / span) : scd_cur_ua;
+}
+
+static const char* scd_mode_name() {
+  switch (scd_mode) {
+    case SCD_PERIODIC:    return "periodic";
+    case SCD_LOW_POWER:   return "low_power";
+    case SCD_SINGLE_SHOT: return "single_shot";
+    default:              return "off";
+  }
+}
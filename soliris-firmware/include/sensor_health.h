@@ -0,0 +1,218 @@
+#pragma once
+// Sensor health supervisor. Every sampling path reports its transfers
+// (health_note / health_run); a device that keeps failing is isolated (its
+// *_ok flag drops, so loop() stops touching it), its bus gets a clear and
+// re-init, and it is re-probed in the background with exponential backoff:
+//
+//   OK --(HL_ISOLATE_CONSEC errors in a row, or error rate >= 50%)--> ISOLATED
+//   ISOLATED --(backoff elapsed, address ACKs)--> REINIT --(step OK)--> OK
+//                                                        \--(fail)--> ISOLATED, backoff x2
+//
+// REINIT runs the device's step function with the init_seq.h protocol (wait
+// ms / INIT_OK / INIT_FAIL), one step per health_service() call, so waits
+// never block sampling. Devices that failed at boot start ISOLATED.
+//
+// Bus clear (NXP UM10204 3.1.16): release the controller, clock SCL until
+// the device holding SDA lets go (at most 9 pulses), send a STOP, re-init.
+// With a 50 ms Wire timeout a hung device costs one short timeout per
+// transfer until it is isolated, instead of 1 s each.
+#include <Arduino.h>
+#include <Wire.h>
+#include "boot.h"
+#include "init_seq.h"
+#include "tlog.h"
+
+#define I2C_TIMEOUT_MS        50       // none of the parts clock-stretch
+#define HL_ISOLATE_CONSEC      4
+#define HL_RATE_SHIFT          4       // error-rate EWMA, 1/16 per transfer
+#define HL_ISOLATE_RATE      128       // /256
+#define HL_RATE_MIN_OPS       16       // transfers before the rate counts
+#define HL_BACKOFF_MIN_MS   2000
+#define HL_BACKOFF_MAX_MS 300000
+#define HL_STABLE_MS       60000       // healthy this long: backoff back to min
+#define HL_CLEAR_PULSES        9
+#define HL_HALF_US             5       // 100 kHz
+
+enum HlState : uint8_t { HL_OK, HL_ISOLATED, HL_REINIT };
+static const char* const HL_STATE_NAMES[] = { "ok", "isolated", "reinit" };
+
+struct HealthDev {
+  const char* name;
+  uint8_t     bus;                     // BUS_WIRE / BUS_WIRE1 / BUS_ONEWIRE
+  uint8_t     addr;                    // 0: no ACK gate (the step probes)
+  bool*       ok;                      // sampling flag
+  int32_t   (*step)(uint8_t phase);    // nullptr: answering is enough
+  // runtime
+  uint8_t  state, phase, consec;
+  uint16_t rate;                       // error rate, /256
+  uint32_t ops, errs, win_ops;
+  uint32_t isolations, probes, recoveries;
+  uint32_t backoff_ms, due_ms, since_ms;
+};
+
+struct HlBus {
+  TwoWire* wire;
+  int8_t   sda, scl;
+  uint32_t hz;
+  uint32_t clears, sda_stuck, scl_stuck, fails;
+};
+
+static HealthDev* hl_devs = nullptr;
+static int        hl_ndevs = 0;
+static HlBus      hl_bus[2] = {};
+static uint8_t    hl_bus_pending = 0;  // bit per bus: clear on the next service
+static bool       hl_running = false;
+
+static void health_bus(uint8_t b, TwoWire& w, int8_t sda, int8_t scl, uint32_t hz) {
+  hl_bus[b].wire = &w; hl_bus[b].sda = sda; hl_bus[b].scl = scl; hl_bus[b].hz = hz;
+}
+
+static void health_setup(HealthDev* devs, int n) {
+  hl_devs = devs; hl_ndevs = n;
+  for (int i = 0; i < n; ++i) { devs[i].state = HL_OK; devs[i].backoff_ms = HL_BACKOFF_MIN_MS; }
+}
+
+static inline bool hl_i2c(uint8_t b) { return b < 2 && hl_bus[b].wire; }
+
+static bool hl_lines_idle(uint8_t b) {
+  return digitalRead(hl_bus[b].sda) && digitalRead(hl_bus[b].scl);
+}
+
+static bool hl_bus_clear(uint8_t b) {
+  HlBus& h = hl_bus[b];
+  h.clears++;
+  h.wire->end();
+  pinMode(h.sda, INPUT_PULLUP); pinMode(h.scl, INPUT_PULLUP);
+  delayMicroseconds(HL_HALF_US);
+  bool ok = true;
+  if (!digitalRead(h.scl)) {
+    h.scl_stuck++; ok = false;                  // a device holds the clock: nothing to clock out
+  } else {
+    if (!digitalRead(h.sda)) {
+      h.sda_stuck++;
+      pinMode(h.scl, OUTPUT_OPEN_DRAIN);
+      for (int i = 0; i < HL_CLEAR_PULSES && !digitalRead(h.sda); ++i) {
+        digitalWrite(h.scl, LOW);  delayMicroseconds(HL_HALF_US);
+        digitalWrite(h.scl, HIGH); delayMicroseconds(HL_HALF_US);
+      }
+    }
+    pinMode(h.scl, OUTPUT_OPEN_DRAIN); digitalWrite(h.scl, LOW);
+    pinMode(h.sda, OUTPUT_OPEN_DRAIN); digitalWrite(h.sda, LOW);
+    delayMicroseconds(HL_HALF_US);
+    digitalWrite(h.scl, HIGH); delayMicroseconds(HL_HALF_US);
+    digitalWrite(h.sda, HIGH); delayMicroseconds(HL_HALF_US);   // STOP
+    pinMode(h.sda, INPUT_PULLUP); pinMode(h.scl, INPUT_PULLUP);
+    ok = digitalRead(h.sda) && digitalRead(h.scl);
+  }
+  h.wire->begin(h.sda, h.scl);
+  h.wire->setClock(h.hz);
+  h.wire->setTimeOut(I2C_TIMEOUT_MS);
+  if (!ok) h.fails++;
+  tlog<TL_HEALTH_CLEAR>(b, ok ? "ok" : "FAILED");
+  return ok;
+}
+
+static void hl_isolate(HealthDev& h, uint32_t now) {
+  *h.ok = false;
+  h.state = HL_ISOLATED;
+  h.isolations++;
+  h.due_ms = now + h.backoff_ms;
+  if (hl_i2c(h.bus)) hl_bus_pending |= 1u << h.bus;
+  tlog<TL_HEALTH_ISOLATE>(h.name, h.consec, h.rate * 100 / 256, h.backoff_ms);
+}
+
+static void hl_retry(HealthDev& h, uint32_t now) {
+  *h.ok = false;
+  h.state = HL_ISOLATED;
+  h.backoff_ms = h.backoff_ms * 2 > HL_BACKOFF_MAX_MS ? HL_BACKOFF_MAX_MS : h.backoff_ms * 2;
+  h.due_ms = now + h.backoff_ms;
+}
+
+static void hl_up(HealthDev& h, uint32_t now) {
+  *h.ok = true;
+  h.state = HL_OK;
+  h.consec = 0; h.rate = 0; h.win_ops = 0;
+  h.recoveries++;
+  h.since_ms = now;
+  topo_save();                                  // no-op unless the probe found a new address
+  tlog<TL_HEALTH_BACK>(h.name, h.probes);
+}
+
+// ops transfers of which errs failed, from one sampling call.
+static void health_count(uint8_t d, uint32_t ops, uint32_t errs) {
+  if (!hl_running || d >= hl_ndevs || !ops) return;
+  HealthDev& h = hl_devs[d];
+  if (h.state != HL_OK) return;
+  h.ops += ops; h.errs += errs; h.win_ops += ops;
+  uint32_t c = errs < ops ? errs : h.consec + errs;    // order within a call is unknown
+  h.consec = c > 255 ? 255 : c;
+  for (uint32_t i = 0; i < ops && i < 8; ++i) {
+    int e = i < errs ? 256 : 0;
+    h.rate += (e - (int)h.rate) >> HL_RATE_SHIFT;
+  }
+  if (h.consec >= HL_ISOLATE_CONSEC || (h.win_ops >= HL_RATE_MIN_OPS && h.rate >= HL_ISOLATE_RATE))
+    hl_isolate(h, millis());
+}
+
+static inline void health_note(uint8_t d, bool ok) { health_count(d, 1, ok ? 0 : 1); }
+
+// Runs a driver's service call and charges its transfer/error counter deltas.
+template <typename F>
+static inline void health_run(uint8_t d, const uint32_t& xfers, const uint32_t& errors, F f) {
+  uint32_t x = xfers, e = errors;
+  f();
+  health_count(d, xfers - x, errors - e);
+}
+
+// Once the init runners are done: boot failures go to background probing.
+static void health_begin(uint32_t now) {
+  for (int i = 0; i < hl_ndevs; ++i) {
+    HealthDev& h = hl_devs[i];
+    h.since_ms = now;
+    if (*h.ok) continue;
+    h.state = HL_ISOLATED;
+    h.due_ms = now + h.backoff_ms;
+  }
+  hl_running = true;
+}
+
+// From loop() under the bus lock. Does at most one probe or step per call.
+static void health_service(uint32_t now) {
+  if (!hl_running) return;
+  for (uint8_t b = 0; b < 2; ++b)
+    if (hl_bus_pending & (1u << b)) { hl_bus_pending &= ~(1u << b); hl_bus_clear(b); }
+
+  for (int i = 0; i < hl_ndevs; ++i) {
+    HealthDev& h = hl_devs[i];
+    if (h.state == HL_OK) {
+      if (h.backoff_ms > HL_BACKOFF_MIN_MS && now - h.since_ms > HL_STABLE_MS) h.backoff_ms = HL_BACKOFF_MIN_MS;
+      continue;
+    }
+    if ((int32_t)(now - h.due_ms) < 0) continue;
+    if (h.state == HL_ISOLATED) {
+      h.probes++;
+      if (hl_i2c(h.bus)) {
+        if (!hl_lines_idle(h.bus)) hl_bus_clear(h.bus);
+        if (h.addr) {
+          if (!i2c_ack(*hl_bus[h.bus].wire, h.addr)) { hl_retry(h, now); return; }
+          if (!topo_has(h.bus, h.addr)) { topo_set(h.bus, h.addr); topo_dirty = true; }
+        }
+      }
+      h.state = HL_REINIT; h.phase = 0;
+    }
+    int32_t r = h.step ? h.step(h.phase++) : INIT_OK;
+    now = millis();
+    if (r >= 0)            h.due_ms = now + r;
+    else if (r == INIT_OK) hl_up(h, now);
+    else                   hl_retry(h, now);
+    return;
+  }
+}
+
+// Earliest probe or step, for the idle planner (now + 1 h when none).
+static uint32_t health_due(uint32_t now) {
+  uint32_t due = now + 3600000;
+  for (int i = 0; hl_running && i < hl_ndevs; ++i)
+    if (hl_devs[i].state != HL_OK && (int32_t)(hl_devs[i].due_ms - due) < 0) due = hl_devs[i].due_ms;
+  return due;
+}
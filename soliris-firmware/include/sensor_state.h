@@ -0,0 +1,86 @@
+#pragma once
+// Published sensor state. Each producer copies what it owns out of the
+// pipeline globals into a typed struct once per update and publishes it
+// (snapshot.h); the serializer, the uplink and the alert engine read those
+// structs instead of the globals, so a producer can move to its own task
+// or core without the readers seeing half an update.
+//
+//   producer            struct    rate
+//   ppg_service()       PpgState  100 Hz (published at 10 Hz)
+//   IMU block, loop()   ImuState  50 Hz
+//   1 s block, loop()   EnvState  1 Hz   (ambient, air, sun, wear)
+// Portable (host benches).
+#include "snapshot.h"
+#include "pipeline.h"
+
+#define PPG_PUBLISH_MS 100
+
+struct PpgState {
+  uint32_t t_ms;
+  float    bpm, spo2, dc_ir;
+  int      bpm_avg;
+  uint8_t  spo2_q, ir_drive;
+  bool     contact;
+};
+
+struct ImuState {
+  uint32_t t_ms;
+  float    ax, ay, az, gx, gy, gz, a2;   // a2: |a|^2, the serializer takes the root at 1 Hz
+  float    face;                       // cos of the sun-axis angle to vertical, 0..1
+  float    unconscious_score;
+  uint32_t steps;
+  int      motion;
+  uint8_t  activity, posture;
+  bool     fall, unconscious, ok;
+};
+
+struct EnvState {
+  uint32_t t_ms;
+  float    skin_raw, skin, env_c, rh, hpa, co2, voc;
+  int      voc_sraw;
+  float    sun_proxy, sun_score;
+  uint32_t sun_dose;
+  uint16_t vis, ir;
+  bool     si_ok, covered, outdoor, sun_touch;
+  bool     on_wrist;
+  float    ow_score, ow_dSA, ow_dTdt;
+};
+
+static Snapshot<PpgState> st_ppg;
+static Snapshot<ImuState> st_imu;
+static Snapshot<EnvState> st_env;
+
+// One consistent view for a consumer (each part is consistent on its own).
+struct SensorState {
+  PpgState ppg;
+  ImuState imu;
+  EnvState env;
+};
+
+static inline void state_read(SensorState& s) {
+  st_ppg.read(s.ppg); st_imu.read(s.imu); st_env.read(s.env);
+}
+
+static void state_publish_ppg(uint32_t now) {
+  static uint32_t next = 0;
+  if ((int32_t)(now - next) < 0) return;
+  next = now + PPG_PUBLISH_MS;
+  PpgState p;
+  p.t_ms = now;
+  p.bpm = ppg_bpm; p.spo2 = spo2_value; p.dc_ir = dc_ir; p.bpm_avg = ppg_bpm_avg;
+  p.spo2_q = spo2_quality; p.ir_drive = ppg_irDrive; p.contact = ppg_contact;
+  st_ppg.publish(p);
+}
+
+static void state_publish_imu(uint32_t now, const float v[7], float face, bool ok) {
+  ImuState s;
+  s.t_ms = now;
+  s.ax = v[0]; s.ay = v[1]; s.az = v[2]; s.gx = v[3]; s.gy = v[4]; s.gz = v[5]; s.a2 = v[6];
+  s.face = face;
+  s.unconscious_score = unconscious_score;
+  s.steps = step_count;
+  s.motion = motion_g;
+  s.activity = (uint8_t)activity_state; s.posture = (uint8_t)posture_state;
+  s.fall = fall_event; s.unconscious = unconscious; s.ok = ok;
+  st_imu.publish(s);
+}
@@ -0,0 +1,121 @@
+#pragma once
+// USB serial channels. Telemetry and logs leave on separate framed channels
+// (frame.h), so the host no longer picks JSON out of a mixed text stream:
+//
+//   FRAME_CH_TELEM  one JSON line per TEL_LINE frame; a line longer than
+//                   FRAME_MAX_BODY is sent as TEL_PART frames first
+//   FRAME_CH_LOG    TLOG_RECORDS: u32 dropped, then tlog.h records
+//
+// `tel` is a Print: the serializer and the control replies print into it as
+// they did into Serial, and each '\n' closes a frame. tlog_service() batches
+// log records into frames from loop(). Every writer runs on the loop task,
+// so frames never interleave; a frame the CDC buffer can't take whole is
+// dropped and counted rather than cut. Other tasks (init runners, network)
+// only ever tlog(); plain Serial prints are left to setup() before the
+// init runners start.
+//
+// {"log":"text"} switches back to plain lines (telemetry as is, logs
+// formatted by the drain), for a serial monitor; {"log":"off"} stops
+// recording logs; {"log":"bin"} is the default.
+#include <Arduino.h>
+#include "frame.h"
+#include "tlog.h"
+
+#ifndef SERIAL_FRAMED
+  #define SERIAL_FRAMED  1
+#endif
+#define TLOG_BATCH_BYTES  256         // frame a batch this big at once...
+#define TLOG_FLUSH_MS     250         // ...or once the oldest record is this old
+#define TLOG_TEXT_PER_PASS  4
+
+static bool     ser_framed = SERIAL_FRAMED;
+static uint16_t tel_seq = 0, tlog_seq = 0;
+static uint32_t tel_frames = 0, tel_dropped = 0, tlog_frames = 0, tlog_frame_drops = 0;
+
+static bool ser_write_frame(uint8_t chan, uint8_t type, uint16_t& seq, const uint8_t* p, size_t n) {
+  uint8_t wire[FRAME_MAX_WIRE];
+  FrameHdr h = { chan, type, seq++, micros() };
+  size_t len = frame_build(wire, sizeof(wire), h, p, n);
+  if (!len || Serial.availableForWrite() < (int)len) return false;
+  Serial.write(wire, len);
+  return true;
+}
+
+class TelPrint : public Print {
+ public:
+  size_t write(uint8_t c) override {
+    if (!ser_framed) return Serial.write(c);
+    if (c == '\r') return 1;
+    if (c == '\n') { emit(TEL_LINE); return 1; }
+    if (n_ == sizeof(buf_)) emit(TEL_PART);
+    buf_[n_++] = c;
+    return 1;
+  }
+  size_t write(const uint8_t* p, size_t n) override {
+    if (!ser_framed) return Serial.write(p, n);
+    for (size_t i = 0; i < n; ++i) write(p[i]);
+    return n;
+  }
+  using Print::write;
+
+ private:
+  uint8_t buf_[FRAME_MAX_BODY];
+  size_t  n_ = 0;
+
+  void emit(uint8_t type) {
+    if (ser_write_frame(FRAME_CH_TELEM, type, tel_seq, buf_, n_)) tel_frames++;
+    else tel_dropped++;
+    n_ = 0;
+  }
+};
+
+static TelPrint tel;
+
+// Long replies (bench) give the host up to ms to make room for a whole
+// frame rather than lose lines; the loop is blocked anyway.
+static void ser_wait_room(uint32_t ms) {
+  uint32_t t0 = millis();
+  while (Serial.availableForWrite() < FRAME_MAX_WIRE && millis() - t0 < ms) delay(1);
+}
+
+// "bin" | "text" | "off"
+static bool serial_chan_mode(const char* m) {
+  if      (!strcmp(m, "bin"))  { ser_framed = true;  tlog_on = true; }
+  else if (!strcmp(m, "text")) { ser_framed = false; tlog_on = true; }
+  else if (!strcmp(m, "off"))  { tlog_on = false; }
+  else return false;
+  return true;
+}
+
+static const char* serial_chan_mode_name() {
+  return !tlog_on ? "off" : ser_framed ? "bin" : "text";
+}
+
+// Call from loop(): frames or formats what the other tasks logged.
+static void tlog_service(uint32_t now) {
+  static uint32_t last_ms = 0;
+  uint32_t pending = tlog_pending();
+  if (!pending) { last_ms = now; return; }
+
+  if (!ser_framed) {
+    uint8_t rec[TLOG_REC_MAX];
+    char    line[TLOG_LINE_MAX];
+    for (int i = 0; i < TLOG_TEXT_PER_PASS && Serial.availableForWrite() >= TLOG_LINE_MAX + 2; ++i) {
+      size_t n = tlog_take(rec, sizeof(rec), 1);     // whole lines only: the rest waits in the ring
+      if (!n) break;
+      if (tlog_format(line, sizeof(line), rec, n) >= 0) Serial.println(line);
+    }
+    last_ms = now;
+    return;
+  }
+
+  if (pending < TLOG_BATCH_BYTES && now - last_ms < TLOG_FLUSH_MS) return;
+  while (tlog_pending() && Serial.availableForWrite() >= FRAME_MAX_WIRE) {
+    uint8_t p[FRAME_MAX_BODY];
+    frame_put32(p, tlog_main.dropped);
+    size_t n = 4 + tlog_take(p + 4, sizeof(p) - 4);
+    if (ser_write_frame(FRAME_CH_LOG, TLOG_RECORDS, tlog_seq, p, n)) tlog_frames++;
+    else tlog_frame_drops++;
+  }
+  last_ms = now;
+}
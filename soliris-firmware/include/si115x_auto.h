@@ -0,0 +1,220 @@
+#pragma once
+// Si115X autonomous-mode light sampling.
+// The sensor measures on its own timer (MEASRATE x MEASCOUNT0) and only raises
+// IRQ_STATUS when the visible channel leaves a window around the last value.
+// The host reads the result registers when the IRQ fires (INT pin, or a cheap
+// one-byte IRQ_STATUS poll when no pin is wired) or when SI_READ_PERIOD_MS has
+// elapsed, and queues the sample in a small block that the 1 s telemetry path
+// aggregates.
+#include <Arduino.h>
+#include <Wire.h>
+#include "power.h"
+
+#ifndef SI115X_ADDR
+  #define SI115X_ADDR        0x53
+#endif
+#ifndef SI115X_INT_PIN
+  #define SI115X_INT_PIN     -1          // Grove module: INT not routed, poll IRQ_STATUS
+#endif
+#ifndef SI_MEAS_PERIOD_MS
+  #define SI_MEAS_PERIOD_MS  100         // autonomous measurement period
+#endif
+#ifndef SI_READ_PERIOD_MS
+  #define SI_READ_PERIOD_MS  1000        // forced read rate when light is stable
+#endif
+#ifndef SI_IRQ_POLL_MS
+  #define SI_IRQ_POLL_MS     100         // IRQ_STATUS poll rate without INT pin
+#endif
+#ifndef SI_WINDOW_PCT
+  #define SI_WINDOW_PCT      12          // window half-width, % of last visible count
+#endif
+#define SI_WINDOW_MIN        4
+
+// registers
+#define SI_REG_PART_ID     0x00
+#define SI_REG_HOSTIN0     0x0A
+#define SI_REG_COMMAND     0x0B
+#define SI_REG_IRQ_ENABLE  0x0F
+#define SI_REG_RESPONSE0   0x11
+#define SI_REG_IRQ_STATUS  0x12
+#define SI_REG_HOSTOUT0    0x13
+// commands
+#define SI_CMD_RESET_CTR   0x00
+#define SI_CMD_PAUSE       0x12
+#define SI_CMD_START       0x13
+#define SI_CMD_PARAM_SET   0x80
+// parameters
+#define SI_P_CHAN_LIST     0x01
+#define SI_P_ADCCONFIG(n)  (0x02 + 4*(n))
+#define SI_P_ADCSENS(n)    (0x03 + 4*(n))
+#define SI_P_ADCPOST(n)    (0x04 + 4*(n))
+#define SI_P_MEASCONFIG(n) (0x05 + 4*(n))
+#define SI_P_MEASRATE_H    0x1A
+#define SI_P_MEASRATE_L    0x1B
+#define SI_P_MEASCOUNT0    0x1C
+#define SI_P_UPPER_H       0x29
+#define SI_P_UPPER_L       0x2A
+#define SI_P_LOWER_H       0x2C
+#define SI_P_LOWER_L       0x2D
+// field values
+#define SI_ADCMUX_LARGE_IR     0x02
+#define SI_ADCMUX_LARGE_WHITE  0x0D
+#define SI_ADCPOST_WINDOW      0x03      // THRESH_SEL = outside UPPER/LOWER
+#define SI_MEASCONFIG_COUNT0   0x40      // COUNTER_INDEX = MEASCOUNT0
+
+struct LightSample { uint32_t t_ms; uint16_t vis, ir; };
+
+#define SI_BLOCK_LEN 32
+static LightSample si_block[SI_BLOCK_LEN];
+static uint8_t  si_block_n = 0;
+static uint32_t si_block_drops = 0;
+
+static bool     si_auto = false;             // autonomous mode configured
+static volatile bool si_irq_flag = false;
+static uint32_t si_next_poll_ms = 0, si_next_read_ms = 0;
+static uint16_t si_last_vis = 0;
+
+// counters for the stats surface
+static uint32_t si_i2c_xfers = 0, si_reads = 0, si_irq_reads = 0, si_errors = 0;
+
+static bool si_wr(uint8_t reg, uint8_t v) {
+  si_i2c_xfers++;
+  Wire.beginTransmission(SI115X_ADDR);
+  Wire.write(reg); Wire.write(v);
+  if (Wire.endTransmission() == 0) return true;
+  si_errors++;
+  return false;
+}
+
+static bool si_rd(uint8_t reg, uint8_t* buf, uint8_t n) {
+  si_i2c_xfers++;
+  Wire.beginTransmission(SI115X_ADDR);
+  Wire.write(reg);
+  if (Wire.endTransmission(false) != 0 || Wire.requestFrom((uint8_t)SI115X_ADDR, n) != n) {
+    si_errors++;
+    return false;
+  }
+  for (uint8_t i = 0; i < n; ++i) buf[i] = Wire.read();
+  return true;
+}
+
+static bool si_cmd(uint8_t cmd) {
+  uint8_t r0 = 0;
+  if (!si_rd(SI_REG_RESPONSE0, &r0, 1)) return false;
+  uint8_t ctr = r0 & 0x0F;
+  if (!si_wr(SI_REG_COMMAND, cmd)) return false;
+  if (cmd == SI_CMD_RESET_CTR) return true;
+  for (int i = 0; i < 10; ++i) {
+    if (!si_rd(SI_REG_RESPONSE0, &r0, 1)) return false;
+    if (r0 & 0x10) { si_wr(SI_REG_COMMAND, SI_CMD_RESET_CTR); return false; }
+    if ((r0 & 0x0F) != ctr) return true;
+    delayMicroseconds(200);
+  }
+  return false;
+}
+
+static bool si_param(uint8_t p, uint8_t v) {
+  return si_wr(SI_REG_HOSTIN0, v) && si_cmd(SI_CMD_PARAM_SET | p);
+}
+
+static bool si_set_window(uint16_t vis) {
+  uint16_t w = (uint16_t)((uint32_t)vis * SI_WINDOW_PCT / 100);
+  if (w < SI_WINDOW_MIN) w = SI_WINDOW_MIN;
+  uint16_t hi = (vis > 0xFFFF - w) ? 0xFFFF : vis + w;
+  uint16_t lo = (vis < w) ? 0 : vis - w;
+  return si_param(SI_P_UPPER_H, hi >> 8) && si_param(SI_P_UPPER_L, hi & 0xFF)
+      && si_param(SI_P_LOWER_H, lo >> 8) && si_param(SI_P_LOWER_L, lo & 0xFF);
+}
+
+#if SI115X_INT_PIN >= 0
+static void IRAM_ATTR si_isr() { si_irq_flag = true; pm_wake_isr(); }
+#endif
+
+// Reconfigure the part for autonomous visible (ch0, windowed) + IR (ch1).
+// Call after Si115X::Begin(); returns false if the part rejected a command,
+// in which case the caller keeps the polled path.
+static bool si115_auto_begin() {
+  const uint16_t rate = (uint16_t)(SI_MEAS_PERIOD_MS * 10 / 8);   // 800 us units
+  bool ok = si_cmd(SI_CMD_PAUSE)
+    && si_param(SI_P_CHAN_LIST, 0x03)
+    && si_param(SI_P_ADCCONFIG(0), SI_ADCMUX_LARGE_WHITE)
+    && si_param(SI_P_ADCSENS(0), 0x00)
+    && si_param(SI_P_ADCPOST(0), SI_ADCPOST_WINDOW)
+    && si_param(SI_P_MEASCONFIG(0), SI_MEASCONFIG_COUNT0)
+    && si_param(SI_P_ADCCONFIG(1), SI_ADCMUX_LARGE_IR)
+    && si_param(SI_P_ADCSENS(1), 0x00)
+    && si_param(SI_P_ADCPOST(1), 0x00)
+    && si_param(SI_P_MEASCONFIG(1), SI_MEASCONFIG_COUNT0)
+    && si_param(SI_P_MEASRATE_H, rate >> 8)
+    && si_param(SI_P_MEASRATE_L, rate & 0xFF)
+    && si_param(SI_P_MEASCOUNT0, 1)
+    && si_set_window(0)
+    && si_wr(SI_REG_IRQ_ENABLE, 0x01)
+    && si_cmd(SI_CMD_START);
+  si_auto = ok;
+#if SI115X_INT_PIN >= 0
+  if (ok) {
+    pinMode(SI115X_INT_PIN, INPUT_PULLUP);
+    attachInterrupt(digitalPinToInterrupt(SI115X_INT_PIN), si_isr, FALLING);
+  }
+#endif
+  return ok;
+}
+
+static void si_push(uint32_t now, uint16_t vis, uint16_t ir) {
+  if (si_block_n >= SI_BLOCK_LEN) {            // keep newest, count the loss
+    memmove(si_block, si_block + 1, (SI_BLOCK_LEN - 1) * sizeof(LightSample));
+    si_block_n = SI_BLOCK_LEN - 1;
+    si_block_drops++;
+  }
+  si_block[si_block_n++] = LightSample{ now, vis, ir };
+}
+
+// Cheap to call every loop(): at most one 1-byte read per SI_IRQ_POLL_MS
+// (none with an INT pin) plus one 4-byte read per change or SI_READ_PERIOD_MS.
+static void si115_auto_service(uint32_t now) {
+  if (!si_auto) return;
+
+  bool fired = false;
+#if SI115X_INT_PIN >= 0
+  if (si_irq_flag) { si_irq_flag = false; fired = true; }
+#else
+  if ((int32_t)(now - si_next_poll_ms) >= 0) {
+    si_next_poll_ms = now + SI_IRQ_POLL_MS;
+    uint8_t st = 0;
+    if (si_rd(SI_REG_IRQ_STATUS, &st, 1) && (st & 0x01)) fired = true;
+  }
+#endif
+  bool due = (int32_t)(now - si_next_read_ms) >= 0;
+  if (!fired && !due) return;
+
+  uint8_t b[4];
+  if (!si_rd(SI_REG_HOSTOUT0, b, 4)) return;
+  uint16_t vis = ((uint16_t)b[0] << 8) | b[1];
+  uint16_t ir  = ((uint16_t)b[2] << 8) | b[3];
+  si_next_read_ms = now + SI_READ_PERIOD_MS;
+  si_reads++;
+  if (fired) { si_irq_reads++; si_set_window(vis); }
+#if SI115X_INT_PIN >= 0
+  else {
+    uint8_t st; si_rd(SI_REG_IRQ_STATUS, &st, 1);   // clear a stale IRQ
+  }
+#endif
+  si_last_vis = vis;
+  si_push(now, vis, ir);
+}
+
+// Aggregate and clear the pending block. Returns the sample count; when no
+// new sample arrived the light is unchanged and the last value is reported.
+static uint8_t si115_take_block(uint16_t& vis_mean, uint16_t& ir_mean, uint16_t& vis_max) {
+  uint8_t n = si_block_n;
+  if (!n) return 0;
+  uint32_t sv = 0, si = 0; uint16_t mx = 0;
+  for (uint8_t i = 0; i < n; ++i) {
+    sv += si_block[i].vis; si += si_block[i].ir;
+    if (si_block[i].vis > mx) mx = si_block[i].vis;
+  }
+  vis_mean = (uint16_t)(sv / n); ir_mean = (uint16_t)(si / n); vis_max = mx;
+  si_block_n = 0;
+  return n;
+}
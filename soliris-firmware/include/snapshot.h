@@ -0,0 +1,62 @@
+#pragma once
+// Lock-free state snapshots: one writer publishes a whole struct, any
+// number of readers on any task or core copy a consistent version of it.
+//
+// Double-buffered seqlock: the writer fills the slot readers are not
+// directed to, then flips `ver`. A reader copies the current slot and
+// retries only if the writer lapped it (two publishes during one copy), so
+// a reader that preempts the writer mid-publish on the same core never
+// spins on a half-written struct. Slots are copied as 32-bit relaxed atomic
+// words between acquire/release fences, so no access is a data race.
+// Portable (host benches run it across threads).
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <atomic>
+#include <type_traits>
+
+template <typename T>
+struct Snapshot {
+  static_assert(std::is_trivially_copyable<T>::value, "snapshots are copied as raw words");
+  static constexpr size_t W = (sizeof(T) + 3) / 4;
+
+  struct Slot { std::atomic<uint32_t> seq{0}; uint32_t v = 0, w[W] = {}; };
+  Slot                  slot[2];
+  std::atomic<uint32_t> ver{0};                  // publishes so far; slot[ver & 1] is current
+  mutable std::atomic<uint32_t> retries{0};
+
+  // Single writer.
+  void publish(const T& v) {
+    uint32_t buf[W] = {};
+    memcpy(buf, &v, sizeof(T));
+    uint32_t n = ver.load(std::memory_order_relaxed) + 1;
+    Slot& s = slot[n & 1];
+    uint32_t q = s.seq.load(std::memory_order_relaxed);
+    s.seq.store(q + 1, std::memory_order_relaxed);       // odd: being written
+    std::atomic_thread_fence(std::memory_order_release);
+    __atomic_store_n(&s.v, n, __ATOMIC_RELAXED);
+    for (size_t i = 0; i < W; ++i) __atomic_store_n(&s.w[i], buf[i], __ATOMIC_RELAXED);
+    s.seq.store(q + 2, std::memory_order_release);
+    ver.store(n, std::memory_order_release);
+  }
+
+  // Copies the newest version into out; returns its number (0: never published).
+  uint32_t read(T& out) const {
+    uint32_t buf[W];
+    for (;;) {
+      uint32_t n = ver.load(std::memory_order_acquire);
+      const Slot& s = slot[n & 1];
+      uint32_t q = s.seq.load(std::memory_order_acquire);
+      if (!(q & 1)) {
+        uint32_t v = __atomic_load_n(&s.v, __ATOMIC_RELAXED);
+        for (size_t i = 0; i < W; ++i) buf[i] = __atomic_load_n(&s.w[i], __ATOMIC_RELAXED);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (s.seq.load(std::memory_order_relaxed) == q) { memcpy(&out, buf, sizeof(T)); return v; }
+      }
+      retries.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  T get() const { T v; read(v); return v; }
+  uint32_t version() const { return ver.load(std::memory_order_acquire); }
+};
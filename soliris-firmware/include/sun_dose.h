@@ -0,0 +1,201 @@
+#pragma once
+// Incremental sun-exposure engine.
+// Fed once per second from loop(); keeps per-minute bins for the last 24 h,
+// hourly totals for the current day, a rolling window and daily accumulators.
+// Daily accumulators are checkpointed to NVS, rate-limited to spare flash.
+#include <Arduino.h>
+#include <Preferences.h>
+#include <math.h>
+#include "clock.h"
+#include "tlog.h"
+
+#ifndef SUN_BINS
+  #define SUN_BINS          1440        // 24 h of 1-minute bins
+#endif
+#ifndef SUN_ROLL_MIN
+  #define SUN_ROLL_MIN      60          // rolling window length, minutes
+#endif
+#ifndef SUN_CKPT_PERIOD_MS
+  #define SUN_CKPT_PERIOD_MS  (15UL * 60UL * 1000UL)
+#endif
+#define SUN_UV_NONE  0xFFFF
+
+// One minute of exposure. dose uses the historical sun_dose unit:
+// sum over the minute of (sun_score * 100) per second.
+struct SunBin {
+  uint32_t minute;      // minute key (epoch/60, or uptime/60 before SNTP)
+  uint16_t light_q;     // mean sun_proxy * 1000
+  uint16_t uv_q;        // mean UV index * 100, SUN_UV_NONE if no UV sample
+  uint16_t dose;        // orientation-weighted dose
+  uint8_t  n;           // seconds accumulated
+  uint8_t  touch_s;     // seconds with sun_touch
+};
+
+struct SunDay {
+  uint32_t day_id;      // yyyymmdd, 0 = clock unknown
+  uint32_t dose;        // same unit as SunBin::dose
+  float    uv_sed;      // erythemal dose, SED (1 UVI*s = 0.025 J/m2, 1 SED = 100 J/m2)
+  uint16_t sun_min;     // minutes with >= 30 s of sun_touch
+  uint32_t hour_dose[24];
+};
+
+static SunBin  sun_bins[SUN_BINS];
+static int     sun_head = -1;           // index of the open bin
+static SunDay  sun_day = {};
+static uint32_t sun_roll = 0;           // dose over the last SUN_ROLL_MIN closed minutes
+static uint32_t sun_undated = 0;        // dose before the clock was set (no hour for it)
+
+// running sums for the open minute
+static uint32_t sun_acc_light = 0, sun_acc_dose = 0, sun_acc_uv = 0;
+static uint8_t  sun_acc_n = 0, sun_acc_uv_n = 0, sun_acc_touch = 0;
+
+static bool     sun_dirty = false;
+static uint32_t sun_last_ckpt_ms = 0;
+static bool     sun_restore_pending = true;
+static uint32_t sun_ckpt_writes = 0;
+
+static inline uint32_t sun_minute_key() {
+  uint32_t e = clock_epoch();
+  return e ? (e / 60) : (millis() / 60000UL);
+}
+
+static void sun_close_minute() {
+  if (sun_head < 0) return;
+  SunBin& b = sun_bins[sun_head];
+  b.n       = sun_acc_n;
+  b.light_q = sun_acc_n ? (uint16_t)(sun_acc_light / sun_acc_n) : 0;
+  b.uv_q    = sun_acc_uv_n ? (uint16_t)(sun_acc_uv / sun_acc_uv_n) : SUN_UV_NONE;
+  b.dose    = (uint16_t)sun_acc_dose;
+  b.touch_s = sun_acc_touch;
+
+  sun_roll += b.dose;
+  int old = sun_head - SUN_ROLL_MIN; if (old < 0) old += SUN_BINS;
+  if (sun_bins[old].minute + SUN_ROLL_MIN == b.minute) sun_roll -= sun_bins[old].dose;
+  if (sun_acc_touch >= 30) sun_day.sun_min++;
+
+  sun_acc_light = sun_acc_dose = sun_acc_uv = 0;
+  sun_acc_n = sun_acc_uv_n = sun_acc_touch = 0;
+}
+
+static void sun_open_minute(uint32_t key) {
+  sun_head = (sun_head + 1) % SUN_BINS;
+  SunBin& b = sun_bins[sun_head];
+  b = SunBin{};
+  b.minute = key;
+  b.uv_q = SUN_UV_NONE;
+}
+
+static void sun_day_reset(uint32_t day_id) {
+  sun_day = SunDay{};
+  sun_day.day_id = day_id;
+  sun_dirty = true;
+  sun_last_ckpt_ms = 0;                 // force a checkpoint for the new day
+}
+
+// sun_score in [0,1] already includes orientation (face) and cover;
+// uv_index may be NAN when no UV source is available.
+static void sun_dose_tick(float sun_proxy, float sun_score, float uv_index, bool touch) {
+  uint32_t key = sun_minute_key();
+
+  uint32_t day = clock_day_id();
+  if (day && sun_day.day_id && day != sun_day.day_id) sun_day_reset(day);
+  else if (day && !sun_day.day_id) sun_day.day_id = day;
+
+  if (sun_head < 0) {
+    sun_open_minute(key);
+  } else if (key != sun_bins[sun_head].minute) {
+    uint32_t cur = sun_bins[sun_head].minute;
+    sun_close_minute();
+    // fill short gaps with empty minutes so the rolling window stays exact;
+    // a large jump (clock set, long stall) just starts a new run
+    if (key > cur && key - cur <= SUN_ROLL_MIN) {
+      for (uint32_t m = cur + 1; m < key; ++m) { sun_open_minute(m); sun_close_minute(); }
+    } else if (key > cur + SUN_ROLL_MIN || key < cur) {
+      sun_roll = 0;
+    }
+    sun_open_minute(key);
+  }
+
+  uint32_t d = (uint32_t)(sun_score * 100.0f);
+  sun_acc_light += (uint32_t)(sun_proxy * 1000.0f);
+  sun_acc_dose  += d;
+  if (touch) sun_acc_touch++;
+  if (sun_acc_n < 255) sun_acc_n++;
+
+  sun_day.dose += d;
+  if (clock_epoch()) sun_day.hour_dose[clock_local_hour()] += d;
+  else sun_undated += d;
+  if (!isnan(uv_index) && uv_index >= 0.0f) {
+    sun_acc_uv += (uint32_t)(uv_index * 100.0f);
+    sun_acc_uv_n++;
+    float face_w = (sun_proxy > 0.0f) ? (sun_score / sun_proxy) : 0.0f;
+    if (face_w > 1.0f) face_w = 1.0f;
+    sun_day.uv_sed += uv_index * face_w * 0.025f / 100.0f;
+  }
+  if (d) sun_dirty = true;
+}
+
+static inline uint32_t sun_roll_dose() { return sun_roll + sun_acc_dose; }
+
+// Bin at ring index i, the open minute with its running sums; false for a
+// slot never written.
+static bool sun_bin_at(int i, SunBin& out) {
+  const SunBin& b = sun_bins[i];
+  if (!b.minute && !b.n) return false;
+  out = b;
+  if (i == sun_head) {
+    out.n = sun_acc_n;
+    out.light_q = sun_acc_n ? (uint16_t)(sun_acc_light / sun_acc_n) : 0;
+    out.uv_q = sun_acc_uv_n ? (uint16_t)(sun_acc_uv / sun_acc_uv_n) : SUN_UV_NONE;
+    out.dose = (uint16_t)sun_acc_dose;
+    out.touch_s = sun_acc_touch;
+  }
+  return true;
+}
+
+// Before SNTP a bin is keyed by uptime minutes, after by epoch minutes.
+static inline bool sun_bin_dated(const SunBin& b) { return b.minute >= 1700000000UL / 60; }
+
+// ---- NVS checkpoint ---------------------------------------------------------
+#define SUN_CKPT_MAGIC  0x53554E31u    // "SUN1"
+struct SunCkpt { uint32_t magic; SunDay day; };
+
+static void sun_checkpoint_save() {
+  Preferences p;
+  if (!p.begin("sun", false)) return;
+  SunCkpt c = { SUN_CKPT_MAGIC, sun_day };
+  p.putBytes("ckpt", &c, sizeof(c));
+  p.end();
+  sun_dirty = false;
+  sun_ckpt_writes++;
+}
+
+// Records are only trusted for the same calendar day, so restore waits for
+// SNTP; undated state (no clock yet) is never persisted.
+static void sun_checkpoint_restore() {
+  uint32_t today = clock_day_id();
+  if (!today) return;
+  sun_restore_pending = false;
+  Preferences p;
+  if (!p.begin("sun", true)) return;
+  SunCkpt c;
+  size_t n = p.getBytes("ckpt", &c, sizeof(c));
+  p.end();
+  if (n != sizeof(c) || c.magic != SUN_CKPT_MAGIC || c.day.day_id != today) return;
+
+  sun_day.dose   += c.day.dose;
+  sun_day.uv_sed += c.day.uv_sed;
+  sun_day.sun_min += c.day.sun_min;
+  for (int h = 0; h < 24; ++h) sun_day.hour_dose[h] += c.day.hour_dose[h];
+  sun_day.day_id = today;
+  tlog<TL_SUN_RESTORED>((unsigned long)today, (unsigned long)sun_day.dose);
+}
+
+static void sun_checkpoint_service(uint32_t now) {
+  if (sun_restore_pending) sun_checkpoint_restore();
+  if (sun_restore_pending || !sun_day.day_id) return;
+  if (!sun_dirty) return;
+  if (sun_last_ckpt_ms && (now - sun_last_ckpt_ms) < SUN_CKPT_PERIOD_MS) return;
+  sun_last_ckpt_ms = now ? now : 1;
+  sun_checkpoint_save();
+}
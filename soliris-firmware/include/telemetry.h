@@ -0,0 +1,88 @@
+#pragma once
+// Published telemetry: quantization helpers and the backend push frame.
+// Formatting goes straight into a caller buffer (no String temporaries);
+// portable so the host benches measure the same code.
+#include <stdint.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+
+static inline float qf(float x, float step){ if (isnan(x)) return NAN; return roundf(x/step)*step; }
+static inline int   qi(float x, float step){ if (isnan(x)) return -1; return (int)roundf(x/step)*step; }
+static inline int   bucket_ppg_drive(uint8_t drv){
+  if (drv <= 0x10) return 0;
+  if (drv <= 0x28) return 1;
+  if (drv <= 0x60) return 2;
+  return 3;
+}
+
+// Reportable fields of a frame, in output order (report_policy.h decides
+// which ones go out); gps.lat/gps.lon share the "gps" object.
+enum TelemetryField : uint8_t {
+  TF_HR, TF_SPO2, TF_SKIN, TF_ENV, TF_CO2, TF_VOC, TF_TOUCH, TF_SUN, TF_MOTION,
+  TF_LAT, TF_LON, TF_N
+};
+static const char* const TF_NAMES[TF_N] = {
+  "hr", "spo2", "temp_skin", "env_c", "co2", "voc", "sun_touch", "sun_proxy", "motion",
+  "gps.lat", "gps.lon"
+};
+
+// One push to the backend (POST /telemetry). Negative ints and NAN floats
+// are sent as null where the backend expects "no value".
+struct TelemetryFrame {
+  const char* user;
+  int    hr, spo2;
+  float  temp_skin, env_c;
+  int    co2, voc;             // -1: none
+  bool   sun_touch;
+  float  sun_proxy;
+  const char* sun;             // pre-rendered sun summary object, or nullptr
+  bool   motion;
+  double lat, lon;
+  uint32_t up_ms;              // capture time: frames are uploaded in batches
+  uint32_t epoch;              // s, 0 while the clock is not set
+  const char* win;             // pre-rendered push-window aggregates, or nullptr
+  uint16_t fields;             // bit per TelemetryField, 0: all
+};
+
+struct JsonOut {
+  char* p; char* end; bool ok = true;
+  JsonOut(char* buf, size_t cap) : p(buf), end(buf + cap) { if (cap) *p = 0; }
+  void put(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+  void raw(const char* s)        { put("%s", s); }
+  void num(float v, int d)       { if (isnan(v)) raw("null"); else put("%.*f", d, (double)v); }
+  void opt(int v)                { if (v < 0) raw("null"); else put("%d", v); }
+};
+
+inline void JsonOut::put(const char* fmt, ...) {
+  if (!ok) return;
+  va_list ap; va_start(ap, fmt);
+  int n = vsnprintf(p, end - p, fmt, ap);
+  va_end(ap);
+  if (n < 0 || n >= end - p) { ok = false; return; }
+  p += n;
+}
+
+// Returns the length written, 0 if cap was too small.
+static size_t telemetry_format(char* buf, size_t cap, const TelemetryFrame& t) {
+  JsonOut o(buf, cap);
+  auto has = [&](int f) { return !t.fields || (t.fields & (1u << f)); };
+  o.put("{\"userId\":\"%s\"", t.user);
+  if (has(TF_HR))     o.put(",\"hr\":%d", t.hr);
+  if (has(TF_SPO2))   o.put(",\"spo2\":%d", t.spo2);
+  if (has(TF_SKIN))   { o.raw(",\"temp_skin\":"); o.num(t.temp_skin, 2); }
+  if (has(TF_ENV))    { o.raw(",\"env_c\":");     o.num(t.env_c, 2); }
+  if (has(TF_CO2))    { o.raw(",\"co2\":");       o.opt(t.co2); }
+  if (has(TF_VOC))    { o.raw(",\"voc\":");       o.opt(t.voc); }
+  if (has(TF_TOUCH))  o.put(",\"sun_touch\":%d", t.sun_touch ? 1 : 0);
+  if (has(TF_SUN))    { o.raw(",\"sun_proxy\":"); o.num(t.sun_proxy, 2); }
+  if (t.sun) { o.raw(",\"sun\":"); o.raw(t.sun); }
+  if (has(TF_MOTION)) o.put(",\"motion\":%d", t.motion ? 1 : 0);
+  if (has(TF_LAT) || has(TF_LON)) o.put(",\"gps\":{\"lat\":%.6f,\"lon\":%.6f}", t.lat, t.lon);
+  if (t.win) { o.raw(",\"win\":"); o.raw(t.win); }
+  o.put(",\"up_ms\":%lu", (unsigned long)t.up_ms);
+  if (t.epoch) o.put(",\"ts\":%lu000", (unsigned long)t.epoch);
+  o.raw("}");
+  return o.ok ? (size_t)(o.p - buf) : 0;
+}
@@ -0,0 +1,231 @@
+#pragma once
+// Tokenized logging. A call site records a token id, a timestamp and its
+// raw arguments into a byte ring; nothing is formatted on the hot path:
+//
+//   tlog<TL_NET_POST>(url, code);
+//
+//   record : u8 len | u16 id | u32 t_us | args      (little endian)
+//   args   : integers and floats 4 bytes each, strings u8 n + n bytes
+//
+// The format string lives in the dictionary (tlog_defs.h) and is checked
+// against the argument types at compile time. Records are framed on
+// FRAME_CH_LOG by tlog_service() (serial_chan.h) and formatted on the host
+// (tools/tlog/tlog_cat, Backend/tlog.py) or, in text mode, by the drain in
+// loop(). When the ring is full a record is dropped and counted.
+//
+// Safe from any task (the ring is a short critical section); not from ISRs.
+// Portable: the host build prints each record at once (tlog_print).
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <type_traits>
+#include "tlog_defs.h"
+
+#ifdef ARDUINO
+  #include <Arduino.h>
+  static portMUX_TYPE tlog_mux = portMUX_INITIALIZER_UNLOCKED;
+  #define TLOG_LOCK()    portENTER_CRITICAL(&tlog_mux)
+  #define TLOG_UNLOCK()  portEXIT_CRITICAL(&tlog_mux)
+  #define TLOG_NOW_US()  micros()
+#else
+  #define TLOG_LOCK()
+  #define TLOG_UNLOCK()
+  #define TLOG_NOW_US()  0u
+#endif
+
+#ifndef TLOG_RING_BYTES
+  #define TLOG_RING_BYTES  4096
+#endif
+#define TLOG_HDR_LEN       7
+#define TLOG_REC_MAX     128
+#define TLOG_STR_MAX      32
+#define TLOG_LINE_MAX    192           // formatted
+
+enum TlogLevel : uint8_t { TLOG_ERROR, TLOG_WARN, TLOG_INFO, TLOG_DEBUG };
+
+struct TlogDef {
+  const char* name;
+  uint8_t     level;
+  const char* fmt;
+};
+
+#define TLOG_X_ID(n, l, f)   TL_##n,
+#define TLOG_X_DEF(n, l, f)  { #n, l, f },
+enum TlogId : uint16_t { TLOG_DEFS_LIST(TLOG_X_ID) TLOG_NDEFS };
+static constexpr TlogDef TLOG_DEFS[] = { TLOG_DEFS_LIST(TLOG_X_DEF) };
+
+// ---- compile-time format check ------------------------------------------------
+constexpr bool tlog_in(char c, const char* set) {
+  for (; *set; ++set) if (*set == c) return true;
+  return false;
+}
+
+// Kind of the k-th conversion in f: 'i', 'f', 's', 0 past the last one, '?' if
+// it is one tlog can't carry (%p, %n, '*' widths).
+constexpr char tlog_conv(const char* f, int k) {
+  for (; *f; ++f) {
+    if (*f != '%') continue;
+    ++f;
+    if (*f == '%') continue;
+    while (*f && tlog_in(*f, "-+ #0123456789.hlLzjtq")) ++f;
+    char c = *f;
+    char kind = tlog_in(c, "diuxXoc") ? 'i' : tlog_in(c, "fFeEgGaA") ? 'f' : c == 's' ? 's' : '?';
+    if (!k--) return kind;
+    if (!c) return '?';
+  }
+  return 0;
+}
+
+template <typename T>
+constexpr char tlog_kind() {
+  using D = typename std::decay<T>::type;
+  return std::is_floating_point<D>::value ? 'f'
+       : (std::is_integral<D>::value || std::is_enum<D>::value) ? 'i'
+       : (std::is_same<D, const char*>::value || std::is_same<D, char*>::value) ? 's' : '?';
+}
+
+template <typename... A>
+constexpr bool tlog_args_match(const char* f) {
+  const char kinds[] = { tlog_kind<A>()..., 0 };
+  for (size_t k = 0; k < sizeof...(A); ++k)
+    if (tlog_conv(f, (int)k) != kinds[k]) return false;
+  return tlog_conv(f, (int)sizeof...(A)) == 0;
+}
+
+// ---- encoding -----------------------------------------------------------------
+template <typename T>
+static inline void tlog_put_arg(uint8_t*& p, const uint8_t* end, T v) {
+  if (p + 4 > end) { p = (uint8_t*)end; return; }
+  if (std::is_floating_point<T>::value) { float f = (float)v; memcpy(p, &f, 4); }
+  else { uint32_t u = (uint32_t)v; memcpy(p, &u, 4); }   // ESP32 and x86 are both little endian
+  p += 4;
+}
+
+static inline void tlog_put_arg(uint8_t*& p, const uint8_t* end, const char* s) {
+  if (p >= end) return;
+  size_t n = s ? strnlen(s, TLOG_STR_MAX) : 0;
+  if (n > (size_t)(end - p - 1)) n = end - p - 1;
+  *p++ = (uint8_t)n;
+  memcpy(p, s, n);
+  p += n;
+}
+
+static inline void tlog_put_arg(uint8_t*& p, const uint8_t* end, char* s) { tlog_put_arg(p, end, (const char*)s); }
+
+template <uint16_t ID, typename... A>
+static inline size_t tlog_encode(uint8_t* rec, uint32_t t_us, A... a) {
+  static_assert(ID < TLOG_NDEFS, "unknown log token");
+  static_assert(tlog_args_match<A...>(TLOG_DEFS[ID].fmt), "log arguments don't match the token's format");
+  uint8_t* p = rec + TLOG_HDR_LEN;
+  const uint8_t* end = rec + TLOG_REC_MAX;
+  (void)end;                                           // no arguments
+  int unpack[] = { 0, (tlog_put_arg(p, end, a), 0)... };
+  (void)unpack;
+  rec[0] = (uint8_t)(p - rec);
+  rec[1] = (uint8_t)ID; rec[2] = (uint8_t)(ID >> 8);
+  memcpy(rec + 3, &t_us, 4);
+  return p - rec;
+}
+
+// ---- ring ---------------------------------------------------------------------
+struct TlogRing {
+  uint8_t           buf[TLOG_RING_BYTES];
+  volatile uint32_t r = 0, w = 0;                       // free-running indices
+  uint32_t          records = 0, dropped = 0;
+};
+static TlogRing tlog_main;                               // what tlog() records into
+static bool     tlog_on = true;
+
+static inline void tlog_commit(TlogRing& g, const uint8_t* rec, size_t n) {
+  TLOG_LOCK();
+  if (TLOG_RING_BYTES - (g.w - g.r) < n) {
+    g.dropped++;
+  } else {
+    uint32_t at = g.w % TLOG_RING_BYTES, first = TLOG_RING_BYTES - at;
+    if (first >= n) memcpy(g.buf + at, rec, n);
+    else { memcpy(g.buf + at, rec, first); memcpy(g.buf, rec + first, n - first); }
+    g.w += n;
+    g.records++;
+  }
+  TLOG_UNLOCK();
+}
+
+// Into another ring than the live one (the bench).
+template <uint16_t ID, typename... A>
+static inline void tlog_to(TlogRing& g, A... a) {
+  if (!tlog_on) return;
+  uint8_t rec[TLOG_REC_MAX];
+  tlog_commit(g, rec, tlog_encode<ID>(rec, TLOG_NOW_US(), a...));
+}
+
+template <uint16_t ID, typename... A>
+static inline void tlog(A... a) { tlog_to<ID>(tlog_main, a...); }
+
+// Moves whole records (at most cap bytes, max_recs records) out of the ring.
+// Returns bytes.
+static inline size_t tlog_take(uint8_t* out, size_t cap, uint32_t max_recs = UINT32_MAX, TlogRing& g = tlog_main) {
+  size_t o = 0;
+  TLOG_LOCK();
+  for (; g.r != g.w && max_recs; --max_recs) {
+    uint8_t n = g.buf[g.r % TLOG_RING_BYTES];
+    if (o + n > cap) break;
+    for (uint8_t i = 0; i < n; ++i) out[o + i] = g.buf[(g.r + i) % TLOG_RING_BYTES];
+    o += n;
+    g.r += n;
+  }
+  TLOG_UNLOCK();
+  return o;
+}
+
+static inline uint32_t tlog_pending(const TlogRing& g = tlog_main) { return g.w - g.r; }
+
+// ---- formatting (drain text mode, host decoders) ------------------------------
+// One record to text. Returns the text length, or -1 if the record is malformed.
+static inline int tlog_format(char* out, size_t cap, const uint8_t* rec, size_t n) {
+  if (!cap) return -1;
+  out[0] = 0;
+  if (n < TLOG_HDR_LEN || rec[0] != n) return -1;
+  uint16_t id = (uint16_t)(rec[1] | (rec[2] << 8));
+  if (id >= TLOG_NDEFS) return -1;
+  const uint8_t* p = rec + TLOG_HDR_LEN;
+  const uint8_t* end = rec + n;
+  size_t o = 0;
+  auto emit = [&](int w) { if (w > 0) o += (size_t)w < cap - o ? (size_t)w : cap - 1 - o; };
+  for (const char* f = TLOG_DEFS[id].fmt; *f && o + 1 < cap; ++f) {
+    if (*f != '%') { out[o++] = *f; continue; }
+    if (f[1] == '%') { out[o++] = '%'; ++f; continue; }
+    char spec[16];
+    size_t s = 0;
+    spec[s++] = *f++;
+    while (*f && tlog_in(*f, "-+ #0123456789.hlLzjtq")) {
+      if (!tlog_in(*f, "hlLzjtq") && s < sizeof(spec) - 2) spec[s++] = *f;
+      ++f;
+    }
+    if (!*f) break;
+    spec[s++] = *f; spec[s] = 0;
+    if (*f == 's') {
+      if (p >= end || *p > TLOG_STR_MAX || p + 1 + *p > end) return -1;
+      char str[TLOG_STR_MAX + 1];
+      memcpy(str, p + 1, *p); str[*p] = 0;
+      p += 1 + *p;
+      emit(snprintf(out + o, cap - o, spec, str));
+      continue;
+    }
+    if (p + 4 > end) return -1;
+    uint32_t u; memcpy(&u, p, 4); p += 4;
+    if (tlog_in(*f, "fFeEgGaA")) { float v; memcpy(&v, &u, 4); emit(snprintf(out + o, cap - o, spec, (double)v)); }
+    else if (*f == 'd' || *f == 'i') emit(snprintf(out + o, cap - o, spec, (int)(int32_t)u));
+    else emit(snprintf(out + o, cap - o, spec, (unsigned)u));
+  }
+  out[o] = 0;
+  return (int)o;
+}
+
+// Host build: format at once (no drain runs there).
+template <uint16_t ID, typename... A>
+static inline void tlog_print(A... a) {
+  uint8_t rec[TLOG_REC_MAX];
+  char line[TLOG_LINE_MAX];
+  if (tlog_format(line, sizeof(line), rec, tlog_encode<ID>(rec, TLOG_NOW_US(), a...)) >= 0) puts(line);
+}
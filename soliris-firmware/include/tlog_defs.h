@@ -0,0 +1,50 @@
+#pragma once
+// Log token dictionary (tlog.h). The id of a token is its position in the
+// list and is what goes on the wire, so tokens are only ever appended; the
+// host decoders (tools/tlog/tlog_cat, Backend/tlog.py) read this file.
+//
+//   X(name, level, format)     printf format, no trailing newline
+//
+// Conversions: d i u x X o c (32-bit integers), f e g (float), s (string,
+// truncated to TLOG_STR_MAX). Length modifiers are accepted and ignored.
+#define TLOG_DEFS_LIST(X) \
+  X(FALL_IMPACT,    TLOG_INFO, "[FALL] impact! amag=%.2f g=%.2f") \
+  X(FALL_STATE,     TLOG_DEBUG, "[FALL] hadImp=%d lying=%d inactive=%d | still_ms=%u fall=%d | a_hp=%.2f steps=%lu act=%d") \
+  X(NET_POST,       TLOG_INFO, "[NET] POST %s -> %d") \
+  X(NET_POST_ERR,   TLOG_WARN, "[NET] POST %s -> ERR %d") \
+  X(NET_WIFI_OK,    TLOG_INFO, "[NET] Wi-Fi OK in %lu ms, %d queued") \
+  X(NET_WIFI_FAIL,  TLOG_WARN, "[NET] Wi-Fi FAIL") \
+  X(NET_BLE_UP,     TLOG_INFO, "[NET] BLE central connecté") \
+  X(NET_BLE_DOWN,   TLOG_INFO, "[NET] BLE central déconnecté") \
+  X(MPU_INIT,       TLOG_INFO, "MPU6050 %s sur %s (essaie 0x68/0x69)") \
+  X(MPU_SAMPLE,     TLOG_DEBUG, "[MPU] ax=%.2f ay=%.2f az=%.2f | gx=%.2f gy=%.2f gz=%.2f") \
+  X(INIT_DONE,      TLOG_INFO, "[INIT] %s %s at %lu ms (%s)") \
+  X(HEALTH_CLEAR,   TLOG_WARN, "[HEALTH] bus %d clear %s") \
+  X(HEALTH_ISOLATE, TLOG_WARN, "[HEALTH] %s isolated (%u in a row, rate %u%%), probe in %lu ms") \
+  X(HEALTH_BACK,    TLOG_INFO, "[HEALTH] %s back (probe %lu)") \
+  X(ALERT_ACK,      TLOG_INFO, "[ALERT] %s #%lu acked via %s after %lu ms") \
+  X(DEV_OK,         TLOG_INFO, "%s OK") \
+  X(DEV_FAIL,       TLOG_WARN, "%s FAIL") \
+  X(SI_AUTO,        TLOG_INFO, "SI115X autonomous %s") \
+  X(SCD_PROBE,      TLOG_DEBUG, "SCD4x: probing...") \
+  X(SCD_SN_ERR,     TLOG_WARN, "SCD4x getSerialNumber error: %d") \
+  X(SCD_SN,         TLOG_INFO, "SCD4x SN: 0x%04X%08X") \
+  X(OW_FOUND,       TLOG_INFO, ">>> OneWire device on GPIO %d, ROM %s") \
+  X(OW_NONE,        TLOG_WARN, ">>> No OneWire device found on tested pins.") \
+  X(DS_COUNT,       TLOG_INFO, "DS18B20 count: %u") \
+  X(DS_ADDR,        TLOG_INFO, "DS18B20 addr: %s  parasite? %s") \
+  X(DS_FIRST,       TLOG_INFO, "DS18B20 first read: %.2f") \
+  X(SUN_RESTORED,   TLOG_INFO, "[SUN] restored day %lu dose=%lu") \
+  X(VOC_WARM,       TLOG_INFO, "[VOC] warm start from %s (age %ld s)") \
+  X(TS_BEGIN,       TLOG_INFO, "[TS] %s raw=%us m1=%u m15=%u spill=%lu") \
+  X(HIST_NOBUF,     TLOG_WARN, "[HIST] no buffer, bulk upload off") \
+  X(NET_CELL_FAIL,  TLOG_WARN, "[NET] %s") \
+  X(NET_CELL_OK,    TLOG_INFO, "[NET] Cellular OK") \
+  X(NET_BLE_READY,  TLOG_INFO, "[NET] BLE prêt (advertising).") \
+  X(PM_DFS,         TLOG_INFO, "[PM] DFS + auto light sleep") \
+  X(PM_IDLE,        TLOG_INFO, "[PM] idle waits only (core built without CONFIG_PM_ENABLE)") \
+  X(BOOT_DONE,      TLOG_INFO, "[BOOT] %lu ms, topology %s") \
+  X(BOOT_STAGE,     TLOG_INFO, "[BOOT]   %s=%u ms") \
+  X(BOOT_READY,     TLOG_INFO, "SAFE ready") \
+  X(SCD_VARIANT,    TLOG_INFO, "SCD4x variant %s, slow demand -> %s") \
+  X(PM_DFS_ONLY,    TLOG_INFO, "[PM] DFS only (core built without tickless idle)")
@@ -0,0 +1,31 @@
+#pragma once
+// Metrics of the 1 s sample row and their running aggregate; shared by the
+// time-series store and the push window. Portable.
+#include <stdint.h>
+#include <math.h>
+
+enum TsMetric : uint8_t {
+  TS_HR = 0, TS_SPO2, TS_SKIN, TS_ENV_C, TS_RH, TS_HPA, TS_CO2, TS_VOC,
+  TS_SUN, TS_STEPS, TS_MOTION, TS_NMETRIC
+};
+static const char* const TS_NAMES[TS_NMETRIC] = {
+  "hr", "spo2", "skin", "env_c", "rh", "hpa", "co2", "voc", "sun", "steps", "motion"
+};
+
+// State flags stored with each raw second.
+#define TS_F_ONWRIST  0x01
+#define TS_F_MOTION   0x02
+#define TS_F_TOUCH    0x04
+
+// Resolution kept when raw seconds leave the device (hist_batch.h); finer
+// than the live publish so trends survive, coarse enough to compress.
+static const float TS_QUANT[TS_NMETRIC] = {
+  1, 1, 0.05f, 0.05f, 0.5f, 0.1f, 10, 1, 0.01f, 1, 1
+};
+
+struct TsAgg {
+  float    mn, mx, sum;
+  uint16_t n;
+  void clear() { mn = INFINITY; mx = -INFINITY; sum = 0; n = 0; }
+  void add(float v) { if (v < mn) mn = v; if (v > mx) mx = v; sum += v; n++; }
+};
@@ -0,0 +1,235 @@
+#pragma once
+// On-device multi-resolution time-series store.
+//   raw   : 1 s samples, last TS_RAW_LEN seconds
+//   1 min : min/max/sum/count rollups, last TS_M1_LEN minutes
+//   15 min: same, last TS_M15_LEN quarters; closed quarters spill to flash
+// Each sample updates the raw slot and the two open rollup buckets directly,
+// so ingest is O(1) per metric whatever the history length. Buffers live in
+// PSRAM when present and shrink to a DRAM-sized history otherwise. Raw
+// seconds also keep the row's state flags (worn, moving, sun contact).
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <esp_heap_caps.h>
+#include <math.h>
+#include "clock.h"
+#include "ts_metric.h"
+#include "tlog.h"
+
+// one rollup bucket: start time + one aggregate per metric
+struct TsBucket { uint32_t t0; TsAgg a[TS_NMETRIC]; };
+
+struct TsRing {
+  TsBucket* b; uint16_t len, head; uint32_t span_s; bool any;
+};
+
+#define TS_SPILL_PATH  "/ts15.bin"
+#ifndef TS_SPILL_MAX
+  #define TS_SPILL_MAX  2880             // 30 days of 15-min buckets on flash
+#endif
+
+static float*   ts_raw = nullptr;        // [TS_RAW_LEN][TS_NMETRIC]
+static uint8_t* ts_raw_flags = nullptr;  // [TS_RAW_LEN] TS_F_*
+static uint16_t ts_raw_len = 0, ts_raw_head = 0;
+static uint32_t ts_raw_last = 0;
+static TsRing   ts_m1 = {}, ts_m15 = {};
+static bool     ts_ready = false, ts_fs = false;
+static uint32_t ts_spill_n = 0, ts_spill_next = 0;   // records on flash, next slot
+
+static inline uint32_t ts_now_s() {
+  uint32_t e = clock_epoch();
+  return e ? e : millis() / 1000;
+}
+
+static void* ts_alloc(size_t n) {
+  void* p = heap_caps_malloc(n, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  return p ? p : heap_caps_malloc(n, MALLOC_CAP_8BIT);
+}
+
+static bool ts_ring_init(TsRing& r, uint16_t len, uint32_t span) {
+  r.b = (TsBucket*)ts_alloc(sizeof(TsBucket) * len);
+  if (!r.b) return false;
+  r.len = len; r.head = 0; r.span_s = span; r.any = false;
+  for (uint16_t i = 0; i < len; ++i) { r.b[i].t0 = 0; for (auto& a : r.b[i].a) a.clear(); }
+  return true;
+}
+
+static void ts_spill(const TsBucket& b) {
+  if (!ts_fs) return;
+  File f = LittleFS.open(TS_SPILL_PATH, LittleFS.exists(TS_SPILL_PATH) ? "r+" : "w+");
+  if (!f) return;
+  f.seek((size_t)ts_spill_next * sizeof(TsBucket));
+  f.write((const uint8_t*)&b, sizeof(TsBucket));
+  f.close();
+  ts_spill_next = (ts_spill_next + 1) % TS_SPILL_MAX;
+  if (ts_spill_n < TS_SPILL_MAX) ts_spill_n++;
+}
+
+// Returns the open bucket for time t, advancing (and clearing) as needed.
+static TsBucket& ts_ring_at(TsRing& r, uint32_t t, bool spill) {
+  uint32_t t0 = t - (t % r.span_s);
+  TsBucket* cur = &r.b[r.head];
+  if (!r.any) { cur->t0 = t0; r.any = true; return *cur; }
+  if (cur->t0 == t0) return *cur;
+  if (spill) ts_spill(*cur);
+  r.head = (r.head + 1) % r.len;
+  cur = &r.b[r.head];
+  cur->t0 = t0;
+  for (auto& a : cur->a) a.clear();
+  return *cur;
+}
+
+static void ts_begin() {
+  bool ps = psramFound();
+  ts_raw_len = ps ? 3600 : 300;
+  ts_raw = (float*)ts_alloc(sizeof(float) * ts_raw_len * TS_NMETRIC);
+  ts_raw_flags = (uint8_t*)ts_alloc(ts_raw_len);
+  ts_ready = ts_raw && ts_raw_flags
+          && ts_ring_init(ts_m1,  ps ? 1440 : 120, 60)
+          && ts_ring_init(ts_m15, ps ? 672  : 96,  900);
+  if (ts_raw) for (uint32_t i = 0; i < (uint32_t)ts_raw_len * TS_NMETRIC; ++i) ts_raw[i] = NAN;
+  if (ts_raw_flags) memset(ts_raw_flags, 0, ts_raw_len);
+
+  ts_fs = LittleFS.begin(true);
+  if (ts_fs && LittleFS.exists(TS_SPILL_PATH)) {
+    File f = LittleFS.open(TS_SPILL_PATH, "r");
+    size_t n = f ? f.size() / sizeof(TsBucket) : 0;
+    // find the append point: the slot after the newest record
+    uint32_t best_t = 0;
+    for (size_t i = 0; i < n; ++i) {
+      uint32_t t; f.seek(i * sizeof(TsBucket)); f.read((uint8_t*)&t, 4);
+      if (t >= best_t) { best_t = t; ts_spill_next = (i + 1) % TS_SPILL_MAX; }
+    }
+    ts_spill_n = n;
+    if (f) f.close();
+  }
+  tlog<TL_TS_BEGIN>(ts_ready ? "ready" : "FAIL", ts_raw_len, ts_m1.len, ts_m15.len, (unsigned long)ts_spill_n);
+}
+
+// One row per second; NAN marks a missing metric.
+static void ts_add(const float v[TS_NMETRIC], uint8_t flags = 0) {
+  if (!ts_ready) return;
+  uint32_t t = ts_now_s();
+  if (ts_raw_last && t > ts_raw_last && t - ts_raw_last < ts_raw_len) {
+    while (++ts_raw_last < t) {                  // mark skipped seconds
+      ts_raw_head = (ts_raw_head + 1) % ts_raw_len;
+      for (int m = 0; m < TS_NMETRIC; ++m) ts_raw[ts_raw_head * TS_NMETRIC + m] = NAN;
+      ts_raw_flags[ts_raw_head] = 0;
+    }
+    ts_raw_head = (ts_raw_head + 1) % ts_raw_len;
+  } else if (t != ts_raw_last) {                 // first sample or clock jump
+    ts_raw_head = 0;
+    for (uint32_t i = 0; i < (uint32_t)ts_raw_len * TS_NMETRIC; ++i) ts_raw[i] = NAN;
+    memset(ts_raw_flags, 0, ts_raw_len);
+  }
+  ts_raw_last = t;
+  ts_raw_flags[ts_raw_head] = flags;
+
+  TsBucket& b1  = ts_ring_at(ts_m1,  t, false);
+  TsBucket& b15 = ts_ring_at(ts_m15, t, true);
+  for (int m = 0; m < TS_NMETRIC; ++m) {
+    ts_raw[ts_raw_head * TS_NMETRIC + m] = v[m];
+    if (isnan(v[m])) continue;
+    b1.a[m].add(v[m]);
+    b15.a[m].add(v[m]);
+  }
+}
+
+// Oldest second still in the raw ring (0 before the first sample).
+static inline uint32_t ts_raw_first() {
+  if (!ts_raw_last) return 0;
+  return (ts_raw_last >= ts_raw_len) ? ts_raw_last - ts_raw_len + 1 : 1;
+}
+
+// Raw row for second t (first <= t <= last); NAN metrics where nothing was sampled.
+static inline const float* ts_raw_at(uint32_t t, uint8_t* flags) {
+  uint16_t i = (uint16_t)((ts_raw_head + ts_raw_len - (ts_raw_last - t)) % ts_raw_len);
+  if (flags) *flags = ts_raw_flags[i];
+  return &ts_raw[i * TS_NMETRIC];
+}
+
+static int ts_metric_by_name(const char* s) {
+  for (int m = 0; m < TS_NMETRIC; ++m) if (!strcmp(s, TS_NAMES[m])) return m;
+  return -1;
+}
+
+// Before SNTP buckets are keyed by uptime seconds. Once the clock is set,
+// this boot's RAM buckets are rebased onto the epoch; uptime keys on flash
+// may come from an earlier boot and are left out.
+#define TS_DATED_MIN  1000000000UL
+
+static inline uint32_t ts_dated(uint32_t t0) {
+  if (t0 >= TS_DATED_MIN || !clock_epoch()) return t0;
+  return t0 + (clock_epoch() - millis() / 1000);
+}
+
+// Resumable range query: ts_query_step() reads at most TS_SCAN_PER_STEP
+// flash records, so a scan of the spill file never holds loop() for long.
+// row(t, mn, mx, mean, n) is called oldest first (q.out is the number of
+// rows before this one); raw rows have mn == mx == mean and n == 1.
+#ifndef TS_SCAN_PER_STEP
+  #define TS_SCAN_PER_STEP  64
+#endif
+
+struct TsQuery {
+  int      m, max_rows, out;
+  uint32_t res, from, to;
+  uint32_t k;                            // next flash record
+  uint8_t  stage;                        // 0 flash, 1 RAM, 2 done
+};
+
+static void ts_query_begin(TsQuery& q, int m, uint32_t res, uint32_t from, uint32_t to, int max_rows) {
+  q.m = m; q.res = res; q.from = from; q.to = to; q.max_rows = max_rows;
+  q.out = 0; q.k = 0;
+  q.stage = (!ts_ready || m < 0 || m >= TS_NMETRIC) ? 2 : (res >= 900 && ts_fs && ts_spill_n) ? 0 : 1;
+}
+
+// True once the query is complete.
+template <typename F>
+static bool ts_query_step(TsQuery& q, F row) {
+  const int m = q.m;
+  if (q.stage == 2) return true;
+  if (q.res <= 1) {
+    uint32_t last = ts_raw_last;
+    uint32_t first = (last >= ts_raw_len) ? last - ts_raw_len + 1 : 0;
+    for (uint32_t t = max(q.from, first); t <= q.to && t <= last && q.out < q.max_rows; ++t) {
+      uint16_t i = (uint16_t)((ts_raw_head + ts_raw_len - (last - t)) % ts_raw_len);
+      float v = ts_raw[i * TS_NMETRIC + m];
+      if (isnan(v)) continue;
+      row(t, v, v, v, 1); q.out++;
+    }
+    q.stage = 2;
+    return true;
+  }
+  TsRing& r = (q.res >= 900) ? ts_m15 : ts_m1;
+  uint32_t ram_first = 0;                // flash holds what is older than the RAM ring
+  for (uint16_t k = 1; k <= r.len && !ram_first; ++k) {
+    uint32_t t0 = r.b[(r.head + k) % r.len].t0;
+    if (t0 >= TS_DATED_MIN) ram_first = t0;
+  }
+  if (!ram_first) ram_first = UINT32_MAX;
+  if (q.stage == 0) {
+    if (q.from >= ram_first) { q.stage = 1; return false; }
+    File f = LittleFS.open(TS_SPILL_PATH, "r");
+    bool opened = (bool)f;
+    uint32_t start = (ts_spill_n < TS_SPILL_MAX) ? 0 : ts_spill_next;
+    for (uint32_t n = 0; f && n < TS_SCAN_PER_STEP && q.k < ts_spill_n && q.out < q.max_rows; ++n, ++q.k) {
+      TsBucket b;
+      f.seek(((start + q.k) % TS_SPILL_MAX) * sizeof(TsBucket));
+      if (f.read((uint8_t*)&b, sizeof(b)) != sizeof(b)) { q.k = ts_spill_n; break; }
+      if (b.t0 < TS_DATED_MIN || b.t0 < q.from || b.t0 > q.to || b.t0 >= ram_first || !b.a[m].n) continue;
+      row(b.t0, b.a[m].mn, b.a[m].mx, b.a[m].sum / b.a[m].n, b.a[m].n); q.out++;
+    }
+    if (f) f.close();
+    if (!opened || q.k >= ts_spill_n || q.out >= q.max_rows) q.stage = 1;
+    return false;
+  }
+  for (uint16_t k = 1; k <= r.len && q.out < q.max_rows; ++k) {
+    const TsBucket& b = r.b[(r.head + k) % r.len];
+    if (!b.t0 || !b.a[m].n) continue;
+    uint32_t t = ts_dated(b.t0);
+    if (t < q.from || t > q.to) continue;
+    row(t, b.a[m].mn, b.a[m].mx, b.a[m].sum / b.a[m].n, b.a[m].n); q.out++;
+  }
+  q.stage = 2;
+  return true;
+}
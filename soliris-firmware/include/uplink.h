@@ -0,0 +1,158 @@
+#pragma once
+// Upload scheduler. Telemetry frames are queued instead of being POSTed one
+// by one over a link that stays associated: Wi-Fi is off between flushes,
+// comes up (max modem sleep) to send the backlog as JSON arrays, and goes
+// off again. The flush interval adapts to the battery level and the backlog
+// fill; a priority frame flushes at once. The first connection stays up
+// until SNTP has set the clock. Batches go LZ-compressed (lzss.h) once the
+// backend has advertised the encoding. Cost is reported as radio-on ms per
+// uploaded kB.
+#include <Arduino.h>
+#include "net.h"
+#include "battery.h"
+#include "clock.h"
+
+#define UPL_BASE_MS       120000UL   // healthy battery, light backlog
+#define UPL_MIN_MS         30000UL
+#define UPL_MAX_MS        600000UL
+#define UPL_CONNECT_MS     12000UL   // association timeout
+#define UPL_RETRY_MS       60000UL   // after a failed flush, doubles up to UPL_MAX_MS
+#define UPL_CLOCK_MS        5000UL   // wait for SNTP while the clock is unset
+#define UPL_BATCH_FRAMES      16
+#define UPL_BATCH_BYTES     6144
+#define UPL_FILL_FLUSH   (OFFLINE_MAX * 3 / 4)
+
+enum UplState : uint8_t { UPL_OFF, UPL_CONNECTING, UPL_SENDING };
+static const char* const UPL_STATE_NAMES[] = { "off", "connecting", "sending" };
+
+static uint8_t  upl_state = UPL_OFF;
+static bool     upl_urgent = false;
+static uint32_t upl_t0_ms = 0, upl_conn_ms = 0, upl_last_ms = 0;
+static uint32_t upl_retry_ms = 0;                 // 0: last flush went through
+static uint32_t upl_flushes = 0, upl_frames = 0, upl_fails = 0, upl_sessions = 0;
+// Priority lane (alert_lane.h): runs before any batch while the link is up;
+// true when it used the pass.
+static bool   (*upl_prio)() = nullptr;
+// History bulk (hist_batch.h): runs next; 1 used the pass, 0 nothing to
+// send, -1 failed.
+static int    (*upl_bulk)() = nullptr;
+static uint64_t upl_bytes = 0, upl_raw_bytes = 0, upl_radio_ms = 0;   // on the wire, before LZ
+static LzEnc    upl_lz;
+
+static uint32_t uplink_interval_ms() {
+  if (upl_retry_ms) return upl_retry_ms;
+  uint32_t iv = UPL_BASE_MS;
+  int b = battery_pct();                          // -1: unknown, treat as healthy
+  if (b >= 0 && b < 50) iv *= 2;
+  if (b >= 0 && b < BATT_LOW_PCT) iv *= 2;
+  if (offlineQ.size() >= OFFLINE_MAX / 2) iv /= 2;
+  return constrain(iv, UPL_MIN_MS, UPL_MAX_MS);
+}
+
+static bool uplink_due(uint32_t now) {
+  if (!upl_flushes && !upl_fails && !clock_epoch()) return true;   // boot: get the time
+  if (upl_urgent) return true;
+  if (offlineQ.empty()) return false;
+  if (offlineQ.size() >= UPL_FILL_FLUSH) return true;
+  return now - upl_last_ms >= uplink_interval_ms();
+}
+
+// Oldest frames as one JSON array; they leave the queue only once acked.
+static bool uplink_post_batch() {
+  String body; body.reserve(UPL_BATCH_BYTES + 256);
+  body = "[";
+  int n = 0;
+  while (n < offlineQ.size() && n < UPL_BATCH_FRAMES) {
+    const String& f = offlineQ.at(n);
+    if (n && body.length() + f.length() + 2 > UPL_BATCH_BYTES) break;
+    if (n) body += ',';
+    body += f; n++;
+  }
+  body += ']';
+  size_t wire = body.length();
+  bool ok = false, tried = false;
+  if (net_lz_ok) {
+    static uint8_t lz[UPL_BATCH_BYTES + 512];
+    size_t k = 0;
+    lz_init(upl_lz);
+    auto sink = [&](const uint8_t* p, size_t m) {
+      if (k + m <= sizeof(lz)) memcpy(lz + k, p, m);
+      k += m;
+    };
+    lz_write(upl_lz, (const uint8_t*)body.c_str(), body.length(), sink);
+    lz_flush(upl_lz, sink);
+    if (k <= sizeof(lz) && k < body.length()) {
+      tried = true; wire = k;
+      ok = http_post_wifi_body(lz, k, ENDPOINT_PATH, "application/json", LZ_ENCODING);
+    }
+  }
+  if (!ok && (!tried || !net_lz_ok)) { wire = body.length(); ok = http_post_wifi(body); }   // 415: plain again
+  if (!ok) return false;
+  offlineQ.drop(n);
+  upl_frames += n; upl_bytes += wire; upl_raw_bytes += body.length();
+  return true;
+}
+
+static void uplink_end(bool ok) {
+  uint32_t now = millis();           // posts may have taken a while
+  wifi_radio_off();
+  pm_release(PM_LOCK_RADIO);
+  upl_radio_ms += now - upl_t0_ms;
+  upl_last_ms = now; upl_state = UPL_OFF;
+  if (ok) { upl_flushes++; upl_retry_ms = 0; return; }
+  upl_fails++;
+  upl_retry_ms = upl_retry_ms ? min(upl_retry_ms * 2, (uint32_t)UPL_MAX_MS) : UPL_RETRY_MS;
+}
+
+// Every loop pass; never blocks longer than one batch POST.
+static void uplink_service(uint32_t now) {
+  MemScope ms(MEM_NET);
+  switch (upl_state) {
+    case UPL_OFF:
+      if (!uplink_due(now)) return;
+      upl_urgent = false;
+      pm_acquire(PM_LOCK_RADIO);
+      wifi_radio_on();
+      upl_t0_ms = now; upl_state = UPL_CONNECTING; upl_sessions++;
+      return;
+    case UPL_CONNECTING:
+      if (WiFi.status() == WL_CONNECTED) {
+        wifiReady = true; upl_conn_ms = now; upl_state = UPL_SENDING;
+        clock_begin();
+        tlog<TL_NET_WIFI_OK>(now - upl_t0_ms, (int)offlineQ.size());
+      } else if (now - upl_t0_ms >= UPL_CONNECT_MS) {
+        tlog<TL_NET_WIFI_FAIL>();
+        uplink_end(false);
+      }
+      return;
+    case UPL_SENDING:
+      if (upl_prio && upl_prio()) return;
+      if (upl_bulk) {
+        int r = upl_bulk();
+        if (r < 0) uplink_end(false);
+        if (r) return;
+      }
+      if (!offlineQ.empty()) {                    // one batch per pass
+        if (!uplink_post_batch()) uplink_end(false);
+        return;
+      }
+      if (!clock_epoch() && now - upl_conn_ms < UPL_CLOCK_MS) return;
+      uplink_end(true);
+      return;
+  }
+}
+
+// Bring the link up now (ignores the interval and the failure backoff).
+static inline void uplink_kick() { upl_urgent = true; }
+
+// Queues a frame for the next flush; `urgent` flushes now.
+static void uplink_enqueue(const String& json, bool urgent = false) {
+  MemScope ms(MEM_NET);
+  offline_enqueue(json);
+  if (urgent) uplink_kick();
+}
+
+// Radio-on time per uploaded kB since boot.
+static inline uint32_t uplink_ms_per_kb() {
+  return upl_bytes ? (uint32_t)(upl_radio_ms * 1024 / upl_bytes) : 0;
+}
@@ -0,0 +1,201 @@
+#pragma once
+// SGP40 + Sensirion VOC gas index: non-blocking sampling and warm start.
+//
+// Sampling: the measure_raw command is issued from voc_service() once per
+// second and the result is read SGP_MEAS_MS later, so loop() never sits in
+// the 30 ms conversion like Adafruit_SGP40::measureRaw() does.
+//
+// Warm start: the algorithm state (get_states/set_states) is kept in RTC RAM,
+// which survives resets, panics and OTA reboots, and checkpointed to NVS for
+// power cycles. Sensirion only allows a restore after <= 10 min off and from
+// an algorithm that had run >= 3 h, which is what the checks below enforce.
+#include <Arduino.h>
+#include <Wire.h>
+#include <Preferences.h>
+#include <VOCGasIndexAlgorithm.h>
+#include <esp_attr.h>
+#include <esp_system.h>
+#include <sys/time.h>
+#include "clock.h"
+#include "tlog.h"
+
+#ifndef SGP40_ADDR
+  #define SGP40_ADDR          0x59
+#endif
+#define SGP_MEAS_MS           30
+#define SGP_PERIOD_MS         1000       // VOC algorithm sampling interval
+
+#ifndef VOC_STATE_MAX_AGE_S
+  #define VOC_STATE_MAX_AGE_S   600      // Sensirion: max interruption
+#endif
+#ifndef VOC_STATE_MIN_RUN_S
+  #define VOC_STATE_MIN_RUN_S   10800    // Sensirion: min learning time
+#endif
+#ifndef VOC_NVS_PERIOD_MS
+  #define VOC_NVS_PERIOD_MS     (5UL * 60UL * 1000UL)
+#endif
+#define VOC_RTC_PERIOD_MS     10000
+#define VOC_STATE_MAGIC       0x564F4331u   // "VOC1"
+
+extern VOCGasIndexAlgorithm voc_algo;
+
+struct VocState {
+  uint32_t magic;
+  float    s0, s1;
+  int64_t  saved_s;       // time(nullptr) at save
+  uint32_t run_s;         // algorithm run time when saved
+  uint32_t crc;
+};
+
+RTC_NOINIT_ATTR static VocState voc_rtc;
+
+enum VocStart { VOC_COLD = 0, VOC_WARM_RTC = 1, VOC_WARM_NVS = 2 };
+static uint8_t  voc_start = VOC_COLD;
+static uint32_t voc_run_s = 0;             // seconds of samples fed to voc_algo
+static uint32_t voc_next_rtc_ms = 0, voc_next_nvs_ms = 0;
+static bool     voc_nvs_pending = true;    // NVS restore waits for SNTP
+
+static uint32_t voc_crc(const VocState& v) {
+  const uint8_t* p = (const uint8_t*)&v;
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < offsetof(VocState, crc); ++i) { h ^= p[i]; h *= 16777619u; }
+  return h;
+}
+
+static int64_t voc_now_s() { struct timeval tv; gettimeofday(&tv, nullptr); return tv.tv_sec; }
+
+static bool voc_state_valid(const VocState& v, int64_t now_s) {
+  if (v.magic != VOC_STATE_MAGIC || v.crc != voc_crc(v)) return false;
+  if (v.run_s < VOC_STATE_MIN_RUN_S) return false;
+  int64_t age = now_s - v.saved_s;
+  return age >= 0 && age <= VOC_STATE_MAX_AGE_S;
+}
+
+static void voc_state_fill(VocState& v) {
+  v.magic = VOC_STATE_MAGIC;
+  voc_algo.get_states(v.s0, v.s1);
+  v.saved_s = voc_now_s();
+  v.run_s = voc_run_s;
+  v.crc = voc_crc(v);
+}
+
+static void voc_apply(const VocState& v, uint8_t src) {
+  voc_algo.set_states(v.s0, v.s1);
+  voc_run_s = v.run_s;
+  voc_start = src;
+  tlog<TL_VOC_WARM>(src == VOC_WARM_RTC ? "RTC" : "NVS", (long)(voc_now_s() - v.saved_s));
+}
+
+static void voc_save_nvs() {
+  if (voc_run_s < VOC_STATE_MIN_RUN_S || !clock_epoch()) return;  // undated records are useless
+  VocState v; voc_state_fill(v);
+  Preferences p;
+  if (!p.begin("voc", false)) return;
+  p.putBytes("st", &v, sizeof(v));
+  p.end();
+}
+
+static void voc_shutdown_handler() {
+  if (voc_run_s < VOC_STATE_MIN_RUN_S) return;
+  voc_state_fill(voc_rtc);
+  voc_save_nvs();
+}
+
+// Boot: RTC slot first (system time keeps running across soft resets).
+static void voc_state_begin() {
+  if (esp_reset_reason() != ESP_RST_POWERON && voc_state_valid(voc_rtc, voc_now_s())) {
+    voc_apply(voc_rtc, VOC_WARM_RTC);
+    voc_nvs_pending = false;
+  }
+  esp_register_shutdown_handler(voc_shutdown_handler);
+}
+
+static void voc_state_service(uint32_t now) {
+  // power-cycle path: only once SNTP lets us date the NVS record
+  if (voc_nvs_pending && clock_epoch()) {
+    voc_nvs_pending = false;
+    if (voc_start == VOC_COLD && voc_run_s < 60) {
+      Preferences p; VocState v;
+      if (p.begin("voc", true)) {
+        size_t n = p.getBytes("st", &v, sizeof(v));
+        p.end();
+        if (n == sizeof(v) && voc_state_valid(v, voc_now_s())) voc_apply(v, VOC_WARM_NVS);
+      }
+    }
+  }
+  if (voc_run_s < VOC_STATE_MIN_RUN_S) return;
+  if ((int32_t)(now - voc_next_rtc_ms) >= 0) {
+    voc_next_rtc_ms = now + VOC_RTC_PERIOD_MS;
+    voc_state_fill(voc_rtc);
+  }
+  if ((int32_t)(now - voc_next_nvs_ms) >= 0) {
+    voc_next_nvs_ms = now + VOC_NVS_PERIOD_MS;
+    voc_save_nvs();
+  }
+}
+
+// ---- non-blocking SGP40 ------------------------------------------------------
+static uint8_t sgp_crc8(const uint8_t* d, int n) {
+  uint8_t c = 0xFF;
+  for (int i = 0; i < n; ++i) {
+    c ^= d[i];
+    for (int b = 0; b < 8; ++b) c = (c & 0x80) ? (uint8_t)((c << 1) ^ 0x31) : (uint8_t)(c << 1);
+  }
+  return c;
+}
+
+static bool     sgp_busy = false;
+static uint32_t sgp_ready_ms = 0, sgp_next_ms = 0;
+static int32_t  voc_sraw_last = -1;
+static float    voc_index_last = NAN;
+static float    sgp_comp_t = 25.0f, sgp_comp_rh = 50.0f;
+static uint32_t sgp_errors = 0, sgp_i2c_xfers = 0;
+
+static inline void voc_set_compensation(float tC, float rh) {
+  if (!isnan(tC)) sgp_comp_t = tC;
+  if (!isnan(rh)) sgp_comp_rh = rh;
+}
+
+static bool sgp_start() {
+  uint16_t rh = (uint16_t)(constrain(sgp_comp_rh, 0.0f, 100.0f) * 65535.0f / 100.0f);
+  uint16_t t  = (uint16_t)((constrain(sgp_comp_t, -45.0f, 130.0f) + 45.0f) * 65535.0f / 175.0f);
+  uint8_t b[8] = { 0x26, 0x0F, (uint8_t)(rh >> 8), (uint8_t)rh, 0, (uint8_t)(t >> 8), (uint8_t)t, 0 };
+  b[4] = sgp_crc8(b + 2, 2);
+  b[7] = sgp_crc8(b + 5, 2);
+  sgp_i2c_xfers++;
+  Wire.beginTransmission(SGP40_ADDR);
+  Wire.write(b, sizeof(b));
+  return Wire.endTransmission() == 0;
+}
+
+static bool sgp_fetch(uint16_t& sraw) {
+  uint8_t b[3];
+  sgp_i2c_xfers++;
+  if (Wire.requestFrom((uint8_t)SGP40_ADDR, (uint8_t)3) != 3) return false;
+  for (int i = 0; i < 3; ++i) b[i] = Wire.read();
+  if (sgp_crc8(b, 2) != b[2]) return false;
+  sraw = ((uint16_t)b[0] << 8) | b[1];
+  return true;
+}
+
+static void voc_service(uint32_t now) {
+  if (sgp_busy) {
+    if ((int32_t)(now - sgp_ready_ms) < 0) return;
+    sgp_busy = false;
+    uint16_t sraw;
+    if (!sgp_fetch(sraw)) { sgp_errors++; return; }
+    voc_sraw_last = sraw;
+    int32_t idx = voc_algo.process((int32_t)sraw);
+    voc_run_s++;
+    if (idx < 0)   idx = 0;
+    if (idx > 500) idx = 500;
+    // the index is 0 during the algorithm's blackout unless warm-started
+    voc_index_last = (idx == 0 && voc_start == VOC_COLD) ? NAN : (float)idx;
+    voc_state_service(now);
+    return;
+  }
+  if ((int32_t)(now - sgp_next_ms) < 0) return;
+  sgp_next_ms = now + SGP_PERIOD_MS;
+  if (sgp_start()) { sgp_busy = true; sgp_ready_ms = now + SGP_MEAS_MS; }
+  else sgp_errors++;
+}
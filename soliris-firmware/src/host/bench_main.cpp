@@ -0,0 +1,39 @@
+// Host build of the firmware micro-benchmarks (include/bench_cases.h).
+//
+//   pio run -e bench && .pio/build/bench/program [filter]
+//
+// Prints one JSON line per case plus the accuracy / allocation checks; diff
+// two runs (or the device's "bench" output) to spot regressions. Exits 1 when
+// a check fails.
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+#include "bench_cases.h"
+
+// Heap accounting for the allocation checks: operator new directly, malloc
+// through the linker wrap in [env:bench].
+static uint32_t host_allocs = 0;
+
+extern "C" void* __real_malloc(size_t n);
+extern "C" void* __wrap_malloc(size_t n) { host_allocs++; return __real_malloc(n); }
+
+void* operator new(size_t n) {
+  host_allocs++;
+  if (void* p = __real_malloc(n ? n : 1)) return p;
+  throw std::bad_alloc();
+}
+void* operator new[](size_t n) { return operator new(n); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+int main(int argc, char** argv) {
+  const char* filter = argc > 1 ? argv[1] : "";
+  pipe_log = false;
+  bench_alloc_count = [] { return host_allocs; };
+  int n = bench_run(BENCH_CASES, BENCH_NCASES, filter, [](const char* line) { puts(line); });
+  static bool failed = false;
+  bench_checks(filter, [](const char* line) { puts(line); if (strstr(line, "\"pass\":0")) failed = true; });
+  return n && !failed ? 0 : 1;
+}
@@ -0,0 +1,208 @@
+// Faster-than-real-time replay of recorded sessions through pipeline.h.
+//
+//   pio run -e replay
+//   .pio/build/replay/program [options] session.scap [more.scap ...]
+//     --repeat N            run each session N times (throughput measurement)
+//     --trace out.csv       1 s trace of the pipeline outputs (first run)
+//     --expect key=val[:tol] fail (exit 1) when a summary value is off, e.g.
+//                           --expect steps=412:5 --expect falls=1
+//     -v                    keep the pipelines' debug log
+//
+// Sessions come from tools/capture (PPG 100 Hz, IMU 50 Hz, env 1 Hz). The
+// clock is the recorded sample timestamp, so every timing rule (refractory,
+// lying confirm, on-wrist arming...) sees the same time base as on device.
+// One JSON summary line per session goes to stdout.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "scap.h"
+#include "pipeline.h"
+
+enum EvKind : uint8_t { EV_PPG, EV_IMU, EV_ENV };
+
+struct Ev {
+  uint64_t t_us;
+  uint8_t  kind;
+  float    v[6];          // PPG: ir, red (exact up to 2^24, the MAX3010x is 18-bit)
+};
+
+static bool load_session(const char* path, std::vector<Ev>& evs) {
+  FILE* f = fopen(path, "rb");
+  if (!f || !scap_check_header(f)) { fprintf(stderr, "%s: not a .scap file\n", path); if (f) fclose(f); return false; }
+  FrameHdr h; uint8_t p[FRAME_MAX_BODY]; size_t n;
+  uint64_t wraps = 0; uint32_t last = 0; bool any = false;
+  while (scap_read(f, h, p, n)) {
+    if (h.chan != FRAME_CH_CAPTURE) continue;
+    // micros() wraps every ~71 min; frames are close enough to in-order to unwrap
+    if (any && h.t_us < last && last - h.t_us > 0x80000000u) wraps++;
+    last = h.t_us; any = true;
+    uint64_t t0 = (wraps << 32) | h.t_us;
+
+    if ((h.type == CAP_PPG || h.type == CAP_IMU) && n >= 4) {
+      uint32_t per = frame_get16(p) * 10u;
+      uint16_t cnt = frame_get16(p + 2);
+      size_t stride = h.type == CAP_PPG ? 8 : 24;
+      if (4 + cnt * stride > n) continue;
+      for (uint16_t i = 0; i < cnt; ++i) {
+        const uint8_t* s = p + 4 + i * stride;
+        Ev e = {}; e.t_us = t0 + (uint64_t)i * per;
+        if (h.type == CAP_PPG) {
+          e.kind = EV_PPG; e.v[0] = (float)frame_get32(s); e.v[1] = (float)frame_get32(s + 4);
+        } else {
+          e.kind = EV_IMU; memcpy(e.v, s, 6 * sizeof(float));
+        }
+        evs.push_back(e);
+      }
+    } else if (h.type == CAP_ENV && n >= 16) {
+      Ev e = {}; e.t_us = t0; e.kind = EV_ENV; memcpy(e.v, p, 4 * sizeof(float));
+      evs.push_back(e);
+    }
+  }
+  fclose(f);
+  std::stable_sort(evs.begin(), evs.end(), [](const Ev& a, const Ev& b) { return a.t_us < b.t_us; });
+  return true;
+}
+
+struct Summary {
+  double   dur_s = 0;
+  uint64_t samples = 0;
+  uint32_t steps = 0, falls = 0, uncon = 0;
+  double   hr_sum = 0; int hr_n = 0, hr_min = 0, hr_max = 0;
+  double   spo2_sum = 0; int spo2_n = 0;
+  uint32_t posture_s[4] = {0}, activity_s[3] = {0}, onwrist_s = 0;
+};
+
+static const char* POSTURE_NAMES[4]  = { "unknown", "standing", "sitting", "lying" };
+static const char* ACTIVITY_NAMES[3] = { "still", "walk", "run" };
+
+static void run_once(const std::vector<Ev>& evs, Summary& s, FILE* trace) {
+  pipeline_reset();
+  s = Summary();
+  if (evs.empty()) return;
+  uint64_t t_first = evs.front().t_us;
+  uint32_t next_tick = 0;
+  bool prev_fall = false, prev_uncon = false;
+  if (trace) fprintf(trace, "t_s,hr,spo2,steps,posture,activity,fall,unconscious,on_wrist,env_c,rh\n");
+
+  for (const Ev& e : evs) {
+    uint32_t now = (uint32_t)(e.t_us / 1000);
+    switch (e.kind) {
+      case EV_PPG:
+        ppg_process((long)e.v[0], (long)e.v[1], now);
+        break;
+      case EV_IMU: {
+        float a2 = e.v[0]*e.v[0] + e.v[1]*e.v[1] + e.v[2]*e.v[2];
+        imu_process(e.v[0], e.v[1], e.v[2], e.v[3], e.v[4], e.v[5], a2, now);
+        break;
+      }
+      case EV_ENV:
+        if (!isnan(e.v[0])) ambient_process(e.v[0], e.v[1], e.v[2]);
+        onwrist_update_robuste(e.v[3], env_c_out, ppg_contact, dc_ir, motion_g, now);
+        break;
+    }
+    s.samples++;
+    if (fall_event && !prev_fall) s.falls++;
+    if (unconscious && !prev_uncon) s.uncon++;
+    prev_fall = fall_event; prev_uncon = unconscious;
+
+    // once per second of session time: the values the device would publish
+    uint32_t rel_ms = (uint32_t)((e.t_us - t_first) / 1000);
+    if (rel_ms < next_tick) continue;
+    next_tick = rel_ms - rel_ms % 1000 + 1000;
+    if (ppg_contact && ppg_bpm_avg > 0) {
+      s.hr_sum += ppg_bpm_avg; s.hr_n++;
+      if (!s.hr_min || ppg_bpm_avg < s.hr_min) s.hr_min = ppg_bpm_avg;
+      if (ppg_bpm_avg > s.hr_max) s.hr_max = ppg_bpm_avg;
+    }
+    if (!isnan(spo2_value)) { s.spo2_sum += spo2_value; s.spo2_n++; }
+    s.posture_s[posture_state]++;
+    s.activity_s[activity_state]++;
+    if (onWrist) s.onwrist_s++;
+    if (trace)
+      fprintf(trace, "%u,%d,%.1f,%lu,%s,%s,%d,%d,%d,%.2f,%.1f\n", rel_ms / 1000,
+              ppg_contact ? ppg_bpm_avg : 0, spo2_value, (unsigned long)step_count,
+              POSTURE_NAMES[posture_state], ACTIVITY_NAMES[activity_state],
+              (int)fall_event, (int)unconscious, (int)onWrist, env_c_out, rh_out_corr);
+  }
+  s.steps = step_count;
+  s.dur_s = (evs.back().t_us - t_first) / 1e6;
+}
+
+static double summary_value(const Summary& s, const std::string& k, bool& ok) {
+  ok = true;
+  if (k == "steps")     return s.steps;
+  if (k == "falls")     return s.falls;
+  if (k == "uncon")     return s.uncon;
+  if (k == "hr_mean")   return s.hr_n ? s.hr_sum / s.hr_n : 0;
+  if (k == "spo2_mean") return s.spo2_n ? s.spo2_sum / s.spo2_n : 0;
+  if (k == "onwrist_s") return s.onwrist_s;
+  for (int i = 0; i < 4; ++i) if (k == std::string(POSTURE_NAMES[i]) + "_s") return s.posture_s[i];
+  for (int i = 0; i < 3; ++i) if (k == std::string(ACTIVITY_NAMES[i]) + "_s") return s.activity_s[i];
+  ok = false;
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  int repeat = 1;
+  const char* trace_path = nullptr;
+  std::vector<std::string> expects, sessions;
+  pipe_log = false;
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--repeat") && i + 1 < argc)      repeat = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--trace") && i + 1 < argc)  trace_path = argv[++i];
+    else if (!strcmp(argv[i], "--expect") && i + 1 < argc) expects.push_back(argv[++i]);
+    else if (!strcmp(argv[i], "-v"))                      pipe_log = true;
+    else sessions.push_back(argv[i]);
+  }
+  if (sessions.empty() || repeat < 1) {
+    fprintf(stderr, "usage: %s [--repeat N] [--trace out.csv] [--expect key=val[:tol]] [-v] session.scap...\n", argv[0]);
+    return 2;
+  }
+
+  int failures = 0;
+  for (const std::string& path : sessions) {
+    std::vector<Ev> evs;
+    if (!load_session(path.c_str(), evs)) { failures++; continue; }
+
+    Summary s;
+    FILE* trace = trace_path ? fopen(trace_path, "w") : nullptr;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeat; ++r) run_once(evs, s, r == 0 ? trace : nullptr);
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    if (trace) fclose(trace);
+
+    double sps = wall > 0 ? (double)s.samples * repeat / wall : 0;
+    double xrt = wall > 0 ? s.dur_s * repeat / wall : 0;
+    bool ok;
+    printf("{\"session\":\"%s\",\"dur_s\":%.1f,\"samples\":%llu,\"steps\":%u,\"falls\":%u,\"uncon\":%u,"
+           "\"hr\":{\"mean\":%.1f,\"min\":%d,\"max\":%d,\"n\":%d},\"spo2_mean\":%.1f,\"onwrist_s\":%u,",
+           path.c_str(), s.dur_s, (unsigned long long)s.samples, s.steps, s.falls, s.uncon,
+           summary_value(s, "hr_mean", ok), s.hr_min, s.hr_max, s.hr_n,
+           summary_value(s, "spo2_mean", ok), s.onwrist_s);
+    printf("\"posture_s\":{");
+    for (int i = 0; i < 4; ++i) printf("%s\"%s\":%u", i ? "," : "", POSTURE_NAMES[i], s.posture_s[i]);
+    printf("},\"activity_s\":{");
+    for (int i = 0; i < 3; ++i) printf("%s\"%s\":%u", i ? "," : "", ACTIVITY_NAMES[i], s.activity_s[i]);
+    printf("},\"perf\":{\"runs\":%d,\"wall_s\":%.3f,\"samples_per_s\":%.0f,\"x_realtime\":%.0f}}\n",
+           repeat, wall, sps, xrt);
+
+    for (const std::string& ex : expects) {
+      size_t eq = ex.find('=');
+      if (eq == std::string::npos) { fprintf(stderr, "bad --expect %s\n", ex.c_str()); failures++; continue; }
+      std::string key = ex.substr(0, eq), rest = ex.substr(eq + 1);
+      size_t colon = rest.find(':');
+      double want = atof(rest.substr(0, colon).c_str());
+      double tol  = colon == std::string::npos ? 0 : atof(rest.substr(colon + 1).c_str());
+      double got  = summary_value(s, key, ok);
+      if (!ok || got < want - tol || got > want + tol) {
+        fprintf(stderr, "%s: %s = %.2f, expected %.2f +/- %.2f\n", path.c_str(), key.c_str(), got, want, tol);
+        failures++;
+      }
+    }
+  }
+  return failures ? 1 : 0;
+}
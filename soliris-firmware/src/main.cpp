@@ -1,9 +1,13 @@
 #include "net.h"
+#include "uplink.h"
+#include "alert_lane.h"
+#include "hist_batch.h"
 #include <Arduino.h>
 #include <ArduinoJson.h>
 #include <Wire.h>
 #include <math.h>
 #include <limits.h>
+#include <atomic>
 #include <OneWire.h>
 #include <Adafruit_NeoPixel.h>
 #include <DallasTemperature.h>
@@ -18,6 +22,25 @@ bool ds_parasite = false;
 #include "heartRate.h"
 #include <Adafruit_MPU6050.h>
 #include "Si115X.h"
+#include "si115x_auto.h"
+#include "orient.h"
+#include "pipeline.h"
+#include "sun_dose.h"
+#include "tsdb.h"
+#include "sensor_state.h"
+#include "capture.h"
+#include "serial_chan.h"
+#include "telemetry.h"
+#include "push_window.h"
+#include "report_policy.h"
+#include "ctrl.h"
+#include "ctrl_queue.h"
+#include "power.h"
+#include "bench_cases.h"
+#include "memstat.h"
+#include "boot.h"
+#include "init_seq.h"
+#include "sensor_health.h"
 Si115X si115(0x53);
 bool si_ok = false;
 
@@ -34,78 +57,33 @@ bool     si_outdoor = false;
 float    sun_proxy  = 0.0f;                 
 uint32_t sun_dose   = 0;                   
 
-bool  onWrist = false;
-float onwrist_score = 0.0f;   
-float onwrist_dSA   = NAN;    
-float onwrist_dTdt  = 0.0f;   
-
-const float   G = 9.81f;
-
-#define EASY_TEST 1
-#if EASY_TEST
-  const float    IMPACT_G           = 1.8f;     
-  const float    NO_MOTION_DYN      = 1.0f;    
-  const float    NO_MOTION_GYRO     = 2.0f;    
-  const uint16_t IMPACT_LOCK_MS     = 800;     
-  const uint16_t INACT_AFTER_MS     = 3000;    
-  const uint16_t LYING_CONFIRM_MS   = 1000;    
-#else
-  const float    IMPACT_G           = 2.8f;
-  const float    NO_MOTION_DYN      = 0.25f;
-  const float    NO_MOTION_GYRO     = 0.50f;
-  const uint16_t IMPACT_LOCK_MS     = 1200;
-  const uint16_t INACT_AFTER_MS     = 10000;
-  const uint16_t LYING_CONFIRM_MS   = 4000;
-#endif
-
-const int   HR_BRADY       = 40;  
-const int   HR_TACHY       = 180;
-const int   SPO2_LOW       = 88;  
-const uint16_t UNCON_MIN_MS = 20000; 
-
 bool  sun_touch = false;  
 float sun_score = 0.0f;    
 const int SUN_AXIS_SIGN = -1; 
 
 
 
-float T_FIXED_OFFSET = -4.94f;
-float RH_GAIN        = 1.00f;
-float RH_OFFSET      = 10.0f;
-
-
-const float K_UP   = 0.002f;
-const float K_DOWN = 0.60f;
-const float ALPHA_SMOOTH = 0.30f;
-
-
-float T_floor = NAN;
-float T_air_est_prev = NAN;
-
-
-float env_c_out = NAN, rh_out_corr = NAN, hpa_out = NAN;
-
-
-static float es_hPa(float T_C) {
-  return 6.112f * expf((17.62f * T_C) / (243.12f + T_C));
-}
-static float rh_retarget(float RH_raw, float Traw_C, float Tcorr_C) {
-  float e = (RH_raw / 100.0f) * es_hPa(Traw_C);
-  float RHcorr = 100.0f * (e / es_hPa(Tcorr_C));
-  if (RHcorr < 0) RHcorr = 0; if (RHcorr > 100) RHcorr = 100;
-  return RHcorr;
-}
 
 #include <Adafruit_Sensor.h>
 
-Adafruit_MPU6050 mpu;
+// begin() resets the part and settles for ~300 ms in delay()s. With quick
+// set it only attaches and checks the chip id; the health re-probe does
+// the reset and the settling as timed phases on the loop task.
+class Mpu6050 : public Adafruit_MPU6050 {
+ public:
+  bool quick = false;
+ protected:
+  bool _init(int32_t id) override { return quick || Adafruit_MPU6050::_init(id); }
+};
+Mpu6050 mpu;
 bool mpu_ok = false;
 #include <VOCGasIndexAlgorithm.h>  
 
 VOCGasIndexAlgorithm voc_algo;
-static inline int32_t voc_index_from_sraw(int32_t s){ return voc_algo.process(s); }
+#include "voc.h"
 
 #include <SensirionI2cScd4x.h>
+#include "scd4x_drv.h"
 
 #ifdef NO_ERROR
 #undef NO_ERROR
@@ -119,8 +97,11 @@ static char errorMessage[64];
 static int16_t error;
 
 
-static unsigned long last_push_ms = 0;
 static const unsigned long PUSH_PERIOD_MS = 30000;   
+static PushWindow push_win;
+static RpLane     rp_lanes[RP_NLANES];
+static unsigned long last_stats_ms = 0;
+static const unsigned long STATS_PERIOD_MS = 60000;
 static const char* USER_ID = "veronique";
 
 
@@ -163,17 +144,9 @@ const double DEMO_LON = -3.7038;
 #define PRINT_COORDS 0              
 
 
-static inline float qf(float x, float step){ if (isnan(x)) return NAN; return roundf(x/step)*step; }
-static inline int   qi(float x, float step){ if (isnan(x)) return -1; return (int)roundf(x/step)*step; }
-static inline int   bucket_ppg_drive(uint8_t drv){
-  if (drv <= 0x10) return 0;          
-  if (drv <= 0x28) return 1;          
-  if (drv <= 0x60) return 2;          
-  return 3;                           
-}
 
 
-void ppg_init();
+static int32_t ppg_init_step(uint8_t phase);
 void ppg_service();
 float read_env_c();
 float read_env_rh();
@@ -182,27 +155,22 @@ float read_skin_c();
 float read_skin_c_raw();
 float read_voc_index(int* srawOut, float tempC=NAN, float rh=NAN);
 float read_co2_ppm(float* out_rh);
-bool read_mpu(float& ax, float& ay, float& az, float& gx, float& gy, float& gz, float& amag);
+bool read_mpu(float& ax, float& ay, float& az, float& gx, float& gy, float& gz, float& a2);
 void si115_service();
-void onwrist_update_robuste(float skinC, float airC, bool ppg_contact, float dc_ir, int motion);
+void si115_update_proxy();
 void ambient_update(float skinC);
 
-void PrintUint64(uint64_t& value) {
-    Serial.print("0x");
-    Serial.print((uint32_t)(value >> 32), HEX);
-    Serial.print((uint32_t)(value & 0xFFFFFFFF), HEX);
-}
 
 
 static uint32_t ppg_next_ms = 0;
 const uint8_t  PPG_PERIOD_MS = 10;   
+// The part samples at 100 sps and averages PPG_AVG of them per FIFO entry;
+// capture mode turns averaging off for the raw 100 Hz stream.
+const uint8_t  PPG_AVG = 8;
+static uint8_t  ppg_avg = PPG_AVG;
+static uint32_t ppg_last_us = 0, ppg_fifo_ms = 0;
 
 
-static float    ppg_env = 0.0f;      
-static float    ppg_prev_ac = 0.0f;  
-const  float    PPG_ENV_ALPHA = 0.10f;   
-const  float    PPG_THR_RATIO = 0.55f;   
-const  uint16_t PPG_REFRACT_MS = 280;   
 
 #define SDA1_PIN 7
 #define SCL1_PIN 6
@@ -220,8 +188,6 @@ Adafruit_SGP40*    sgp = nullptr;
 bool ds_ok=false, bme_ok=false, sgp_ok=false;
 
 
-enum Activity { ACT_STILL=0, ACT_WALK=1, ACT_RUN=2 };
-enum Posture  { POST_UNKNOWN=0, POST_STANDING=1, POST_SITTING=2, POST_LYING=3 };
 
 
 
@@ -229,8 +195,8 @@ enum Posture  { POST_UNKNOWN=0, POST_STANDING=1, POST_SITTING=2, POST_LYING=3 };
 #define BUZZ_PIN   2         
 
 
-volatile bool ALERTS_LED_ENABLED  = true;
-volatile bool ALERTS_BUZZ_ENABLED = true;
+std::atomic<bool> ALERTS_LED_ENABLED{true};    // also set from control commands
+std::atomic<bool> ALERTS_BUZZ_ENABLED{true};
 
 
 Adafruit_NeoPixel led(1, RGB_PIN, NEO_GRB + NEO_KHZ800);
@@ -312,34 +278,297 @@ void alerts_update(){
 
 
 
-void apply_control_json(const String& s){
-  JsonDocument d;                      
-  DeserializationError err = deserializeJson(d, s);
-  if (err) return;
+// Reply to a control query on every channel a request may have come from.
+static void ctrl_reply(const String& s) {
+  tel.println(s);
+  ble_notify_text(s);
+}
+
+static String sun_summary_json() {
+  String s = String("{\"day\":") + String(sun_day.dose)
+           + ",\"roll\":"  + String(sun_roll_dose())
+           + ",\"min\":"   + String(sun_day.sun_min)
+           + ",\"sed\":"   + f2json(sun_day.uv_sed, 3)
+           + ",\"date\":"  + String(sun_day.day_id)
+           + ",\"undated\":" + String(sun_undated)
+           + ",\"hours\":[";
+  for (int h = 0; h < 24; ++h) { if (h) s += ","; s += String(sun_day.hour_dose[h]); }
+  s += "]}";
+  return s;
+}
+
+// {"get":"sun","n":60}
+//   -> {"sun":{...},"sun_bins":[[minute,light_q,uv_q|null,dose,touch_s],...],"clock":1,"more":1}
+//      {"sun_bins":[...],"clock":1,"more":0}
+// n is capped at SUN_REPLY_MAX and the bins go out SUN_PAGE_BINS per loop
+// pass (sun_reply_service), so a long reply never holds the loop on BLE.
+// With "clock":1 bins from before SNTP (keyed by uptime) are left out; with
+// "clock":0 every minute is uptime and "up_min" is the current one.
+#define SUN_REPLY_MAX  240
+#define SUN_PAGE_BINS    8
+static int  sun_rep_idx = 0, sun_rep_left = 0;
+static bool sun_rep_head = false;       // the summary page is still due
+
+static void sun_reply_bins(int n) {
+  if (n <= 0) n = SUN_ROLL_MIN;
+  if (n > SUN_REPLY_MAX) n = SUN_REPLY_MAX;
+  sun_rep_idx  = ((sun_head - (n - 1)) % SUN_BINS + SUN_BINS) % SUN_BINS;
+  sun_rep_left = sun_head < 0 ? 0 : n;
+  sun_rep_head = true;
+}
+
+static void sun_reply_service() {
+  if (!sun_rep_head && sun_rep_left <= 0) return;
+  bool dated = clock_epoch() != 0;
+  String s = "{";
+  if (sun_rep_head) s += "\"sun\":" + sun_summary_json() + ",";
+  s += "\"sun_bins\":[";
+  bool first = true;
+  for (int k = 0; k < SUN_PAGE_BINS && sun_rep_left > 0; ++k) {
+    SunBin b;
+    bool open = sun_rep_idx == sun_head;
+    if (sun_bin_at(sun_rep_idx, b) && (!dated || sun_bin_dated(b))) {
+      if (!first) s += ",";
+      first = false;
+      s += "[" + String(b.minute) + "," + String(b.light_q) + ","
+         + (b.uv_q == SUN_UV_NONE ? String("null") : String(b.uv_q)) + ","
+         + String(b.dose) + "," + String(b.touch_s) + "]";
+    }
+    sun_rep_idx  = (sun_rep_idx + 1) % SUN_BINS;
+    sun_rep_left = open ? 0 : sun_rep_left - 1;
+  }
+  s += "],\"clock\":" + String(dated ? 1 : 0);
+  if (!dated) s += ",\"up_min\":" + String(millis() / 60000UL);
+  s += ",\"more\":" + String(sun_rep_left > 0 ? 1 : 0) + "}";
+  sun_rep_head = false;
+  ctrl_reply(s);
+}
+
+// Reporting rules per lane:
+//   {"policy":{"wifi":{"gap_ms":10000,"hr":[abs,rel,roc,silence_s],...},"ble":{...}}}
+static void policy_reply() {
+  static char buf[1024];
+  JsonOut o(buf, sizeof(buf));
+  o.raw("{\"policy\":{");
+  for (int i = 0; i < RP_NLANES; ++i) {
+    const RpLane& l = rp_lanes[i];
+    o.put("%s\"%s\":{\"gap_ms\":%lu", i ? "," : "", RP_LANE_NAMES[i], (unsigned long)l.min_gap_ms);
+    for (int f = 0; f < TF_N; ++f)
+      o.put(",\"%s\":[%g,%g,%g,%u]", TF_NAMES[f], (double)l.rule[f].abs, (double)l.rule[f].rel,
+            (double)l.rule[f].roc, (unsigned)l.rule[f].silence_s);
+    o.raw("}");
+  }
+  o.raw("}}");
+  if (o.ok) ctrl_reply(String(buf));
+}
+
+// Subsystem counters, one JSON line: {"stats":{...}}.
+static void stats_emit() {
+  uint32_t now = millis();
+  JsonDocument d;
+  JsonObject st = d["stats"].to<JsonObject>();
+  st["up_s"] = now / 1000;
+
+  JsonObject c = st["scd"].to<JsonObject>();
+  c["ok"] = scd_ok; c["mode"] = scd_mode_name(); c["i2c"] = scd_i2c_xfers;
+  c["reads"] = scd_reads; c["not_ready"] = scd_not_ready; c["err"] = scd_errors;
+  c["ua_avg"] = scd_ok ? scd_avg_ua(now) : 0; c["demand_ms"] = scd_demand_ms;
+
+  JsonObject l = st["si"].to<JsonObject>();
+  l["ok"] = si_ok; l["auto"] = si_auto; l["i2c"] = si_i2c_xfers;
+  l["reads"] = si_reads; l["irq_reads"] = si_irq_reads; l["drops"] = si_block_drops; l["err"] = si_errors;
+
+  JsonObject v = st["voc"].to<JsonObject>();
+  v["ok"] = sgp_ok; v["start"] = voc_start; v["run_s"] = voc_run_s; v["err"] = sgp_errors;
+
+  JsonObject hl = st["health"].to<JsonObject>();
+  for (int i = 0; i < hl_ndevs; ++i) {
+    const HealthDev& h = hl_devs[i];
+    JsonObject o = hl[h.name].to<JsonObject>();
+    o["st"] = HL_STATE_NAMES[h.state]; o["ops"] = h.ops; o["err"] = h.errs; o["rate_pct"] = h.rate * 100 / 256;
+    o["iso"] = h.isolations; o["probes"] = h.probes; o["rec"] = h.recoveries; o["backoff_s"] = h.backoff_ms / 1000;
+  }
+  for (int b = 0; b < 2; ++b) {
+    JsonArray a = hl[b ? "wire1" : "wire"].to<JsonArray>();   // [clears, sda_stuck, scl_stuck, fails]
+    a.add(hl_bus[b].clears); a.add(hl_bus[b].sda_stuck); a.add(hl_bus[b].scl_stuck); a.add(hl_bus[b].fails);
+  }
+
+  JsonObject u = st["sun"].to<JsonObject>();
+  u["ckpt_writes"] = sun_ckpt_writes;
+
+  JsonObject k = st["cap"].to<JsonObject>();
+  k["on"] = cap_on; k["frames"] = cap_frames; k["dropped"] = cap_dropped; k["bytes"] = cap_bytes;
+
+  JsonObject lg = st["log"].to<JsonObject>();
+  lg["mode"] = serial_chan_mode_name(); lg["records"] = tlog_main.records; lg["dropped"] = tlog_main.dropped;
+  lg["frames"] = tlog_frames; lg["frame_drops"] = tlog_frame_drops;
+  lg["tel_frames"] = tel_frames; lg["tel_dropped"] = tel_dropped;
+
+  JsonObject pw = st["pm"].to<JsonObject>();
+  pw["dfs"] = pm_dfs; pw["light_sleep"] = pm_sleep;
+  uint64_t res_tot = 0;
+  for (int i = 0; i < PM_NSTATES; ++i) res_tot += pm_res_us[i];
+  JsonObject pr = pw["res_pct"].to<JsonObject>();
+  for (int i = 0; i < PM_NSTATES; ++i) pr[PM_STATE_NAMES[i]] = res_tot ? (float)(pm_res_us[i] * 1000 / res_tot) / 10.0f : 0.0f;
+  JsonObject pl = pw["locks"].to<JsonObject>();
+  for (int i = 0; i < PM_NLOCKS; ++i) {
+    JsonArray a = pl[PM_LOCK_NAMES[i]].to<JsonArray>();   // [held_ms, takes]
+    a.add((uint32_t)(pm_locks[i].held_us / 1000)); a.add(pm_locks[i].takes);
+  }
+
+  JsonObject bt = st["boot"].to<JsonObject>();
+  bt["ms"] = boot_total_ms; bt["first_sample_ms"] = boot_first_sample_ms; bt["topo_cached"] = topo_cached;
+
+  JsonObject up = st["uplink"].to<JsonObject>();
+  up["state"] = UPL_STATE_NAMES[upl_state]; up["backlog"] = offlineQ.size(); up["drops"] = offlineQ.drops;
+  up["interval_s"] = uplink_interval_ms() / 1000; up["flushes"] = upl_flushes; up["fails"] = upl_fails;
+  up["frames"] = upl_frames; up["bytes"] = upl_bytes; up["radio_on_ms"] = upl_radio_ms;
+  up["ms_per_kb"] = uplink_ms_per_kb(); up["raw_bytes"] = upl_raw_bytes; up["lz"] = net_lz_ok;
+  up["ble_lz"] = (bool)ble_lz_on; up["ble_lz_in"] = ble_lz_in; up["ble_lz_out"] = ble_lz_out;
+
+  JsonObject hb = st["hist"].to<JsonObject>();
+  hb["sent_s"] = hb_sent_s; hb["batches"] = hb_batches; hb["rows"] = hb_rows_up; hb["bytes"] = hb_bytes;
+  hb["fails"] = hb_fails; hb["frames_dropped"] = hb_dropped;
+
+  JsonObject rpo = st["report"].to<JsonObject>();
+  for (int i = 0; i < RP_NLANES; ++i) {
+    JsonArray a = rpo[RP_LANE_NAMES[i]].to<JsonArray>();   // [frames, fields, bytes]
+    a.add(rp_lanes[i].frames); a.add(rp_lanes[i].fields); a.add(rp_lanes[i].bytes);
+  }
+
+  JsonObject al = st["alert"].to<JsonObject>();
+  al["raised"] = alert_raised; al["acked"] = alert_acks; al["pending"] = alert_pending();
+  al["overwrites"] = alert_overwrites; al["lat_last_ms"] = alert_lat_last_ms; al["lat_max_ms"] = alert_lat_max_ms;
+
+  JsonObject q = st["ctrl"].to<JsonObject>();
+  q["rx"] = ctrl_q_rx; q["drops"] = ctrl_q_drops; q["overflows"] = ctrl_rx_serial.overflows;
+  q["lat_avg_us"] = ctrl_lat_avg_us; q["lat_max_us"] = ctrl_lat_max_us;
+
+  mem_sample();
+  JsonObject m = st["mem"].to<JsonObject>();
+  m["heap"] = mem_s.heap; m["heap_min"] = mem_s.heap_min; m["largest"] = mem_s.largest;
+  m["largest_min"] = mem_s.largest_min; m["frag_pct"] = mem_frag_pct();
+  m["psram"] = mem_s.psram_size; m["psram_free"] = mem_s.psram_free; m["psram_largest"] = mem_s.psram_largest;
+  m["wrap"] = MEMSTAT_WRAP; m["frees"] = mem_frees;
+  JsonObject mt = m["alloc"].to<JsonObject>();
+  for (int i = 0; i < MEM_NTAGS; ++i) {
+    JsonArray a = mt[MEM_TAG_NAMES[i]].to<JsonArray>();   // [allocs, reallocs, bytes]
+    a.add(mem_tags[i].allocs); a.add(mem_tags[i].reallocs); a.add(mem_tags[i].bytes);
+  }
+  JsonObject ms = m["stack_hwm"].to<JsonObject>();
+  mem_for_each_stack([&](const char* name, uint32_t hwm){ ms[name] = hwm; });
+
+  String out; serializeJson(d, out);
+  ctrl_reply(out);
+}
+
+// {"get":"hist","m":"hr","res":60,"from":t0,"to":t1,"max":240}
+// -> {"hist":{"m":"hr","res":60,"rows":[[t,min,max,mean,n],...],"more":0,"clock":1}}
+// res 1 returns raw [t,v] rows; res >= 900 reaches back into the flash spill.
+// The query runs from loop() (hist_reply_service), a bounded slice of the
+// spill file per pass. "clock":0: t is device uptime and "up_s" is now.
+// One query at a time: another one meanwhile gets {"hist":{"m":..,"busy":1}}.
+static TsQuery hist_q;
+static bool    hist_busy = false;
+static String  hist_s;
+
+static void hist_reply(const char* metric, uint32_t res, uint32_t from, uint32_t to, int max_rows) {
+  if (hist_busy) { ctrl_reply(String("{\"hist\":{\"m\":\"") + metric + "\",\"busy\":1}}"); return; }
+  int m = ts_metric_by_name(metric);
+  if (max_rows <= 0 || max_rows > 240) max_rows = 240;
+  if (!to) to = ts_now_s();
+  ts_query_begin(hist_q, m, res, from, to, max_rows);
+  hist_s = String("{\"hist\":{\"m\":\"") + metric + "\",\"res\":" + String(res) + ",\"rows\":[";
+  hist_busy = true;
+}
 
-  if (d["led"].is<bool>())  ALERTS_LED_ENABLED  = d["led"].as<bool>();
-  if (d["buzz"].is<bool>()) ALERTS_BUZZ_ENABLED = d["buzz"].as<bool>();
+static void hist_reply_service() {
+  if (!hist_busy) return;
+  String& s = hist_s;
+  bool raw = hist_q.res <= 1;
+  bool done = ts_query_step(hist_q, [&](uint32_t t, float mn, float mx, float mean, uint16_t cnt){
+    if (hist_q.out) s += ",";
+    if (raw) s += "[" + String(t) + "," + String(mean, 2) + "]";
+    else s += "[" + String(t) + "," + String(mn, 2) + "," + String(mx, 2) + "," + String(mean, 2) + "," + String(cnt) + "]";
+  });
+  if (!done) return;
+  hist_busy = false;
+  bool dated = clock_epoch() != 0;
+  s += "],\"more\":" + String(hist_q.out >= hist_q.max_rows ? 1 : 0) + ",\"clock\":" + String(dated ? 1 : 0);
+  if (!dated) s += ",\"up_s\":" + String(millis() / 1000);
+  s += "}}";
+  ctrl_reply(s);
+  s = String();
+}
 
-  if (d["play"].is<const char*>()){
-    const char* k = d["play"];
+void ctrl_apply(const CtrlCmd& c){
+  if (c.led  >= 0) ALERTS_LED_ENABLED  = c.led;
+  if (c.buzz >= 0) ALERTS_BUZZ_ENABLED = c.buzz;
+  if (c.capture >= 0) capture_set(c.capture);
+  if (c.ev_ack) alert_ack(c.ev_ack, "link");
+  if (c.rp[0])
+    for (int i = 0; i < RP_NLANES; ++i)
+      if (!c.via[0] || !strcmp(c.via, RP_LANE_NAMES[i])) rp_set(rp_lanes[i], c.rp, c.db, c.rel, c.roc, c.sil);
+  if (c.enc[0]) ble_lz_set(!strcmp(c.enc, "lzss") || !strcmp(c.enc, LZ_ENCODING));
+  if (c.log[0]) serial_chan_mode(c.log);
+
+  if (c.play[0]){
+    const char* k = c.play;
     if (!strcmp(k,"hydr")) alerts_play_kind(ALERT_HYDR);
     else if (!strcmp(k,"sun"))  alerts_play_kind(ALERT_SUN);
     else if (!strcmp(k,"air"))  alerts_play_kind(ALERT_AIR);
     else if (!strcmp(k,"fall")) alerts_play_kind(ALERT_FALL);
     else if (!strcmp(k,"hrt"))  alerts_play_kind(ALERT_HRT);
   }
+
+  if (c.get[0]){
+    const char* g = c.get;
+    if (!strcmp(g,"sun")) sun_reply_bins(c.n >= 0 ? c.n : SUN_ROLL_MIN);
+    else if (!strcmp(g,"stats")) stats_emit();
+    else if (!strcmp(g,"hist"))  hist_reply(c.metric, c.res, c.from, c.to, c.max);
+    else if (!strcmp(g,"policy")) policy_reply();
+  }
 }
 
+// One command in either encoding (include/ctrl.h); no heap on the way in.
+bool ctrl_handle(const char* s, size_t n, CtrlCmd& c){
+  if (!ctrl_parse(s, n, c)) return false;
+  ctrl_apply(c);
+  return true;
+}
 
-void ctrl_serial_poll() {
-  while (Serial.available()) {
-    String s = Serial.readStringUntil('\n');  
-    s.trim();
-    if (s.length()) {
-     
-      apply_control_json(s);  
-    }
-  }
+
+// "bench [filter]": micro-benchmarks, one JSON line per case. Blocks the
+// loop for a few hundred ms; the live detectors and log ring are untouched.
+// Loop-task allocations only: other tasks keep allocating during a run.
+static uint32_t bench_allocs() {
+  uint32_t n = 0;
+  for (int i = 0; i < MEM_TASKS; ++i) n += mem_tags[i].allocs + mem_tags[i].reallocs;
+  return n;
+}
+
+static void bench_cmd(const char* filter) {
+  while (*filter == ' ') filter++;
+  if (MEMSTAT_WRAP) bench_alloc_count = bench_allocs;
+  auto out = [](const char* l) { ser_wait_room(100); tel.println(l); };
+  bench_run(BENCH_CASES, BENCH_NCASES, filter, out);
+  bench_checks(filter, out);
+}
+
+// Queued command (include/ctrl_queue.h), acked to where it came from:
+//   {"ack":{"id":7,"ok":1,"lat_us":850}}   (id only when the command had one)
+static void ctrl_dispatch(const CtrlMsg& m) {
+  MemScope ms(MEM_CTRL);
+  if (!strncmp(m.buf, "bench", 5)) { bench_cmd(m.buf + 5); return; }
+  CtrlCmd c;
+  bool ok = ctrl_handle(m.buf, m.n, c);
+  uint32_t lat = ctrl_latency_note(m);
+  char ack[64];
+  int k = snprintf(ack, sizeof(ack), "{\"ack\":{");
+  if (c.id) k += snprintf(ack + k, sizeof(ack) - k, "\"id\":%lu,", (unsigned long)c.id);
+  snprintf(ack + k, sizeof(ack) - k, "\"ok\":%d,\"lat_us\":%lu}}", ok ? 1 : 0, (unsigned long)lat);
+  if (m.src == CTRL_SRC_BLE) ble_notify_text(String(ack));
+  else tel.println(ack);
 }
 
 #ifdef ESP_PLATFORM
@@ -351,7 +580,7 @@ class CtrlCb : public NimBLECharacteristicCallbacks {
  public:
   void onWrite(NimBLECharacteristic* c) {
     std::string v = c->getValue();
-    if (!v.empty()) apply_control_json(String(v.c_str()));
+    if (!v.empty()) ctrl_ble_write(v.data(), v.size());
   }
   void onWrite(NimBLECharacteristic* c, NimBLEConnInfo& /*conn*/) {
     onWrite(c);
@@ -370,133 +599,323 @@ void ble_setup_ctrl() {
   chr->setCallbacks(&_ctrlCb);
   chr->setValue("{}");
   svc->start();
-  NimBLEAdvertising* adv = NimBLEDevice::getAdvertising();
-  adv->addServiceUUID(UUID_SVC_CTRL);
-  adv->start();
+  NimBLEDevice::getAdvertising()->addServiceUUID(UUID_SVC_CTRL);   // started by ble_start()
 }
 #endif
 
-volatile uint32_t step_count = 0;
-uint32_t last_step_ms = 0;
-
-uint16_t last_step_interval_ms = 0;  
-uint32_t t_last_upright_ms = 0;     
-static uint32_t still_ms = 0;    
-
-bool  fall_event = false;
-bool  unconscious = false;
-float unconscious_score = 0.0f;
-
-uint32_t t_impact_ms      = 0;  
-uint32_t t_last_motion_ms = 0;  
-uint32_t t_lying_since_ms = 0;  
-
-Activity activity_state = ACT_STILL;
-Posture  posture_state  = POST_UNKNOWN;
-
-
-bool  g_init=false;
-float g_lp_x=0, g_lp_y=0, g_lp_z=0;     
-float a_par_hp = 0;                     
-const float G_LP_ALPHA = 0.05f; 
-const float HP_ALPHA   = 0.30f;
-
-#if EASY_TEST
-const float STEP_PEAK = 0.35f;   
-#else
-const float STEP_PEAK = 0.60f;
-#endif
-const uint16_t STEP_MIN_MS = 250;  
-const uint16_t STEP_MAX_MS = 1200; 
-
-
-const uint8_t IMU_PERIOD_MS = 20;  
 static uint32_t imu_next_ms = 0;
 
 
-static float ax_g=NAN, ay_g=NAN, az_g=NAN, gx_g=NAN, gy_g=NAN, gz_g=NAN, amag_g=NAN;
-static float gyro_sum_g = 0.0f, face_g = 0.0f;
-static int   motion_g   = 0;
+static float ax_g=NAN, ay_g=NAN, az_g=NAN, gx_g=NAN, gy_g=NAN, gz_g=NAN, a2_g=NAN;   // a2: |a|^2
+static float face_g = 0.0f;
 
 
 MAX30105 ppg;
 bool ppg_ok = false;
-bool ppg_contact = false;
 
-uint8_t ppg_irDrive  = 0x30;         
-uint8_t ppg_redDrive = 0x30;         
 
+int find_onewire_pin(const int* pins, int n, byte* addr_out) {
+  for (int i = 0; i < n; ++i) {
+    int p = pins[i];
 
-long        PPG_IR_LOW  = 40000;
-long        PPG_IR_HIGH = 120000;
-const uint8_t PPG_DRIVE_MIN = 0x20, PPG_DRIVE_MAX = 0xB0;
+    pinMode(p, INPUT_PULLUP);   
+    delay(2);
 
+    OneWire testBus(p);
+    if (testBus.reset()) {     
+      testBus.reset_search();
+      if (testBus.search(addr_out)) {
+        return p;               
+      }
+    }
+  }
+  return -1;                    
+}
 
-const int   PPG_SR_HZ = 100;
-const int   PPG_WIN   = PPG_SR_HZ;   
-long        ppg_acIR[PPG_WIN], ppg_acRED[PPG_WIN];
-int         ppg_idx = 0, ppg_filled = 0;
+// ---- device bring-up (include/init_seq.h) -----------------------------------
+// One step function per device; phases are the old sequential setup code cut
+// at each wait.
 
+static int32_t si115_init_step(uint8_t phase) {
+  if (!topo_expect(BUS_WIRE, SI115X_ADDR)) return INIT_FAIL;
+  if (phase == 0) return topo_cached ? 0 : 20;
+  si_ok = si115.Begin();
+  if (si_ok) tlog<TL_DEV_OK>("SI115X"); else tlog<TL_DEV_FAIL>("SI115X");
+  return si_ok ? INIT_OK : INIT_FAIL;
+}
 
-bool        ppg_locked = false;
-unsigned long ppg_okSince = 0, ppg_badSince = 0;
-unsigned long ppg_lastBeat = 0;
+static int32_t si115_auto_step(uint8_t) {
+  tlog<TL_SI_AUTO>(si115_auto_begin() ? "(window IRQ)" : "FAIL, polled");
+  return INIT_OK;                        // polled mode still samples
+}
 
-float ppg_bpm = 0;
-byte  ppg_rates[8] = {0};
-byte  ppg_rateSpot = 0;
-int   ppg_rateFilled = 0;            
-int   ppg_bpm_avg  = 0;
+static int32_t bme_init_step(uint8_t) {
+  if (!topo_expect(BUS_WIRE, 0x77)) { tlog<TL_DEV_FAIL>("BME280"); return INIT_FAIL; }
+  if (!bme) bme = new Adafruit_BME280();
+  if (!bme->begin(0x77, &Wire)) { tlog<TL_DEV_FAIL>("BME280"); return INIT_FAIL; }
+  bme->setSampling(
+    Adafruit_BME280::MODE_FORCED,
+    Adafruit_BME280::SAMPLING_X1,  
+    Adafruit_BME280::SAMPLING_X1,  
+    Adafruit_BME280::SAMPLING_X1,  
+    Adafruit_BME280::FILTER_OFF,
+    Adafruit_BME280::STANDBY_MS_1000
+  );
+  bme_ok = true;
+  tlog<TL_DEV_OK>("BME280");
+  return INIT_OK;
+}
 
+static int32_t sgp_init_step(uint8_t) {
+  if (topo_expect(BUS_WIRE, SGP40_ADDR)) {
+    if (!sgp) sgp = new Adafruit_SGP40();
+    if (sgp->begin(&Wire)) { tlog<TL_DEV_OK>("SGP40"); return INIT_OK; }
+  }
+  tlog<TL_DEV_FAIL>("SGP40");
+  return INIT_FAIL;
+}
 
-float dc_ir = 0, dc_red = 0;
-float rms_ir = 0, rms_red = 0;
-uint32_t spo2_n = 0;
-float   spo2_value = NAN;    
-uint8_t spo2_quality = 0;    
+static int32_t voc_init_step(uint8_t) {
+  tlog<TL_DEV_OK>("VOC algo");
+  voc_state_begin();
+  sgp_ok = true;
+  return INIT_OK;
+}
 
+static int32_t scd_init_step(uint8_t phase) {
+  switch (phase) {
+    case 0:
+      if (!topo_expect(BUS_WIRE, SCD4X_ADDR)) { tlog<TL_DEV_FAIL>("SCD40"); return INIT_FAIL; }
+      tlog<TL_SCD_PROBE>();
+      sensor.begin(Wire, 0x62);
+      return 30;
+    case 1:
+      sensor.wakeUp();
+      sensor.stopPeriodicMeasurement();
+      return 500;
+    case 2:
+      error = sensor.reinit();
+      return 20;
+    default: {
+      uint64_t serialNumber = 0;
+      error = sensor.getSerialNumber(serialNumber);
+      if (error != NO_ERROR) {
+        tlog<TL_SCD_SN_ERR>((int)error);
+        tlog<TL_DEV_FAIL>("SCD40");
+        return INIT_FAIL;
+      }
+      tlog<TL_SCD_SN>((uint32_t)(serialNumber >> 32), (uint32_t)serialNumber);
+      scd_set_demand(PUSH_PERIOD_MS);
+      scd_begin(millis());
+      scd_ok = true;
+      tlog<TL_DEV_OK>("SCD40");
+      return INIT_OK;
+    }
+  }
+}
 
-const long  DC_CONTACT_MIN = 20000;   
-const long  DC_LOSS_MIN    = 15000;   
-const float AC_CONTACT_MIN = 120.0f;  
-const float AC_LOSS_MIN    = 80.0f;   
-const int   CONTACT_ON_SAMPLES  = 8;  
-const int   CONTACT_OFF_SAMPLES = 20; 
+static int32_t mpu_init_step(uint8_t) {
+  const char* imu_bus_name = "Wire1";
+  bool ok = false;
+  if (topo_cached && topo.mpu_bus >= 0) {
+    imu_bus_name = topo.mpu_bus == BUS_WIRE1 ? "Wire1" : "Wire";
+    ok = mpu.begin(topo.mpu_addr, topo.mpu_bus == BUS_WIRE1 ? &Wire1 : &Wire);
+    if (!ok) topo_invalidate();
+  } else if (!topo_cached) {                  // cached without an MPU: only the re-probe searches
+    ok = mpu.begin(0x68, &Wire1) || mpu.begin(0x69, &Wire1);
+    topo.mpu_bus = -1;
+    if (ok) { topo.mpu_bus = BUS_WIRE1; topo.mpu_addr = i2c_ack(Wire1, 0x68) ? 0x68 : 0x69; }
+    else {
+      imu_bus_name = "Wire";
+      ok = mpu.begin(0x68, &Wire) || mpu.begin(0x69, &Wire);
+      if (ok) { topo.mpu_bus = BUS_WIRE; topo.mpu_addr = i2c_ack(Wire, 0x68) ? 0x68 : 0x69; }
+    }
+    if (ok) topo_dirty = true;
+  }
+  tlog<TL_MPU_INIT>(ok ? "OK" : "FAIL", imu_bus_name);
+  if (!ok) return INIT_FAIL;
 
+  mpu.setAccelerometerRange(MPU6050_RANGE_4_G);
+  mpu.setGyroRange(MPU6050_RANGE_500_DEG);
+  mpu.setFilterBandwidth(MPU6050_BAND_21_HZ);
 
-static uint32_t scd_next_read_ms = 0;
+  sensors_event_t a,g,t;
+  mpu.getEvent(&a,&g,&t);
+  tlog<TL_MPU_SAMPLE>(a.acceleration.x, a.acceleration.y, a.acceleration.z, g.gyro.x, g.gyro.y, g.gyro.z);
+  mpu_ok = true;
+  return INIT_OK;
+}
 
-int find_onewire_pin(const int* pins, int n, byte* addr_out) {
-  for (int i = 0; i < n; ++i) {
-    int p = pins[i];
+#define MPU_REG_SIGNAL_RESET  0x68
+#define MPU_REG_PWR_MGMT_1    0x6B
 
-    pinMode(p, INPUT_PULLUP);   
-    delay(2);
+static bool mpu_write(TwoWire& w, uint8_t addr, uint8_t reg, uint8_t v) {
+  w.beginTransmission(addr); w.write(reg); w.write(v);
+  return w.endTransmission() == 0;
+}
 
-    OneWire testBus(p);
-    if (testBus.reset()) {     
-      testBus.reset_search();
-      if (testBus.search(addr_out)) {
-        return p;               
+// Health re-probe: what mpu_init_step does through begin(), in phases that
+// return their waits instead of sleeping.
+static int32_t mpu_reprobe_step(uint8_t phase) {
+  static TwoWire* bus = nullptr;
+  static uint8_t  addr = 0;
+  switch (phase) {
+    case 0: {
+      bus = nullptr;
+      if (topo.mpu_bus >= 0) {
+        TwoWire& w = topo.mpu_bus == BUS_WIRE1 ? Wire1 : Wire;
+        if (i2c_ack(w, topo.mpu_addr)) { bus = &w; addr = topo.mpu_addr; }
       }
+      TwoWire* const buses[2] = { &Wire1, &Wire };
+      for (int b = 0; !bus && b < 2; ++b)
+        for (uint8_t a = 0x68; !bus && a <= 0x69; ++a)
+          if (i2c_ack(*buses[b], a)) { bus = buses[b]; addr = a; }
+      if (!bus || !mpu_write(*bus, addr, MPU_REG_PWR_MGMT_1, 0x80)) return INIT_FAIL;
+      return 100;                                          // device reset
+    }
+    case 1:
+      return mpu_write(*bus, addr, MPU_REG_SIGNAL_RESET, 0x07) ? 100 : INIT_FAIL;
+    case 2: {
+      mpu.quick = true;
+      bool ok = mpu.begin(addr, bus);                      // chip id only
+      mpu.quick = false;
+      if (!ok || !mpu_write(*bus, addr, MPU_REG_PWR_MGMT_1, 0x01)) return INIT_FAIL;   // PLL, gyro X
+      mpu.setAccelerometerRange(MPU6050_RANGE_4_G);
+      mpu.setGyroRange(MPU6050_RANGE_500_DEG);
+      mpu.setFilterBandwidth(MPU6050_BAND_21_HZ);
+      int8_t b = bus == &Wire1 ? BUS_WIRE1 : BUS_WIRE;
+      if (topo.mpu_bus != b || topo.mpu_addr != addr) { topo.mpu_bus = b; topo.mpu_addr = addr; topo_dirty = true; }
+      return 100;                                          // clock settles
+    }
+    default: {
+      sensors_event_t a, g, t;
+      mpu.getEvent(&a, &g, &t);
+      tlog<TL_MPU_INIT>("OK", bus == &Wire1 ? "Wire1" : "Wire");
+      mpu_ok = true;
+      return INIT_OK;
     }
   }
-  return -1;                    
 }
 
-void i2c_scan(TwoWire& bus, const char* name){
-  Serial.print("[SCAN] "); Serial.print(name); Serial.print(": ");
-  for (uint8_t a=1; a<127; a++){
-    bus.beginTransmission(a);
-    if (bus.endTransmission()==0){ Serial.print("0x"); Serial.print(a,HEX); Serial.print(" "); }
+static int32_t ds_init_step(uint8_t phase) {
+#if BIOMETRICS_ENABLED
+  if (phase == 0) {
+    if (!topo_cached && !init_done_ms) {       // pin search at boot only (it drives GPIOs)
+      const int candidates[] = {8,9,10,11,12,13,14,15,16,17,18,21,33};
+      byte rom[8] = {0};
+      int foundPin = find_onewire_pin(candidates, sizeof(candidates)/sizeof(candidates[0]), rom);
+
+      if (foundPin > 0) {
+        char hex[17];
+        for (uint8_t i=0; i<8; i++) snprintf(hex + 2*i, 3, "%02X", rom[i]);
+        tlog<TL_OW_FOUND>(foundPin, hex);
+      } else {
+        tlog<TL_OW_NONE>();
+      }
+      topo.ow_pin = foundPin > 0 ? foundPin : -1;
+      memcpy(topo.ow_rom, rom, sizeof(rom));
+    }
+
+    if (!ow) { ow = new OneWire(ONEWIRE_PIN); ds = new DallasTemperature(ow); }
+    ds->begin();
+
+    bool ds_found;
+    if (topo_cached && topo.ow_pin == ONEWIRE_PIN) {
+      memcpy(DS_ADDR, topo.ow_rom, 8);          // skip the enumeration
+      ds_found = true;
+    } else {
+      uint8_t count = ds->getDeviceCount();
+      tlog<TL_DS_COUNT>(count);
+      ds_found = count > 0 && ds->getAddress(DS_ADDR, 0);
+    }
+    if (!ds_found) { tlog<TL_DEV_FAIL>("DS18B20"); return INIT_FAIL; }
+
+    char hex[17];
+    for (uint8_t i=0; i<8; i++) snprintf(hex + 2*i, 3, "%02X", DS_ADDR[i]);
+    tlog<TL_DS_ADDR>(hex, ds->isParasitePowerMode() ? "YES" : "NO");
+
+    // The 1 s tick reads the previous conversion and starts the next one
+    // instead of blocking ~190 ms per read; the first one starts here.
+    ds->setResolution(DS_ADDR, 10);   
+    ds->setWaitForConversion(false);
+    ds->requestTemperaturesByAddress(DS_ADDR);
+    return 200;                          // 10-bit conversion
   }
-  Serial.println();
+  if (!topo_cached) tlog<TL_DS_FIRST>(ds->getTempC(DS_ADDR));
+  ds->requestTemperaturesByAddress(DS_ADDR);
+  ds_ok = true;
+  tlog<TL_DEV_OK>("DS18B20");
+  return INIT_OK;
+#else
+  return INIT_FAIL;
+#endif
 }
 
-void setup() {
+// Bit i of deps refers to row i.
+enum { DEV_PPG, DEV_SI, DEV_SI_AUTO, DEV_BME, DEV_SGP, DEV_VOC, DEV_SCD, DEV_MPU, DEV_DS };
+static InitDev INIT_DEVS[] = {
+  { "max3010x",    BUS_WIRE,  0,               ppg_init_step },
+  { "si115x",      BUS_WIRE,  0,               si115_init_step },
+  { "si115x_auto", BUS_WIRE,  1u << DEV_SI,    si115_auto_step },
+  { "bme280",      BUS_WIRE,  0,               bme_init_step },
+  { "sgp40",       BUS_WIRE,  0,               sgp_init_step },
+  { "voc_state",   BUS_WIRE,  1u << DEV_SGP,   voc_init_step },
+  { "scd4x",       BUS_WIRE,  0,               scd_init_step },
+  { "mpu6050",     BUS_WIRE1, 0,               mpu_init_step },
+  { "ds18b20",     BUS_ONEWIRE, 0,             ds_init_step },
+};
+static const int INIT_NDEVS = sizeof(INIT_DEVS) / sizeof(INIT_DEVS[0]);
+
+// ---- runtime re-probe (include/sensor_health.h) ------------------------------
+// Same step protocol as bring-up; where the boot path blocks for long
+// (vendor stop/reinit, self-test) the driver state is reset directly.
+
+static int32_t si_reprobe_step(uint8_t phase) {
+  if (phase < 2) { int32_t r = si115_init_step(phase); return r == INIT_OK ? 0 : r; }
+  return si115_auto_step(phase);
+}
 
-  Serial.begin(115200); delay(300);
+static int32_t sgp_reprobe_step(uint8_t) {
+  sgp_busy = false;                      // drop the measurement the failure cut short
+  return INIT_OK;
+}
+
+static int32_t scd_reprobe_step(uint8_t phase) {
+  if (phase == 0) { scd_send(SCD_CMD_STOP_PERIODIC); return 500; }   // idle, whatever it was doing
+  scd_op = SCD_OP_NONE;
+  scd_begin(millis());
+  return INIT_OK;
+}
+
+// Biometric parts last: without BIOMETRICS_ENABLED they are not supervised.
+enum { HL_SI, HL_BME, HL_SGP, HL_SCD, HL_MPU, HL_PPG, HL_DS };
+static HealthDev HEALTH_DEVS[] = {
+  { "si115x",   BUS_WIRE,    SI115X_ADDR, &si_ok,  si_reprobe_step },
+  { "bme280",   BUS_WIRE,    0x77,        &bme_ok, bme_init_step },
+  { "sgp40",    BUS_WIRE,    SGP40_ADDR,  &sgp_ok, sgp_reprobe_step },
+  { "scd4x",    BUS_WIRE,    SCD4X_ADDR,  &scd_ok, scd_reprobe_step },
+  { "mpu6050",  BUS_WIRE1,   0,           &mpu_ok, mpu_reprobe_step },   // bus from topo, step searches
+#if BIOMETRICS_ENABLED
+  { "max3010x", BUS_WIRE,    0x57,        &ppg_ok, ppg_init_step },
+  { "ds18b20",  BUS_ONEWIRE, 0,           &ds_ok,  ds_init_step },
+#endif
+};
+static const int HEALTH_NDEVS = sizeof(HEALTH_DEVS) / sizeof(HEALTH_DEVS[0]);
+
+
+void setup() {
+  mem_begin();
+  capture_serial_setup();
+  ctrl_queue_begin();
+  topo_load();
+  Serial.begin(115200);
+  if (!topo_stored) delay(300);          // first boot: let the monitor attach
+  boot_stage("serial");
   Serial.println("SAFE start");
+  pm_begin();
+#if SI115X_INT_PIN >= 0
+  pm_wake_pin(SI115X_INT_PIN, true);
+#endif
 
 #ifdef ESP_PLATFORM
   randomSeed(esp_random());  
@@ -518,167 +937,56 @@ void setup() {
   Serial.println("[MODE] DEMO PI réelle (sanitisée)");
 #endif
 
+  mem_tag = MEM_SENSORS;
   Wire.begin(SDA1_PIN, SCL1_PIN);
   Wire1.begin(SDA2_PIN, SCL2_PIN);
-  for (uint8_t a=1; a<127; a++) {
-  Wire1.beginTransmission(a);
-  if (Wire1.endTransmission()==0) { Serial.print("I2C1 found 0x"); Serial.println(a,HEX); }
-}
-
-i2c_scan(Wire,  "Wire  (SDA=7, SCL=6)");
-i2c_scan(Wire1, "Wire1 (SDA=4, SCL=5)");
 
   Wire.setClock(100000);
-  Wire.setTimeOut(1000);   
+  Wire.setTimeOut(I2C_TIMEOUT_MS);
 
   static float    skin_last = NAN;
   static uint32_t skin_last_ms = 0;
 
   Wire1.setClock(100000);
-  Wire1.setTimeOut(1000); 
+  Wire1.setTimeOut(I2C_TIMEOUT_MS);
+  health_bus(BUS_WIRE,  Wire,  SDA1_PIN, SCL1_PIN, 100000);
+  health_bus(BUS_WIRE1, Wire1, SDA2_PIN, SCL2_PIN, 100000);
+  health_setup(HEALTH_DEVS, HEALTH_NDEVS);
   Serial.println("I2C OK");
 
-#if BIOMETRICS_ENABLED
-  ppg_init();
-#else
-  ppg_ok = false;   
-#endif
-
-
-
-if (!si_ok) {
-  delay(20);
-  si_ok = si115.Begin();
-  Serial.println(si_ok ? "SI115X OK (retry)" : "SI115X FAIL");
-}
-
-
-const int candidates[] = {8,9,10,11,12,13,14,15,16,17,18,21,33};
-byte rom[8] = {0};
-int foundPin = find_onewire_pin(candidates, sizeof(candidates)/sizeof(candidates[0]), rom);
-
-if (foundPin > 0) {
-  Serial.print(">>> OneWire device on GPIO "); Serial.println(foundPin);
-  Serial.print("ROM family: 0x"); Serial.println(rom[0], HEX); 
-  Serial.print("ROM addr  : ");
-  for (uint8_t i=0; i<8; i++){ if (rom[i] < 16) Serial.print("0"); Serial.print(rom[i], HEX); }
-  Serial.println();
-} else {
-  Serial.println(">>> No OneWire device found on tested pins.");
-}
-
-
-#if BIOMETRICS_ENABLED
-ow = new OneWire(ONEWIRE_PIN);
-ds = new DallasTemperature(ow);
-ds->begin();
-
-uint8_t count = ds->getDeviceCount();
-Serial.print("DS18B20 count: "); Serial.println(count);
-
-if (count > 0 && ds->getAddress(DS_ADDR, 0)) {
-  
-  Serial.print("DS18B20 addr: ");
-  for (uint8_t i=0; i<8; i++){ if (DS_ADDR[i] < 16) Serial.print("0"); Serial.print(DS_ADDR[i], HEX); }
-  Serial.print("  parasite? "); Serial.println(ds->isParasitePowerMode() ? "YES" : "NO");
-
-  ds->setResolution(DS_ADDR, 10);   
-  ds->setWaitForConversion(true);   
-  ds_ok = true;
-  Serial.println("DS18B20 OK");
-  ds->requestTemperaturesByAddress(DS_ADDR);
-  float t0 = ds->getTempC(DS_ADDR);
-  Serial.print("DS18B20 first read: "); Serial.println(t0);
-} else {
-  ds_ok = false;
-  Serial.println("DS18B20 FAIL (pas trouvé)");
-}
-#else
-  ds_ok = false;  
-#endif
-
-  bme = new Adafruit_BME280();
-  bme_ok = bme->begin(0x77, &Wire);
-  Serial.println(bme_ok ? "BME280 OK" : "BME280 FAIL");
-  if (bme_ok) {
-  bme->setSampling(
-    Adafruit_BME280::MODE_FORCED,
-    Adafruit_BME280::SAMPLING_X1,  
-    Adafruit_BME280::SAMPLING_X1,  
-    Adafruit_BME280::SAMPLING_X1,  
-    Adafruit_BME280::FILTER_OFF,
-    Adafruit_BME280::STANDBY_MS_1000
-  );
-}
-
-
-  sgp = new Adafruit_SGP40();
-  sgp_ok = sgp->begin(&Wire);
-  Serial.println(sgp_ok ? "SGP40 OK" : "SGP40 FAIL");
-
-
-  Serial.println("VOC algo: PRESENT");
-
-  
-Serial.println("SCD4x: probing...");
-
-
-TwoWire& BUS = Wire;
-
-BUS.setClock(100000);
-sensor.begin(BUS, 0x62);     
-
-delay(30);
-sensor.wakeUp();
-sensor.stopPeriodicMeasurement();
-delay(500);
-error = sensor.reinit();
-delay(20);
-
-
-const char* imu_bus_name = "Wire1";
-mpu_ok = mpu.begin(0x68, &Wire1) || mpu.begin(0x69, &Wire1);
-if (!mpu_ok) {                     
-  imu_bus_name = "Wire";
-  mpu_ok = mpu.begin(0x68, &Wire) || mpu.begin(0x69, &Wire);
-}
-Serial.printf("MPU6050 %s sur %s (essaie 0x68/0x69)\n", mpu_ok ? "OK" : "FAIL", imu_bus_name);
-
-if (mpu_ok) {
-  mpu.setAccelerometerRange(MPU6050_RANGE_4_G);
-  mpu.setGyroRange(MPU6050_RANGE_500_DEG);
-  mpu.setFilterBandwidth(MPU6050_BAND_21_HZ);
-
-  
-  sensors_event_t a,g,t;
-  mpu.getEvent(&a,&g,&t);
-  Serial.printf("[MPU] ax=%.2f ay=%.2f az=%.2f | gx=%.2f gy=%.2f gz=%.2f\n",
-                a.acceleration.x, a.acceleration.y, a.acceleration.z,
-                g.gyro.x, g.gyro.y, g.gyro.z);
-}
-
-
-uint64_t serialNumber = 0;
-error = sensor.getSerialNumber(serialNumber);
-if (error != NO_ERROR) {
-  Serial.print("getSerialNumber error: "); Serial.println(error);
-  scd_ok = false;
-} else {
-  Serial.print("SCD4x SN: "); PrintUint64(serialNumber); Serial.println();
-  error = sensor.startPeriodicMeasurement();
-  scd_next_read_ms = millis() + 6500;   
-  scd_ok = (error == NO_ERROR);
-}
-Serial.println(scd_ok ? "SCD40 OK" : "SCD40 FAIL");
-
-  Serial.println("SAFE ready");
+  if (!topo_verify(Wire, Wire1)) {
+    topo_scan(Wire,  BUS_WIRE,  "Wire  (SDA=7, SCL=6)");
+    topo_scan(Wire1, BUS_WIRE1, "Wire1 (SDA=4, SCL=5)");
+  }
+  boot_stage("topology");
+
+  init_start(INIT_DEVS, INIT_NDEVS);
+  boot_stage("init_start");
+
+  mem_tag = MEM_TSDB;
+  ts_begin();
+  hist_begin();
+  mem_tag = MEM_CORE;
+  boot_stage("tsdb");
+  {                                   // readers never see an unpublished state
+    const float none[7] = { NAN, NAN, NAN, NAN, NAN, NAN, NAN };
+    state_publish_imu(0, none, 0.0f, false);
+    state_publish_ppg(0);
+  }
+  tlog<TL_BOOT_READY>();
   alerts_init();
 ALERTS_LED_ENABLED = true;  ALERTS_BUZZ_ENABLED = true;
 #if defined(ESP_PLATFORM)
+  mem_tag = MEM_BLE;
   ble_setup_ctrl();
+  mem_tag = MEM_CORE;
 #endif
 
   net_setup();
+  alert_begin(USER_ID);
+  rp_init(rp_lanes[RP_WIFI], 10000);
+  rp_init(rp_lanes[RP_BLE], 2000);
+  boot_stage("net");
 }
 
 float read_env_c(){ return bme_ok ? bme->readTemperature() : NAN; }
@@ -688,8 +996,9 @@ float read_env_hpa(){return bme_ok ? bme->readPressure()/100.0f : NAN; }
 float read_skin_c(){
   if (!ds_ok) return NAN;
 
-  ds->requestTemperaturesByAddress(DS_ADDR);   
-  float t = ds->getTempC(DS_ADDR);             
+  float t = ds->getTempC(DS_ADDR);             // conversion started on the previous call
+  ds->requestTemperaturesByAddress(DS_ADDR);
+  health_note(HL_DS, t != DEVICE_DISCONNECTED_C && t != 85.0f);   // 85: power-on value, it reset
 
   if (t == DEVICE_DISCONNECTED_C) return NAN;  
   if (t == 85.0f) return NAN;                  
@@ -701,52 +1010,60 @@ float read_skin_c(){
 
 float read_skin_c_raw(){
   if (!ds_ok) return NAN;
-  ds->requestTemperaturesByAddress(DS_ADDR);
   float t = ds->getTempC(DS_ADDR);
+  ds->requestTemperaturesByAddress(DS_ADDR);
+  health_note(HL_DS, t != DEVICE_DISCONNECTED_C && t != 85.0f);
   if (t == DEVICE_DISCONNECTED_C) return NAN;  
   if (t == 85.0f) return NAN;                  
   return t;
 }
 
+// Sampling runs in voc_service(); this only hands over the latest result and
+// updates the humidity/temperature compensation for the next measurement.
 float read_voc_index(int* srawOut, float tempC, float rh) {
   if (!sgp_ok){ if (srawOut) *srawOut=-1; return NAN; }
-  uint16_t sraw = sgp->measureRaw(isnan(tempC)?25.0f:tempC, isnan(rh)?50.0f:rh);
-  if (srawOut) *srawOut = (int)sraw;
-  int32_t idx = voc_index_from_sraw((int32_t)sraw); 
-  if (idx < 0)   idx = 0;
-  if (idx > 500) idx = 500;
-  return (float)idx;
+  voc_set_compensation(tempC, rh);
+  if (srawOut) *srawOut = (int)voc_sraw_last;
+  return voc_index_last;
 }
 
+// Newest CO2 value produced by scd_service(), or NAN if none since last call.
 float read_co2_ppm(float* out_rh = nullptr){
   if (!scd_ok) return NAN;
-
-  uint16_t co2 = 0;
-  float tC = 0.0f, rH = 0.0f;
-
-  int16_t ret = sensor.readMeasurement(co2, tC, rH);
-  if (ret != NO_ERROR) return NAN;  
-  if (co2 == 0) return NAN;         
-
-  if (out_rh) *out_rh = rH;
-  return (float)co2;
+  return scd_take(out_rh);
 }
 
-bool read_mpu(float& ax, float& ay, float& az, float& gx, float& gy, float& gz, float& amag){
+bool read_mpu(float& ax, float& ay, float& az, float& gx, float& gy, float& gz, float& a2){
   if(!mpu_ok) return false;
   sensors_event_t a, g, t;
   mpu.getEvent(&a, &g, &t);
   ax = a.acceleration.x;  ay = a.acceleration.y;  az = a.acceleration.z;   
   gx = g.gyro.x;          gy = g.gyro.y;          gz = g.gyro.z;          
-  amag = sqrtf(ax*ax + ay*ay + az*az);                                     
-  return true;
+  a2 = ax*ax + ay*ay + az*az;                                              
+  // A failed read comes back as all-zero or all-ones registers: |a| far from 1 g.
+  bool ok = a2 > fm_sq(0.5f) && a2 < fm_sq(80.0f);
+  health_note(HL_MPU, ok);
+  return ok;
 }
 
 void si115_service() {
   if (!si_ok) return;
+  uint32_t now = millis();
+  if (si_auto) { si115_auto_service(now); return; }
+
+  // polled fallback, rate-limited to the same forced-read period
+  if ((int32_t)(now - si_next_read_ms) < 0) return;
+  si_next_read_ms = now + SI_READ_PERIOD_MS;
+  si_push(now, si115.ReadVisible(), si115.ReadIR());
+  si_i2c_xfers += 2; si_reads++;
+}
+
+// 1 s path: fold the samples gathered since the last call into sun_proxy.
+void si115_update_proxy() {
+  if (!si_ok) return;
 
-  si_vis = si115.ReadVisible();
-  si_ir  = si115.ReadIR();
+  uint16_t vis_mean, ir_mean, vis_max;
+  if (si115_take_block(vis_mean, ir_mean, vis_max)) { si_vis = vis_mean; si_ir = ir_mean; }
   si_uv  = 0;
   uv_index = NAN;
 
@@ -776,388 +1093,104 @@ void si115_service() {
                         (sun_proxy >= 0.25f) ? "cloudy" : "dim";
 }
 
-void update_steps_activity_posture(float ax, float ay, float az,
-                                   float gx, float gy, float gz,
-                                   float amag, uint32_t now_ms) {
-
-                                    
-  if (!isfinite(ax) || !isfinite(ay) || !isfinite(az)) {
-    activity_state = ACT_STILL;
-    return;
-  }
-
-  if (!(amag > 0.5f) || !isfinite(amag)) {
-    amag = sqrtf(ax*ax + ay*ay + az*az);
-  }
-
-  
-  if (!g_init) { g_lp_x=ax; g_lp_y=ay; g_lp_z=az; g_init=true; }
-  g_lp_x = (1.0f-G_LP_ALPHA)*g_lp_x + G_LP_ALPHA*ax;
-  g_lp_y = (1.0f-G_LP_ALPHA)*g_lp_y + G_LP_ALPHA*ay;
-  g_lp_z = (1.0f-G_LP_ALPHA)*g_lp_z + G_LP_ALPHA*az;
-
-  float gnorm = sqrtf(g_lp_x*g_lp_x + g_lp_y*g_lp_y + g_lp_z*g_lp_z);
-  if (gnorm < 1e-3f) gnorm = 1e-3f;
-
-  
-  
-  float cosZ = fabsf(g_lp_z) / gnorm;
-  if (cosZ > 1.0f) cosZ = 1.0f;
-  float tilt_deg = acosf(cosZ) * 57.2958f;     
-  if      (tilt_deg < 35) posture_state = POST_LYING;
-  else if (tilt_deg < 65) posture_state = POST_SITTING;
-  else                    posture_state = POST_STANDING;
-
-  
-  if (posture_state != POST_LYING) t_last_upright_ms = now_ms;
-
-  
-  float gxhat = g_lp_x / gnorm, gyhat = g_lp_y / gnorm, gzhat = g_lp_z / gnorm;
-  float a_par     = ax*gxhat + ay*gyhat + az*gzhat; 
-  float a_par_dyn = a_par - gnorm;
-  static float prev_hp = 0.0f;
-  a_par_hp = (1.0f-HP_ALPHA)*a_par_hp + HP_ALPHA*a_par_dyn;
-
-  
-  uint16_t dt_ms = now_ms - last_step_ms;
-  bool rising = (a_par_hp > STEP_PEAK && prev_hp <= STEP_PEAK);
-  if (rising && dt_ms >= STEP_MIN_MS && dt_ms <= STEP_MAX_MS) {
-    step_count++;
-    last_step_interval_ms = dt_ms;
-    last_step_ms = now_ms;
-  }
-  prev_hp = a_par_hp;
-
-  
-  float dyn = fabsf(amag - G);
-  float thr_dyn  = NO_MOTION_DYN;
-  float thr_gyro = NO_MOTION_GYRO;
-  if (posture_state == POST_LYING) {
-    thr_dyn  *= 2.0f;   
-    thr_gyro *= 3.0f;
-  }
-  float gyro_sum = fabsf(gx) + fabsf(gy) + fabsf(gz);
-  bool moving = (dyn > thr_dyn) || (gyro_sum > thr_gyro);
-
-  
-  if (t_impact_ms && (now_ms - t_impact_ms) < 700) {
-    moving = false;
-  }
-
-  
-  if (!moving) {
-    still_ms = (still_ms + IMU_PERIOD_MS);
-    if (still_ms > 60000) still_ms = 60000;
-  } else {
-    still_ms = 0;
-  }
-
-  
-  uint32_t since_step = now_ms - last_step_ms;
-  if (since_step < 2500) {
-    if (last_step_interval_ms > 0 && last_step_interval_ms < 450) activity_state = ACT_RUN;
-    else                                                           activity_state = ACT_WALK;
-  } else if (!moving) {
-    activity_state = ACT_STILL;
-  } else {
-    
-    activity_state = ACT_WALK;
-  }
-
-  
-  if (moving) t_last_motion_ms = now_ms;
+static void ppg_configure(uint8_t avg) {
+  const byte ledMode = 2;
+  const int  sampleRate = 100, pulseWidth = 411, adcRange = 16384;
+  ppg.setup(ppg_irDrive, avg, ledMode, sampleRate, pulseWidth, adcRange);
+  ppg.setPulseAmplitudeIR(ppg_irDrive);
+  ppg.setPulseAmplitudeRed(ppg_redDrive);
+  ppg.setPulseAmplitudeGreen(0);
+  ppg.clearFIFO();
+  ppg_avg = avg;
 }
 
-void ppg_init(){
-  delay(50);
+// Begin, then prime the DC estimate from the first 32 FIFO samples without
+// blocking the Wire runner (getIR() waits for each new sample).
+static int32_t ppg_init_step(uint8_t phase){
+#if BIOMETRICS_ENABLED
+  static long sIR = 0, sRED = 0;
+  static int  k = 0;
+  if (phase == 0) return topo_expect(BUS_WIRE, 0x57) ? 50 : INIT_FAIL;
+  if (phase == 1) {
   Wire.setClock(400000);
   if (!ppg.begin(Wire, I2C_SPEED_FAST, 0x57)) {
     Wire.setClock(100000);
     if (!ppg.begin(Wire, I2C_SPEED_STANDARD, 0x57)) {
-      Serial.println("MAX3010x FAIL (not found)");
-      ppg_ok = false;
-      return;
+      tlog<TL_DEV_FAIL>("MAX3010x");
+      return INIT_FAIL;
     }
   }
 
-  byte sampleAverage = 8;
-byte ledMode       = 2;     
-int  sampleRate    = 100;
-int  pulseWidth    = 411;
-int  adcRange      = 16384;
-
-  ppg.setup(ppg_irDrive, sampleAverage, ledMode, sampleRate, pulseWidth, adcRange);
-  ppg.setPulseAmplitudeIR(ppg_irDrive);     
-  ppg.setPulseAmplitudeRed(ppg_redDrive);    
-  ppg.setPulseAmplitudeGreen(0);
-  ppg.clearFIFO();
+  ppg_configure(PPG_AVG);
+  Wire.setClock(100000);                 // other Wire devices init meanwhile
+  sIR = sRED = 0; k = 0;
+  return 10;
+  }
 
-  
-  long sIR=0, sRED=0;
-  for (int i=0;i<32;i++){ sIR += (long)ppg.getIR(); sRED += (long)ppg.getRed(); delay(5); }
-  dc_ir  = (float)(sIR/32);
-  dc_red = (float)(sRED/32);
-  rms_ir = 0; rms_red = 0; spo2_n = 0;
+  ppg.check();
+  while (ppg.available() && k < 32) {
+    sIR += (long)ppg.getFIFOIR(); sRED += (long)ppg.getFIFORed(); k++;
+    ppg.nextSample();
+  }
+  if (k < 32) return 10;
+  ppg_seed((float)(sIR/32), (float)(sRED/32));
 
   ppg_ok = true;
-  Serial.println("MAX3010x OK (BPM+SpO2)");
-
-  
-  Wire.setClock(100000);
+  tlog<TL_DEV_OK>("MAX3010x");
+  return INIT_OK;
+#else
+  return INIT_FAIL;
+#endif
 }
 
+// Drains the FIFO: one sample per entry, IR and red from the same entry.
+// The newest entry is dated now and each older one a sample period before
+// it; check() keeps only the last 4 entries, so the 10 ms poll must keep up.
 void ppg_service(){
   if (!ppg_ok) return;
 
-  
   uint32_t now = millis();
   if ((int32_t)(now - ppg_next_ms) < 0) return;
   ppg_next_ms = now + PPG_PERIOD_MS;
 
-  
-  long ir  = (long)ppg.getIR();
-  long red = (long)ppg.getRed();
-
-  
-  if (ir > PPG_IR_HIGH && ppg_irDrive > 0x08) {
-    ppg_irDrive -= 0x08; ppg.setPulseAmplitudeIR(ppg_irDrive);
-  } else if (ir < PPG_IR_LOW && ppg_irDrive < 0xF0) {
-    ppg_irDrive += 0x08; ppg.setPulseAmplitudeIR(ppg_irDrive);
-  }
-
-  
-  const float ALPHA_DC = 0.02f;             
-  dc_ir = (1.0f-ALPHA_DC)*dc_ir + ALPHA_DC*(float)ir;
-  float ac_ir = (float)ir - dc_ir;
-
-  
-  static float ac_abs_avg = 0.0f;           
-  const float ALPHA_ACABS = 0.10f;
-  ac_abs_avg = (1.0f-ALPHA_ACABS)*ac_abs_avg + ALPHA_ACABS*fabsf(ac_ir);
-
-  static int yes_cnt = 0, no_cnt = 0;
-  bool cond_on  = (dc_ir > DC_CONTACT_MIN) && (ac_abs_avg > AC_CONTACT_MIN);
-  bool cond_off = (dc_ir < DC_LOSS_MIN)    || (ac_abs_avg < AC_LOSS_MIN);
-
-  if (cond_on)  { yes_cnt++; no_cnt = 0; } else { yes_cnt = 0; }
-  if (cond_off) { no_cnt++;  yes_cnt = 0; } else { /* keep */ }
-
-  if (!ppg_contact && yes_cnt >= CONTACT_ON_SAMPLES)  ppg_contact = true;   
-  if ( ppg_contact && no_cnt  >= CONTACT_OFF_SAMPLES) {                     
-    ppg_contact = false;
-    ppg_rateSpot = 0; ppg_rateFilled = 0; ppg_bpm = 0; ppg_bpm_avg = 0;     
-
-  if (!ppg_contact && ppg_irDrive != PPG_DRIVE_MIN) {
-  ppg_irDrive = PPG_DRIVE_MIN;  
-  ppg.setPulseAmplitudeIR(ppg_irDrive);
-}
-
-
-  ppg_env = (1.0f-PPG_ENV_ALPHA)*ppg_env + PPG_ENV_ALPHA*fabsf(ac_ir);
-  float thr = PPG_THR_RATIO * ppg_env;
-
-  
-  if (ppg_contact &&
-      ac_ir > thr && ppg_prev_ac <= thr &&
-      (now - ppg_lastBeat) > PPG_REFRACT_MS) {
-
-    unsigned long beatMs = now - ppg_lastBeat;
-    ppg_lastBeat = now;
-
-    if (beatMs > 250 && beatMs < 2000) {    
-      float inst = 60000.0f / (float)beatMs;
-      ppg_bpm = inst;
-
-      ppg_rates[ppg_rateSpot++] = (byte)inst;
-      if (ppg_rateSpot >= 8) ppg_rateSpot = 0;
-      if (ppg_rateFilled < 8) ppg_rateFilled++;
-
-      int s = 0; for (int i=0;i<ppg_rateFilled;i++) s += ppg_rates[i];
-      ppg_bpm_avg = (ppg_rateFilled > 0) ? (s / ppg_rateFilled) : 0;
-    }
-  }
-  ppg_prev_ac = ac_ir;
-
-  
-  const float ALPHA_RMS = 0.05f;
-  dc_red = (1.0f-ALPHA_DC)*dc_red + ALPHA_DC*(float)red;
-  float ac_red = (float)red - dc_red;
-
-  rms_ir  = (1.0f-ALPHA_RMS)*rms_ir  + ALPHA_RMS*(ac_ir*ac_ir);
-  rms_red = (1.0f-ALPHA_RMS)*rms_red + ALPHA_RMS*(ac_red*ac_red);
-  spo2_n++;
-
-  if (spo2_n >= 100) { 
-    float acIR  = sqrtf(fmaxf(rms_ir,  0.0f));
-    float acRED = sqrtf(fmaxf(rms_red, 0.0f));
-
-    if (ppg_contact && dc_ir>15000 && dc_red>15000 && acIR>300 && acRED>150) {
-      float R  = (acRED/dc_red) / (acIR/dc_ir);
-      float sp = 104.0f - 17.0f * R;
-      if (sp < 70.0f) sp = 70.0f;
-      if (sp > 100.0f) sp = 100.0f;
-      spo2_value = sp;
-
-      float snr = (acIR>0) ? (acIR / sqrtf(dc_ir)) : 0.0f;
-      spo2_quality = (snr > 50) ? 3 : (snr > 20) ? 2 : 1;
-    } else {
-      spo2_value = NAN; spo2_quality = 0;
-    }
-    spo2_n = 0;
-  }
-
-  
-  if (!ppg_contact) {
-    ppg_rateSpot = 0; ppg_rateFilled = 0; ppg_bpm = 0; ppg_bpm_avg = 0;
-    ppg_env = 0; ppg_prev_ac = 0;
-  }
-}
+  uint8_t avg = cap_on ? 1 : PPG_AVG;
+  if (avg != ppg_avg) { ppg_configure(avg); ppg_fifo_ms = now; }
 
-void onwrist_update_robuste(float skinC, float airC, bool ppg_contact, float dc_ir, int motion) {
-  static float skin_lp = NAN, skin_lp_prev = NAN;
-  static uint32_t t_prev = 0, arm_t0 = 0;
-  uint32_t now = millis();
-
-  
-  if (!isnan(skinC)) skin_lp = isnan(skin_lp) ? skinC : (0.9f*skin_lp + 0.1f*skinC);
-  float dTdt = 0.0f;
-  if (!isnan(skin_lp)) {
-    if (!isnan(skin_lp_prev) && t_prev) {
-      float dt = (now - t_prev) / 1000.0f; if (dt < 0.5f) dt = 0.5f;
-      dTdt = (skin_lp - skin_lp_prev) / dt;
-    }
-    skin_lp_prev = skin_lp;
+  ppg.check();
+  int n = ppg.available();
+  if (!n) {
+    if (now - ppg_fifo_ms > 250) { health_note(HL_PPG, false); ppg_fifo_ms = now; }
+    return;
   }
-  t_prev = now;
-
-  bool skinOK = !isnan(skin_lp) && skin_lp > 20.0f && skin_lp < 45.0f;
-  bool airOK  = !isnan(airC);
-  float dSA   = (skinOK && airOK) ? (skin_lp - airC) : NAN; 
-  bool near_skin_ppg = ppg_contact || (dc_ir > 20000);      
-
-  
-  float s = 0.0f;
-  if (skinOK && skin_lp >= 29.0f && skin_lp <= 36.5f) s += 0.35f;             
-  if (!isnan(dSA) && dSA > 3.0f)                    s += 0.35f;               
-  else if (!isnan(dSA) && dSA > 1.0f)               s += 0.15f;               
-  if (dTdt > 0.03f)                                 s += 0.15f;               
-  if (near_skin_ppg)                                s += 0.35f;               
-  if (motion)                                       s -= 0.10f;               
-  if (s < 0) s = 0; if (s > 1) s = 1;
-
-  
-  static float s_lp = 0.0f;
-  s_lp = 0.8f*s_lp + 0.2f*s;                        
-
-  if (!onWrist) {
-    if (s_lp >= 0.60f) { if (!arm_t0) arm_t0 = now; if (now - arm_t0 > 15000) onWrist = true; }
-    else arm_t0 = 0;
-  } else {
-    if (s_lp <= 0.35f) { onWrist = false; arm_t0 = 0; }
+  ppg_fifo_ms = now;
+  uint32_t per_us = 10000u * ppg_avg, t_read = micros(), t_us = t_read - (uint32_t)(n - 1) * per_us;
+  bool drive = false;
+  for (; ppg.available(); ppg.nextSample(), t_us += per_us) {
+    long ir  = (long)ppg.getFIFOIR();
+    long red = (long)ppg.getFIFORed();
+    if ((int32_t)(t_us - ppg_last_us) <= 0) t_us = ppg_last_us + per_us;   // overlap with the last drain
+    ppg_last_us = t_us;
+    health_note(HL_PPG, ir || red);
+    cap_ppg(t_us, (uint32_t)ir, (uint32_t)red);
+    drive |= ppg_process(ir, red, now - (t_read - t_us) / 1000);
   }
 
-  
-  onwrist_score = s_lp;
-  onwrist_dSA   = dSA;
-  onwrist_dTdt  = dTdt;
+  if (drive) ppg.setPulseAmplitudeIR(ppg_irDrive);
+  state_publish_ppg(now);
+  boot_first_sample();
 }
 
 void ambient_update(float skinC) {
   if (!bme_ok) { env_c_out=NAN; rh_out_corr=NAN; hpa_out=NAN; return; }
 
-  
   bme->takeForcedMeasurement();
   float T_bme = bme->readTemperature();
   float RH_raw = bme->readHumidity();
-  hpa_out = bme->readPressure() / 100.0f;
-
-  
-  if (isnan(T_floor)) T_floor = T_bme;
-  if (T_bme < T_floor) T_floor += K_DOWN * (T_bme - T_floor);
-  else                 T_floor += K_UP   * (T_bme - T_floor);
-  if (T_floor > T_bme) T_floor = T_bme;
-
-  float T_air_est = T_floor;
-
-  
-  if (isnan(T_air_est_prev)) T_air_est_prev = T_air_est;
-  T_air_est = (1.0f - ALPHA_SMOOTH) * T_air_est_prev + ALPHA_SMOOTH * T_air_est;
-  T_air_est_prev = T_air_est;
-
-  
-  float T_air_final = T_air_est + T_FIXED_OFFSET;
-
-  
-  float RH_corr  = rh_retarget(RH_raw, T_bme, T_air_final);
-  float RH_final = RH_GAIN * RH_corr + RH_OFFSET;
-  if (RH_final < 0) RH_final = 0; if (RH_final > 100) RH_final = 100;
-
-  
-  env_c_out   = T_air_final;   
-  rh_out_corr = RH_final;      
-}
-
-void update_fall_and_unconscious(float amag, float gyro_sum,
-                                 Posture posture, int activity,
-                                 int bpm_pub, int spo2_pub,
-                                 bool ppg_has_contact, uint32_t now) {
-  static uint32_t last_impact_mark = 0;
-  bool impact = (amag > IMPACT_G * G) && ((now - last_impact_mark) > IMPACT_LOCK_MS);
-  if (impact) {
-    t_impact_ms = now;
-    last_impact_mark = now;
-    Serial.printf("[FALL] impact! amag=%.2f g=%.2f\n", amag, amag/9.81f);
-  }
-
-  
-  static Posture prev_post = POST_UNKNOWN;
-  if (posture == POST_LYING) {
-    if (prev_post != POST_LYING) t_lying_since_ms = now;
-  } else {
-    t_lying_since_ms = 0;
-  }
-  prev_post = posture;
-
-  bool had_recent_impact = (t_impact_ms && (now - t_impact_ms) < 8000);
-  bool lying_confirmed   = (t_lying_since_ms && (now - t_lying_since_ms) > LYING_CONFIRM_MS);
-  bool inactive_enough   = (still_ms >= INACT_AFTER_MS);
-  bool soft_drop         = ((now - t_last_upright_ms) < 2000) && lying_confirmed;
-
-  fall_event = ((had_recent_impact || soft_drop) && inactive_enough);
-
-  
-  float s = 0.0f;
-  if (lying_confirmed) s += 0.35f;
-  if (inactive_enough) s += 0.35f;
-
-  bool hr_bad   = (bpm_pub <= 0 || bpm_pub < HR_BRADY);
-  bool spo2_bad = (spo2_pub >= 0 && spo2_pub < SPO2_LOW);
-  if (hr_bad)   s += 0.20f;
-  if (spo2_bad) s += 0.35f;
-
-  if (!ppg_has_contact) s -= 0.10f;
-
-  if (s < 0) s = 0; if (s > 1) s = 1;
-  unconscious_score = 0.8f * unconscious_score + 0.2f * s;
-
-  static uint32_t t_score_high = 0;
-  if (unconscious_score >= 0.75f) {
-    if (!t_score_high) t_score_high = now;
-    unconscious = ((now - t_score_high) > UNCON_MIN_MS);
-  } else {
-    t_score_high = 0;
-    if (still_ms < 500 || posture != POST_LYING) unconscious = false;
-  }
-
-  
-  static uint32_t next_dbg = 0;
-  if ((int32_t)(now - next_dbg) >= 0) {
-    next_dbg = now + 1000;
-    Serial.printf("[FALL] hadImp=%d lying=%d inactive=%d | still_ms=%u fall=%d | a_hp=%.2f steps=%lu act=%d\n",
-      (int)had_recent_impact, (int)lying_confirmed, (int)inactive_enough,
-      (unsigned)still_ms, (int)fall_event, a_par_hp,
-      (unsigned long)step_count, (int)activity_state);
-  }
+  float hpa = bme->readPressure() / 100.0f;
+  // Lost transfers decode to out-of-range compensation results, not NAN.
+  health_note(HL_BME, T_bme > -40.0f && T_bme < 85.0f && hpa > 300.0f && hpa < 1100.0f);
+  cap_env(micros(), T_bme, RH_raw, hpa, skinC);
+  ambient_process(T_bme, RH_raw, hpa);
 }
 
 struct SimPI {
@@ -1192,51 +1225,61 @@ void simpi_update(float envC){
 }
 
 void loop() {
-  net_loop();
+  ctrl_queue_service(ctrl_dispatch);
+  sun_reply_service();
+  hist_reply_service();
+  alert_service(millis());
+  uplink_service(millis());
   alerts_update();
   static uint32_t last = 0;
   uint32_t now = millis();
 
+  {
+    PmHold bus(PM_LOCK_BUS);
 #if BIOMETRICS_ENABLED
-  ppg_service();
+    ppg_service();
 #endif
-  si115_service();
-
+    health_run(HL_SI, si_i2c_xfers, si_errors, [] { si115_service(); });
+    if (sgp_ok) health_run(HL_SGP, sgp_i2c_xfers, sgp_errors, [&] { voc_service(now); });
+    if (scd_ok) health_run(HL_SCD, scd_i2c_xfers, scd_errors, [&] { scd_service(now); });
+    health_service(now);
+  }
+  capture_service(now);
+  tlog_service(now);
+  mem_service(now);
+  if (init_finished()) {
+    topo_save(); boot_report();
+    if (topo.mpu_bus >= 0) HEALTH_DEVS[HL_MPU].bus = topo.mpu_bus;
+    health_begin(now);
+  }
 
   if (mpu_ok && (int32_t)(now - imu_next_ms) >= 0) {
     imu_next_ms = now + IMU_PERIOD_MS;
+    PmHold bus(PM_LOCK_BUS);
 
     
-    read_mpu(ax_g, ay_g, az_g, gx_g, gy_g, gz_g, amag_g);
+    if (read_mpu(ax_g, ay_g, az_g, gx_g, gy_g, gz_g, a2_g)) boot_first_sample();
+    cap_imu(micros(), ax_g, ay_g, az_g, gx_g, gy_g, gz_g);
 
-    
-    gyro_sum_g = (isnan(gx_g)||isnan(gy_g)||isnan(gz_g)) ? 0.0f
-                                                         : (fabsf(gx_g)+fabsf(gy_g)+fabsf(gz_g));
-    float accel_dyn_g = (!isnan(amag_g)) ? fabsf(amag_g - 9.81f) : 0.0f;
-    motion_g = (accel_dyn_g > 0.6f || gyro_sum_g > 0.6f) ? 1 : 0;
+    imu_process(ax_g, ay_g, az_g, gx_g, gy_g, gz_g, a2_g, now);
 
+    
     face_g = 0.0f;
-    if (!isnan(amag_g) && amag_g > 5.0f) {
-      float cosTheta = (-az_g) / amag_g;   
+    if (orient.init) {
+      float cosTheta = SUN_AXIS_SIGN * up_z;   
       if (cosTheta < 0) cosTheta = 0;
       if (cosTheta > 1) cosTheta = 1;
       face_g = cosTheta;                   
     }
+    const float iv[7] = { ax_g, ay_g, az_g, gx_g, gy_g, gz_g, a2_g };
+    state_publish_imu(now, iv, face_g, true);
 
-    
-    update_steps_activity_posture(ax_g, ay_g, az_g, gx_g, gy_g, gz_g, amag_g, now);
+    ImuState im = st_imu.get();
+    alert_note(EV_FALL, im.fall, 0.0f);
+    alert_note(EV_UNCONSCIOUS, im.unconscious, im.unconscious_score);
 
-    
-    update_fall_and_unconscious(
-      amag_g, gyro_sum_g,
-      posture_state, activity_state,
-      /* bpm_pub  */ ppg_contact ? ((int)roundf(ppg_bpm/5.0f)*5) : 0,
-      /* spo2_pub */ (isnan(spo2_value) ? -1 : (int)roundf(spo2_value)),
-      /* ppg contact */ ppg_contact,
-      now
-    );
     static uint32_t last_fall_play = 0;
-if (fall_event && (millis() - last_fall_play > 10000)) { 
+if (im.fall && (millis() - last_fall_play > 10000)) { 
   alerts_play_kind(ALERT_FALL);
   last_fall_play = millis();
 }
@@ -1245,6 +1288,9 @@ if (fall_event && (millis() - last_fall_play > 10000)) {
   
   if (now - last >= 1000) {
     last = now;
+    PmHold bus(PM_LOCK_BUS);
+    PpgState pp = st_ppg.get();
+    ImuState im = st_imu.get();
 
     
 #if STRICT_PI
@@ -1270,21 +1316,18 @@ if (fall_event && (millis() - last_fall_play > 10000)) {
 
    
     float rh_scd = NAN;
-    float co2    = NAN;
-    if ((int32_t)(now - scd_next_read_ms) >= 0) {
-      float rh_tmp = NAN;
-      float co2_new = read_co2_ppm(&rh_tmp);           
-      if (!isnan(co2_new)) { co2 = co2_new; rh_scd = rh_tmp; scd_next_read_ms = now + 5500; }
-      else                 { scd_next_read_ms = now + 500; }
-    }
+    float co2    = read_co2_ppm(&rh_scd);
     
     float rh_out = isnan(rh) ? rh_scd : rh;
 
     
-    sun_score = (!si_covered ? (sun_proxy * face_g) : 0.0f);
-    if (motion_g) sun_score *= 0.8f;   
+    si115_update_proxy();
+    sun_score = (!si_covered ? (sun_proxy * im.face) : 0.0f);
+    if (im.motion) sun_score *= 0.8f;   
     sun_touch = (sun_score > 0.35f);
-    sun_dose += (uint32_t)(sun_score * 100);
+    sun_dose_tick(sun_proxy, sun_score, uv_index, sun_touch);
+    sun_dose = sun_day.dose;
+    sun_checkpoint_service(now);
 
     
 #if STRICT_PI
@@ -1293,124 +1336,174 @@ if (fall_event && (millis() - last_fall_play > 10000)) {
     onwrist_dSA   = NAN;
     onwrist_dTdt  = 0.0f;
 #else
-    onwrist_update_robuste(skin_raw, envC, ppg_contact, dc_ir, motion_g);
+    onwrist_update_robuste(skin_raw, envC, pp.contact, pp.dc_ir, im.motion, now);
+#endif
+    alert_note(EV_CARDIAC, cardiac_update(pp.contact, pp.bpm, now), pp.bpm);
+
+    {
+      static uint32_t steps_prev = 0;
+      uint32_t steps_now = im.steps;
+      float row[TS_NMETRIC];
+#if STRICT_PI && SIM_PI
+      row[TS_HR]   = simpi.bpm;
+      row[TS_SPO2] = simpi.spo2;
+      row[TS_SKIN] = simpi.skin;
+#else
+      row[TS_HR]   = (pp.contact && pp.bpm > 0) ? pp.bpm : NAN;
+      row[TS_SPO2] = pp.spo2;
+      row[TS_SKIN] = skin;
+#endif
+      row[TS_ENV_C]  = envC;
+      row[TS_RH]     = rh_out;
+      row[TS_HPA]    = hpa;
+      row[TS_CO2]    = co2;
+      row[TS_VOC]    = voc_idx;
+      row[TS_SUN]    = sun_score;
+      row[TS_STEPS]  = (float)(steps_now - steps_prev);
+      row[TS_MOTION] = (float)im.motion;
+      steps_prev = steps_now;
+      ts_add(row, (onWrist ? TS_F_ONWRIST : 0) | (im.motion ? TS_F_MOTION : 0) | (sun_touch ? TS_F_TOUCH : 0));
+      if (!push_win.t0_ms) pushwin_reset(push_win, now, sun_dose);
+#if STRICT_PI && !SIM_PI
+      row[TS_HR] = row[TS_SPO2] = row[TS_SKIN] = NAN;   // not published, so not in the window either
 #endif
+      pushwin_add(push_win, row);
+    }
+
+    {
+      EnvState e;
+      e.t_ms = now;
+      e.skin_raw = skin_raw; e.skin = skin; e.env_c = envC; e.rh = rh_out; e.hpa = hpa;
+      e.co2 = co2; e.voc = voc_idx; e.voc_sraw = voc_sraw;
+      e.sun_proxy = sun_proxy; e.sun_score = sun_score; e.sun_dose = sun_dose;
+      e.vis = si_vis; e.ir = si_ir; e.si_ok = si_ok; e.covered = si_covered; e.outdoor = si_outdoor;
+      e.sun_touch = sun_touch; e.on_wrist = onWrist;
+      e.ow_score = onwrist_score; e.ow_dSA = onwrist_dSA; e.ow_dTdt = onwrist_dTdt;
+      st_env.publish(e);
+    }
+
+    if (now - last_stats_ms >= STATS_PERIOD_MS) {
+      last_stats_ms = now;
+      stats_emit();
+    }
+
+    // Everything below serializes published snapshots only.
+    SensorState snap;
+    state_read(snap);
 
 
 #if DEMO_MODE
 
     uint32_t ts_pub   = (now/1000/60)*60;  
-    float    envC_pub = qf(envC, 0.5f);
-    float    rh_pub   = qf(rh_out, 1.0f);
-    float    hpa_pub  = qf(hpa, 1.0f);
-    float    skin_pub = qf(skin, 0.5f);
-    int      bpm_pub  = ppg_contact ? ((int)roundf(ppg_bpm/5.0f)*5) : 0;
-    int      spo2_pub = isnan(spo2_value) ? -1 : (int)qf(spo2_value, 1.0f);
-    int      spo2q_pub= (int)spo2_quality;
-    int      ppg_drive_lvl = bucket_ppg_drive(ppg_irDrive);
-    int      voc_pub  = isnan(voc_idx) ? -1 : (int)qf(voc_idx, 5.0f);
-    int      co2_pub  = isnan(co2) ? -1 : (int)(roundf(co2/50.0f)*50);
-    float    dSA_pub  = qf(onwrist_dSA, 0.01f);
-    float    dTdt_pub = qf(onwrist_dTdt, 0.001f);
-    float    sun_proxy_pub = qf(sun_proxy, 0.01f);
-    float    sun_score_pub = qf(sun_score, 0.01f);
-
-    Serial.print("{");
-    Serial.print("\"ts\":");        Serial.print(ts_pub);                    Serial.print(",");
-    Serial.print("\"env_c\":");     Serial.print(isnan(envC_pub)?String("null"):String(envC_pub,2)); Serial.print(",");
-    Serial.print("\"rh\":");        Serial.print(isnan(rh_pub)?String("null"):String(rh_pub,0));     Serial.print(",");
-    Serial.print("\"hpa\":");       Serial.print(isnan(hpa_pub)?String("null"):String(hpa_pub,0));   Serial.print(",");
+    float    envC_pub = qf(snap.env.env_c, 0.5f);
+    float    rh_pub   = qf(snap.env.rh, 1.0f);
+    float    hpa_pub  = qf(snap.env.hpa, 1.0f);
+    float    skin_pub = qf(snap.env.skin, 0.5f);
+    int      bpm_pub  = snap.ppg.contact ? ((int)roundf(snap.ppg.bpm/5.0f)*5) : 0;
+    int      spo2_pub = isnan(snap.ppg.spo2) ? -1 : (int)qf(snap.ppg.spo2, 1.0f);
+    int      spo2q_pub= (int)snap.ppg.spo2_q;
+    int      ppg_drive_lvl = bucket_ppg_drive(snap.ppg.ir_drive);
+    int      voc_pub  = isnan(snap.env.voc) ? -1 : (int)qf(snap.env.voc, 5.0f);
+    int      co2_pub  = isnan(snap.env.co2) ? -1 : (int)(roundf(snap.env.co2/50.0f)*50);
+    float    dSA_pub  = qf(snap.env.ow_dSA, 0.01f);
+    float    dTdt_pub = qf(snap.env.ow_dTdt, 0.001f);
+    float    sun_proxy_pub = qf(snap.env.sun_proxy, 0.01f);
+    float    sun_score_pub = qf(snap.env.sun_score, 0.01f);
+
+    tel.print("{");
+    tel.print("\"ts\":");        tel.print(ts_pub);                    tel.print(",");
+    tel.print("\"env_c\":");     tel.print(isnan(envC_pub)?String("null"):String(envC_pub,2)); tel.print(",");
+    tel.print("\"rh\":");        tel.print(isnan(rh_pub)?String("null"):String(rh_pub,0));     tel.print(",");
+    tel.print("\"hpa\":");       tel.print(isnan(hpa_pub)?String("null"):String(hpa_pub,0));   tel.print(",");
 
     
   #if STRICT_PI && SIM_PI
-    Serial.print("\"skin_c\":");    Serial.print(simpi.skin,2);  Serial.print(",");
-    Serial.print("\"bpm\":");       Serial.print(simpi.bpm);     Serial.print(",");
-    Serial.print("\"spo2\":");      Serial.print(simpi.spo2);    Serial.print(",");
-    Serial.print("\"spo2_q\":");    Serial.print(2);             Serial.print(",");
-    Serial.print("\"ppg_contact\":");Serial.print(simpi.contact?1:0); Serial.print(",");
-    Serial.print("\"ppg_drive_lvl\":");Serial.print(simpi.drive_lvl);  Serial.print(",");
+    tel.print("\"skin_c\":");    tel.print(simpi.skin,2);  tel.print(",");
+    tel.print("\"bpm\":");       tel.print(simpi.bpm);     tel.print(",");
+    tel.print("\"spo2\":");      tel.print(simpi.spo2);    tel.print(",");
+    tel.print("\"spo2_q\":");    tel.print(2);             tel.print(",");
+    tel.print("\"ppg_contact\":");tel.print(simpi.contact?1:0); tel.print(",");
+    tel.print("\"ppg_drive_lvl\":");tel.print(simpi.drive_lvl);  tel.print(",");
   #elif STRICT_PI
-    Serial.print("\"skin_c\":null,");
-    Serial.print("\"bpm\":0,");
-    Serial.print("\"spo2\":null,");
-    Serial.print("\"spo2_q\":0,");
-    Serial.print("\"ppg_contact\":0,");
+    tel.print("\"skin_c\":null,");
+    tel.print("\"bpm\":0,");
+    tel.print("\"spo2\":null,");
+    tel.print("\"spo2_q\":0,");
+    tel.print("\"ppg_contact\":0,");
   #else
-    Serial.print("\"skin_c\":");    Serial.print(isnan(skin_pub)?String("null"):String(skin_pub,2)); Serial.print(",");
-    Serial.print("\"bpm\":");       Serial.print(bpm_pub);                         Serial.print(",");
-    Serial.print("\"spo2\":");      Serial.print((spo2_pub<0)?String("null"):String(spo2_pub)); Serial.print(",");
-    Serial.print("\"spo2_q\":");    Serial.print(spo2q_pub);                       Serial.print(",");
-    Serial.print("\"ppg_contact\":");Serial.print(ppg_contact?1:0);                 Serial.print(",");
-    Serial.print("\"ppg_drive_lvl\":");Serial.print(ppg_drive_lvl);                 Serial.print(",");
+    tel.print("\"skin_c\":");    tel.print(isnan(skin_pub)?String("null"):String(skin_pub,2)); tel.print(",");
+    tel.print("\"bpm\":");       tel.print(bpm_pub);                         tel.print(",");
+    tel.print("\"spo2\":");      tel.print((spo2_pub<0)?String("null"):String(spo2_pub)); tel.print(",");
+    tel.print("\"spo2_q\":");    tel.print(spo2q_pub);                       tel.print(",");
+    tel.print("\"ppg_contact\":");tel.print(snap.ppg.contact?1:0);                 tel.print(",");
+    tel.print("\"ppg_drive_lvl\":");tel.print(ppg_drive_lvl);                 tel.print(",");
   #endif
 
   
-    Serial.print("\"voc\":");       Serial.print((voc_pub<0)?String("null"):String(voc_pub)); Serial.print(",");
-    Serial.print("\"co2\":");       Serial.print((co2_pub<0)?String("null"):String(co2_pub));
+    tel.print("\"voc\":");       tel.print((voc_pub<0)?String("null"):String(voc_pub)); tel.print(",");
+    tel.print("\"co2\":");       tel.print((co2_pub<0)?String("null"):String(co2_pub));
 
     
-    Serial.print(",\"motion\":");   Serial.print(motion_g);
-    Serial.print(",\"vis\":");      Serial.print(si_ok ? (int)si_vis : -1);
-    Serial.print(",\"ir\":");       Serial.print(si_ok ? (int)si_ir  : -1);
-    Serial.print(",\"covered\":");  Serial.print(si_covered?1:0);
-    Serial.print(",\"outdoor\":");  Serial.print(si_outdoor?1:0);
-    Serial.print(",\"sun_proxy\":");Serial.print(sun_proxy_pub,2);
-    Serial.print(",\"sun_dose\":"); Serial.print(sun_dose);
-    Serial.print(",\"sun_score\":");Serial.print(sun_score_pub,2);
-    Serial.print(",\"sun_touch\":");Serial.print(sun_touch?1:0);
+    tel.print(",\"motion\":");   tel.print(snap.imu.motion);
+    tel.print(",\"vis\":");      tel.print(snap.env.si_ok ? (int)snap.env.vis : -1);
+    tel.print(",\"ir\":");       tel.print(snap.env.si_ok ? (int)snap.env.ir  : -1);
+    tel.print(",\"covered\":");  tel.print(snap.env.covered?1:0);
+    tel.print(",\"outdoor\":");  tel.print(snap.env.outdoor?1:0);
+    tel.print(",\"sun_proxy\":");tel.print(sun_proxy_pub,2);
+    tel.print(",\"sun_dose\":"); tel.print(snap.env.sun_dose);
+    tel.print(",\"sun_score\":");tel.print(sun_score_pub,2);
+    tel.print(",\"sun_touch\":");tel.print(snap.env.sun_touch?1:0);
 
     
   #if STRICT_PI && SIM_PI
-    Serial.print(",\"on_wrist\":"); Serial.print(simpi.on_wrist?1:0);
-    Serial.print(",\"dSA\":");      Serial.print(simpi.dSA,2);
-    Serial.print(",\"dTdt\":");     Serial.print(simpi.dTdt,3);
+    tel.print(",\"on_wrist\":"); tel.print(simpi.on_wrist?1:0);
+    tel.print(",\"dSA\":");      tel.print(simpi.dSA,2);
+    tel.print(",\"dTdt\":");     tel.print(simpi.dTdt,3);
   #elif STRICT_PI
-    Serial.print(",\"on_wrist\":0");
+    tel.print(",\"on_wrist\":0");
   #else
-    Serial.print(",\"on_wrist\":"); Serial.print(onWrist?1:0);
-    Serial.print(",\"dSA\":");      Serial.print(isnan(dSA_pub)?String("null"):String(dSA_pub,2));
-    Serial.print(",\"dTdt\":");     Serial.print(dTdt_pub,3);
+    tel.print(",\"on_wrist\":"); tel.print(snap.env.on_wrist?1:0);
+    tel.print(",\"dSA\":");      tel.print(isnan(dSA_pub)?String("null"):String(dSA_pub,2));
+    tel.print(",\"dTdt\":");     tel.print(dTdt_pub,3);
   #endif
 
   #if DEMO_LOCATION
-    Serial.print(",\"gps\":{\"lat\":"); Serial.print(DEMO_LAT, 6);
-    Serial.print(",\"lon\":");          Serial.print(DEMO_LON, 6);
-    Serial.print("}");
-    Serial.print(",\"privacy\":{\"use_demo_location\":true}");
+    tel.print(",\"gps\":{\"lat\":"); tel.print(DEMO_LAT, 6);
+    tel.print(",\"lon\":");          tel.print(DEMO_LON, 6);
+    tel.print("}");
+    tel.print(",\"privacy\":{\"use_demo_location\":true}");
   #endif
 
   
-    Serial.print(",\"steps\":");    Serial.print(step_count);
-    Serial.print(",\"activity\":\"");
-    switch (activity_state) {
-      case ACT_WALK: Serial.print("walk"); break;
-      case ACT_RUN:  Serial.print("run");  break;
-      default:       Serial.print("still"); break;
+    tel.print(",\"steps\":");    tel.print(snap.imu.steps);
+    tel.print(",\"activity\":\"");
+    switch (snap.imu.activity) {
+      case ACT_WALK: tel.print("walk"); break;
+      case ACT_RUN:  tel.print("run");  break;
+      default:       tel.print("still"); break;
     }
-    Serial.print("\",");
-
-    Serial.print("\"posture\":\"");
-    switch (posture_state) {
-      case POST_STANDING: Serial.print("standing"); break;
-      case POST_SITTING:  Serial.print("sitting");  break;
-      case POST_LYING:    Serial.print("lying");    break;
-      default:            Serial.print("unknown");  break;
+    tel.print("\",");
+
+    tel.print("\"posture\":\"");
+    switch (snap.imu.posture) {
+      case POST_STANDING: tel.print("standing"); break;
+      case POST_SITTING:  tel.print("sitting");  break;
+      case POST_LYING:    tel.print("lying");    break;
+      default:            tel.print("unknown");  break;
     }
-    Serial.print("\"");
+    tel.print("\"");
 
     
-    Serial.print(",\"fall_event\":");       Serial.print(fall_event ? 1 : 0);
-    Serial.print(",\"unconscious\":");      Serial.print(unconscious ? 1 : 0);
-    Serial.print(",\"unconscious_score\":");Serial.print(unconscious_score, 2);
+    tel.print(",\"fall_event\":");       tel.print(snap.imu.fall ? 1 : 0);
+    tel.print(",\"unconscious\":");      tel.print(snap.imu.unconscious ? 1 : 0);
+    tel.print(",\"unconscious_score\":");tel.print(snap.imu.unconscious_score, 2);
 
-    Serial.print(",\"imu_ok\":"); Serial.print(mpu_ok?1:0);
+    tel.print(",\"imu_ok\":"); tel.print(snap.imu.ok?1:0);
 
-    Serial.println("}");
+    tel.println("}");
 
     
-    if (millis() - last_push_ms >= PUSH_PERIOD_MS) {
-      last_push_ms = millis();
-
+    {
       float skin_to_send =
       #if STRICT_PI && SIM_PI
         simpi.skin;
@@ -1435,76 +1528,101 @@ if (fall_event && (millis() - last_fall_play > 10000)) {
       double lat_send = DEMO_LAT;
       double lon_send = DEMO_LON;
 
-      String json = String("{")
-        + "\"userId\":\"" + String(USER_ID) + "\","
-        + "\"hr\":"         + String(hr_to_send) + ","
-        + "\"spo2\":"       + String(spo2_to_send) + ","
-        + "\"temp_skin\":"  + f2json(skin_to_send) + ","
-        + "\"env_c\":"      + f2json(envC) + ","
-        + "\"co2\":"        + (co2_pub < 0 ? String("null") : String(co2_pub)) + ","
-        + "\"voc\":"        + (voc_pub < 0 ? String("null") : String(voc_pub)) + ","
-        + "\"sun_touch\":"  + String(sun_touch ? 1 : 0) + ","
-        + "\"sun_proxy\":"  + f2json(sun_proxy_pub, 2) + ","
-        + "\"motion\":"     + String(motion_g ? 1 : 0) + ","  
-        + "\"gps\":{\"lat\":" + String(lat_send, 6) + ",\"lon\":" + String(lon_send, 6) + "}"
-        + "}";
-
-      net_send(json);
-      ctrl_serial_poll(); 
+      // Send-on-delta per transport (include/report_policy.h), on the
+      // published values.
+      const float rv[TF_N] = {
+        (float)hr_to_send, (float)spo2_to_send, skin_to_send, envC_pub,
+        co2_pub < 0 ? NAN : (float)co2_pub, voc_pub < 0 ? NAN : (float)voc_pub,
+        snap.env.sun_touch ? 1.0f : 0.0f, sun_proxy_pub, snap.imu.motion ? 1.0f : 0.0f,
+        (float)lat_send, (float)lon_send
+      };
+      TelemetryFrame tf = {
+        USER_ID, hr_to_send, spo2_to_send, skin_to_send, envC_pub, co2_pub, voc_pub,
+        snap.env.sun_touch, sun_proxy_pub, nullptr, snap.imu.motion != 0, lat_send, lon_send,
+        now, clock_epoch(), nullptr, 0
+      };
+      for (int i = 0; i < RP_NLANES; ++i) {
+        if (i == RP_BLE && !ble_connected()) continue;
+        uint16_t mask = rp_eval(rp_lanes[i], rv, now);
+        if (!mask) continue;
+        mem_tag = MEM_TELEM;
+        static char win[512], json[1280];
+        String sun_js;
+        tf.fields = mask; tf.sun = nullptr; tf.win = nullptr;
+        if (i == RP_WIFI) {                      // the backend also gets the window
+          sun_js = sun_summary_json(); tf.sun = sun_js.c_str();
+          if (pushwin_format(win, sizeof(win), push_win, now, snap.env.sun_dose, PW_DEMO_STEP)) tf.win = win;
+        }
+        size_t n = telemetry_format(json, sizeof(json), tf);
+        if (n) {
+          if (i == RP_WIFI) { uplink_enqueue(String(json)); pushwin_reset(push_win, now, snap.env.sun_dose); }
+          else ble_notify_text(String(json));
+          rp_commit(rp_lanes[i], rv, mask, now, n);
+        }
+        mem_tag = MEM_CORE;
+      }
     }
 #else
 
-  Serial.print("{");
-
-  Serial.print("\"ts\":");        Serial.print(now/1000);                                  Serial.print(",");
-  Serial.print("\"env_c\":");     Serial.print(isnan(envC)?String("null"):String(envC,2)); Serial.print(",");
-  Serial.print("\"rh\":");        Serial.print(isnan(rh_out)?String("null"):String(rh_out,1)); Serial.print(",");
-  Serial.print("\"hpa\":");       Serial.print(isnan(hpa)?String("null"):String(hpa,1));   Serial.print(",");
-  Serial.print("\"skin_c\":");    Serial.print(isnan(skin)?String("null"):String(skin,2)); Serial.print(",");
-  Serial.print("\"skin_raw\":");  Serial.print(isnan(skin_raw)?String("null"):String(skin_raw,2)); Serial.print(",");
-
-  Serial.print("\"bpm\":");       Serial.print(ppg_contact ? (int)ppg_bpm : 0);           Serial.print(",");
-  Serial.print("\"bpm_avg\":");   Serial.print(ppg_contact ? ppg_bpm_avg : 0);            Serial.print(",");
-  Serial.print("\"spo2\":");      Serial.print(isnan(spo2_value)?String("null"):String(spo2_value,0)); Serial.print(",");
-  Serial.print("\"spo2_q\":");    Serial.print((int)spo2_quality);                        Serial.print(",");
-  Serial.print("\"ppg_contact\":");Serial.print(ppg_contact?1:0);                          Serial.print(",");
-  Serial.print("\"ppg_ir_dc\":"); Serial.print((int)dc_ir);                                Serial.print(",");
-  Serial.print("\"ppg_ir_drv\":");Serial.print(ppg_irDrive, HEX);                          Serial.print(",");
-
-  Serial.print("\"voc\":");       Serial.print(isnan(voc_idx)?String("null"):String(voc_idx,0)); Serial.print(",");
-  Serial.print("\"voc_sraw\":");  Serial.print((int)voc_sraw);                             Serial.print(",");
-
-  Serial.print("\"co2\":");       Serial.print(isnan(co2)?String("null"):String(co2,0));
-
-  Serial.print(",\"ax\":");       Serial.print(isnan(ax)?String("null"):String(ax,2));
-  Serial.print(",\"ay\":");       Serial.print(isnan(ay)?String("null"):String(ay,2));
-  Serial.print(",\"az\":");       Serial.print(isnan(az)?String("null"):String(az,2));
-  Serial.print(",\"gx\":");       Serial.print(isnan(gx)?String("null"):String(gx,2));
-  Serial.print(",\"gy\":");       Serial.print(isnan(gy)?String("null"):String(gy,2));
-  Serial.print(",\"gz\":");       Serial.print(isnan(gz)?String("null"):String(gz,2));
-  Serial.print(",\"a_mag\":");    Serial.print(isnan(amag)?String("null"):String(amag,2));
-
-  Serial.print(",\"motion\":");   Serial.print(motion);
-  Serial.print(",\"vis\":");      Serial.print(si_ok ? (int)si_vis : -1);
-  Serial.print(",\"ir\":");       Serial.print(si_ok ? (int)si_ir  : -1);
-  Serial.print(",\"sun_raw\":");  Serial.print((int)si_vis + (int)si_ir);
-  Serial.print(",\"covered\":");  Serial.print(si_covered?1:0);
-  Serial.print(",\"outdoor\":");  Serial.print(si_outdoor?1:0);
-  Serial.print(",\"sun_proxy\":");Serial.print(sun_proxy,2);
-  Serial.print(",\"sun_dose\":"); Serial.print(sun_dose);
-  Serial.print(",\"sun_score\":");Serial.print(sun_score,2);
-  Serial.print(",\"sun_touch\":");Serial.print(sun_touch?1:0);
-
-  Serial.print(",\"on_wrist\":"); Serial.print(onWrist?1:0);
-  Serial.print(",\"ow_score\":"); Serial.print(onwrist_score,2);
-  Serial.print(",\"dSA\":");      Serial.print(isnan(onwrist_dSA)?String("null"):String(onwrist_dSA,2));
-  Serial.print(",\"dTdt\":");     Serial.print(onwrist_dTdt,3);
-
-  Serial.print(",\"fall_event\":");       Serial.print(fall_event ? 1 : 0);
-  Serial.print(",\"unconscious\":");      Serial.print(unconscious ? 1 : 0);
-  Serial.print(",\"unconscious_score\":");Serial.print(unconscious_score, 2);
-
-  Serial.println("}");
+  tel.print("{");
+
+  tel.print("\"ts\":");        tel.print(now/1000);                                  tel.print(",");
+  tel.print("\"env_c\":");     tel.print(isnan(snap.env.env_c)?String("null"):String(snap.env.env_c,2)); tel.print(",");
+  tel.print("\"rh\":");        tel.print(isnan(snap.env.rh)?String("null"):String(snap.env.rh,1)); tel.print(",");
+  tel.print("\"hpa\":");       tel.print(isnan(snap.env.hpa)?String("null"):String(snap.env.hpa,1));   tel.print(",");
+  tel.print("\"skin_c\":");    tel.print(isnan(snap.env.skin)?String("null"):String(snap.env.skin,2)); tel.print(",");
+  tel.print("\"skin_raw\":");  tel.print(isnan(snap.env.skin_raw)?String("null"):String(snap.env.skin_raw,2)); tel.print(",");
+
+  tel.print("\"bpm\":");       tel.print(snap.ppg.contact ? (int)snap.ppg.bpm : 0);           tel.print(",");
+  tel.print("\"bpm_avg\":");   tel.print(snap.ppg.contact ? snap.ppg.bpm_avg : 0);            tel.print(",");
+  tel.print("\"spo2\":");      tel.print(isnan(snap.ppg.spo2)?String("null"):String(snap.ppg.spo2,0)); tel.print(",");
+  tel.print("\"spo2_q\":");    tel.print((int)snap.ppg.spo2_q);                        tel.print(",");
+  tel.print("\"ppg_contact\":");tel.print(snap.ppg.contact?1:0);                          tel.print(",");
+  tel.print("\"ppg_ir_dc\":"); tel.print((int)snap.ppg.dc_ir);                                tel.print(",");
+  tel.print("\"ppg_ir_drv\":");tel.print(snap.ppg.ir_drive, HEX);                          tel.print(",");
+
+  tel.print("\"voc\":");       tel.print(isnan(snap.env.voc)?String("null"):String(snap.env.voc,0)); tel.print(",");
+  tel.print("\"voc_sraw\":");  tel.print((int)snap.env.voc_sraw);                             tel.print(",");
+
+  tel.print("\"co2\":");       tel.print(isnan(snap.env.co2)?String("null"):String(snap.env.co2,0));
+
+  tel.print(",\"ax\":");       tel.print(isnan(snap.imu.ax)?String("null"):String(snap.imu.ax,2));
+  tel.print(",\"ay\":");       tel.print(isnan(snap.imu.ay)?String("null"):String(snap.imu.ay,2));
+  tel.print(",\"az\":");       tel.print(isnan(snap.imu.az)?String("null"):String(snap.imu.az,2));
+  tel.print(",\"gx\":");       tel.print(isnan(snap.imu.gx)?String("null"):String(snap.imu.gx,2));
+  tel.print(",\"gy\":");       tel.print(isnan(snap.imu.gy)?String("null"):String(snap.imu.gy,2));
+  tel.print(",\"gz\":");       tel.print(isnan(snap.imu.gz)?String("null"):String(snap.imu.gz,2));
+  tel.print(",\"a_mag\":");    tel.print(isnan(snap.imu.a2)?String("null"):String(sqrtf(snap.imu.a2),2));
+
+  tel.print(",\"motion\":");   tel.print(snap.imu.motion);
+  tel.print(",\"vis\":");      tel.print(snap.env.si_ok ? (int)snap.env.vis : -1);
+  tel.print(",\"ir\":");       tel.print(snap.env.si_ok ? (int)snap.env.ir  : -1);
+  tel.print(",\"sun_raw\":");  tel.print((int)snap.env.vis + (int)snap.env.ir);
+  tel.print(",\"covered\":");  tel.print(snap.env.covered?1:0);
+  tel.print(",\"outdoor\":");  tel.print(snap.env.outdoor?1:0);
+  tel.print(",\"sun_proxy\":");tel.print(snap.env.sun_proxy,2);
+  tel.print(",\"sun_dose\":"); tel.print(snap.env.sun_dose);
+  tel.print(",\"sun_score\":");tel.print(snap.env.sun_score,2);
+  tel.print(",\"sun_touch\":");tel.print(snap.env.sun_touch?1:0);
+
+  tel.print(",\"on_wrist\":"); tel.print(snap.env.on_wrist?1:0);
+  tel.print(",\"ow_score\":"); tel.print(snap.env.ow_score,2);
+  tel.print(",\"dSA\":");      tel.print(isnan(snap.env.ow_dSA)?String("null"):String(snap.env.ow_dSA,2));
+  tel.print(",\"dTdt\":");     tel.print(snap.env.ow_dTdt,3);
+
+  tel.print(",\"fall_event\":");       tel.print(snap.imu.fall ? 1 : 0);
+  tel.print(",\"unconscious\":");      tel.print(snap.imu.unconscious ? 1 : 0);
+  tel.print(",\"unconscious_score\":");tel.print(snap.imu.unconscious_score, 2);
+
+  tel.println("}");
 #endif
   }
+
+  // Sleep until the next sample is due; commands wake the loop early.
+  uint32_t due = last + 1000;
+  if (ppg_ok) due = pm_earliest(due, ppg_next_ms);
+  if (mpu_ok) due = pm_earliest(due, imu_next_ms);
+  due = pm_earliest(due, health_due(now));
+  int32_t wait = (int32_t)(due - millis());
+  pm_idle(wait > 0 ? (uint32_t)wait : 0);
 }
\ No newline at end of file
@@ -0,0 +1,151 @@
+// Host recorder for the firmware's raw capture mode (include/capture.h).
+//
+//   g++ -O2 -std=c++17 -I../../include soliris_rec.cpp -o soliris_rec
+//   ./soliris_rec /dev/ttyACM0 session.scap [--csv session]
+//
+// Turns capture on, writes every CRC-valid frame to a .scap file (scap.h),
+// and reports sequence gaps, CRC errors and the device's own drop counter.
+// Ctrl-C turns capture off and prints the summary. Passing a regular file
+// instead of a tty decodes a raw byte dump offline.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <time.h>
+#include "scap.h"
+
+static volatile sig_atomic_t stop = 0;
+static void on_sigint(int) { stop = 1; }
+
+static bool tty_raw(int fd) {
+  termios t;
+  if (tcgetattr(fd, &t) != 0) return false;
+  cfmakeraw(&t);
+  cfsetispeed(&t, B115200); cfsetospeed(&t, B115200);   // ignored by USB CDC
+  t.c_cc[VMIN] = 0; t.c_cc[VTIME] = 1;
+  return tcsetattr(fd, TCSANOW, &t) == 0;
+}
+
+static void send_cmd(int fd, const char* s) {
+  if (write(fd, s, strlen(s)) < 0) perror("write");
+}
+
+struct Stats {
+  uint64_t frames = 0, ppg = 0, imu = 0, env = 0, status = 0;
+  uint64_t lost = 0, gaps = 0;
+  bool     have_seq = false;
+  uint16_t last_seq = 0;
+  uint32_t dev_frames = 0, dev_dropped = 0, dev_bytes = 0;
+};
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s <tty|dump> <out.scap> [--csv prefix]\n", argv[0]);
+    return 2;
+  }
+  const char* csv = (argc >= 5 && !strcmp(argv[3], "--csv")) ? argv[4] : nullptr;
+
+  int fd = open(argv[1], O_RDWR | O_NOCTTY);
+  if (fd < 0) { perror(argv[1]); return 1; }
+  bool tty = isatty(fd) && tty_raw(fd);
+
+  FILE* out = fopen(argv[2], "wb");
+  if (!out || !scap_write_header(out)) { perror(argv[2]); return 1; }
+  FILE *fppg = nullptr, *fimu = nullptr, *fenv = nullptr;
+  if (csv) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s_ppg.csv", csv); fppg = fopen(path, "w");
+    snprintf(path, sizeof(path), "%s_imu.csv", csv); fimu = fopen(path, "w");
+    snprintf(path, sizeof(path), "%s_env.csv", csv); fenv = fopen(path, "w");
+    if (!fppg || !fimu || !fenv) { perror("csv"); return 1; }
+    fprintf(fppg, "t_us,ir,red\n");
+    fprintf(fimu, "t_us,ax,ay,az,gx,gy,gz\n");
+    fprintf(fenv, "t_us,t_c,rh,hpa,skin_c\n");
+  }
+
+  signal(SIGINT, on_sigint);
+  if (tty) { tcflush(fd, TCIFLUSH); send_cmd(fd, "{\"capture\":1}\n"); }
+
+  static FrameReader rd;
+  Stats st;
+  time_t last_report = time(nullptr);
+
+  auto on_frame = [&](const FrameHdr& h, const uint8_t* p, size_t n) {
+    if (h.chan != FRAME_CH_CAPTURE) return;
+    if (st.have_seq) {
+      uint16_t d = (uint16_t)(h.seq - st.last_seq - 1);
+      if (d) { st.gaps++; st.lost += d; }
+    }
+    st.have_seq = true; st.last_seq = h.seq;
+    st.frames++;
+    scap_write(out, h, p, n);
+
+    if ((h.type == CAP_PPG || h.type == CAP_IMU) && n >= 4) {
+      uint32_t per = frame_get16(p) * 10u;
+      uint16_t cnt = frame_get16(p + 2);
+      size_t stride = h.type == CAP_PPG ? 8 : 24;
+      if (4 + cnt * stride > n) return;
+      for (uint16_t i = 0; i < cnt; ++i) {
+        const uint8_t* s = p + 4 + i * stride;
+        uint32_t t = h.t_us + i * per;
+        if (h.type == CAP_PPG) {
+          st.ppg++;
+          if (fppg) fprintf(fppg, "%u,%u,%u\n", t, frame_get32(s), frame_get32(s + 4));
+        } else {
+          st.imu++;
+          float v[6]; memcpy(v, s, sizeof(v));
+          if (fimu) fprintf(fimu, "%u,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f\n", t, v[0], v[1], v[2], v[3], v[4], v[5]);
+        }
+      }
+    } else if (h.type == CAP_ENV && n >= 16) {
+      st.env++;
+      float v[4]; memcpy(v, p, sizeof(v));
+      if (fenv) fprintf(fenv, "%u,%.2f,%.2f,%.2f,%.2f\n", h.t_us, v[0], v[1], v[2], v[3]);
+    } else if (h.type == CAP_STATUS && n >= 12) {
+      st.status++;
+      st.dev_frames = frame_get32(p); st.dev_dropped = frame_get32(p + 4); st.dev_bytes = frame_get32(p + 8);
+    }
+  };
+
+  uint8_t buf[4096];
+  while (!stop) {
+    ssize_t r = read(fd, buf, sizeof(buf));
+    if (r < 0) { perror("read"); break; }
+    if (r == 0) { if (!tty) break; continue; }
+    rd.push(buf, (size_t)r, on_frame);
+
+    time_t now = time(nullptr);
+    if (tty && now != last_report) {
+      last_report = now;
+      fprintf(stderr, "\rframes=%llu ppg=%llu imu=%llu lost=%llu crc=%u dev_dropped=%u   ",
+              (unsigned long long)st.frames, (unsigned long long)st.ppg, (unsigned long long)st.imu,
+              (unsigned long long)st.lost, rd.crc_errors, st.dev_dropped);
+    }
+  }
+
+  if (tty) {
+    send_cmd(fd, "{\"capture\":0}\n");
+    // pick up the flushed partial blocks and the final status frame
+    for (int i = 0; i < 5; ++i) {
+      ssize_t r = read(fd, buf, sizeof(buf));
+      if (r > 0) rd.push(buf, (size_t)r, on_frame);
+    }
+  }
+  close(fd);
+  fclose(out);
+  if (fppg) fclose(fppg);
+  if (fimu) fclose(fimu);
+  if (fenv) fclose(fenv);
+
+  fprintf(stderr, "\nframes %llu (ppg samples %llu, imu samples %llu, env %llu, status %llu)\n",
+          (unsigned long long)st.frames, (unsigned long long)st.ppg,
+          (unsigned long long)st.imu, (unsigned long long)st.env, (unsigned long long)st.status);
+  fprintf(stderr, "sequence gaps %llu, frames lost %llu (device dropped %u of %u)\n",
+          (unsigned long long)st.gaps, (unsigned long long)st.lost, st.dev_dropped,
+          st.dev_frames + st.dev_dropped);
+  fprintf(stderr, "crc errors %u, non-frame bytes %u\n", rd.crc_errors, rd.junk);
+  return (st.lost || rd.crc_errors) ? 3 : 0;
+}
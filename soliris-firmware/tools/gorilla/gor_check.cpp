@@ -0,0 +1,131 @@
+// Host decoder and self-test for the compressed history batches (include/gorilla.h).
+//
+//   g++ -O2 -std=c++17 -I../../include gor_check.cpp -o gor_check
+//   ./gor_check batch.bin            decode a batch to CSV on stdout
+//   ./gor_check --selftest [N]       N random batches: exact round trip, then
+//                                    truncated / bit-flipped copies must be
+//                                    rejected or decode within bounds
+//
+// Build with -fsanitize=address,undefined to turn the mutation pass into a
+// memory-safety check of the decoder. Exit status 1 on any failure.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <random>
+#include "gorilla.h"
+
+struct Table {
+  int ncols = 0, nflags = 0, nrows = 0;
+  std::vector<uint32_t> ts;
+  std::vector<float>    vs;         // row-major, ncols per row
+  std::vector<uint8_t>  fs;         // row-major, nflags per row
+  void resize(int r, int c, int fl) {
+    nrows = r; ncols = c; nflags = fl;
+    ts.assign(r, 0); vs.assign((size_t)r * c, 0); fs.assign((size_t)r * fl, 0);
+  }
+  // encoder source
+  uint32_t t(uint16_t i)               { return ts[i]; }
+  float    v(uint16_t i, uint8_t c)    { return vs[(size_t)i * ncols + c]; }
+  bool     flag(uint16_t i, uint8_t k) { return fs[(size_t)i * nflags + k]; }
+  // decoder sink (a decoder bug must not write out of range)
+  void t(uint16_t i, uint32_t x)           { if (i < nrows) ts[i] = x; else abort(); }
+  void v(uint16_t i, uint8_t c, float x)   { if (i < nrows && c < ncols) vs[(size_t)i * ncols + c] = x; else abort(); }
+  void flag(uint16_t i, uint8_t k, bool b) { if (i < nrows && k < nflags) fs[(size_t)i * nflags + k] = b; else abort(); }
+};
+
+static bool decode(const uint8_t* b, size_t n, GorHeader& h, Table& out) {
+  if (n < GOR_HDR_LEN) return false;
+  out.resize(b[6] | (b[7] << 8), b[4] > GOR_MAX_COLS ? 0 : b[4], b[5] > GOR_MAX_FLAGS ? 0 : b[5]);
+  return gor_decode(b, n, h, out);
+}
+
+static int dump(const char* path) {
+  FILE* fp = fopen(path, "rb");
+  if (!fp) { perror(path); return 1; }
+  std::vector<uint8_t> buf;
+  uint8_t tmp[4096]; size_t k;
+  while ((k = fread(tmp, 1, sizeof(tmp), fp)) > 0) buf.insert(buf.end(), tmp, tmp + k);
+  fclose(fp);
+  GorHeader h; Table tb;
+  if (!decode(buf.data(), buf.size(), h, tb)) { fprintf(stderr, "%s: malformed batch\n", path); return 1; }
+  printf("t,%s\n", h.names);
+  for (int i = 0; i < tb.nrows; ++i) {
+    printf("%u", tb.ts[i]);
+    for (int c = 0; c < tb.ncols; ++c) {
+      float x = tb.vs[(size_t)i * tb.ncols + c];
+      if (isnan(x)) printf(","); else printf(",%g", x);
+    }
+    for (int k = 0; k < tb.nflags; ++k) printf(",%d", tb.fs[(size_t)i * tb.nflags + k]);
+    printf("\n");
+  }
+  fprintf(stderr, "%d rows, %zu bytes (%.2f bytes/row), %s time\n", tb.nrows, buf.size(),
+          tb.nrows ? (double)buf.size() / tb.nrows : 0.0, (h.flags & GOR_F_EPOCH) ? "epoch" : "uptime");
+  return 0;
+}
+
+// Sensor-like columns: slow random walks on a quantization grid, NAN gaps,
+// constant columns, occasional raw noise and timestamp gaps.
+static void random_table(std::mt19937& rng, Table& tb) {
+  std::uniform_int_distribution<int> rows(0, 2000), cols(1, 16), flags(0, GOR_MAX_FLAGS);
+  std::uniform_real_distribution<float> u(0, 1);
+  tb.resize(rows(rng), cols(rng), flags(rng));
+  uint32_t t = rng();
+  for (int i = 0; i < tb.nrows; ++i) {
+    tb.ts[i] = t;
+    float p = u(rng);
+    t += p < 0.9f ? 1 : p < 0.97f ? 1 + (rng() % 100) : 1 + (rng() % 100000);
+  }
+  for (int c = 0; c < tb.ncols; ++c) {
+    int kind = rng() % 4;
+    float x = u(rng) * 100, q = (rng() % 2) ? 0.5f : 0.01f;
+    for (int i = 0; i < tb.nrows; ++i) {
+      if (kind == 1) x += (u(rng) - 0.5f) * 2;                 // raw noise
+      else if (kind == 2 && u(rng) < 0.1f) x += (u(rng) < 0.5f ? q : -q);
+      float y = kind == 1 ? x : roundf(x / q) * q;
+      if (kind == 3 || u(rng) < 0.02f) y = NAN;
+      tb.vs[(size_t)i * tb.ncols + c] = y;
+    }
+  }
+  for (int k = 0; k < tb.nflags; ++k) {
+    bool b = rng() & 1;
+    for (int i = 0; i < tb.nrows; ++i) { if (u(rng) < 0.02f) b = !b; tb.fs[(size_t)i * tb.nflags + k] = b; }
+  }
+}
+
+static int selftest(int n) {
+  std::mt19937 rng(12345);
+  std::vector<uint8_t> buf(1 << 20);
+  int fails = 0; size_t raw = 0, packed = 0;
+  for (int it = 0; it < n; ++it) {
+    Table a; random_table(rng, a);
+    std::string names;
+    for (int i = 0; i < a.ncols + a.nflags; ++i) names += (i ? ",c" : "c") + std::to_string(i);
+    GorSpec s = { 0, (uint8_t)a.ncols, (uint8_t)a.nflags, (uint16_t)a.nrows, names.c_str() };
+    size_t len = gor_encode(buf.data(), buf.size(), s, a);
+    GorHeader h; Table b;
+    bool ok = len && decode(buf.data(), len, h, b) && b.nrows == a.nrows && b.ts == a.ts && b.fs == a.fs
+              && !memcmp(a.vs.data(), b.vs.data(), a.vs.size() * sizeof(float)) && names == h.names;
+    if (!ok) { fprintf(stderr, "round trip %d failed (rows=%d cols=%d flags=%d)\n", it, a.nrows, a.ncols, a.nflags); fails++; continue; }
+    raw += (size_t)a.nrows * (4 + 4 * a.ncols + a.nflags); packed += len;
+
+    // truncated copies: any outcome but a crash or out-of-range write
+    // (a cut inside the last byte's padding can still decode)
+    for (size_t cut = 0; cut < len; cut += 1 + len / 16) decode(buf.data(), cut, h, b);
+    // bit flips: any outcome but a crash or out-of-range write
+    std::vector<uint8_t> m(buf.begin(), buf.begin() + len);
+    for (int k = 0; k < 8; ++k) {
+      m[rng() % len] ^= (uint8_t)(1u << (rng() % 8));
+      decode(m.data(), m.size(), h, b);
+    }
+  }
+  printf("{\"selftest\":%d,\"fail\":%d,\"ratio\":%.2f}\n", n, fails, packed ? (double)raw / packed : 0.0);
+  return fails ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc >= 2 && !strcmp(argv[1], "--selftest")) return selftest(argc >= 3 ? atoi(argv[2]) : 1000);
+  if (argc != 2) { fprintf(stderr, "usage: %s batch.bin | --selftest [N]\n", argv[0]); return 2; }
+  return dump(argv[1]);
+}
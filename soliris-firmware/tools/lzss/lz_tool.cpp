@@ -0,0 +1,122 @@
+// Host side of the uplink / BLE compression (include/lzss.h).
+//
+//   g++ -O2 -std=c++17 -I../../include lz_tool.cpp -o lz_tool
+//   ./lz_tool bench session.log     ratio vs CPU on recorded telemetry
+//   ./lz_tool c < in > out.lz       compress stdin (one stream, one flush)
+//   ./lz_tool d < in.lz > out       decompress stdin
+//
+// bench keeps the JSON lines of a serial log (ingest_serial.py input,
+// `pio device monitor` capture, ...) and replays them the way the device
+// sends them: as 6 kB upload batches (one stream per batch) and as one
+// BLE stream flushed after every line, for each match-search depth.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include "lzss.h"
+
+#define BATCH_BYTES 6144                  // UPL_BATCH_BYTES
+
+static double now_ns() {
+  timespec ts; clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static std::vector<uint8_t> read_all(FILE* f) {
+  std::vector<uint8_t> v;
+  uint8_t buf[4096]; size_t k;
+  while ((k = fread(buf, 1, sizeof(buf), f)) > 0) v.insert(v.end(), buf, buf + k);
+  return v;
+}
+
+static LzEnc enc;
+static LzDec dec;
+
+static int bench(const char* path) {
+  FILE* f = fopen(path, "rb");
+  if (!f) { perror(path); return 1; }
+  std::vector<std::string> lines;
+  char line[4096];
+  while (fgets(line, sizeof(line), f)) {
+    size_t n = strcspn(line, "\r\n");
+    if (n && line[0] == '{' && line[n - 1] == '}') lines.emplace_back(line, n);
+  }
+  fclose(f);
+  if (lines.empty()) { fprintf(stderr, "%s: no JSON lines\n", path); return 1; }
+
+  std::vector<std::string> batches(1, "[");
+  for (const std::string& l : lines) {
+    if (batches.back().size() > 1 && batches.back().size() + l.size() + 2 > BATCH_BYTES) {
+      batches.back() += ']'; batches.emplace_back("[");
+    }
+    if (batches.back().size() > 1) batches.back() += ',';
+    batches.back() += l;
+  }
+  batches.back() += ']';
+  size_t raw_b = 0, raw_s = 0;
+  for (const std::string& b : batches) raw_b += b.size();
+  for (const std::string& l : lines) raw_s += l.size() + 1;
+
+  printf("%zu lines, %zu batches\n", lines.size(), batches.size());
+  printf("depth  batch_ratio  batch_ns/B  ble_ratio  ble_ns/B\n");
+  const uint8_t depths[] = { 1, 2, 4, 8, 16, 32, 64 };
+  for (uint8_t d : depths) {
+    size_t out = 0;
+    auto sink = [&](const uint8_t*, size_t m) { out += m; };
+    double t0 = now_ns();
+    for (const std::string& b : batches) {
+      lz_init(enc, d);
+      lz_write(enc, (const uint8_t*)b.data(), b.size(), sink);
+      lz_flush(enc, sink);
+    }
+    double t1 = now_ns();
+    size_t out_b = out; out = 0;
+    lz_init(enc, d);
+    for (const std::string& l : lines) {
+      lz_write(enc, (const uint8_t*)l.data(), l.size(), sink);
+      lz_write(enc, (const uint8_t*)"\n", 1, sink);
+      lz_flush(enc, sink);
+    }
+    double t2 = now_ns();
+    printf("%5u  %11.2f  %10.1f  %9.2f  %8.1f\n", d, (double)raw_b / out_b, (t1 - t0) / raw_b,
+           (double)raw_s / out, (t2 - t1) / raw_s);
+  }
+
+  // round trip of the default setting
+  std::vector<uint8_t> comp; std::string back;
+  lz_init(enc);
+  for (const std::string& l : lines) {
+    lz_write(enc, (const uint8_t*)l.data(), l.size(), [&](const uint8_t* p, size_t m) { comp.insert(comp.end(), p, p + m); });
+    lz_write(enc, (const uint8_t*)"\n", 1, [&](const uint8_t* p, size_t m) { comp.insert(comp.end(), p, p + m); });
+    lz_flush(enc, [&](const uint8_t* p, size_t m) { comp.insert(comp.end(), p, p + m); });
+  }
+  lz_dec_init(dec);
+  bool ok = lz_dec_feed(dec, comp.data(), comp.size(), [&](uint8_t b) { back += (char)b; });
+  std::string want;
+  for (const std::string& l : lines) { want += l; want += '\n'; }
+  printf("round trip: %s\n", ok && back == want ? "ok" : "FAIL");
+  return ok && back == want ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+  if (argc == 3 && !strcmp(argv[1], "bench")) return bench(argv[2]);
+  if (argc == 2 && !strcmp(argv[1], "c")) {
+    std::vector<uint8_t> in = read_all(stdin);
+    auto sink = [](const uint8_t* p, size_t m) { fwrite(p, 1, m, stdout); };
+    lz_init(enc);
+    lz_write(enc, in.data(), in.size(), sink);
+    lz_flush(enc, sink);
+    return 0;
+  }
+  if (argc == 2 && !strcmp(argv[1], "d")) {
+    std::vector<uint8_t> in = read_all(stdin);
+    lz_dec_init(dec);
+    bool ok = lz_dec_feed(dec, in.data(), in.size(), [](uint8_t b) { putchar(b); });
+    if (!ok) fprintf(stderr, "malformed stream\n");
+    return ok ? 0 : 1;
+  }
+  fprintf(stderr, "usage: %s bench <log> | c | d\n", argv[0]);
+  return 2;
+}
@@ -0,0 +1,140 @@
+// Host decoder for the firmware's serial channels (include/serial_chan.h).
+//
+//   g++ -O2 -std=c++17 -I../../include tlog_cat.cpp -o tlog_cat
+//   ./tlog_cat /dev/ttyACM0 [--no-telem] [--no-log] [--level N]
+//
+// Formats the tokenized log records (FRAME_CH_LOG) with the dictionary in
+// tlog_defs.h, reassembles the JSON telemetry lines (FRAME_CH_TELEM) and
+// passes plain text (the setup() banner before the framed channels) through:
+//
+//   [   12.345678] I [NET] POST http://... -> 200
+//   T {"ts":...}
+//   | [MODE] LIVE non-PI + SIM PI ...
+//
+// Log sequence gaps and the device's own drop counter are reported inline.
+// Passing a regular file instead of a tty decodes a raw byte dump offline.
+// The dictionary is compiled in: rebuild after adding tokens.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <string>
+#include "frame.h"
+#include "tlog.h"
+
+static volatile sig_atomic_t stop = 0;
+static void on_sigint(int) { stop = 1; }
+
+static bool tty_raw(int fd) {
+  termios t;
+  if (tcgetattr(fd, &t) != 0) return false;
+  cfmakeraw(&t);
+  cfsetispeed(&t, B115200); cfsetospeed(&t, B115200);   // ignored by USB CDC
+  t.c_cc[VMIN] = 0; t.c_cc[VTIME] = 1;
+  return tcsetattr(fd, TCSANOW, &t) == 0;
+}
+
+static const char LEVEL_CH[] = "EWID";
+
+struct Chan {
+  bool     have_seq = false;
+  uint16_t last_seq = 0;
+  uint64_t frames = 0, lost = 0;
+
+  // Returns the number of frames missing before this one.
+  uint16_t step(uint16_t seq) {
+    uint16_t d = have_seq ? (uint16_t)(seq - last_seq - 1) : 0;
+    have_seq = true; last_seq = seq; frames++; lost += d;
+    return d;
+  }
+};
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <tty|dump> [--no-telem] [--no-log] [--level 0-3]\n", argv[0]);
+    return 2;
+  }
+  bool show_tel = true, show_log = true;
+  int  max_level = TLOG_DEBUG;
+  for (int i = 2; i < argc; ++i) {
+    if (!strcmp(argv[i], "--no-telem"))                  show_tel = false;
+    else if (!strcmp(argv[i], "--no-log"))               show_log = false;
+    else if (!strcmp(argv[i], "--level") && i + 1 < argc) max_level = atoi(argv[++i]);
+  }
+
+  int fd = open(argv[1], O_RDONLY | O_NOCTTY);
+  if (fd < 0) { perror(argv[1]); return 1; }
+  bool tty = isatty(fd) && tty_raw(fd);
+  setvbuf(stdout, nullptr, _IOLBF, 0);
+  signal(SIGINT, on_sigint);
+
+  static FrameReader rd;
+  Chan        ch_log, ch_tel;
+  std::string tel_line, text;
+  uint32_t    dev_dropped = 0;
+  uint64_t    records = 0, bad = 0;
+
+  auto on_log = [&](const FrameHdr& h, const uint8_t* p, size_t n) {
+    if (uint16_t d = ch_log.step(h.seq)) printf("-- %u log frame(s) lost\n", d);
+    if (h.type != TLOG_RECORDS || n < 4) return;
+    uint32_t dd = frame_get32(p);
+    if (dd != dev_dropped) printf("-- %u record(s) dropped on the device\n", dd - dev_dropped);
+    dev_dropped = dd;
+    char line[TLOG_LINE_MAX];
+    for (size_t o = 4; o < n; ) {
+      size_t len = p[o];
+      if (len < TLOG_HDR_LEN || o + len > n || tlog_format(line, sizeof(line), p + o, len) < 0) { bad++; break; }
+      const TlogDef& def = TLOG_DEFS[frame_get16(p + o + 1)];
+      uint32_t t_us = frame_get32(p + o + 3);
+      records++;
+      o += len;
+      if (!show_log || def.level > max_level) continue;
+      printf("[%5u.%06u] %c %s\n", t_us / 1000000, t_us % 1000000, LEVEL_CH[def.level], line);
+    }
+  };
+
+  auto on_tel = [&](const FrameHdr& h, const uint8_t* p, size_t n) {
+    if (ch_tel.step(h.seq)) tel_line.clear();          // a lost part: drop the line
+    tel_line.append((const char*)p, n);
+    if (h.type != TEL_LINE) return;
+    if (show_tel) printf("T %s\n", tel_line.c_str());
+    tel_line.clear();
+  };
+
+  auto on_frame = [&](const FrameHdr& h, const uint8_t* p, size_t n) {
+    if (h.chan == FRAME_CH_LOG) on_log(h, p, n);
+    else if (h.chan == FRAME_CH_TELEM) on_tel(h, p, n);
+  };
+
+  auto on_text = [&](const uint8_t* p, size_t n) {
+    text.append((const char*)p, n);
+    size_t nl;
+    while ((nl = text.find('\n')) != std::string::npos) {
+      std::string l = text.substr(0, nl);
+      if (!l.empty() && l.back() == '\r') l.pop_back();
+      if (!l.empty()) printf("| %s\n", l.c_str());
+      text.erase(0, nl + 1);
+    }
+  };
+
+  uint8_t buf[4096];
+  while (!stop) {
+    ssize_t r = read(fd, buf, sizeof(buf));
+    if (r < 0) { perror("read"); break; }
+    if (r == 0) { if (!tty) break; continue; }
+    rd.push(buf, (size_t)r, on_frame, on_text);
+  }
+  close(fd);
+  if (rd.len && !rd.overflow && !FrameReader::looks_binary(rd.buf, rd.len)) on_text(rd.buf, rd.len);
+  if (!text.empty()) on_text((const uint8_t*)"\n", 1);   // text after the last frame
+
+  fprintf(stderr, "log: %llu records in %llu frames, %llu frames lost, %u dropped on the device, %llu malformed\n",
+          (unsigned long long)records, (unsigned long long)ch_log.frames, (unsigned long long)ch_log.lost,
+          dev_dropped, (unsigned long long)bad);
+  fprintf(stderr, "telemetry: %llu frames, %llu lost; crc errors %u\n",
+          (unsigned long long)ch_tel.frames, (unsigned long long)ch_tel.lost, rd.crc_errors);
+  return 0;
+}